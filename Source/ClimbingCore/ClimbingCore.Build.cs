@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class ClimbingCore : ModuleRules
+{
+	public ClimbingCore(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// The climbing rules, the analytic world and the captures only need Core: no UObjects, no engine.
+		// They build into the standalone ClimbingCoreTests program as well as the game
+		PublicDependencyModuleNames.AddRange(new string[] { "Core" });
+	}
+}
@@ -0,0 +1,404 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AnalyticClimbingWorld.h"
+
+namespace
+{
+	/** How far the top of a box may be from the height asked for a ledge */
+	const float LedgeHeightTolerance = 2.f;
+
+	/** How far from its rim a ledge is still found */
+	const float LedgeMaxRimDistance = 100.f;
+
+	/** Surfaces are box indices, shifted so that nullptr stays invalid */
+	const void* BoxIndexToSurface(int32 InIndex)
+	{
+		return reinterpret_cast<const void*>(static_cast<UPTRINT>(InIndex) + 1);
+	}
+
+	int32 SurfaceToBoxIndex(const void* InSurface)
+	{
+		return static_cast<int32>(reinterpret_cast<UPTRINT>(InSurface)) - 1;
+	}
+
+	/** Smallest axis to leave the box from an inside point */
+	FVector GetExitNormal(const FBox& InBox, const FVector& InPoint, float& OutDepth)
+	{
+		const float Distances[6] =
+		{
+			InPoint.X - InBox.Min.X, InBox.Max.X - InPoint.X,
+			InPoint.Y - InBox.Min.Y, InBox.Max.Y - InPoint.Y,
+			InPoint.Z - InBox.Min.Z, InBox.Max.Z - InPoint.Z
+		};
+		const FVector Normals[6] =
+		{
+			-FVector::ForwardVector, FVector::ForwardVector,
+			-FVector::RightVector, FVector::RightVector,
+			-FVector::UpVector, FVector::UpVector
+		};
+
+		int32 Best = 0;
+		for (int32 i = 1; i < 6; ++i)
+		{
+			if (Distances[i] < Distances[Best])
+			{
+				Best = i;
+			}
+		}
+
+		OutDepth = Distances[Best];
+		return Normals[Best];
+	}
+}
+
+int32 FAnalyticClimbingWorld::AddBox(const FBox& InBox)
+{
+	return Boxes.Add(InBox);
+}
+
+void FAnalyticClimbingWorld::Reset()
+{
+	Boxes.Reset();
+	NumQueries = 0;
+}
+
+EClimbingQueryStatus FAnalyticClimbingWorld::SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit)
+{
+	++NumQueries;
+
+	float Penetration;
+	return Overlap(InLocation, InRadius, InHalfHeight, OutHit, Penetration) ? EClimbingQueryStatus::Hit : EClimbingQueryStatus::Miss;
+}
+
+EClimbingQueryStatus FAnalyticClimbingWorld::TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits)
+{
+	++NumQueries;
+
+	// Everything blocks, so like a multi trace in the engine only the first hit is reported
+	FClimbingHit Hit;
+	if (!Raycast(InBegin, InEnd, Hit))
+	{
+		return EClimbingQueryStatus::Miss;
+	}
+
+	OutHits.Add(Hit);
+	return EClimbingQueryStatus::Hit;
+}
+
+EClimbingQueryStatus FAnalyticClimbingWorld::OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces)
+{
+	++NumQueries;
+
+	for (int32 BoxIndex = 0; BoxIndex < Boxes.Num(); ++BoxIndex)
+	{
+		const FBox& Box = Boxes[BoxIndex];
+		if (!Box.Intersect(InBounds))
+		{
+			continue;
+		}
+
+		FClimbingGrabSurface& Surface = OutSurfaces.AddDefaulted_GetRef();
+		Surface.Points.Add(FVector2D(Box.Min.X, Box.Min.Y));
+		Surface.Points.Add(FVector2D(Box.Max.X, Box.Min.Y));
+		Surface.Points.Add(FVector2D(Box.Max.X, Box.Max.Y));
+		Surface.Points.Add(FVector2D(Box.Min.X, Box.Max.Y));
+		Surface.TopZ = Box.Max.Z;
+		Surface.BottomZ = Box.Min.Z;
+		Surface.Surface = BoxIndexToSurface(BoxIndex);
+	}
+
+	return OutSurfaces.Num() > 0 ? EClimbingQueryStatus::Hit : EClimbingQueryStatus::Miss;
+}
+
+bool FAnalyticClimbingWorld::TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit)
+{
+	++NumQueries;
+
+	return Raycast(InStart, InEnd, OutHit);
+}
+
+bool FAnalyticClimbingWorld::FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge)
+{
+	int32 ClosestBox = INDEX_NONE;
+	float ClosestDistance = LedgeMaxRimDistance;
+
+	for (int32 BoxIndex = 0; BoxIndex < Boxes.Num(); ++BoxIndex)
+	{
+		const FBox& Box = Boxes[BoxIndex];
+		if (FMath::Abs(Box.Max.Z - InLocation.Z) > LedgeHeightTolerance)
+		{
+			continue;
+		}
+
+		// Distance to the rim, from inside or outside of the top face
+		const FVector2D Location(InLocation.X, InLocation.Y);
+		const FVector2D Outside(FMath::Max3(Box.Min.X - Location.X, 0.f, Location.X - Box.Max.X), 
+			FMath::Max3(Box.Min.Y - Location.Y, 0.f, Location.Y - Box.Max.Y));
+		const float Inside = FMath::Min(FMath::Min(Location.X - Box.Min.X, Box.Max.X - Location.X),
+			FMath::Min(Location.Y - Box.Min.Y, Box.Max.Y - Location.Y));
+		const float Distance = Outside.IsZero() ? Inside : Outside.Size();
+
+		if (Distance <= ClosestDistance)
+		{
+			ClosestDistance = Distance;
+			ClosestBox = BoxIndex;
+		}
+	}
+
+	if (ClosestBox == INDEX_NONE)
+	{
+		return false;
+	}
+
+	// Counter-clockwise from above
+	const FBox& Box = Boxes[ClosestBox];
+	OutLedge.Points.Reset();
+	OutLedge.Points.Add(FVector2D(Box.Min.X, Box.Min.Y));
+	OutLedge.Points.Add(FVector2D(Box.Max.X, Box.Min.Y));
+	OutLedge.Points.Add(FVector2D(Box.Max.X, Box.Max.Y));
+	OutLedge.Points.Add(FVector2D(Box.Min.X, Box.Max.Y));
+
+	OutLedge.Normals.Reset();
+	OutLedge.Normals.Add(FVector2D(0.f, -1.f));
+	OutLedge.Normals.Add(FVector2D(1.f, 0.f));
+	OutLedge.Normals.Add(FVector2D(0.f, 1.f));
+	OutLedge.Normals.Add(FVector2D(-1.f, 0.f));
+
+	OutLedge.TopZ = Box.Max.Z;
+	OutLedge.Surface = BoxIndexToSurface(ClosestBox);
+	OutLedge.Revision = 0;
+	return true;
+}
+
+bool FAnalyticClimbingWorld::IsSurfaceValid(const void* InSurface) const
+{
+	return Boxes.IsValidIndex(SurfaceToBoxIndex(InSurface));
+}
+
+FVector FAnalyticClimbingWorld::ResolvePenetration(FVector& InOutLocation, float InRadius, float InHalfHeight, FVector& OutNormal) const
+{
+	FVector TotalPush = FVector::ZeroVector;
+	OutNormal = FVector::ZeroVector;
+
+	// A few passes are enough for corners between two boxes
+	for (int32 Pass = 0; Pass < 4; ++Pass)
+	{
+		FClimbingHit Hit;
+		float Penetration;
+		if (!Overlap(InOutLocation, InRadius, InHalfHeight, Hit, Penetration))
+		{
+			break;
+		}
+
+		const FVector Push = Hit.ImpactNormal * (Penetration + KINDA_SMALL_NUMBER);
+		InOutLocation += Push;
+		TotalPush += Push;
+		OutNormal = Hit.ImpactNormal;
+	}
+
+	return TotalPush;
+}
+
+bool FAnalyticClimbingWorld::Raycast(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit) const
+{
+	const FVector Delta = InEnd - InStart;
+
+	float ClosestTime = 1.f;
+	int32 ClosestBox = INDEX_NONE;
+	FVector ClosestNormal = FVector::ZeroVector;
+
+	for (int32 BoxIndex = 0; BoxIndex < Boxes.Num(); ++BoxIndex)
+	{
+		const FBox& Box = Boxes[BoxIndex];
+
+		// Slabs
+		float EntryTime = 0.f;
+		float ExitTime = 1.f;
+		FVector EntryNormal = FVector::ZeroVector;
+		bool IsMissed = false;
+
+		for (int32 Axis = 0; Axis < 3 && !IsMissed; ++Axis)
+		{
+			if (FMath::Abs(Delta[Axis]) < KINDA_SMALL_NUMBER)
+			{
+				IsMissed = InStart[Axis] < Box.Min[Axis] || InStart[Axis] > Box.Max[Axis];
+				continue;
+			}
+
+			float Near = (Box.Min[Axis] - InStart[Axis]) / Delta[Axis];
+			float Far = (Box.Max[Axis] - InStart[Axis]) / Delta[Axis];
+			float Sign = -1.f;
+			if (Near > Far)
+			{
+				Swap(Near, Far);
+				Sign = 1.f;
+			}
+
+			if (Near > EntryTime)
+			{
+				EntryTime = Near;
+				EntryNormal = FVector::ZeroVector;
+				EntryNormal[Axis] = Sign;
+			}
+			ExitTime = FMath::Min(ExitTime, Far);
+			IsMissed = EntryTime > ExitTime;
+		}
+
+		// Segments starting inside a box don't hit it, same as the engine's traces
+		if (IsMissed || EntryNormal.IsZero() || EntryTime >= ClosestTime)
+		{
+			continue;
+		}
+
+		ClosestTime = EntryTime;
+		ClosestBox = BoxIndex;
+		ClosestNormal = EntryNormal;
+	}
+
+	if (ClosestBox == INDEX_NONE)
+	{
+		return false;
+	}
+
+	OutHit = MakeHit(ClosestBox, InStart + Delta * ClosestTime, ClosestNormal);
+	return true;
+}
+
+bool FAnalyticClimbingWorld::Overlap(const FVector& InLocation, float InRadius, float InHalfHeight, FClimbingHit& OutHit, float& OutPenetration) const
+{
+	const float SegmentHalfLength = FMath::Max(InHalfHeight - InRadius, 0.f);
+	const float SegmentBottom = InLocation.Z - SegmentHalfLength;
+	const float SegmentTop = InLocation.Z + SegmentHalfLength;
+
+	OutPenetration = 0.f;
+	bool HasHit = false;
+
+	for (int32 BoxIndex = 0; BoxIndex < Boxes.Num(); ++BoxIndex)
+	{
+		const FBox& Box = Boxes[BoxIndex];
+
+		// Closest points of a vertical segment and a box
+		float SegmentZ, BoxZ;
+		if (SegmentTop < Box.Min.Z)
+		{
+			SegmentZ = SegmentTop;
+			BoxZ = Box.Min.Z;
+		}
+		else if (SegmentBottom > Box.Max.Z)
+		{
+			SegmentZ = SegmentBottom;
+			BoxZ = Box.Max.Z;
+		}
+		else
+		{
+			SegmentZ = BoxZ = FMath::Clamp(InLocation.Z, FMath::Max(SegmentBottom, Box.Min.Z), FMath::Min(SegmentTop, Box.Max.Z));
+		}
+
+		const FVector BoxPoint(FMath::Clamp(InLocation.X, Box.Min.X, Box.Max.X), FMath::Clamp(InLocation.Y, Box.Min.Y, Box.Max.Y), BoxZ);
+		const FVector SegmentPoint(InLocation.X, InLocation.Y, SegmentZ);
+		const FVector Separation = SegmentPoint - BoxPoint;
+		const float Distance = Separation.Size();
+
+		float Penetration;
+		FVector Normal;
+		if (Distance > KINDA_SMALL_NUMBER)
+		{
+			Penetration = InRadius - Distance;
+			Normal = Separation / Distance;
+		}
+		else
+		{
+			float Depth;
+			Normal = GetExitNormal(Box, SegmentPoint, Depth);
+			Penetration = InRadius + Depth;
+		}
+
+		if (Penetration <= 0.f || Penetration <= OutPenetration)
+		{
+			continue;
+		}
+
+		OutPenetration = Penetration;
+		OutHit = MakeHit(BoxIndex, BoxPoint, Normal);
+		HasHit = true;
+	}
+
+	return HasHit;
+}
+
+FClimbingHit FAnalyticClimbingWorld::MakeHit(int32 InBoxIndex, const FVector& InPoint, const FVector& InNormal) const
+{
+	FClimbingHit Hit;
+	Hit.ImpactPoint = InPoint;
+	Hit.ImpactNormal = InNormal;
+	Hit.SurfaceTopZ = Boxes[InBoxIndex].Max.Z;
+	Hit.Surface = BoxIndexToSurface(InBoxIndex);
+	return Hit;
+}
+
+FAnalyticClimbingBody::FAnalyticClimbingBody(const FAnalyticClimbingWorld& InWorld)
+	: World(InWorld)
+{
+}
+
+void FAnalyticClimbingBody::GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const
+{
+	OutRadius = Radius;
+	OutHalfHeight = HalfHeight;
+}
+
+void FAnalyticClimbingBody::LaunchClimbMovement(const FVector& InVelocity)
+{
+	Flying = true;
+	Grounded = false;
+	Velocity = InVelocity;
+}
+
+void FAnalyticClimbingBody::ExitClimbMovement()
+{
+	Flying = false;
+}
+
+void FAnalyticClimbingBody::Step(float InDeltaTime)
+{
+	if (!Flying && !Grounded)
+	{
+		Velocity.Z += GravityZ * InDeltaTime;
+	}
+
+	Location += Velocity * InDeltaTime;
+
+	FVector ContactNormal;
+	const FVector Push = World.ResolvePenetration(Location, Radius, HalfHeight, ContactNormal);
+
+	// Walls stop the velocity going into them, floors stop the fall
+	if (!Push.IsNearlyZero())
+	{
+		const float IntoContact = FVector::DotProduct(Velocity, ContactNormal);
+		if (IntoContact < 0.f)
+		{
+			Velocity -= ContactNormal * IntoContact;
+		}
+	}
+
+	const bool WasGrounded = Grounded;
+	Grounded = ContactNormal.Z >= WalkableFloorZ;
+
+	// Stay on the floor while walking, it's only touched every other step otherwise
+	if (!Flying && WasGrounded && !Grounded)
+	{
+		FVector ProbeLocation = Location - FVector(0.f, 0.f, 2.f);
+		FVector ProbeNormal;
+		if (!World.ResolvePenetration(ProbeLocation, Radius, HalfHeight, ProbeNormal).IsNearlyZero() && ProbeNormal.Z >= WalkableFloorZ)
+		{
+			Location = ProbeLocation;
+			Grounded = true;
+		}
+	}
+
+	if (Grounded && !Flying)
+	{
+		Velocity = FVector::ZeroVector;
+	}
+}
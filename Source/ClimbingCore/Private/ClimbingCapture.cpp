@@ -0,0 +1,700 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingCapture.h"
+#include "HAL/PlatformFilemanager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/Paths.h"
+#include "Async/MappedFileHandle.h"
+#include "Serialization/BufferReader.h"
+#include "Misc/Crc.h"
+
+namespace
+{
+	/** Records are appended to the file once the buffer holds that many bytes */
+	const int32 CaptureFlushSize = 64 * 1024;
+
+	/** Same as what FaceBody implementations do, the recorder and the replay have to agree on it */
+	FQuat GetFacingRotation(const FVector& InDirection)
+	{
+		return FRotator(0.f, FMath::RadiansToDegrees(FMath::Atan2(InDirection.Y, InDirection.X)), 0.f).Quaternion();
+	}
+}
+
+bool FClimbingCaptureBody::operator==(const FClimbingCaptureBody& Other) const
+{
+	return Location == Other.Location && Rotation == Other.Rotation && ChestHeight == Other.ChestHeight
+		&& Radius == Other.Radius && HalfHeight == Other.HalfHeight && WalkableFloorZ == Other.WalkableFloorZ;
+}
+
+FArchive& operator<<(FArchive& Ar, FClimbingCaptureBody& InOutBody)
+{
+	Ar << InOutBody.Location;
+	Ar << InOutBody.Rotation;
+	Ar << InOutBody.ChestHeight;
+	Ar << InOutBody.Radius;
+	Ar << InOutBody.HalfHeight;
+	Ar << InOutBody.WalkableFloorZ;
+	return Ar;
+}
+
+uint32 ClimbingCapture::HashState(FClimbingCore& InCore, FClimbingCaptureBody& InBody, TArray<uint8>& InOutScratch)
+{
+	InOutScratch.Reset();
+	FMemoryWriter Writer(InOutScratch);
+	InCore.SerializeState(Writer);
+	Writer << InBody.Location;
+	Writer << InBody.Rotation;
+
+	return FCrc::MemCrc32(InOutScratch.GetData(), InOutScratch.Num());
+}
+
+FClimbingCaptureRecorder::FClimbingCaptureRecorder(IClimbingBody& InBody, IClimbingCollision& InCollision)
+	: Body(InBody)
+	, Collision(InCollision)
+	, Writer(Buffer)
+{
+}
+
+FClimbingCaptureRecorder::~FClimbingCaptureRecorder()
+{
+	Close();
+}
+
+bool FClimbingCaptureRecorder::Open(const FString& InPath, FClimbingCore& InCore)
+{
+	Close();
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(InPath));
+
+	File = PlatformFile.OpenWrite(*InPath);
+	if (!File)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Can't create %s."), *FString(__FUNCTION__), *InPath);
+		return false;
+	}
+
+	uint32 Magic = ClimbingCapture::Magic;
+	uint32 Version = ClimbingCapture::Version;
+	Writer << Magic;
+	Writer << Version;
+	InCore.SerializeState(Writer);
+
+	LastSettings.Reset();
+	FMemoryWriter SettingsWriter(LastSettings);
+	SettingsWriter << InCore.Settings;
+
+	HasCallBody = false;
+	Flush();
+	return true;
+}
+
+void FClimbingCaptureRecorder::Close()
+{
+	if (!File)
+	{
+		return;
+	}
+
+	Flush();
+	delete File;
+	File = nullptr;
+}
+
+void FClimbingCaptureRecorder::RecordFrame(float InDeltaTime)
+{
+	WriteTag(EClimbingCaptureRecord::Frame);
+	Writer << InDeltaTime;
+}
+
+void FClimbingCaptureRecorder::BeginCall(EClimbingCaptureRecord InCall, FClimbingCore& InCore)
+{
+	// The body moved on its own since the last call, e.g. with the character movement
+	const FClimbingCaptureBody CurrentBody = ReadBody();
+	if (!HasCallBody || !(CurrentBody == CallBody))
+	{
+		CallBody = CurrentBody;
+		HasCallBody = true;
+		WriteTag(EClimbingCaptureRecord::Body);
+		Writer << CallBody;
+	}
+
+	SettingsScratch.Reset();
+	FMemoryWriter SettingsWriter(SettingsScratch);
+	SettingsWriter << InCore.Settings;
+	if (SettingsScratch != LastSettings)
+	{
+		Swap(LastSettings, SettingsScratch);
+		WriteTag(EClimbingCaptureRecord::Settings);
+		Writer << InCore.Settings;
+	}
+
+	WriteTag(InCall);
+	IsInCall = true;
+}
+
+void FClimbingCaptureRecorder::EndCall(FClimbingCore& InCore)
+{
+	IsInCall = false;
+
+	uint32 Hash = ClimbingCapture::HashState(InCore, CallBody, HashScratch);
+	WriteTag(EClimbingCaptureRecord::Check);
+	Writer << Hash;
+
+	if (Buffer.Num() >= CaptureFlushSize)
+	{
+		Flush();
+	}
+}
+
+FClimbingCaptureBody FClimbingCaptureRecorder::ReadBody() const
+{
+	FClimbingCaptureBody Result;
+	Result.Location = Body.GetBodyLocation();
+	Result.Rotation = Body.GetBodyRotation();
+	Result.ChestHeight = Body.GetBodyChestZ() - Result.Location.Z;
+	Body.GetBodyCapsuleSize(Result.Radius, Result.HalfHeight);
+	Result.WalkableFloorZ = Body.GetBodyWalkableFloorZ();
+	return Result;
+}
+
+void FClimbingCaptureRecorder::WriteTag(EClimbingCaptureRecord InRecord) const
+{
+	uint8 Tag = (uint8)InRecord;
+	Writer << Tag;
+}
+
+void FClimbingCaptureRecorder::Flush() const
+{
+	if (File && Buffer.Num() > 0)
+	{
+		File->Write(Buffer.GetData(), Buffer.Num());
+	}
+
+	Buffer.Reset();
+	Writer.Seek(0);
+}
+
+// The core only sees the body as it was at the start of the call, plus its own moves, the replay can't know better
+
+FVector FClimbingCaptureRecorder::GetBodyLocation() const
+{
+	return IsInCall ? CallBody.Location : Body.GetBodyLocation();
+}
+
+FQuat FClimbingCaptureRecorder::GetBodyRotation() const
+{
+	return IsInCall ? CallBody.Rotation : Body.GetBodyRotation();
+}
+
+float FClimbingCaptureRecorder::GetBodyChestZ() const
+{
+	return IsInCall ? CallBody.Location.Z + CallBody.ChestHeight : Body.GetBodyChestZ();
+}
+
+void FClimbingCaptureRecorder::GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const
+{
+	if (IsInCall)
+	{
+		OutRadius = CallBody.Radius;
+		OutHalfHeight = CallBody.HalfHeight;
+		return;
+	}
+
+	Body.GetBodyCapsuleSize(OutRadius, OutHalfHeight);
+}
+
+float FClimbingCaptureRecorder::GetBodyWalkableFloorZ() const
+{
+	return IsInCall ? CallBody.WalkableFloorZ : Body.GetBodyWalkableFloorZ();
+}
+
+void FClimbingCaptureRecorder::LaunchClimbMovement(const FVector& InVelocity)
+{
+	Body.LaunchClimbMovement(InVelocity);
+}
+
+void FClimbingCaptureRecorder::ExitClimbMovement()
+{
+	Body.ExitClimbMovement();
+}
+
+void FClimbingCaptureRecorder::StopBodyMovement()
+{
+	Body.StopBodyMovement();
+}
+
+void FClimbingCaptureRecorder::OffsetBody(const FVector& InDelta)
+{
+	Body.OffsetBody(InDelta);
+	CallBody.Location += InDelta;
+}
+
+void FClimbingCaptureRecorder::SetBodyLocation(const FVector& InLocation)
+{
+	Body.SetBodyLocation(InLocation);
+	CallBody.Location = InLocation;
+}
+
+void FClimbingCaptureRecorder::FaceBody(const FVector& InDirection)
+{
+	Body.FaceBody(InDirection);
+	CallBody.Rotation = GetFacingRotation(InDirection);
+}
+
+EClimbingQueryStatus FClimbingCaptureRecorder::SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit)
+{
+	EClimbingQueryStatus Status = Collision.SweepCapsule(InLocation, InRotation, InRadius, InHalfHeight, OutHit);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::SweepCapsule);
+		Writer << Status;
+		Writer << OutHit;
+	}
+	return Status;
+}
+
+EClimbingQueryStatus FClimbingCaptureRecorder::TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits)
+{
+	const int32 FirstHit = OutHits.Num();
+	EClimbingQueryStatus Status = Collision.TraceDown(InBegin, InEnd, InMinZ, InWall, OutHits);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::TraceDown);
+		Writer << Status;
+
+		int32 NumHits = OutHits.Num() - FirstHit;
+		Writer << NumHits;
+		for (int32 i = FirstHit; i < OutHits.Num(); ++i)
+		{
+			Writer << OutHits[i];
+		}
+	}
+	return Status;
+}
+
+bool FClimbingCaptureRecorder::TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit)
+{
+	bool HasHit = Collision.TraceWall(InStart, InEnd, InMaxDepth, OutHit);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::TraceWall);
+		Writer << HasHit;
+		Writer << OutHit;
+	}
+	return HasHit;
+}
+
+EClimbingQueryStatus FClimbingCaptureRecorder::TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit)
+{
+	EClimbingQueryStatus Status = Collision.TraceScanRay(InStart, InEnd, OutHit);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::TraceScanRay);
+		Writer << Status;
+		Writer << OutHit;
+	}
+	return Status;
+}
+
+bool FClimbingCaptureRecorder::FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge)
+{
+	bool HasLedge = Collision.FindLedge(InLocation, InWall, OutLedge);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::FindLedge);
+		Writer << HasLedge;
+		Writer << OutLedge;
+	}
+	return HasLedge;
+}
+
+bool FClimbingCaptureRecorder::IsLedgeCurrent(const FClimbingLedge& InLedge) const
+{
+	bool IsCurrent = Collision.IsLedgeCurrent(InLedge);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::IsLedgeCurrent);
+		Writer << IsCurrent;
+	}
+	return IsCurrent;
+}
+
+bool FClimbingCaptureRecorder::IsSurfaceValid(const void* InSurface) const
+{
+	bool IsValid = Collision.IsSurfaceValid(InSurface);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::IsSurfaceValid);
+		Writer << IsValid;
+	}
+	return IsValid;
+}
+
+bool FClimbingCaptureRecorder::GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const
+{
+	bool HasTransform = Collision.GetSurfaceTransform(InSurface, OutTransform);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::GetSurfaceTransform);
+		Writer << HasTransform;
+		Writer << OutTransform;
+	}
+	return HasTransform;
+}
+
+bool FClimbingCaptureRecorder::SupportsGrabSurfaces() const
+{
+	bool IsSupported = Collision.SupportsGrabSurfaces();
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::SupportsGrabSurfaces);
+		Writer << IsSupported;
+	}
+	return IsSupported;
+}
+
+EClimbingQueryStatus FClimbingCaptureRecorder::OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces)
+{
+	const int32 FirstSurface = OutSurfaces.Num();
+	EClimbingQueryStatus Status = Collision.OverlapGrabSurfaces(InBounds, InWall, OutSurfaces);
+	if (IsInCall)
+	{
+		WriteTag(EClimbingCaptureRecord::OverlapGrabSurfaces);
+		Writer << Status;
+
+		int32 NumSurfaces = OutSurfaces.Num() - FirstSurface;
+		Writer << NumSurfaces;
+		for (int32 i = FirstSurface; i < OutSurfaces.Num(); ++i)
+		{
+			Writer << OutSurfaces[i];
+		}
+	}
+	return Status;
+}
+
+void FClimbingCaptureRecorder::CancelPendingQueries()
+{
+	Collision.CancelPendingQueries();
+}
+
+FClimbingCaptureReplay::FClimbingCaptureReplay()
+{
+}
+
+FClimbingCaptureReplay::~FClimbingCaptureReplay()
+{
+	// The reader and the core point into the mapping
+	Core.Reset();
+	Reader.Reset();
+	MappedRegion.Reset();
+	MappedFile.Reset();
+}
+
+bool FClimbingCaptureReplay::Open(const FString& InPath)
+{
+	MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*InPath));
+	MappedRegion.Reset(MappedFile ? MappedFile->MapRegion() : nullptr);
+	if (!MappedRegion)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Can't map %s."), *FString(__FUNCTION__), *InPath);
+		return false;
+	}
+
+	Reader = MakeUnique<FBufferReader>(const_cast<uint8*>(MappedRegion->GetMappedPtr()), MappedRegion->GetMappedSize(), false);
+
+	uint32 Magic = 0;
+	uint32 Version = 0;
+	*Reader << Magic;
+	*Reader << Version;
+	if (Magic != ClimbingCapture::Magic || Version != ClimbingCapture::Version)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] %s is not a climbing capture of version %u."), *FString(__FUNCTION__), *InPath, ClimbingCapture::Version);
+		return false;
+	}
+
+	Core = MakeUnique<FClimbingCore>(*this, *this);
+	Core->SerializeState(*Reader);
+	CallBody = FClimbingCaptureBody();
+	IsOffTrack = false;
+
+	return !Reader->IsError();
+}
+
+FClimbingCaptureReplayResult FClimbingCaptureReplay::Run(int64 InMaxFrames, bool InStopOnMismatch)
+{
+	FClimbingCaptureReplayResult Result;
+	if (!(Reader && Core))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] No capture is open."), *FString(__FUNCTION__));
+		return Result;
+	}
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	while (!Reader->AtEnd() && !Reader->IsError() && !IsOffTrack)
+	{
+		const int64 RecordStart = Reader->Tell();
+
+		uint8 Tag = 0;
+		*Reader << Tag;
+		const EClimbingCaptureRecord Record = (EClimbingCaptureRecord)Tag;
+
+		if (Record == EClimbingCaptureRecord::Frame)
+		{
+			if (InMaxFrames >= 0 && Result.NumFrames >= InMaxFrames)
+			{
+				Reader->Seek(RecordStart);
+				break;
+			}
+
+			float DeltaTime = 0.f;
+			*Reader << DeltaTime;
+			++Result.NumFrames;
+		}
+		else if (Record == EClimbingCaptureRecord::Body)
+		{
+			*Reader << CallBody;
+		}
+		else if (Record == EClimbingCaptureRecord::Settings)
+		{
+			*Reader << Core->Settings;
+		}
+		else if (Record >= EClimbingCaptureRecord::Scan && Record <= EClimbingCaptureRecord::ApplySnapshot)
+		{
+			ReplayCall(Record);
+			++Result.NumCalls;
+
+			if (!ExpectRecord(EClimbingCaptureRecord::Check))
+			{
+				break;
+			}
+
+			uint32 RecordedHash = 0;
+			*Reader << RecordedHash;
+			if (RecordedHash != ClimbingCapture::HashState(*Core, CallBody, HashScratch) && Result.FirstMismatchCall == INDEX_NONE)
+			{
+				Result.FirstMismatchCall = Result.NumCalls - 1;
+				Result.FirstMismatchFrame = Result.NumFrames;
+
+				if (InStopOnMismatch)
+				{
+					break;
+				}
+			}
+		}
+		else
+		{
+			// A query result outside of a call
+			IsOffTrack = true;
+		}
+	}
+
+	// A crash while recording cuts the last record
+	Result.IsTruncated = Reader->IsError();
+
+	if (IsOffTrack && Result.FirstMismatchCall == INDEX_NONE)
+	{
+		Result.FirstMismatchCall = Result.NumCalls;
+		Result.FirstMismatchFrame = Result.NumFrames;
+	}
+
+	Result.Seconds = FPlatformTime::Seconds() - StartTime;
+	return Result;
+}
+
+void FClimbingCaptureReplay::ReplayCall(EClimbingCaptureRecord InCall)
+{
+	switch (InCall)
+	{
+	case EClimbingCaptureRecord::Scan:
+		Core->Scan();
+		break;
+	case EClimbingCaptureRecord::ApplyScan:
+	{
+		bool HasHit = false;
+		FClimbingHit Hit;
+		bool IsHitClimbable = false;
+		*Reader << HasHit;
+		*Reader << Hit;
+		*Reader << IsHitClimbable;
+		Core->ApplyScan(HasHit, Hit, IsHitClimbable);
+		break;
+	}
+	case EClimbingCaptureRecord::UpdateState:
+		Core->UpdateState();
+		break;
+	case EClimbingCaptureRecord::MoveSideways:
+	{
+		float Scale = 0.f;
+		float DeltaTime = 0.f;
+		*Reader << Scale;
+		*Reader << DeltaTime;
+		Core->MoveSideways(Scale, DeltaTime);
+		break;
+	}
+	case EClimbingCaptureRecord::JumpPressed:
+		Core->JumpPressed();
+		break;
+	case EClimbingCaptureRecord::HangRelease:
+		Core->HangRelease();
+		break;
+	case EClimbingCaptureRecord::ResetStates:
+		Core->ResetStates();
+		break;
+	case EClimbingCaptureRecord::ApplySnapshot:
+	{
+		FClimbingStateSnapshot Snapshot;
+		bool DriveBody = false;
+		*Reader << Snapshot;
+		*Reader << DriveBody;
+		Core->ApplySnapshot(Snapshot, DriveBody);
+		break;
+	}
+	default:
+		IsOffTrack = true;
+		break;
+	}
+}
+
+bool FClimbingCaptureReplay::ExpectRecord(EClimbingCaptureRecord InExpected) const
+{
+	if (IsOffTrack)
+	{
+		return false;
+	}
+
+	uint8 Tag = 0;
+	*Reader << Tag;
+	IsOffTrack = Reader->IsError() || Tag != (uint8)InExpected;
+	return !IsOffTrack;
+}
+
+void FClimbingCaptureReplay::GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const
+{
+	OutRadius = CallBody.Radius;
+	OutHalfHeight = CallBody.HalfHeight;
+}
+
+void FClimbingCaptureReplay::FaceBody(const FVector& InDirection)
+{
+	CallBody.Rotation = GetFacingRotation(InDirection);
+}
+
+EClimbingQueryStatus FClimbingCaptureReplay::SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit)
+{
+	EClimbingQueryStatus Status = EClimbingQueryStatus::Miss;
+	if (ExpectRecord(EClimbingCaptureRecord::SweepCapsule))
+	{
+		*Reader << Status;
+		*Reader << OutHit;
+	}
+	return Status;
+}
+
+EClimbingQueryStatus FClimbingCaptureReplay::TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits)
+{
+	EClimbingQueryStatus Status = EClimbingQueryStatus::Miss;
+	if (ExpectRecord(EClimbingCaptureRecord::TraceDown))
+	{
+		int32 NumHits = 0;
+		*Reader << Status;
+		*Reader << NumHits;
+		for (int32 i = 0; i < NumHits && !Reader->IsError(); ++i)
+		{
+			*Reader << OutHits.AddDefaulted_GetRef();
+		}
+	}
+	return Status;
+}
+
+bool FClimbingCaptureReplay::TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit)
+{
+	bool HasHit = false;
+	if (ExpectRecord(EClimbingCaptureRecord::TraceWall))
+	{
+		*Reader << HasHit;
+		*Reader << OutHit;
+	}
+	return HasHit;
+}
+
+EClimbingQueryStatus FClimbingCaptureReplay::TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit)
+{
+	EClimbingQueryStatus Status = EClimbingQueryStatus::Miss;
+	if (ExpectRecord(EClimbingCaptureRecord::TraceScanRay))
+	{
+		*Reader << Status;
+		*Reader << OutHit;
+	}
+	return Status;
+}
+
+bool FClimbingCaptureReplay::FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge)
+{
+	bool HasLedge = false;
+	if (ExpectRecord(EClimbingCaptureRecord::FindLedge))
+	{
+		*Reader << HasLedge;
+		*Reader << OutLedge;
+	}
+	return HasLedge;
+}
+
+bool FClimbingCaptureReplay::IsLedgeCurrent(const FClimbingLedge& InLedge) const
+{
+	bool IsCurrent = false;
+	if (ExpectRecord(EClimbingCaptureRecord::IsLedgeCurrent))
+	{
+		*Reader << IsCurrent;
+	}
+	return IsCurrent;
+}
+
+bool FClimbingCaptureReplay::IsSurfaceValid(const void* InSurface) const
+{
+	bool IsValid = false;
+	if (ExpectRecord(EClimbingCaptureRecord::IsSurfaceValid))
+	{
+		*Reader << IsValid;
+	}
+	return IsValid;
+}
+
+bool FClimbingCaptureReplay::GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const
+{
+	bool HasTransform = false;
+	if (ExpectRecord(EClimbingCaptureRecord::GetSurfaceTransform))
+	{
+		*Reader << HasTransform;
+		*Reader << OutTransform;
+	}
+	return HasTransform;
+}
+
+bool FClimbingCaptureReplay::SupportsGrabSurfaces() const
+{
+	bool IsSupported = false;
+	if (ExpectRecord(EClimbingCaptureRecord::SupportsGrabSurfaces))
+	{
+		*Reader << IsSupported;
+	}
+	return IsSupported;
+}
+
+EClimbingQueryStatus FClimbingCaptureReplay::OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces)
+{
+	EClimbingQueryStatus Status = EClimbingQueryStatus::Miss;
+	if (ExpectRecord(EClimbingCaptureRecord::OverlapGrabSurfaces))
+	{
+		int32 NumSurfaces = 0;
+		*Reader << Status;
+		*Reader << NumSurfaces;
+		for (int32 i = 0; i < NumSurfaces && !Reader->IsError(); ++i)
+		{
+			*Reader << OutSurfaces.AddDefaulted_GetRef();
+		}
+	}
+	return Status;
+}
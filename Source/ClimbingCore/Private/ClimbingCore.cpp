@@ -0,0 +1,1233 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingCore.h"
+#include "Serialization/Archive.h"
+#include "ClimbingCoreStats.h"
+
+namespace
+{
+	/** Sharper rim corners end the ledge, they are for climbing around the corner */
+	const float LedgeFollowMaxTurnCos = 0.866f;
+
+	/** Room needed above a top for the hands */
+	const float GrabClearance = 10.f;
+
+	/** Tops closer than that in height are taken for one, when picking the lowest */
+	const float GrabHeightTolerance = 1.f;
+
+	/** Scan capsule, relative to the body's */
+	const float ScanRadiusScale = 1.1f;
+
+	const float ScanHalfHeightScale = 0.75f;
+
+	/** Moves of the base between two updates beyond these are taken for a teleport, the grab data is checked again */
+	const float BaseMaxStepDistance = 50.f;
+
+	const float BaseMaxStepAngle = PI / 6.f;
+
+	void SerializeSurface(FArchive& Ar, const void*& InOutSurface)
+	{
+		uint64 Address = (uint64)(UPTRINT)InOutSurface;
+		Ar << Address;
+		InOutSurface = (const void*)(UPTRINT)Address;
+	}
+
+	bool PolygonContainsPoint(const TArray<FVector2D, TInlineAllocator<8>>& InPoints, const FVector2D& InPoint)
+	{
+		bool Inside = false;
+		for (int32 i = 0, j = InPoints.Num() - 1; i < InPoints.Num(); j = i++)
+		{
+			const FVector2D& A = InPoints[i];
+			const FVector2D& B = InPoints[j];
+			if ((A.Y > InPoint.Y) != (B.Y > InPoint.Y) && InPoint.X < (B.X - A.X) * (InPoint.Y - A.Y) / (B.Y - A.Y) + A.X)
+			{
+				Inside = !Inside;
+			}
+		}
+
+		return Inside;
+	}
+}
+
+FClimbingCore::FClimbingCore(IClimbingBody& InBody, IClimbingCollision& InCollision)
+	: Body(InBody)
+	, Collision(InCollision)
+{
+}
+
+void FClimbingCore::Tick(float InDeltaTime)
+{
+	/* TODO: A Freeze should be considered for the Scan */
+	Scan();
+	UpdateState();
+}
+
+bool FClimbingCore::ShouldScan() const
+{
+	return Settings.IsClimbOnHitAllowed && !IsOnTheWall();
+}
+
+void FClimbingCore::GetScanCapsule(FVector& OutLocation, FQuat& OutRotation, float& OutRadius, float& OutHalfHeight) const
+{
+	OutLocation = Body.GetBodyLocation();
+	OutRotation = Body.GetBodyRotation();
+
+	float CapsuleRadius, CapsuleHalfHeight;
+	Body.GetBodyCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+
+	// TODO: This sensor should be rethinked
+	OutRadius = CapsuleRadius * ScanRadiusScale;
+	OutHalfHeight = CapsuleHalfHeight * ScanHalfHeightScale;
+}
+
+void FClimbingCore::GetScanRay(FVector& OutStart, FVector& OutEnd) const
+{
+	float CapsuleRadius, CapsuleHalfHeight;
+	Body.GetBodyCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+
+	MakeScanRay(Body.GetBodyLocation(), Body.GetBodyRotation().GetForwardVector(), CapsuleRadius, OutStart, OutEnd);
+}
+
+void FClimbingCore::MakeScanRay(const FVector& InLocation, const FVector& InForward, float InBodyRadius, FVector& OutStart, FVector& OutEnd)
+{
+	// As far in front as the scan capsule reaches
+	OutStart = InLocation;
+	OutEnd = InLocation + InForward * (InBodyRadius * ScanRadiusScale);
+}
+
+FVector FClimbingCore::GetLaunchVelocity(const FVector& InSurfaceNormal, float InSpeed)
+{
+	return ((InSurfaceNormal * -1.f) + FVector(0.f, 0.f, 1.f)).GetSafeNormal() * InSpeed;
+}
+
+bool FClimbingCore::IsWithinClimbingDistance(const FVector& InStart, const FVector& InLocation, float InMaxDistance, float& OutClimbedDistance)
+{
+	OutClimbedDistance = (InStart - InLocation).Size();
+
+	return InMaxDistance > OutClimbedDistance;
+}
+
+EClimbingStep FClimbingCore::StepClimb(const FVector& InStart, const FVector& InLocation, float InChestZ, const FVector& InLocationToGrab,
+	float InMaxDistance, float& OutClimbedDistance, float& OutHangOffsetZ)
+{
+	OutHangOffsetZ = 0.f;
+
+	// The ledge is reached, even on the last step the distance allows
+	if (InLocationToGrab != FVector::ZeroVector && InChestZ >= InLocationToGrab.Z)
+	{
+		// Compensate Tick location update step
+		OutHangOffsetZ = InChestZ - InLocationToGrab.Z;
+		OutClimbedDistance = 0.f;
+		return EClimbingStep::Hang;
+	}
+
+	return IsWithinClimbingDistance(InStart, InLocation, InMaxDistance, OutClimbedDistance) ? EClimbingStep::Climb : EClimbingStep::Drop;
+}
+
+void FClimbingCore::MakeUpwardTraceRange(const FVector& InWallPoint, const FVector& InWallNormal, float InBodyRadius, float InRemainingDistance,
+	FVector& OutBegin, FVector& OutEnd)
+{
+	// TODO: think it over again later, what location to take as a base.
+	OutEnd = InWallPoint + (InWallNormal * -1.f * InBodyRadius);
+
+	OutBegin = OutEnd + FVector(0.f, 0.f, 1.f) * InRemainingDistance;
+}
+
+void FClimbingCore::Scan()
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(ScanForClimbingData);
+
+	if (!ShouldScan())
+	{
+		return;
+	}
+
+	FVector Location;
+	FQuat Rotation;
+	float Radius, HalfHeight;
+	GetScanCapsule(Location, Rotation, Radius, HalfHeight);
+
+	FClimbingHit Hit;
+	EClimbingQueryStatus Status;
+	if (Settings.ScanWithRay)
+	{
+		FVector RayStart, RayEnd;
+		GetScanRay(RayStart, RayEnd);
+		Status = Collision.TraceScanRay(RayStart, RayEnd, Hit);
+	}
+	else
+	{
+		Status = Collision.SweepCapsule(Location, Rotation, Radius, HalfHeight, Hit);
+	}
+
+	if (Status == EClimbingQueryStatus::Pending)
+	{
+		// Keep the previous data until there is a result
+		return;
+	}
+
+	const bool HasHit = Status == EClimbingQueryStatus::Hit;
+	ApplyScan(HasHit, Hit, HasHit && IsClimbable(Hit));
+}
+
+void FClimbingCore::ApplyScan(bool InHasHit, const FClimbingHit& InHit, bool InIsHitClimbable)
+{
+	if (!InHasHit)
+	{
+		/* TODO: Get rid of this ugly work around */
+		if (!Hanging)
+		{
+			CurrentSurfaceNormal = FVector::ZeroVector;
+		}
+		return;
+	}
+
+	if (InIsHitClimbable)
+	{
+		CurrentSurfaceNormal = InHit.ImpactNormal;
+		WallHit = InHit;
+	}
+	else
+	{
+		WallHit = FClimbingHit();
+	}
+}
+
+void FClimbingCore::UpdateState()
+{
+	FollowBase();
+
+	if (!Climbing)
+	{
+		StartClimbing();
+	}
+	else
+	{
+		UpdateClimbing();
+	}
+}
+
+SIZE_T FClimbingCore::GetAllocatedSize() const
+{
+	SIZE_T Size = HangLedge.Points.GetAllocatedSize() + HangLedge.Normals.GetAllocatedSize();
+
+	if (OwnQueryScratch)
+	{
+		Size += sizeof(FClimbingQueryScratch) + OwnQueryScratch->VerticalHits.GetAllocatedSize() + OwnQueryScratch->GrabSurfaces.GetAllocatedSize();
+		for (const FClimbingGrabSurface& Surface : OwnQueryScratch->GrabSurfaces)
+		{
+			Size += Surface.Points.GetAllocatedSize();
+		}
+	}
+
+	return Size;
+}
+
+FClimbingQueryScratch& FClimbingCore::GetQueryScratch()
+{
+	if (!QueryScratch)
+	{
+		OwnQueryScratch = MakeUnique<FClimbingQueryScratch>();
+		QueryScratch = OwnQueryScratch.Get();
+	}
+
+	return *QueryScratch;
+}
+
+float FClimbingCore::GetTimeToClimbEnd() const
+{
+	if (!Climbing || Settings.MaxClimbingSpeed <= KINDA_SMALL_NUMBER)
+	{
+		return -1.f;
+	}
+
+	// The launch velocity of StartClimbing, the wall only takes its horizontal part away, the body goes up at its vertical part
+	const float VerticalSpeed = GetLaunchVelocity(CurrentSurfaceNormal, Settings.MaxClimbingSpeed).Z;
+	if (VerticalSpeed <= KINDA_SMALL_NUMBER)
+	{
+		return -1.f;
+	}
+
+	float Time = FMath::Max(Settings.MaxClimbingDistance - ClimbedDistance, 0.f) / VerticalSpeed;
+
+	if (LocationToGrab != FVector::ZeroVector)
+	{
+		Time = FMath::Min(Time, FMath::Max(LocationToGrab.Z - Body.GetBodyChestZ(), 0.f) / VerticalSpeed);
+	}
+
+	return Time;
+}
+
+bool FClimbingCore::IsClimbable(const FClimbingHit& InHit) const
+{
+	return IsClimbableSurface(InHit, Body.GetBodyRotation().GetForwardVector(), Body.GetBodyWalkableFloorZ(),
+		Settings.GetCaptureAngleCos());
+}
+
+bool FClimbingCore::IsClimbableSurface(const FClimbingHit& InHit, const FVector& InForward, float InWalkableFloorZ, float InCaptureAngleCos)
+{
+	if (!InHit.IsSurfaceClimbable)
+	{
+		return false;
+	}
+
+	/* Walkable surface check, same as UCharacterMovementComponent::IsWalkable */
+	if (InHit.ImpactNormal.Z >= KINDA_SMALL_NUMBER)
+	{
+		const float WalkableFloorZ = InHit.WalkableFloorZ >= 0.f ? InHit.WalkableFloorZ : InWalkableFloorZ;
+		if (InHit.ImpactNormal.Z >= WalkableFloorZ)
+		{
+			return false;
+		}
+	}
+
+	/* Negative slope check*/
+	//if ((InHit.ImpactNormal.Z > -0.05f))
+	//{
+	//	return false;
+	//}
+
+	float Dot = FVector2D::DotProduct(FVector2D(InForward.X, InForward.Y),
+		FVector2D(InHit.ImpactNormal.X, InHit.ImpactNormal.Y));
+
+	/* Check the capture angle */
+	if (Dot > InCaptureAngleCos)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void FClimbingCore::ClassifySurfaces(const FClimbingSurfaceBatch& InBatch, TArray<bool>& OutClimbable)
+{
+	const int32 Num = InBatch.Num();
+	OutClimbable.SetNumUninitialized(Num);
+
+	const VectorRegister MinNormalZ = VectorSetFloat1(KINDA_SMALL_NUMBER);
+
+	// Same rules as IsClimbableSurface, a lane is rejected by a walkable normal or by one facing away from the capture cone
+	int32 i = 0;
+	for (; i + 4 <= Num; i += 4)
+	{
+		const VectorRegister NormalX = VectorLoadAligned(&InBatch.NormalX[i]);
+		const VectorRegister NormalY = VectorLoadAligned(&InBatch.NormalY[i]);
+		const VectorRegister NormalZ = VectorLoadAligned(&InBatch.NormalZ[i]);
+
+		const VectorRegister IsWalkable = VectorBitwiseAnd(
+			VectorCompareGE(NormalZ, MinNormalZ),
+			VectorCompareGE(NormalZ, VectorLoadAligned(&InBatch.WalkableFloorZ[i])));
+
+		const VectorRegister Dot = VectorMultiplyAdd(VectorLoadAligned(&InBatch.ForwardX[i]), NormalX,
+			VectorMultiply(VectorLoadAligned(&InBatch.ForwardY[i]), NormalY));
+		const VectorRegister IsOutOfCone = VectorCompareGT(Dot, VectorLoadAligned(&InBatch.CaptureAngleCos[i]));
+
+		const uint32 Rejected = VectorMaskBits(VectorBitwiseOr(IsWalkable, IsOutOfCone));
+		OutClimbable[i] = (Rejected & 1) == 0;
+		OutClimbable[i + 1] = (Rejected & 2) == 0;
+		OutClimbable[i + 2] = (Rejected & 4) == 0;
+		OutClimbable[i + 3] = (Rejected & 8) == 0;
+	}
+
+	for (; i < Num; ++i)
+	{
+		const float NormalZ = InBatch.NormalZ[i];
+		const float Dot = InBatch.ForwardX[i] * InBatch.NormalX[i] + InBatch.ForwardY[i] * InBatch.NormalY[i];
+		OutClimbable[i] = !(NormalZ >= KINDA_SMALL_NUMBER && NormalZ >= InBatch.WalkableFloorZ[i]) && Dot <= InBatch.CaptureAngleCos[i];
+	}
+}
+
+void FClimbingSurfaceBatch::Reset()
+{
+	NormalX.Reset();
+	NormalY.Reset();
+	NormalZ.Reset();
+	ForwardX.Reset();
+	ForwardY.Reset();
+	WalkableFloorZ.Reset();
+	CaptureAngleCos.Reset();
+}
+
+void FClimbingSurfaceBatch::Reserve(int32 InNum)
+{
+	NormalX.Reserve(InNum);
+	NormalY.Reserve(InNum);
+	NormalZ.Reserve(InNum);
+	ForwardX.Reserve(InNum);
+	ForwardY.Reserve(InNum);
+	WalkableFloorZ.Reserve(InNum);
+	CaptureAngleCos.Reserve(InNum);
+}
+
+int32 FClimbingSurfaceBatch::Add(const FClimbingHit& InHit, const FVector& InForward, float InWalkableFloorZ, float InCaptureAngleCos)
+{
+	NormalX.Add(InHit.ImpactNormal.X);
+	NormalY.Add(InHit.ImpactNormal.Y);
+	NormalZ.Add(InHit.ImpactNormal.Z);
+	ForwardX.Add(InForward.X);
+	ForwardY.Add(InForward.Y);
+	WalkableFloorZ.Add(InHit.WalkableFloorZ >= 0.f ? InHit.WalkableFloorZ : InWalkableFloorZ);
+
+	// No dot product is below -1, the lane of a surface that can't be climbed is always out of the cone
+	CaptureAngleCos.Add(InHit.IsSurfaceClimbable ? InCaptureAngleCos : -2.f);
+
+	return NormalX.Num() - 1;
+}
+
+bool FClimbingCore::CanStartClimbing() const
+{
+	// Check if we are allowed to climb, have something to climb and not climbing already
+	return HasAbilityToClimb && Settings.IsClimbOnHitAllowed
+		&& Collision.IsSurfaceValid(WallHit.Surface) && !IsOnTheWall();
+}
+
+bool FClimbingCore::FindLocationToGrab()
+{
+	FVector RangeBegin, RangeEnd;
+	GetUpwardTraceRange(RangeBegin, RangeEnd);
+
+	const float ChestZ = Body.GetBodyChestZ();
+	const float MinZ = FMath::Max(RangeEnd.Z, ChestZ);
+
+	if (Settings.GrabProbeColumns > 1 && Collision.SupportsGrabSurfaces())
+	{
+		return FindLocationToGrabWithProbes(RangeBegin, RangeEnd, MinZ);
+	}
+
+	return FindLocationToGrabWithTrace(RangeBegin, RangeEnd, MinZ);
+}
+
+bool FClimbingCore::FindLocationToGrabWithTrace(const FVector& InRangeBegin, const FVector& InRangeEnd, float InMinZ)
+{
+	const float ChestZ = Body.GetBodyChestZ();
+
+	FClimbingHitArray& VerticalHits = GetQueryScratch().VerticalHits;
+	VerticalHits.Reset();
+	const EClimbingQueryStatus Status = Collision.TraceDown(InRangeBegin, InRangeEnd, InMinZ, WallHit, VerticalHits);
+	if (Status == EClimbingQueryStatus::Pending)
+	{
+		// Still potentially reachable, until the query says otherwise
+		return true;
+	}
+
+	FClimbingHit ClosestGrabableHit;
+	if (Status == EClimbingQueryStatus::Hit && FindClosestVerticalHit(VerticalHits, ChestZ, ClosestGrabableHit))
+	{
+		LocationToGrab = ClosestGrabableHit.ImpactPoint;
+		GrabQuality = 1.f;
+		return true;
+	}
+
+	return false;
+}
+
+bool FClimbingCore::FindLocationToGrabWithProbes(const FVector& InRangeBegin, const FVector& InRangeEnd, float InMinZ)
+{
+	float CapsuleRadius, CapsuleHalfHeight;
+	Body.GetBodyCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+
+	// Everything the probes can reach, from the wall to a radius into it and a radius to each side
+	const FVector Extent(CapsuleRadius, CapsuleRadius, 0.f);
+	FBox Bounds(WallHit.ImpactPoint - Extent, WallHit.ImpactPoint + Extent);
+	Bounds += Bounds.ShiftBy(WallHit.ImpactNormal.GetSafeNormal2D() * -CapsuleRadius);
+	Bounds.Min.Z = InMinZ;
+	Bounds.Max.Z = InRangeBegin.Z;
+
+	FClimbingGrabSurfaceArray& GrabSurfaces = GetQueryScratch().GrabSurfaces;
+	GrabSurfaces.Reset();
+	const EClimbingQueryStatus Status = Collision.OverlapGrabSurfaces(Bounds, WallHit, GrabSurfaces);
+	if (Status == EClimbingQueryStatus::Pending)
+	{
+		return true;
+	}
+
+	if (Status == EClimbingQueryStatus::Unsupported)
+	{
+		return FindLocationToGrabWithTrace(InRangeBegin, InRangeEnd, InMinZ);
+	}
+
+	FClimbingGrab Grab;
+	if (Status == EClimbingQueryStatus::Hit && FindBestGrab(GrabSurfaces, WallHit.ImpactPoint, WallHit.ImpactNormal, CapsuleRadius,
+		InMinZ, InRangeBegin.Z, Settings.GrabProbeColumns, Settings.GrabProbeRows, Grab))
+	{
+		LocationToGrab = Grab.Location;
+		GrabQuality = Grab.Quality;
+		return true;
+	}
+
+	return false;
+}
+
+bool FClimbingCore::FindBestGrab(const FClimbingGrabSurfaceArray& InSurfaces, const FVector& InWallPoint, const FVector& InWallNormal,
+	float InRadius, float InMinZ, float InMaxZ, int32 InColumns, int32 InRows, FClimbingGrab& OutGrab)
+{
+	const int32 Columns = FMath::Max(InColumns, 1);
+	const int32 Rows = FMath::Max(InRows, 1);
+	const FVector Inward = InWallNormal.GetSafeNormal2D() * -1.f;
+	const FVector Right(-Inward.Y, Inward.X, 0.f);
+
+	// Top hit by each probe, row after row
+	TArray<int32, TInlineAllocator<32>> ProbeSurfaces;
+	ProbeSurfaces.Init(INDEX_NONE, Columns * Rows);
+
+	for (int32 Row = 0; Row < Rows; ++Row)
+	{
+		for (int32 Column = 0; Column < Columns; ++Column)
+		{
+			const float Lateral = Columns > 1 ? FMath::Lerp(-InRadius, InRadius, (float)Column / (Columns - 1)) : 0.f;
+			const FVector Probe = InWallPoint + Inward * (InRadius * (Row + 1) / Rows) + Right * Lateral;
+			const FVector2D Probe2D(Probe.X, Probe.Y);
+
+			// Highest top under the start of the probe, as a blocking trace down would hit it
+			int32 Hit = INDEX_NONE;
+			for (int32 i = 0; i < InSurfaces.Num(); ++i)
+			{
+				const FClimbingGrabSurface& Surface = InSurfaces[i];
+				if (Surface.TopZ <= InMaxZ && (Hit == INDEX_NONE || Surface.TopZ > InSurfaces[Hit].TopZ)
+					&& PolygonContainsPoint(Surface.Points, Probe2D))
+				{
+					Hit = i;
+				}
+			}
+
+			if (Hit == INDEX_NONE || InSurfaces[Hit].TopZ < InMinZ)
+			{
+				continue;
+			}
+
+			// Something right above the top leaves no room for the hands
+			bool IsBlocked = false;
+			for (const FClimbingGrabSurface& Surface : InSurfaces)
+			{
+				if (Surface.TopZ > InSurfaces[Hit].TopZ && Surface.BottomZ < InSurfaces[Hit].TopZ + GrabClearance
+					&& PolygonContainsPoint(Surface.Points, Probe2D))
+				{
+					IsBlocked = true;
+					break;
+				}
+			}
+
+			if (!IsBlocked)
+			{
+				ProbeSurfaces[Row * Columns + Column] = Hit;
+			}
+		}
+	}
+
+	float BestZ = MAX_flt;
+	float BestQuality = -1.f;
+	bool HasGrab = false;
+
+	for (int32 Row = 0; Row < Rows; ++Row)
+	{
+		for (int32 Column = 0; Column < Columns; ++Column)
+		{
+			const int32 Hit = ProbeSurfaces[Row * Columns + Column];
+			if (Hit == INDEX_NONE)
+			{
+				continue;
+			}
+
+			// Width of the top under the row's probes, and how close to the body's center the grab is
+			int32 Support = 0;
+			for (int32 Other = 0; Other < Columns; ++Other)
+			{
+				Support += ProbeSurfaces[Row * Columns + Other] == Hit ? 1 : 0;
+			}
+
+			const float Centering = Columns > 1 ? 1.f - FMath::Abs(Column - (Columns - 1) * 0.5f) / (Columns - 1) : 1.f;
+			const float Quality = (float)Support / Columns * Centering;
+			const float TopZ = InSurfaces[Hit].TopZ;
+
+			// The lowest top is reached first, the quality picks among the probes on it
+			const bool IsLower = TopZ < BestZ - GrabHeightTolerance;
+			const bool IsLevel = FMath::Abs(TopZ - BestZ) <= GrabHeightTolerance;
+			if (!(IsLower || (IsLevel && Quality > BestQuality)))
+			{
+				continue;
+			}
+
+			const float Lateral = Columns > 1 ? FMath::Lerp(-InRadius, InRadius, (float)Column / (Columns - 1)) : 0.f;
+			const FVector Probe = InWallPoint + Inward * (InRadius * (Row + 1) / Rows) + Right * Lateral;
+
+			OutGrab.Location = FVector(Probe.X, Probe.Y, TopZ);
+			OutGrab.Quality = Quality;
+			OutGrab.Surface = InSurfaces[Hit].Surface;
+			BestZ = TopZ;
+			BestQuality = Quality;
+			HasGrab = true;
+		}
+	}
+
+	return HasGrab;
+}
+
+bool FClimbingCore::FindClosestVerticalHit(const FClimbingHitArray& InHits, float InChestZ, FClimbingHit& OutHit)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(FindClosestVerticalHit);
+
+	const float ComparisonTollerance = 1.f;
+
+	for (int32 i = InHits.Num() - 1; i >= 0; --i)
+	{
+		if (!InHits[i].IsSurfaceClimbable)
+		{
+			continue;
+		}
+
+		// check that ImpactPoint is on the top of the primitive's box, not inside
+		if (InHits[i].SurfaceTopZ - InHits[i].ImpactPoint.Z > ComparisonTollerance)
+		{
+			continue;
+		}
+
+		if (InHits[i].ImpactPoint.Z >= InChestZ)
+		{
+			OutHit = InHits[i];
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void FClimbingCore::GetUpwardTraceRange(FVector& OutBegin, FVector& OutEnd) const
+{
+	float CapsuleRadius, CapsuleHalfHeight;
+	Body.GetBodyCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+
+	MakeUpwardTraceRange(WallHit.ImpactPoint, WallHit.ImpactNormal, CapsuleRadius, Settings.MaxClimbingDistance - ClimbedDistance,
+		OutBegin, OutEnd);
+}
+
+void FClimbingCore::StartClimbing()
+{
+	if (!CanStartClimbing())
+	{
+		return;
+	}
+
+	Climbing = true;
+	HasAbilityToClimb = false;
+
+	// The wall is already known, a sweep in flight is of no use anymore
+	Collision.CancelPendingQueries();
+
+	// by default we assume anything is potentially grabable
+	IsLocationPotentiallyReachable = true;
+
+	LocationToGrab = FVector::ZeroVector;
+	GrabQuality = 0.f;
+
+	ClimbingStartLocation = Body.GetBodyLocation();
+	AttachToBase();
+
+	Body.LaunchClimbMovement(GetLaunchVelocity(CurrentSurfaceNormal, Settings.MaxClimbingSpeed));
+}
+
+void FClimbingCore::AttachToBase()
+{
+	HasBase = Collision.GetSurfaceTransform(WallHit.Surface, BaseTransform);
+}
+
+void FClimbingCore::FollowBase()
+{
+	if (!HasBase)
+	{
+		return;
+	}
+
+	if (!IsOnTheWall())
+	{
+		HasBase = false;
+		return;
+	}
+
+	CLIMBING_SCOPE_CYCLE_COUNTER(FollowBase);
+
+	FTransform Transform;
+	if (!Collision.GetSurfaceTransform(WallHit.Surface, Transform))
+	{
+		// Nothing left to hold on to
+		HasBase = false;
+		if (Climbing)
+		{
+			StopClimbing(EClimbingStopReason::StartFalling);
+		}
+		else
+		{
+			StopHanging();
+		}
+		return;
+	}
+
+	if (Transform.Equals(BaseTransform, KINDA_SMALL_NUMBER))
+	{
+		return;
+	}
+
+	const FQuat DeltaRotation = Transform.GetRotation() * BaseTransform.GetRotation().Inverse();
+	const bool IsDiscontinuous = FVector::DistSquared(Transform.GetLocation(), BaseTransform.GetLocation()) > FMath::Square(BaseMaxStepDistance)
+		|| DeltaRotation.GetAngle() > BaseMaxStepAngle;
+
+	// From the base's previous transform to its current one, through its local space
+	auto FollowPoint = [this, &Transform](const FVector& InPoint)
+	{
+		return Transform.TransformPosition(BaseTransform.InverseTransformPosition(InPoint));
+	};
+
+	auto FollowNormal = [this, &Transform](const FVector& InNormal)
+	{
+		return Transform.TransformVectorNoScale(BaseTransform.InverseTransformVectorNoScale(InNormal));
+	};
+
+	const FVector BodyLocation = Body.GetBodyLocation();
+	Body.OffsetBody(FollowPoint(BodyLocation) - BodyLocation);
+
+	if (LocationToGrab != FVector::ZeroVector)
+	{
+		LocationToGrab = FollowPoint(LocationToGrab);
+	}
+
+	ClimbingStartLocation = FollowPoint(ClimbingStartLocation);
+	CurrentSurfaceNormal = FollowNormal(CurrentSurfaceNormal);
+
+	const FVector WallPoint = FollowPoint(WallHit.ImpactPoint);
+	WallHit.SurfaceTopZ += WallPoint.Z - WallHit.ImpactPoint.Z;
+	WallHit.ImpactPoint = WallPoint;
+	WallHit.ImpactNormal = FollowNormal(WallHit.ImpactNormal);
+
+	if (Hanging)
+	{
+		HangZ = LocationToGrab.Z;
+	}
+
+	BaseTransform = Transform;
+
+	if (!DeltaRotation.IsIdentity(KINDA_SMALL_NUMBER))
+	{
+		Body.FaceBody(-CurrentSurfaceNormal);
+
+		if (Climbing)
+		{
+			Body.LaunchClimbMovement(GetLaunchVelocity(CurrentSurfaceNormal, Settings.MaxClimbingSpeed));
+		}
+	}
+
+	// A followed ledge is extracted again once the collision no longer takes it for current.
+	// Only a jump of the base is worth checking the cached grab data against the geometry
+	if (!IsDiscontinuous)
+	{
+		return;
+	}
+
+	if (Climbing)
+	{
+		LocationToGrab = FVector::ZeroVector;
+		IsLocationPotentiallyReachable = true;
+		return;
+	}
+
+	FClimbingHit Hit;
+	if (!CanMoveSidewaysToLocation(Body.GetBodyLocation(), Hit))
+	{
+		StopHanging();
+		return;
+	}
+
+	CurrentSurfaceNormal = Hit.ImpactNormal;
+	AttachToLedge();
+}
+
+void FClimbingCore::StopClimbing(EClimbingStopReason InReason)
+{
+	// The ledge the hands are on, when hanging
+	HangZ = LocationToGrab.Z;
+	const FVector GrabbedLocation = LocationToGrab;
+
+	// Wipe all the climbing related data.
+	Climbing = false;
+	LocationToGrab = FVector::ZeroVector;
+	IsLocationPotentiallyReachable = true;
+	ClimbedDistance = 0.f;
+	Collision.CancelPendingQueries();
+
+	switch (InReason)
+	{
+	case EClimbingStopReason::StartFalling:
+		Body.ExitClimbMovement();
+		break;
+	case EClimbingStopReason::StartHanging:
+		// The hands stay on the ledge
+		LocationToGrab = GrabbedLocation;
+		StartHanging();
+		break;
+	}
+}
+
+void FClimbingCore::UpdateClimbing()
+{
+	// check if grab location not Zero, but potentially is reachable
+	if (LocationToGrab == FVector::ZeroVector &&
+		IsLocationPotentiallyReachable)
+	{
+		IsLocationPotentiallyReachable = FindLocationToGrab();
+	}
+
+	float HangOffsetZ = 0.f;
+	const EClimbingStep Step = StepClimb(ClimbingStartLocation, Body.GetBodyLocation(), Body.GetBodyChestZ(), LocationToGrab,
+		Settings.MaxClimbingDistance, ClimbedDistance, HangOffsetZ);
+
+	if (Step == EClimbingStep::Hang)
+	{
+		Body.OffsetBody(FVector(0.f, 0.f, HangOffsetZ));
+
+		// Stop climbing
+		StopClimbing(EClimbingStopReason::StartHanging);
+	}
+	else if (Step == EClimbingStep::Drop)
+	{
+		// The ledge was in sight, but the climb ran out of distance before the hands got to it
+		if (Climbing && LocationToGrab != FVector::ZeroVector)
+		{
+			++NumAbortedGrabs;
+		}
+
+		StopClimbing(EClimbingStopReason::StartFalling);
+	}
+}
+
+void FClimbingCore::StartHanging()
+{
+	HasAbilityToClimb = true;
+	Hanging = true;
+	Body.StopBodyMovement();
+
+	AttachToLedge();
+}
+
+void FClimbingCore::StopHanging()
+{
+	Hanging = false;
+	HasHangLedge = false;
+	HasBase = false;
+	LocationToGrab = FVector::ZeroVector;
+	Body.ExitClimbMovement();
+}
+
+void FClimbingCore::HangRelease()
+{
+	if (Hanging)
+	{
+		StopHanging();
+	}
+}
+
+void FClimbingCore::JumpPressed()
+{
+	if (!Hanging)
+	{
+		return;
+	}
+
+	Hanging = false;
+	HasHangLedge = false;
+	HasAbilityToClimb = true;
+
+	StartClimbing();
+
+	// Nothing to climb on, let go
+	if (!Climbing)
+	{
+		Body.ExitClimbMovement();
+	}
+}
+
+bool FClimbingCore::BoxContainsVector(const FVector& Origin, const FVector& Extent, const FVector& InVector)
+{
+	FVector NegativeExtent = Extent * -1.f;
+	FVector LocalSpaceVector = Origin - InVector;
+
+	bool InsideX = ((LocalSpaceVector.X > NegativeExtent.X) && (LocalSpaceVector.X < Extent.X)) ? true : false;
+	bool InsideY = ((LocalSpaceVector.Y > NegativeExtent.Y) && (LocalSpaceVector.Y < Extent.Y)) ? true : false;
+	bool InsideZ = ((LocalSpaceVector.Z > NegativeExtent.Z) && (LocalSpaceVector.Z < Extent.Z)) ? true : false;
+
+	return InsideX && InsideY && InsideZ;
+}
+
+void FClimbingCore::ResetStates()
+{
+	Climbing = false;
+	Hanging = false;
+	HasAbilityToClimb = true;
+	HasHangLedge = false;
+	HasBase = false;
+	LocationToGrab = FVector::ZeroVector;
+	Collision.CancelPendingQueries();
+
+	// Just in case of immergency use, try reset movement to walking
+	Body.ExitClimbMovement();
+}
+
+FClimbingStateSnapshot FClimbingCore::GetSnapshot() const
+{
+	FClimbingStateSnapshot Snapshot;
+	Snapshot.Climbing = Climbing;
+	Snapshot.Hanging = Hanging;
+	Snapshot.LocationToGrab = LocationToGrab;
+	Snapshot.SurfaceNormal = CurrentSurfaceNormal;
+	return Snapshot;
+}
+
+void FClimbingCore::ApplySnapshot(const FClimbingStateSnapshot& InSnapshot, bool InDriveBody)
+{
+	const bool WasClimbing = Climbing;
+	const bool WasOnTheWall = IsOnTheWall();
+
+	Climbing = InSnapshot.Climbing;
+	Hanging = InSnapshot.Hanging && !InSnapshot.Climbing;
+	LocationToGrab = InSnapshot.LocationToGrab;
+	CurrentSurfaceNormal = InSnapshot.SurfaceNormal;
+
+	HasAbilityToClimb = !Climbing;
+	HasHangLedge = false;
+	IsLocationPotentiallyReachable = true;
+	Collision.CancelPendingQueries();
+
+	// Snapped to where the base is now
+	HasBase = false;
+	if (IsOnTheWall())
+	{
+		AttachToBase();
+	}
+
+	if (Climbing && !WasClimbing)
+	{
+		ClimbingStartLocation = Body.GetBodyLocation();
+		ClimbedDistance = 0.f;
+	}
+
+	if (Hanging)
+	{
+		HangZ = LocationToGrab.Z;
+	}
+
+	if (!InDriveBody)
+	{
+		return;
+	}
+
+	if (Climbing)
+	{
+		Body.LaunchClimbMovement(GetLaunchVelocity(CurrentSurfaceNormal, Settings.MaxClimbingSpeed));
+	}
+	else if (Hanging)
+	{
+		Body.LaunchClimbMovement(FVector::ZeroVector);
+		Body.StopBodyMovement();
+		AttachToLedge();
+	}
+	else if (WasOnTheWall)
+	{
+		Body.ExitClimbMovement();
+	}
+}
+
+void FClimbingCore::MoveSideways(float InScale, float InDeltaTime)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(MoveSideways);
+
+	if (!Hanging)
+	{
+		return;
+	}
+
+	if (FMath::Abs(InScale) < 0.1f)
+	{
+		return;
+	}
+
+	const float MoveDistance = InScale * InDeltaTime * Settings.MaxClimbingStrafeSpeed;
+
+	// The ledge actor moved, its rim is somewhere else now
+	if (HasHangLedge && !Collision.IsLedgeCurrent(HangLedge))
+	{
+		AttachToLedge();
+	}
+
+	if (HasHangLedge)
+	{
+		// Right is clockwise along the rim
+		if (SlideAlongLedge(-MoveDistance))
+		{
+			return;
+		}
+
+		if (Settings.ClimbAroundCorners && MoveAroundCorner(MoveDistance < 0.f))
+		{
+			return;
+		}
+
+		// End of the ledge, only a trace can tell if the wall goes on
+		HasHangLedge = false;
+	}
+
+	FVector SurfaceRightVector = CurrentSurfaceNormal;
+	SurfaceRightVector = FVector::CrossProduct(SurfaceRightVector, FVector::UpVector);
+	SurfaceRightVector.Normalize();
+
+	FVector NextLocation = Body.GetBodyLocation() + SurfaceRightVector * MoveDistance;
+	FClimbingHit NewLocationHit;
+	if (CanMoveSidewaysToLocation(NextLocation, NewLocationHit))
+	{
+		// The hands go along
+		LocationToGrab += SurfaceRightVector * MoveDistance;
+		Body.SetBodyLocation(NextLocation);
+		// In case of curved surfaces
+		CurrentSurfaceNormal = NewLocationHit.ImpactNormal;
+
+		AttachToLedge();
+	}
+	else
+	{
+		// climb around the corner
+	}
+}
+
+bool FClimbingCore::CanMoveSidewaysToLocation(const FVector& InTargetLocation, FClimbingHit& OutHit)
+{
+	float CapsuleRadius, CapsuleHalfHeight;
+	Body.GetBodyCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
+
+	FVector Offset = (CurrentSurfaceNormal * -1.f) *
+		(CapsuleRadius * 1.1f);
+
+	return Collision.TraceWall(InTargetLocation, InTargetLocation + Offset, CapsuleHalfHeight * 2.f, OutHit);
+}
+
+bool FClimbingCore::AttachToLedge()
+{
+	HasHangLedge = false;
+
+	if (!Settings.FollowLedges)
+	{
+		return false;
+	}
+
+	const FVector BodyLocation = Body.GetBodyLocation();
+	const FVector Probe(BodyLocation.X, BodyLocation.Y, HangZ);
+	if (!Collision.FindLedge(Probe, WallHit, HangLedge))
+	{
+		return false;
+	}
+
+	const int32 NumPoints = HangLedge.Points.Num();
+	if (NumPoints < 2 || HangLedge.Normals.Num() != NumPoints)
+	{
+		return false;
+	}
+
+	// Closest rim segment the body is in front of
+	const FVector2D Location(BodyLocation.X, BodyLocation.Y);
+	float ClosestDistanceSquared = MAX_flt;
+
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		const FVector2D& Start = HangLedge.Points[i];
+		const FVector2D Segment = HangLedge.Points[(i + 1) % NumPoints] - Start;
+		const float Length = Segment.Size();
+		if (Length < KINDA_SMALL_NUMBER || FVector2D::DotProduct(Location - Start, HangLedge.Normals[i]) < 0.f)
+		{
+			continue;
+		}
+
+		const float Along = FMath::Clamp(FVector2D::DotProduct(Location - Start, Segment / Length), 0.f, Length);
+		const float DistanceSquared = FVector2D::DistSquared(Location, Start + Segment / Length * Along);
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			HangSegment = i;
+			HangDistance = Along;
+		}
+	}
+
+	if (ClosestDistanceSquared == MAX_flt)
+	{
+		return false;
+	}
+
+	HangStandOff = FMath::Sqrt(ClosestDistanceSquared);
+	HasHangLedge = true;
+	return true;
+}
+
+bool FClimbingCore::SlideAlongLedge(float InDistance)
+{
+	const int32 NumPoints = HangLedge.Points.Num();
+
+	auto GetSegmentLength = [this, NumPoints](int32 InSegment)
+	{
+		return (HangLedge.Points[(InSegment + 1) % NumPoints] - HangLedge.Points[InSegment]).Size();
+	};
+
+	int32 Segment = HangSegment;
+	float Distance = HangDistance + InDistance;
+
+	// Walk over the rim corners that are smooth enough to follow
+	for (int32 Step = 0; Step < NumPoints; ++Step)
+	{
+		int32 NextSegment;
+		if (Distance < 0.f)
+		{
+			NextSegment = (Segment + NumPoints - 1) % NumPoints;
+		}
+		else if (Distance > GetSegmentLength(Segment))
+		{
+			NextSegment = (Segment + 1) % NumPoints;
+		}
+		else
+		{
+			break;
+		}
+
+		if (FVector2D::DotProduct(HangLedge.Normals[Segment], HangLedge.Normals[NextSegment]) < LedgeFollowMaxTurnCos)
+		{
+			return false;
+		}
+
+		Distance = Distance < 0.f ? Distance + GetSegmentLength(NextSegment) : Distance - GetSegmentLength(Segment);
+		Segment = NextSegment;
+	}
+
+	const float Length = GetSegmentLength(Segment);
+	if (Distance < 0.f || Distance > Length || Length < KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const FVector2D& Start = HangLedge.Points[Segment];
+	const FVector2D& Normal = HangLedge.Normals[Segment];
+	const FVector2D RimPoint = Start + (HangLedge.Points[(Segment + 1) % NumPoints] - Start) / Length * Distance;
+	const FVector2D Location = RimPoint + Normal * HangStandOff;
+
+	HangSegment = Segment;
+	HangDistance = Distance;
+	LocationToGrab = FVector(RimPoint.X, RimPoint.Y, LocationToGrab.Z);
+
+	Body.SetBodyLocation(FVector(Location.X, Location.Y, Body.GetBodyLocation().Z));
+	CurrentSurfaceNormal = FVector(Normal.X, Normal.Y, 0.f);
+	return true;
+}
+
+bool FClimbingCore::MoveAroundCorner(bool InForward)
+{
+	const int32 NumPoints = HangLedge.Points.Num();
+	const int32 NextSegment = InForward ? (HangSegment + 1) % NumPoints : (HangSegment + NumPoints - 1) % NumPoints;
+
+	// Counter-clockwise rims turn left on their outer corners
+	const int32 First = InForward ? HangSegment : NextSegment;
+	const int32 Second = InForward ? NextSegment : HangSegment;
+	const FVector2D FirstDirection = HangLedge.Points[(First + 1) % NumPoints] - HangLedge.Points[First];
+	const FVector2D SecondDirection = HangLedge.Points[(Second + 1) % NumPoints] - HangLedge.Points[Second];
+	if (FVector2D::CrossProduct(FirstDirection, SecondDirection) <= KINDA_SMALL_NUMBER)
+	{
+		return false;
+	}
+
+	const float NextLength = (HangLedge.Points[(NextSegment + 1) % NumPoints] - HangLedge.Points[NextSegment]).Size();
+	const FVector2D& Corner = HangLedge.Points[InForward ? NextSegment : HangSegment];
+	const FVector2D& Normal = HangLedge.Normals[NextSegment];
+	const FVector2D Location = Corner + Normal * HangStandOff;
+
+	HangSegment = NextSegment;
+	HangDistance = InForward ? 0.f : NextLength;
+	LocationToGrab = FVector(Corner.X, Corner.Y, LocationToGrab.Z);
+
+	Body.SetBodyLocation(FVector(Location.X, Location.Y, Body.GetBodyLocation().Z));
+	CurrentSurfaceNormal = FVector(Normal.X, Normal.Y, 0.f);
+	Body.FaceBody(-CurrentSurfaceNormal);
+	return true;
+}
+
+void FClimbingCore::SerializeState(FArchive& Ar)
+{
+	Ar << Settings;
+	Ar << Climbing;
+	Ar << Hanging;
+	Ar << HasAbilityToClimb;
+	Ar << IsLocationPotentiallyReachable;
+	Ar << LocationToGrab;
+	Ar << CurrentSurfaceNormal;
+	Ar << ClimbingStartLocation;
+	Ar << ClimbedDistance;
+	Ar << GrabQuality;
+	Ar << WallHit;
+	Ar << HasHangLedge;
+	Ar << HangLedge;
+	Ar << HangZ;
+	Ar << HangSegment;
+	Ar << HangDistance;
+	Ar << HangStandOff;
+	Ar << HasBase;
+	Ar << BaseTransform;
+}
+
+FArchive& operator<<(FArchive& Ar, FClimbingHit& InOutHit)
+{
+	Ar << InOutHit.ImpactPoint;
+	Ar << InOutHit.ImpactNormal;
+	Ar << InOutHit.SurfaceTopZ;
+	Ar << InOutHit.WalkableFloorZ;
+	SerializeSurface(Ar, InOutHit.Surface);
+	Ar << InOutHit.IsSurfaceClimbable;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FClimbingLedge& InOutLedge)
+{
+	Ar << InOutLedge.Points;
+	Ar << InOutLedge.Normals;
+	Ar << InOutLedge.TopZ;
+	SerializeSurface(Ar, InOutLedge.Surface);
+	Ar << InOutLedge.Revision;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FClimbingGrabSurface& InOutSurface)
+{
+	Ar << InOutSurface.Points;
+	Ar << InOutSurface.TopZ;
+	Ar << InOutSurface.BottomZ;
+	SerializeSurface(Ar, InOutSurface.Surface);
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FClimbingStateSnapshot& InOutSnapshot)
+{
+	Ar << InOutSnapshot.Climbing;
+	Ar << InOutSnapshot.Hanging;
+	Ar << InOutSnapshot.LocationToGrab;
+	Ar << InOutSnapshot.SurfaceNormal;
+	return Ar;
+}
+
+FArchive& operator<<(FArchive& Ar, FClimbingSettings& InOutSettings)
+{
+	Ar << InOutSettings.MaxClimbingDistance;
+	Ar << InOutSettings.MaxClimbingSpeed;
+	Ar << InOutSettings.MaxClimbingStrafeSpeed;
+	Ar << InOutSettings.MaxSurfaceCaptureAngle;
+	Ar << InOutSettings.IsClimbOnHitAllowed;
+	Ar << InOutSettings.FollowLedges;
+	Ar << InOutSettings.ClimbAroundCorners;
+	Ar << InOutSettings.ScanWithRay;
+	Ar << InOutSettings.GrabProbeColumns;
+	Ar << InOutSettings.GrabProbeRows;
+
+	if (Ar.IsLoading())
+	{
+		InOutSettings.UpdateDerived();
+	}
+	return Ar;
+}
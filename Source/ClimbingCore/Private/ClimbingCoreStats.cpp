@@ -0,0 +1,13 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingCoreStats.h"
+
+DEFINE_STAT(STAT_Climbing_ScanForClimbingData);
+DEFINE_STAT(STAT_Climbing_FindClosestVerticalHit);
+DEFINE_STAT(STAT_Climbing_MoveSideways);
+DEFINE_STAT(STAT_Climbing_FollowBase);
+
+CSV_DEFINE_CATEGORY_MODULE(CLIMBINGCORE_API, Climbing, true);
+
+UE_TRACE_CHANNEL_DEFINE(ClimbingChannel);
@@ -0,0 +1,101 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ClimbingCore.h"
+
+/** In-memory stand-in for the scene: axis aligned boxes, answered analytically.
+	Lets FClimbingCore run without an engine world, e.g. to benchmark or fuzz it.
+	Capsules are assumed upright, which is all the climbing rules ever ask for */
+class CLIMBINGCORE_API FAnalyticClimbingWorld : public IClimbingCollision
+{
+public:
+	int32 AddBox(const FBox& InBox);
+
+	void Reset();
+
+	const TArray<FBox>& GetBoxes() const { return Boxes; }
+
+	/** Queries answered since the last reset of the counter */
+	int32 GetNumQueries() const { return NumQueries; }
+
+	void ResetNumQueries() { NumQueries = 0; }
+
+	/** Pushes an upright capsule out of the boxes. Returns the accumulated push, OutNormal is the last contact's normal */
+	FVector ResolvePenetration(FVector& InOutLocation, float InRadius, float InHalfHeight, FVector& OutNormal) const;
+
+	// IClimbingCollision
+	virtual EClimbingQueryStatus SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits) override;
+	virtual bool TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit) override;
+	virtual bool SupportsGrabSurfaces() const override { return true; }
+	virtual EClimbingQueryStatus OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces) override;
+	virtual bool FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge) override;
+	virtual bool IsSurfaceValid(const void* InSurface) const override;
+
+private:
+	/** Closest box along the segment, like a single blocking line trace */
+	bool Raycast(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit) const;
+
+	/** Deepest box overlapping an upright capsule */
+	bool Overlap(const FVector& InLocation, float InRadius, float InHalfHeight, FClimbingHit& OutHit, float& OutPenetration) const;
+
+	FClimbingHit MakeHit(int32 InBoxIndex, const FVector& InPoint, const FVector& InNormal) const;
+
+private:
+	TArray<FBox> Boxes;
+
+	int32 NumQueries = 0;
+};
+
+/** Kinematic character for FAnalyticClimbingWorld: walks, falls or flies, and is pushed out of the boxes */
+class CLIMBINGCORE_API FAnalyticClimbingBody : public IClimbingBody
+{
+public:
+	FAnalyticClimbingBody(const FAnalyticClimbingWorld& InWorld);
+
+	/** Integrates the velocity and resolves the collisions */
+	void Step(float InDeltaTime);
+
+	bool IsFlying() const { return Flying; }
+
+	bool IsMovingOnGround() const { return !Flying && Grounded; }
+
+	FVector Location = FVector::ZeroVector;
+
+	FVector Velocity = FVector::ZeroVector;
+
+	float Yaw = 0.f;
+
+	float Radius = 34.f;
+
+	float HalfHeight = 88.f;
+
+	/** Chest above the capsule's center */
+	float ChestHeight = 44.f;
+
+	float WalkableFloorZ = 0.71f;
+
+	float GravityZ = -980.f;
+
+	// IClimbingBody
+	virtual FVector GetBodyLocation() const override { return Location; }
+	virtual FQuat GetBodyRotation() const override { return FQuat(FVector::UpVector, FMath::DegreesToRadians(Yaw)); }
+	virtual float GetBodyChestZ() const override { return Location.Z + ChestHeight; }
+	virtual void GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const override;
+	virtual float GetBodyWalkableFloorZ() const override { return WalkableFloorZ; }
+	virtual void LaunchClimbMovement(const FVector& InVelocity) override;
+	virtual void ExitClimbMovement() override;
+	virtual void StopBodyMovement() override { Velocity = FVector::ZeroVector; }
+	virtual void OffsetBody(const FVector& InDelta) override { Location += InDelta; }
+	virtual void SetBodyLocation(const FVector& InLocation) override { Location = InLocation; }
+	virtual void FaceBody(const FVector& InDirection) override { Yaw = FMath::RadiansToDegrees(FMath::Atan2(InDirection.Y, InDirection.X)); }
+
+private:
+	const FAnalyticClimbingWorld& World;
+
+	bool Flying = false;
+
+	bool Grounded = false;
+};
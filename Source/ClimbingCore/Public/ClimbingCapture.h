@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Serialization/MemoryWriter.h"
+#include "ClimbingCore.h"
+
+class IFileHandle;
+class IMappedFileHandle;
+class IMappedFileRegion;
+
+/** Record kinds of a climbing capture, written as one byte before each record */
+enum class EClimbingCaptureRecord : uint8
+{
+	/** Delta time of a frame of the owner */
+	Frame,
+	/** Body state at the start of a core call, when it changed */
+	Body,
+	/** Core settings at the start of a core call, when they changed */
+	Settings,
+
+	// Core calls, with their arguments
+	Scan,
+	ApplyScan,
+	UpdateState,
+	MoveSideways,
+	JumpPressed,
+	HangRelease,
+	ResetStates,
+	ApplySnapshot,
+
+	// Scene query results, in the order the core asked for them
+	SweepCapsule,
+	TraceDown,
+	TraceWall,
+	TraceScanRay,
+	FindLedge,
+	IsLedgeCurrent,
+	IsSurfaceValid,
+	GetSurfaceTransform,
+	SupportsGrabSurfaces,
+	OverlapGrabSurfaces,
+
+	/** Hash of the core's state after a call, for replays to tell they are on track */
+	Check
+};
+
+/** What the core reads from its body. Within a call it only changes by what the core itself does to the body */
+struct FClimbingCaptureBody
+{
+	FVector Location = FVector::ZeroVector;
+
+	FQuat Rotation = FQuat::Identity;
+
+	/** Above the location, so it follows the body's moves */
+	float ChestHeight = 0.f;
+
+	float Radius = 0.f;
+
+	float HalfHeight = 0.f;
+
+	float WalkableFloorZ = 0.f;
+
+	bool operator==(const FClimbingCaptureBody& Other) const;
+
+	friend FArchive& operator<<(FArchive& Ar, FClimbingCaptureBody& InOutBody);
+};
+
+/** Capture file layout: magic, version, the core's state, then records until the end of the file */
+namespace ClimbingCapture
+{
+	const uint32 Magic = 0x50434C43; // "CLCP"
+
+	const uint32 Version = 3;
+
+	/** Hash of everything the core decided and of the body it moved, compared after every call.
+		InOutScratch is kept by the caller, to avoid reallocations */
+	uint32 HashState(FClimbingCore& InCore, FClimbingCaptureBody& InBody, TArray<uint8>& InOutScratch);
+}
+
+/** Records what a core is fed: the calls it gets with their arguments, its body's state and the results of its
+	scene queries. Goes between the core and its real body and collision, the writes to the body go through.
+	Records are appended to the file in blocks, a crash only loses the last one */
+class CLIMBINGCORE_API FClimbingCaptureRecorder : public IClimbingBody, public IClimbingCollision
+{
+public:
+	FClimbingCaptureRecorder(IClimbingBody& InBody, IClimbingCollision& InCollision);
+
+	virtual ~FClimbingCaptureRecorder();
+
+	/** Creates the file and writes InCore's state to it, InCore has to run on this recorder */
+	bool Open(const FString& InPath, FClimbingCore& InCore);
+
+	void Close();
+
+	bool IsOpen() const { return File != nullptr; }
+
+	void RecordFrame(float InDeltaTime);
+
+	/** Before a core call. The call's arguments are to be written with << right after */
+	void BeginCall(EClimbingCaptureRecord InCall, FClimbingCore& InCore);
+
+	/** After a core call */
+	void EndCall(FClimbingCore& InCore);
+
+	template<typename T>
+	FClimbingCaptureRecorder& operator<<(T InValue)
+	{
+		Writer << InValue;
+		return *this;
+	}
+
+	// IClimbingBody
+	virtual FVector GetBodyLocation() const override;
+	virtual FQuat GetBodyRotation() const override;
+	virtual float GetBodyChestZ() const override;
+	virtual void GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const override;
+	virtual float GetBodyWalkableFloorZ() const override;
+	virtual void LaunchClimbMovement(const FVector& InVelocity) override;
+	virtual void ExitClimbMovement() override;
+	virtual void StopBodyMovement() override;
+	virtual void OffsetBody(const FVector& InDelta) override;
+	virtual void SetBodyLocation(const FVector& InLocation) override;
+	virtual void FaceBody(const FVector& InDirection) override;
+
+	// IClimbingCollision
+	virtual EClimbingQueryStatus SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits) override;
+	virtual bool TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit) override;
+	virtual bool FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge) override;
+	virtual bool IsLedgeCurrent(const FClimbingLedge& InLedge) const override;
+	virtual bool IsSurfaceValid(const void* InSurface) const override;
+	virtual bool GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const override;
+	virtual bool SupportsGrabSurfaces() const override;
+	virtual EClimbingQueryStatus OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces) override;
+	virtual void CancelPendingQueries() override;
+
+private:
+	FClimbingCaptureBody ReadBody() const;
+
+	void WriteTag(EClimbingCaptureRecord InRecord) const;
+
+	/** Appends the buffered records to the file */
+	void Flush() const;
+
+private:
+	IClimbingBody& Body;
+
+	IClimbingCollision& Collision;
+
+	IFileHandle* File = nullptr;
+
+	/** Records not written to the file yet. Mutable, the const queries record too */
+	mutable TArray<uint8> Buffer;
+
+	mutable FMemoryWriter Writer;
+
+	/** Body as the core sees it during a call, and as it expects it at the next one */
+	FClimbingCaptureBody CallBody;
+
+	bool HasCallBody = false;
+
+	/** Settings last written, serialized */
+	TArray<uint8> LastSettings;
+
+	TArray<uint8> SettingsScratch;
+
+	TArray<uint8> HashScratch;
+
+	bool IsInCall = false;
+};
+
+/** Records the core call made in its scope, if there is a recorder. The call's arguments are written with << */
+class FClimbingCaptureCallScope
+{
+public:
+	FClimbingCaptureCallScope(FClimbingCaptureRecorder* InRecorder, EClimbingCaptureRecord InCall, FClimbingCore& InCore)
+		: Recorder(InRecorder)
+		, Core(InCore)
+	{
+		if (Recorder)
+		{
+			Recorder->BeginCall(InCall, Core);
+		}
+	}
+
+	~FClimbingCaptureCallScope()
+	{
+		if (Recorder)
+		{
+			Recorder->EndCall(Core);
+		}
+	}
+
+	template<typename T>
+	FClimbingCaptureCallScope& operator<<(T InValue)
+	{
+		if (Recorder)
+		{
+			*Recorder << InValue;
+		}
+		return *this;
+	}
+
+private:
+	FClimbingCaptureRecorder* Recorder;
+
+	FClimbingCore& Core;
+};
+
+/** Replay statistics */
+struct FClimbingCaptureReplayResult
+{
+	int64 NumFrames = 0;
+
+	int64 NumCalls = 0;
+
+	/** First call the core didn't end in the recorded state, INDEX_NONE if none */
+	int64 FirstMismatchCall = INDEX_NONE;
+
+	int64 FirstMismatchFrame = INDEX_NONE;
+
+	/** The file ended in the middle of a record, e.g. the game crashed */
+	bool IsTruncated = false;
+
+	double Seconds = 0.0;
+};
+
+/** Runs a capture again on a fresh core, with no world: the file is mapped to memory, the body's state
+	and the scene query results are read from it. The core has to take the recorded decisions again */
+class CLIMBINGCORE_API FClimbingCaptureReplay : public IClimbingBody, public IClimbingCollision
+{
+public:
+	FClimbingCaptureReplay();
+
+	virtual ~FClimbingCaptureReplay();
+
+	bool Open(const FString& InPath);
+
+	/** Replays up to InMaxFrames frames (all if negative). With InStopOnMismatch it stops at the first call
+		the core doesn't take as recorded, e.g. to bisect a change of the rules */
+	FClimbingCaptureReplayResult Run(int64 InMaxFrames = -1, bool InStopOnMismatch = true);
+
+	const FClimbingCore& GetCore() const { return *Core; }
+
+	// IClimbingBody
+	virtual FVector GetBodyLocation() const override { return CallBody.Location; }
+	virtual FQuat GetBodyRotation() const override { return CallBody.Rotation; }
+	virtual float GetBodyChestZ() const override { return CallBody.Location.Z + CallBody.ChestHeight; }
+	virtual void GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const override;
+	virtual float GetBodyWalkableFloorZ() const override { return CallBody.WalkableFloorZ; }
+	virtual void LaunchClimbMovement(const FVector& InVelocity) override {}
+	virtual void ExitClimbMovement() override {}
+	virtual void StopBodyMovement() override {}
+	virtual void OffsetBody(const FVector& InDelta) override { CallBody.Location += InDelta; }
+	virtual void SetBodyLocation(const FVector& InLocation) override { CallBody.Location = InLocation; }
+	virtual void FaceBody(const FVector& InDirection) override;
+
+	// IClimbingCollision
+	virtual EClimbingQueryStatus SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits) override;
+	virtual bool TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit) override;
+	virtual bool FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge) override;
+	virtual bool IsLedgeCurrent(const FClimbingLedge& InLedge) const override;
+	virtual bool IsSurfaceValid(const void* InSurface) const override;
+	virtual bool GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const override;
+	virtual bool SupportsGrabSurfaces() const override;
+	virtual EClimbingQueryStatus OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces) override;
+
+private:
+	/** Reads the next record's tag, which has to be InExpected. A replay that doesn't ask what was recorded is off track */
+	bool ExpectRecord(EClimbingCaptureRecord InExpected) const;
+
+	/** Reads a call's arguments and makes it */
+	void ReplayCall(EClimbingCaptureRecord InCall);
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+
+	/** Reads the mapped records. Mutable, the const queries read their results too */
+	mutable TUniquePtr<FArchive> Reader;
+
+	TUniquePtr<FClimbingCore> Core;
+
+	/** Body as the core sees it during a call, starting from the last recorded state */
+	FClimbingCaptureBody CallBody;
+
+	TArray<uint8> HashScratch;
+
+	/** Set when a query record didn't match the query asked */
+	mutable bool IsOffTrack = false;
+};
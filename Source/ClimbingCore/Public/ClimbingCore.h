@@ -0,0 +1,521 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/** Result of a query that may be answered asynchronously */
+enum class EClimbingQueryStatus : uint8
+{
+	Miss,
+	Hit,
+	Pending,
+	/** The geometry found can't be answered for by this query, the basic one has to be used instead */
+	Unsupported
+};
+
+/** Reasons to leave the climbing state */
+enum class EClimbingStopReason : uint8
+{
+	StartFalling,
+	StartHanging
+};
+
+/** Where one step of a climb leaves it, see FClimbingCore::StepClimb */
+enum class EClimbingStep : uint8
+{
+	Climb,
+	Hang,
+	Drop
+};
+
+/** What the climbing rules need to know about a hit */
+struct FClimbingHit
+{
+	FVector ImpactPoint = FVector::ZeroVector;
+
+	FVector ImpactNormal = FVector::ZeroVector;
+
+	/** Top of the hit primitive's bounds */
+	float SurfaceTopZ = 0.f;
+
+	/** Walkable floor Z of the hit surface, negative to use the body's one */
+	float WalkableFloorZ = -1.f;
+
+	/** Identity of what was hit, only meaningful to the collision implementation */
+	const void* Surface = nullptr;
+
+	/** Cleared by the collision implementation for surfaces its rules forbid to climb, whatever their shape */
+	bool IsSurfaceClimbable = true;
+};
+
+/** Surfaces to classify at once, one column per value so they can be loaded four at a time.
+	The thresholds are per surface too, so a batch may gather the hits of many characters */
+struct FClimbingSurfaceBatch
+{
+	typedef TArray<float, TAlignedHeapAllocator<16>> FColumn;
+
+	FColumn NormalX;
+
+	FColumn NormalY;
+
+	FColumn NormalZ;
+
+	FColumn ForwardX;
+
+	FColumn ForwardY;
+
+	FColumn WalkableFloorZ;
+
+	FColumn CaptureAngleCos;
+
+	int32 Num() const { return NormalX.Num(); }
+
+	/** Keeps the memory */
+	void Reset();
+
+	void Reserve(int32 InNum);
+
+	/** Same arguments as FClimbingCore::IsClimbableSurface. Returns the surface's index */
+	int32 Add(const FClimbingHit& InHit, const FVector& InForward, float InWalkableFloorZ, float InCaptureAngleCos);
+};
+
+/** Rim of a grabbed ledge, followed while hanging without any scene query */
+struct FClimbingLedge
+{
+	/** Rim corners, counter-clockwise when seen from above, the last one connects to the first */
+	TArray<FVector2D, TInlineAllocator<8>> Points;
+
+	/** Outward normal of each rim segment, segment i goes from Points[i] to Points[i + 1] */
+	TArray<FVector2D, TInlineAllocator<8>> Normals;
+
+	float TopZ = 0.f;
+
+	/** What the ledge was extracted from and its version, only meaningful to the collision implementation */
+	const void* Surface = nullptr;
+
+	uint32 Revision = 0;
+};
+
+/** Top face of a primitive the hands may be put on, for the multi-probe grab search */
+struct FClimbingGrabSurface
+{
+	/** Top face corners, counter-clockwise when seen from above */
+	TArray<FVector2D, TInlineAllocator<8>> Points;
+
+	float TopZ = 0.f;
+
+	/** Bottom of the primitive, there is no room for the hands on a top under it */
+	float BottomZ = 0.f;
+
+	/** Only meaningful to the collision implementation */
+	const void* Surface = nullptr;
+};
+
+/** Results of the multi-hit queries. Inline, so the usual counts never touch the heap */
+typedef TArray<FClimbingHit, TInlineAllocator<8>> FClimbingHitArray;
+
+typedef TArray<FClimbingGrabSurface, TInlineAllocator<4>> FClimbingGrabSurfaceArray;
+
+/** Results of the multi-hit queries, only used within FindLocationToGrab. Cores updated one after another can share one,
+	e.g. all the climbers of a world, instead of each carrying its own */
+struct FClimbingQueryScratch
+{
+	FClimbingHitArray VerticalHits;
+
+	FClimbingGrabSurfaceArray GrabSurfaces;
+};
+
+/** Location to grab picked by the multi-probe search */
+struct FClimbingGrab
+{
+	FVector Location = FVector::ZeroVector;
+
+	/** From 0 to 1: how much of the body's width the grabbed top supports, and how centered the grab is */
+	float Quality = 0.f;
+
+	const void* Surface = nullptr;
+};
+
+/** What defines a climbing state from the outside, e.g. to replicate or record it */
+struct FClimbingStateSnapshot
+{
+	bool Climbing = false;
+
+	bool Hanging = false;
+
+	FVector LocationToGrab = FVector::ZeroVector;
+
+	FVector SurfaceNormal = FVector::ZeroVector;
+};
+
+/** Tuning of the climbing rules */
+struct FClimbingSettings
+{
+	/** Max height that can be climbed */
+	float MaxClimbingDistance = 200.f;
+
+	/** Speed with which a character moves on the walls vertically */
+	float MaxClimbingSpeed = 200.f;
+
+	/** Speed with which a character moves on the walls sideways */
+	float MaxClimbingStrafeSpeed = 200.f;
+
+	/** An angle of capturing a surface. UpdateDerived has to be called after changing it */
+	float MaxSurfaceCaptureAngle = 45.f;
+
+	/** Climbing only starts when allowed, e.g. on sprinting or jumping */
+	bool IsClimbOnHitAllowed = false;
+
+	/** Slide along the grabbed ledge's rim while hanging, instead of tracing the wall every move */
+	bool FollowLedges = true;
+
+	/** Go around the outer corners of a followed ledge, instead of stopping at them */
+	bool ClimbAroundCorners = true;
+
+	/** Scan with a single ray along the body's forward, instead of a capsule. Cheaper, for distant characters */
+	bool ScanWithRay = false;
+
+	/** Probes across the body's width looking for a location to grab. With more than one, the surfaces
+		of a single overlap are searched instead of tracing down, if the collision supports it */
+	int32 GrabProbeColumns = 1;
+
+	/** Probes from the wall into the ledge, up to the body's radius */
+	int32 GrabProbeRows = 1;
+
+	/** Computed once from MaxSurfaceCaptureAngle, not on every surface check */
+	float GetCaptureAngleCos() const { return CaptureAngleCos; }
+
+	/** Recomputes the values derived from the others */
+	void UpdateDerived()
+	{
+		CaptureAngleCos = FMath::Cos(FMath::DegreesToRadians(180.f - MaxSurfaceCaptureAngle));
+	}
+
+private:
+	/** Of the default capture angle */
+	float CaptureAngleCos = -0.70710678f;
+};
+
+/** Binary serialization of the climbing data, e.g. for captures. Surfaces go as their address, which is only an identity */
+CLIMBINGCORE_API FArchive& operator<<(FArchive& Ar, FClimbingHit& InOutHit);
+CLIMBINGCORE_API FArchive& operator<<(FArchive& Ar, FClimbingLedge& InOutLedge);
+CLIMBINGCORE_API FArchive& operator<<(FArchive& Ar, FClimbingGrabSurface& InOutSurface);
+CLIMBINGCORE_API FArchive& operator<<(FArchive& Ar, FClimbingStateSnapshot& InOutSnapshot);
+CLIMBINGCORE_API FArchive& operator<<(FArchive& Ar, FClimbingSettings& InOutSettings);
+
+/** The character being climbed with */
+class IClimbingBody
+{
+public:
+	virtual ~IClimbingBody() {}
+
+	virtual FVector GetBodyLocation() const = 0;
+
+	virtual FQuat GetBodyRotation() const = 0;
+
+	/** Height of the chest, the grab has to be above it */
+	virtual float GetBodyChestZ() const = 0;
+
+	virtual void GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const = 0;
+
+	virtual float GetBodyWalkableFloorZ() const = 0;
+
+	/** Switch to the gravity free climbing movement and launch */
+	virtual void LaunchClimbMovement(const FVector& InVelocity) = 0;
+
+	/** Back to the regular walking movement with gravity */
+	virtual void ExitClimbMovement() = 0;
+
+	virtual void StopBodyMovement() = 0;
+
+	/** Teleport by an offset */
+	virtual void OffsetBody(const FVector& InDelta) = 0;
+
+	virtual void SetBodyLocation(const FVector& InLocation) = 0;
+
+	/** Turns the body to look along InDirection, e.g. at the wall after going around a corner */
+	virtual void FaceBody(const FVector& InDirection) {}
+};
+
+/** The scene queries of the climbing rules */
+class IClimbingCollision
+{
+public:
+	virtual ~IClimbingCollision() {}
+
+	/** Overlap of a capsule at a location (TickTrace). May answer Pending, then keep asking every frame */
+	virtual EClimbingQueryStatus SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit) = 0;
+
+	/** Top-down trace for a location to grab (UpwardTrace). Hits are sorted from InBegin to InEnd.
+		InMinZ and InWall are hints, for implementations answering without a trace */
+	virtual EClimbingQueryStatus TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits) = 0;
+
+	/** Horizontal trace checking that the wall goes on (CanMoveSidewaysToLocation).
+		InMaxDepth is how far below a ledge the trace is expected to be */
+	virtual bool TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit) = 0;
+
+	/** Single blocking ray for the scan, when it doesn't use a capsule. Defaults to the wall trace */
+	virtual EClimbingQueryStatus TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit)
+	{
+		return TraceWall(InStart, InEnd, BIG_NUMBER, OutHit) ? EClimbingQueryStatus::Hit : EClimbingQueryStatus::Miss;
+	}
+
+	/** Rim of the ledge with its top at InLocation.Z, closest to InLocation. Implementations without ledge data return false */
+	virtual bool FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge) { return false; }
+
+	/** Whether OverlapGrabSurfaces is implemented */
+	virtual bool SupportsGrabSurfaces() const { return false; }
+
+	/** Top faces of the primitives overlapping InBounds, with a single query (multi-probe grab search).
+		InWall is a hint, as for TraceDown. Unsupported if the top of a primitive in the way can't be told */
+	virtual EClimbingQueryStatus OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces)
+	{
+		return EClimbingQueryStatus::Miss;
+	}
+
+	/** Whether the geometry a ledge was extracted from is unchanged */
+	virtual bool IsLedgeCurrent(const FClimbingLedge& InLedge) const { return true; }
+
+	/** Whether a hit surface still exists */
+	virtual bool IsSurfaceValid(const void* InSurface) const { return InSurface != nullptr; }
+
+	/** World transform of a surface that may move, e.g. a platform or a vehicle. False for surfaces that never move,
+		and for the ones that are gone */
+	virtual bool GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const { return false; }
+
+	/** Forget about queries in flight, their result is not wanted anymore */
+	virtual void CancelPendingQueries() {}
+};
+
+/** Climbing state machine and geometry, with no dependency on the engine's world or actors.
+	UClimbingComponent is an adapter over it, tools can drive it with any body and collision */
+class CLIMBINGCORE_API FClimbingCore
+{
+public:
+	FClimbingCore(IClimbingBody& InBody, IClimbingCollision& InCollision);
+
+	FClimbingSettings Settings;
+
+	/** Scan and state update, what a component does every frame */
+	void Tick(float InDeltaTime);
+
+	/** If climbing is not allowed by the user and we are not on the wall, no need to update any data for climbing */
+	bool ShouldScan() const;
+
+	/** Prepare data, that will be used on StartClimbing */
+	void Scan();
+
+	/** Capsule used by Scan */
+	void GetScanCapsule(FVector& OutLocation, FQuat& OutRotation, float& OutRadius, float& OutHalfHeight) const;
+
+	/** Ray used by Scan when Settings.ScanWithRay is set */
+	void GetScanRay(FVector& OutStart, FVector& OutEnd) const;
+
+	/** Stores the result of a scan, however it was run */
+	void ApplyScan(bool InHasHit, const FClimbingHit& InHit, bool InIsHitClimbable);
+
+	/** Starts or updates the climb, according to the latest scan. Follows the moving base first */
+	void UpdateState();
+
+	/** Carries the grab data and the body along with the wall they are on, when it moves. Part of UpdateState */
+	void FollowBase();
+
+	void MoveSideways(float InScale, float InDeltaTime);
+
+	void HangRelease();
+
+	/** Climbs on from the ledge, up the wall above it */
+	void JumpPressed();
+
+	/** Reset values that define any climbing state, reset a climbing ability */
+	void ResetStates();
+
+	FClimbingStateSnapshot GetSnapshot() const;
+
+	/** Snaps to a state decided elsewhere, e.g. by the server. With InDriveBody the body is switched
+		to the matching movement, otherwise it is assumed to be moved by someone else */
+	void ApplySnapshot(const FClimbingStateSnapshot& InSnapshot, bool InDriveBody);
+
+	/** Saves or loads everything the rules decide with, settings included. A loaded core goes on exactly as the saved one */
+	void SerializeState(FArchive& Ar);
+
+	bool IsClimbing() const { return Climbing; }
+
+	bool IsHanging() const { return Hanging; }
+
+	bool IsOnTheWall() const { return Climbing || Hanging; }
+
+	/** On a wall that may move, which has to be followed every update */
+	bool IsOnMovingBase() const { return HasBase; }
+
+	/** Ledge location climbed to, or held while hanging */
+	const FVector& GetLocationToGrab() const { return LocationToGrab; }
+
+	const FVector& GetSurfaceNormal() const { return CurrentSurfaceNormal; }
+
+	/** Wall climbed on, or last climbable wall scanned */
+	const FClimbingHit& GetWallHit() const { return WallHit; }
+
+	float GetClimbedDistance() const { return ClimbedDistance; }
+
+	/** Quality of the location to grab from the multi-probe search, 1 when it was traced with a single ray */
+	float GetGrabQuality() const { return GrabQuality; }
+
+	/** Climbs stopped by the max climbing distance while a location to grab was known, since the core was created.
+		Telemetry, not part of the saved state */
+	uint32 GetNumAbortedGrabs() const { return NumAbortedGrabs; }
+
+	/** Heap memory of the state, the ledge followed when it doesn't fit inline, and the scratch when it has its own */
+	SIZE_T GetAllocatedSize() const;
+
+	/** Scratch shared with other cores, which must outlive its use. Without one, the core allocates its own on first use */
+	void SetQueryScratch(FClimbingQueryScratch* InScratch) { QueryScratch = InScratch; }
+
+	/** Time until the climb ends, by reaching the location to grab or the max climbing distance.
+		Lets callers updating the state rarely be on time for it. Negative when not climbing */
+	float GetTimeToClimbEnd() const;
+
+	/** Surface check */
+	bool IsClimbable(const FClimbingHit& InHit) const;
+
+	static bool IsClimbableSurface(const FClimbingHit& InHit, const FVector& InForward, float InWalkableFloorZ, float InCaptureAngleCos);
+
+	/** IsClimbableSurface for a whole batch, four surfaces per instruction. OutClimbable[i] is for the batch's surface i */
+	static void ClassifySurfaces(const FClimbingSurfaceBatch& InBatch, TArray<bool>& OutClimbable);
+
+	/** Lowest hit on the top of its primitive, and above the chest */
+	static bool FindClosestVerticalHit(const FClimbingHitArray& InHits, float InChestZ, FClimbingHit& OutHit);
+
+	/** Multi-probe grab search: a grid of probes in front of the wall, InColumns across 2 * InRadius and InRows up to
+		InRadius deep, each looking down InSurfaces from InMaxZ. Picks the lowest top above InMinZ, then the best quality */
+	static bool FindBestGrab(const FClimbingGrabSurfaceArray& InSurfaces, const FVector& InWallPoint, const FVector& InWallNormal,
+		float InRadius, float InMinZ, float InMaxZ, int32 InColumns, int32 InRows, FClimbingGrab& OutGrab);
+
+	/** The rules' geometry, for callers keeping the state of many climbers themselves (e.g. UClimbingCrowdSubsystem) */
+
+	/** Scan ray from a body's location, facing and capsule radius */
+	static void MakeScanRay(const FVector& InLocation, const FVector& InForward, float InBodyRadius, FVector& OutStart, FVector& OutEnd);
+
+	/** Velocity a climb starts with, up and into the wall. The wall takes its horizontal part away */
+	static FVector GetLaunchVelocity(const FVector& InSurfaceNormal, float InSpeed);
+
+	/** Whether a climb from InStart may go on at InLocation */
+	static bool IsWithinClimbingDistance(const FVector& InStart, const FVector& InLocation, float InMaxDistance, float& OutClimbedDistance);
+
+	/** Vertical range searched for a ledge, from as high as the climb can still go down to the wall's point, a radius into it */
+	static void MakeUpwardTraceRange(const FVector& InWallPoint, const FVector& InWallNormal, float InBodyRadius, float InRemainingDistance,
+		FVector& OutBegin, FVector& OutEnd);
+
+	/** Hangs once the chest is up to InLocationToGrab, zero while none is found, and drops out of the climbing distance.
+		When hanging, OutHangOffsetZ moves the body back to the ledge from past it */
+	static EClimbingStep StepClimb(const FVector& InStart, const FVector& InLocation, float InChestZ, const FVector& InLocationToGrab,
+		float InMaxDistance, float& OutClimbedDistance, float& OutHangOffsetZ);
+
+	static bool BoxContainsVector(const FVector& Origin, const FVector& Extent, const FVector& InVector);
+
+private:
+	bool CanStartClimbing() const;
+
+	/** Updates LocationToGrab. Returns if there is a reachable location to grab,
+		or if the query looking for it is still pending */
+	bool FindLocationToGrab();
+
+	/** FindLocationToGrab with FindBestGrab, on the surfaces of a single overlap.
+		Falls back to FindLocationToGrabWithTrace when the overlap can't tell the tops of what it found */
+	bool FindLocationToGrabWithProbes(const FVector& InRangeBegin, const FVector& InRangeEnd, float InMinZ);
+
+	/** FindLocationToGrab with a single trace down */
+	bool FindLocationToGrabWithTrace(const FVector& InRangeBegin, const FVector& InRangeEnd, float InMinZ);
+
+	/** Vertical segment in front of the wall hit, where a location to grab is looked for */
+	void GetUpwardTraceRange(FVector& OutBegin, FVector& OutEnd) const;
+
+	void StartClimbing();
+
+	void StopClimbing(EClimbingStopReason InReason);
+
+	/** Takes the wall as the base to follow, if it may move */
+	void AttachToBase();
+
+	void UpdateClimbing();
+
+	void StartHanging();
+
+	void StopHanging();
+
+	bool CanMoveSidewaysToLocation(const FVector& InTargetLocation, FClimbingHit& OutHit);
+
+	/** Extracts the ledge under the hands and finds where on its rim the body is. Returns false if there is no ledge data */
+	bool AttachToLedge();
+
+	FClimbingQueryScratch& GetQueryScratch();
+
+	/** Moves the body along the rim of HangLedge. Returns false, without moving, when the end of the ledge is reached */
+	bool SlideAlongLedge(float InDistance);
+
+	/** Moves the body onto the next rim segment, past the outer corner at the end of HangSegment
+		(the start of it when going backwards). Returns false if there is no such corner */
+	bool MoveAroundCorner(bool InForward);
+
+private:
+	IClimbingBody& Body;
+
+	IClimbingCollision& Collision;
+
+	bool Climbing = false;
+
+	bool Hanging = false;
+
+	/** Resets on touching the groung, or hanging */
+	bool HasAbilityToClimb = true;
+
+	bool IsLocationPotentiallyReachable = true;
+
+	/** Or height to climb */
+	FVector LocationToGrab = FVector::ZeroVector;
+
+	/** A surface we are currently operating with */
+	FVector CurrentSurfaceNormal = FVector::ZeroVector;
+
+	/** To track the climbed distance */
+	FVector ClimbingStartLocation = FVector::ZeroVector;
+
+	/** How far we've already climbed */
+	float ClimbedDistance = 0.f;
+
+	/** To store initial data, retrieved from a hit on object to climb */
+	FClimbingHit WallHit;
+
+	float GrabQuality = 0.f;
+
+	/** Ledge followed while hanging, valid when HasHangLedge is set */
+	FClimbingLedge HangLedge;
+
+	bool HasHangLedge = false;
+
+	/** Height of the ledge grabbed when the hang started */
+	float HangZ = 0.f;
+
+	/** Rim segment of HangLedge the body is at */
+	int32 HangSegment = 0;
+
+	/** Distance from the start of HangSegment */
+	float HangDistance = 0.f;
+
+	/** Distance from the rim to the body, along the segment's normal */
+	float HangStandOff = 0.f;
+
+	/** The wall climbed or hung on may move. The grab data is kept relative to it */
+	bool HasBase = false;
+
+	/** Transform of the base when the grab data was last brought up to date */
+	FTransform BaseTransform = FTransform::Identity;
+
+	uint32 NumAbortedGrabs = 0;
+
+	/** Shared or own, see SetQueryScratch */
+	FClimbingQueryScratch* QueryScratch = nullptr;
+
+	TUniquePtr<FClimbingQueryScratch> OwnQueryScratch;
+};
@@ -0,0 +1,27 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "Trace/Trace.h"
+
+DECLARE_STATS_GROUP(TEXT("Climbing"), STATGROUP_Climbing, STATCAT_Advanced);
+
+/** The climbing rules' own stats. The rest of the group is declared by the WallClimb module */
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ScanForClimbingData"), STAT_Climbing_ScanForClimbingData, STATGROUP_Climbing, CLIMBINGCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindClosestVerticalHit"), STAT_Climbing_FindClosestVerticalHit, STATGROUP_Climbing, CLIMBINGCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MoveSideways"), STAT_Climbing_MoveSideways, STATGROUP_Climbing, CLIMBINGCORE_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FollowBase"), STAT_Climbing_FollowBase, STATGROUP_Climbing, CLIMBINGCORE_API);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(CLIMBINGCORE_API, Climbing);
+
+UE_TRACE_CHANNEL_EXTERN(ClimbingChannel, CLIMBINGCORE_API);
+
+/** Cycle stat, CSV timer and Insights event in one go. Stat is one of the STAT_Climbing_ names, without the prefix */
+#define CLIMBING_SCOPE_CYCLE_COUNTER(Stat) \
+	SCOPE_CYCLE_COUNTER(STAT_Climbing_##Stat); \
+	CSV_SCOPED_TIMING_STAT(Climbing, Stat); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Climbing_##Stat, ClimbingChannel)
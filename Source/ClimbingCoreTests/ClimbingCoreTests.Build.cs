@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class ClimbingCoreTests : ModuleRules
+{
+	public ClimbingCoreTests(ReadOnlyTargetRules Target) : base(Target)
+	{
+		// The program's main comes from Launch, as for the engine's own programs
+		PublicIncludePaths.Add("Runtime/Launch/Public");
+		PrivateIncludePaths.Add("Runtime/Launch/Private");
+
+		PrivateDependencyModuleNames.AddRange(new string[] { "Core", "Projects", "ClimbingCore" });
+	}
+}
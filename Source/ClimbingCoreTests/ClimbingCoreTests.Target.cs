@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+/** Console program running the climbing rules on the analytic world, without the engine */
+[SupportedPlatforms(UnrealPlatformClass.Desktop)]
+public class ClimbingCoreTestsTarget : TargetRules
+{
+	public ClimbingCoreTestsTarget(TargetInfo Target) : base(Target)
+	{
+		Type = TargetType.Program;
+		LinkType = TargetLinkType.Monolithic;
+		LaunchModuleName = "ClimbingCoreTests";
+
+		// Core only, as the rules
+		bCompileAgainstEngine = false;
+		bCompileAgainstCoreUObject = false;
+		bCompileAgainstApplicationCore = false;
+		bBuildDeveloperTools = false;
+		bBuildWithEditorOnlyData = false;
+		bCompileICU = false;
+		bIsBuildingConsoleApplication = true;
+	}
+}
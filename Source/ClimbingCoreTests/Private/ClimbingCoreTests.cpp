@@ -0,0 +1,164 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "RequiredProgramMainCPPInclude.h"
+#include "Math/RandomStream.h"
+
+#include "ClimbingCore.h"
+#include "AnalyticClimbingWorld.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogClimbingCoreTests, Log, All);
+
+IMPLEMENT_APPLICATION(ClimbingCoreTests, "ClimbingCoreTests");
+
+namespace
+{
+	const float TestDeltaTime = 1.f / 60.f;
+
+	/** Walks into a wall lower than the climbing distance, which has to end hanging on its top */
+	bool TestClimbToHang(int32 InNumFrames)
+	{
+		FAnalyticClimbingWorld World;
+		World.AddBox(FBox(FVector(-1000.f, -1000.f, -100.f), FVector(1000.f, 1000.f, 0.f)));
+		World.AddBox(FBox(FVector(0.f, -500.f, 0.f), FVector(50.f, 500.f, 250.f)));
+
+		FAnalyticClimbingBody Body(World);
+		Body.Location = FVector(-Body.Radius - 1.f, 0.f, Body.HalfHeight + 1.f);
+
+		FClimbingCore Core(Body, World);
+		Core.Settings.IsClimbOnHitAllowed = true;
+
+		for (int32 Frame = 0; Frame < InNumFrames; ++Frame)
+		{
+			Body.Step(TestDeltaTime);
+			Core.Tick(TestDeltaTime);
+
+			if (Core.IsHanging())
+			{
+				return FMath::IsNearlyEqual(Core.GetLocationToGrab().Z, 250.f, 1.f);
+			}
+		}
+
+		return false;
+	}
+
+	/** Random worlds and inputs, one per seed. Returns the number of seeds that broke an invariant */
+	int32 RunCoreFuzz(int32 InNumSeeds, int32 InNumFrames)
+	{
+		int32 NumFailures = 0;
+
+		for (int32 Seed = 0; Seed < InNumSeeds; ++Seed)
+		{
+			FRandomStream Random(Seed);
+
+			// A floor and a random pile of boxes
+			FAnalyticClimbingWorld World;
+			World.AddBox(FBox(FVector(-2000.f, -2000.f, -100.f), FVector(2000.f, 2000.f, 0.f)));
+
+			const int32 NumBoxes = Random.RandRange(1, 16);
+			for (int32 i = 0; i < NumBoxes; ++i)
+			{
+				const FVector Center(Random.FRandRange(-1000.f, 1000.f), Random.FRandRange(-1000.f, 1000.f), Random.FRandRange(0.f, 300.f));
+				const FVector Extent(Random.FRandRange(10.f, 400.f), Random.FRandRange(10.f, 400.f), Random.FRandRange(10.f, 300.f));
+				World.AddBox(FBox(Center - Extent, Center + Extent));
+			}
+
+			FAnalyticClimbingBody Body(World);
+			Body.Location = FVector(Random.FRandRange(-1000.f, 1000.f), Random.FRandRange(-1000.f, 1000.f), Random.FRandRange(100.f, 600.f));
+			Body.Yaw = Random.FRandRange(0.f, 360.f);
+			Body.Radius = Random.FRandRange(20.f, 50.f);
+			Body.HalfHeight = Body.Radius + Random.FRandRange(10.f, 100.f);
+			Body.ChestHeight = Body.HalfHeight * 0.5f;
+
+			FClimbingCore Core(Body, World);
+			Core.Settings.MaxClimbingDistance = Random.FRandRange(50.f, 400.f);
+			Core.Settings.MaxClimbingSpeed = Random.FRandRange(50.f, 400.f);
+			Core.Settings.MaxClimbingStrafeSpeed = Random.FRandRange(50.f, 400.f);
+			Core.Settings.MaxSurfaceCaptureAngle = Random.FRandRange(0.f, 45.f);
+			Core.Settings.UpdateDerived();
+
+			FString Failure;
+			for (int32 Frame = 0; Frame < InNumFrames && Failure.IsEmpty(); ++Frame)
+			{
+				Body.Step(TestDeltaTime);
+
+				// Random player input
+				Core.Settings.IsClimbOnHitAllowed = Random.FRand() < 0.8f;
+				Body.Yaw += Random.FRandRange(-10.f, 10.f);
+				Body.Velocity += FVector(Random.FRandRange(-50.f, 50.f), Random.FRandRange(-50.f, 50.f), 0.f);
+
+				switch (Random.RandRange(0, 9))
+				{
+				case 0:
+					Core.HangRelease();
+					break;
+				case 1:
+					Core.ResetStates();
+					break;
+				case 2:
+				case 3:
+					Core.MoveSideways(Random.FRandRange(-1.f, 1.f), TestDeltaTime);
+					break;
+				default:
+					break;
+				}
+
+				Core.Tick(TestDeltaTime);
+
+				if (Core.IsClimbing() && Core.IsHanging())
+				{
+					Failure = TEXT("climbing and hanging at once");
+				}
+				else if (Body.Location.ContainsNaN() || Core.GetSurfaceNormal().ContainsNaN() || Core.GetLocationToGrab().ContainsNaN())
+				{
+					Failure = TEXT("NaN in the state");
+				}
+				else if (Core.IsClimbing() && !Body.IsFlying())
+				{
+					Failure = TEXT("climbing without the climbing movement");
+				}
+				else if (Core.GetClimbedDistance() > Core.Settings.MaxClimbingDistance + Core.Settings.MaxClimbingSpeed * TestDeltaTime * 2.f + Body.HalfHeight)
+				{
+					Failure = TEXT("climbed past the max distance");
+				}
+			}
+
+			if (!Failure.IsEmpty())
+			{
+				UE_LOG(LogClimbingCoreTests, Error, TEXT("[%s] Seed %d: %s."), *FString(__FUNCTION__), Seed, *Failure);
+				++NumFailures;
+			}
+		}
+
+		return NumFailures;
+	}
+}
+
+/** Runs the climbing rules with no engine: a climb against one wall, then -Seeds=<N> random worlds checked for broken invariants.
+	Usage: ClimbingCoreTests [-Seeds=100] [-Frames=600] */
+INT32_MAIN_INT32_ARGC_TCHAR_ARGV()
+{
+	GEngineLoop.PreInit(ArgC, ArgV);
+
+	int32 NumSeeds = 100;
+	FParse::Value(FCommandLine::Get(), TEXT("Seeds="), NumSeeds);
+
+	int32 NumFrames = 600;
+	FParse::Value(FCommandLine::Get(), TEXT("Frames="), NumFrames);
+
+	int32 NumFailures = 0;
+
+	if (!TestClimbToHang(NumFrames))
+	{
+		UE_LOG(LogClimbingCoreTests, Error, TEXT("[%s] The climb against a single wall didn't end hanging on its top."), *FString(__FUNCTION__));
+		++NumFailures;
+	}
+
+	const int32 NumFuzzFailures = RunCoreFuzz(NumSeeds, NumFrames);
+	UE_LOG(LogClimbingCoreTests, Display, TEXT("[%s] Fuzz: %d of %d seeds failed."), *FString(__FUNCTION__), NumFuzzFailures, NumSeeds);
+	NumFailures += NumFuzzFailures;
+
+	FEngineLoop::AppExit();
+
+	return NumFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,278 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BakedLedgeSubsystem.h"
+
+#include "GameFramework/Actor.h"
+#include "LedgeBakeData.h"
+#include "LedgeGeometry.h"
+
+namespace
+{
+	const float BakedLedgeCellSize = 500.f;
+
+	/** Longest horizontal query against the grid */
+	const float BakedLedgeMaxReach = 100.f;
+}
+
+void UBakedLedgeSubsystem::Register(const ULedgeBakeData* InData, const ULevel* InLevel)
+{
+	if (!(InData) || Registered.Contains(InData))
+	{
+		return;
+	}
+
+	Registered.Add(InData);
+	LevelData.Add(InLevel, InData);
+	++Revision;
+
+	const TArray<FLedgeShape>& Ledges = InData->GetLedges();
+	TArray<FIntPoint, TInlineAllocator<8>> Cells;
+	for (int32 i = 0; i < Ledges.Num(); ++i)
+	{
+		GetCells(Ledges[i], Cells);
+		for (const FIntPoint& Cell : Cells)
+		{
+			Grid.FindOrAdd(Cell).Add({ InData, i });
+		}
+	}
+}
+
+void UBakedLedgeSubsystem::Unregister(const ULedgeBakeData* InData)
+{
+	if (Registered.Remove(InData) == 0)
+	{
+		return;
+	}
+
+	for (auto It = LevelData.CreateIterator(); It; ++It)
+	{
+		if (It.Value() == InData)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	++Revision;
+
+	const TArray<FLedgeShape>& Ledges = InData->GetLedges();
+	TArray<FIntPoint, TInlineAllocator<8>> Cells;
+	for (const FLedgeShape& Ledge : Ledges)
+	{
+		GetCells(Ledge, Cells);
+		for (const FIntPoint& Cell : Cells)
+		{
+			auto* Refs = Grid.Find(Cell);
+			if (!Refs)
+			{
+				continue;
+			}
+
+			Refs->RemoveAllSwap([InData](const FBakedLedgeRef& Ref) { return Ref.Data == InData; });
+			if (Refs->Num() == 0)
+			{
+				Grid.Remove(Cell);
+			}
+		}
+	}
+}
+
+bool UBakedLedgeSubsystem::GetActorLedges(const AActor* InActor, TArray<FLedgeShape>& OutLedges) const
+{
+	const ULedgeBakeData* Data;
+	const FLedgeBakeActorRecord* Record;
+	if (!FindActorRecord(InActor, Data, Record))
+	{
+		return false;
+	}
+
+	OutLedges.Append(Data->GetLedges().GetData() + Record->FirstLedge, Record->NumLedges);
+	return true;
+}
+
+bool UBakedLedgeSubsystem::IsActorBaked(const AActor* InActor) const
+{
+	const ULedgeBakeData* Data;
+	const FLedgeBakeActorRecord* Record;
+	return FindActorRecord(InActor, Data, Record);
+}
+
+bool UBakedLedgeSubsystem::FindGrabLocation(const AActor* InActor, const FVector& InProbe, float InMinZ, float InMaxZ, FVector& OutLocation) const
+{
+	const ULedgeBakeData* Data;
+	const FLedgeBakeActorRecord* Record;
+	const auto* Refs = FindActorRecord(InActor, Data, Record) ? Grid.Find(GetCell(InProbe)) : nullptr;
+	if (!Refs)
+	{
+		return false;
+	}
+
+	const FVector2D ProbeXY(InProbe.X, InProbe.Y);
+	const FLedgeShape* Closest = nullptr;
+
+	for (const FBakedLedgeRef& Ref : *Refs)
+	{
+		if (!IsRecordLedge(Ref, Data, *Record))
+		{
+			continue;
+		}
+
+		const FLedgeShape& Ledge = Resolve(Ref);
+		if (Ledge.TopZ < InMinZ || Ledge.TopZ >= InMaxZ)
+		{
+			continue;
+		}
+
+		if ((!Closest || Ledge.TopZ < Closest->TopZ) && Ledge.ContainsPoint(ProbeXY))
+		{
+			Closest = &Ledge;
+		}
+	}
+
+	if (!Closest)
+	{
+		return false;
+	}
+
+	OutLocation = FVector(InProbe.X, InProbe.Y, Closest->TopZ);
+	return true;
+}
+
+const FLedgeShape* UBakedLedgeSubsystem::FindLedge(const AActor* InActor, const FVector& InLocation, float InHeightTolerance) const
+{
+	const ULedgeBakeData* Data;
+	const FLedgeBakeActorRecord* Record;
+	const auto* Refs = FindActorRecord(InActor, Data, Record) ? Grid.Find(GetCell(InLocation)) : nullptr;
+	if (!Refs)
+	{
+		return nullptr;
+	}
+
+	const FVector2D LocationXY(InLocation.X, InLocation.Y);
+	const FLedgeShape* Closest = nullptr;
+	float ClosestDistance = BakedLedgeMaxReach;
+
+	for (const FBakedLedgeRef& Ref : *Refs)
+	{
+		if (!IsRecordLedge(Ref, Data, *Record))
+		{
+			continue;
+		}
+
+		const FLedgeShape& Ledge = Resolve(Ref);
+		if (FMath::Abs(Ledge.TopZ - InLocation.Z) > InHeightTolerance)
+		{
+			continue;
+		}
+
+		const float Distance = Ledge.GetRimDistance(LocationXY);
+		if (Distance <= ClosestDistance)
+		{
+			ClosestDistance = Distance;
+			Closest = &Ledge;
+		}
+	}
+
+	return Closest;
+}
+
+bool UBakedLedgeSubsystem::FindWall(const AActor* InActor, const FVector& InStart, const FVector& InDelta, float InMaxDepth, FVector& OutLocation, FVector& OutNormal) const
+{
+	const ULedgeBakeData* Data;
+	const FLedgeBakeActorRecord* Record;
+	const auto* Refs = FindActorRecord(InActor, Data, Record) ? Grid.Find(GetCell(InStart)) : nullptr;
+	if (!Refs)
+	{
+		return false;
+	}
+
+	const FVector2D Start(InStart.X, InStart.Y);
+	FVector2D Direction(InDelta.X, InDelta.Y);
+	const float Reach = FMath::Min(Direction.Size(), BakedLedgeMaxReach);
+	Direction.Normalize();
+
+	float ClosestDistance = -1.f;
+	for (const FBakedLedgeRef& Ref : *Refs)
+	{
+		if (!IsRecordLedge(Ref, Data, *Record))
+		{
+			continue;
+		}
+
+		const FLedgeShape& Ledge = Resolve(Ref);
+		if (Ledge.TopZ <= InStart.Z || Ledge.TopZ - InStart.Z > InMaxDepth)
+		{
+			continue;
+		}
+
+		int32 Segment;
+		const float Distance = Ledge.RaycastSides(Start, Direction, Reach, Segment);
+		if (Distance < 0.f || (ClosestDistance >= 0.f && Distance >= ClosestDistance))
+		{
+			continue;
+		}
+
+		ClosestDistance = Distance;
+		const FVector2D HitPoint = Start + Direction * Distance;
+		OutLocation = FVector(HitPoint.X, HitPoint.Y, InStart.Z);
+		OutNormal = FVector(Ledge.Normals[Segment].X, Ledge.Normals[Segment].Y, 0.f);
+	}
+
+	return ClosestDistance >= 0.f;
+}
+
+void UBakedLedgeSubsystem::GetCells(const FLedgeShape& InShape, TArray<FIntPoint, TInlineAllocator<8>>& OutCells) const
+{
+	OutCells.Reset();
+
+	FBox2D Bounds(ForceInit);
+	for (const FVector2D& Point : InShape.Points)
+	{
+		Bounds += Point;
+	}
+	Bounds = Bounds.ExpandBy(BakedLedgeMaxReach);
+
+	const FIntPoint Min(FMath::FloorToInt(Bounds.Min.X / BakedLedgeCellSize), FMath::FloorToInt(Bounds.Min.Y / BakedLedgeCellSize));
+	const FIntPoint Max(FMath::FloorToInt(Bounds.Max.X / BakedLedgeCellSize), FMath::FloorToInt(Bounds.Max.Y / BakedLedgeCellSize));
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			OutCells.Add(FIntPoint(X, Y));
+		}
+	}
+}
+
+FIntPoint UBakedLedgeSubsystem::GetCell(const FVector& InLocation) const
+{
+	return FIntPoint(FMath::FloorToInt(InLocation.X / BakedLedgeCellSize), FMath::FloorToInt(InLocation.Y / BakedLedgeCellSize));
+}
+
+const FLedgeShape& UBakedLedgeSubsystem::Resolve(const FBakedLedgeRef& InRef) const
+{
+	return InRef.Data->GetLedges()[InRef.Index];
+}
+
+bool UBakedLedgeSubsystem::FindActorRecord(const AActor* InActor, const ULedgeBakeData*& OutData, const FLedgeBakeActorRecord*& OutRecord) const
+{
+	// Anything that may have moved since the bake is queried the usual way
+	if (!(InActor && InActor->IsRootComponentStatic()))
+	{
+		return false;
+	}
+
+	const ULedgeBakeData* const* Data = LevelData.Find(InActor->GetLevel());
+	if (!Data)
+	{
+		return false;
+	}
+
+	OutData = *Data;
+	OutRecord = OutData->FindRecord(InActor->GetFName());
+	return OutRecord != nullptr;
+}
+
+bool UBakedLedgeSubsystem::IsRecordLedge(const FBakedLedgeRef& InRef, const ULedgeBakeData* InData, const FLedgeBakeActorRecord& InRecord)
+{
+	return InRef.Data == InData && InRef.Index >= InRecord.FirstLedge && InRef.Index < InRecord.FirstLedge + InRecord.NumLedges;
+}
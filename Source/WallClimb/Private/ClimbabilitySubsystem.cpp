@@ -0,0 +1,147 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbabilitySubsystem.h"
+#include "ClimbingPhysicalMaterial.h"
+#include "Components/PrimitiveComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+#include "HAL/IConsoleManager.h"
+
+static TAutoConsoleVariable<int32> CVarClimbingTraceChannel(
+	TEXT("Climbing.TraceChannel"),
+	(int32)ECC_WorldStatic,
+	TEXT("Collision channel of the climbing queries. 0: WorldStatic, 14 to 31: GameTraceChannel1 to 18, ")
+	TEXT("e.g. a Climbable channel only the climbable primitives block."));
+
+const FName UClimbabilitySubsystem::ClimbableProfileName(TEXT("Climbable"));
+
+const FName UClimbabilitySubsystem::NotClimbableTag(TEXT("NotClimbable"));
+
+ECollisionChannel UClimbabilitySubsystem::GetTraceChannel()
+{
+	const int32 Channel = CVarClimbingTraceChannel.GetValueOnAnyThread();
+	if (Channel == ECC_WorldStatic || (Channel >= ECC_GameTraceChannel1 && Channel <= ECC_GameTraceChannel18))
+	{
+		return (ECollisionChannel)Channel;
+	}
+
+	return ECC_WorldStatic;
+}
+
+bool UClimbabilitySubsystem::IsClimbableProfileBlocking(ECollisionChannel InChannel)
+{
+	FCollisionResponseTemplate Profile;
+	return UCollisionProfile::Get()->GetProfileTemplate(ClimbableProfileName, Profile)
+		&& Profile.ResponseToChannels.GetResponse(InChannel) == ECR_Block;
+}
+
+bool UClimbabilitySubsystem::IsPrimitiveClimbable(const UPrimitiveComponent* InPrimitive)
+{
+	if (!(InPrimitive))
+	{
+		return false;
+	}
+
+	const UWorld* World = InPrimitive->GetWorld();
+	UClimbabilitySubsystem* Subsystem = World ? World->GetSubsystem<UClimbabilitySubsystem>() : nullptr;
+	return Subsystem ? Subsystem->IsClimbable(InPrimitive) : ResolveClimbable(InPrimitive);
+}
+
+void UClimbabilitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	LevelRemovedHandle = FWorldDelegates::LevelRemovedFromWorld.AddUObject(this, &UClimbabilitySubsystem::OnLevelRemoved);
+
+	// A dedicated channel only culls anything when the walls are set up to block it
+	const ECollisionChannel Channel = GetTraceChannel();
+	const UWorld* World = GetWorld();
+	if (Channel != ECC_WorldStatic && World && World->IsGameWorld() && !IsClimbableProfileBlocking(Channel))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[%s] Climbing.TraceChannel is %d, but no %s collision profile blocks it. Only the primitives ")
+			TEXT("set up one by one are climbable."), *FString(__FUNCTION__), (int32)Channel, *ClimbableProfileName.ToString());
+	}
+}
+
+void UClimbabilitySubsystem::Deinitialize()
+{
+	FWorldDelegates::LevelRemovedFromWorld.Remove(LevelRemovedHandle);
+	InvalidateAll();
+
+	Super::Deinitialize();
+}
+
+bool UClimbabilitySubsystem::IsClimbable(const UPrimitiveComponent* InPrimitive)
+{
+	if (!(InPrimitive))
+	{
+		return false;
+	}
+
+	const FObjectKey Key(InPrimitive);
+	{
+		FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+		if (const bool* Cached = Climbable.Find(Key))
+		{
+			return *Cached;
+		}
+	}
+
+	// Two threads may resolve the same primitive, they get the same answer
+	const bool Result = ResolveClimbable(InPrimitive);
+
+	FRWScopeLock WriteLock(Lock, SLT_Write);
+	Climbable.Add(Key, Result);
+	return Result;
+}
+
+void UClimbabilitySubsystem::Invalidate(const UPrimitiveComponent* InPrimitive)
+{
+	FRWScopeLock WriteLock(Lock, SLT_Write);
+	Climbable.Remove(FObjectKey(InPrimitive));
+}
+
+void UClimbabilitySubsystem::InvalidateAll()
+{
+	FRWScopeLock WriteLock(Lock, SLT_Write);
+	Climbable.Empty();
+}
+
+int32 UClimbabilitySubsystem::Num() const
+{
+	FRWScopeLock ReadLock(Lock, SLT_ReadOnly);
+	return Climbable.Num();
+}
+
+bool UClimbabilitySubsystem::ResolveClimbable(const UPrimitiveComponent* InPrimitive)
+{
+	if (InPrimitive->ComponentHasTag(NotClimbableTag))
+	{
+		return false;
+	}
+
+	const AActor* Owner = InPrimitive->GetOwner();
+	if (Owner && Owner->ActorHasTag(NotClimbableTag))
+	{
+		return false;
+	}
+
+	const UClimbingPhysicalMaterial* Material = Cast<UClimbingPhysicalMaterial>(InPrimitive->BodyInstance.GetSimplePhysicalMaterial());
+	if (Material && !Material->IsClimbable)
+	{
+		return false;
+	}
+
+	return true;
+}
+
+void UClimbabilitySubsystem::OnLevelRemoved(ULevel* InLevel, UWorld* InWorld)
+{
+	// The keys of the level's primitives would only pile up
+	if (InWorld == GetWorld())
+	{
+		InvalidateAll();
+	}
+}
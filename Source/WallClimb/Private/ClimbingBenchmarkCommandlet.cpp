@@ -0,0 +1,831 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingBenchmarkCommandlet.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/MemoryBase.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformTLS.h"
+#include "Templates/Atomic.h"
+
+#include "ClimbingComponent.h"
+#include "ClimbingProfile.h"
+#include "ClimbingSubsystem.h"
+#include "ClimbabilitySubsystem.h"
+#include "ClimbingCrowdSubsystem.h"
+#include "ClimbingCore.h"
+#include "AnalyticClimbingWorld.h"
+#include "ClimbingStats.h"
+#include "ClimbingLatency.h"
+#include "ClimbingBenchmarkWorld.h"
+
+using namespace ClimbingBenchmark;
+
+namespace
+{
+	/** Hanging still before strafing, in the allocation scenario */
+	const int32 AllocationIdleHangFrames = 30;
+
+	/** Forwards to the engine's allocator, counting the allocations and reallocations of one thread on demand */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		void SetInner(FMalloc* InInner) { Inner = InInner; }
+
+		void BeginCounting()
+		{
+			NumAllocations = 0;
+			CountedThreadId = FPlatformTLS::GetCurrentThreadId();
+		}
+
+		uint64 EndCounting()
+		{
+			CountedThreadId = 0;
+			return NumAllocations;
+		}
+
+		virtual void* Malloc(SIZE_T Size, uint32 Alignment) override
+		{
+			CountAllocation();
+			return Inner->Malloc(Size, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Size, uint32 Alignment) override
+		{
+			if (Size > 0)
+			{
+				CountAllocation();
+			}
+			return Inner->Realloc(Original, Size, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual SIZE_T QuantizeSize(SIZE_T Size, uint32 Alignment) override { return Inner->QuantizeSize(Size, Alignment); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual void UpdateStats() override { Inner->UpdateStats(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+	private:
+		void CountAllocation()
+		{
+			// Only the counted thread writes the count
+			if (CountedThreadId.Load(EMemoryOrder::Relaxed) == FPlatformTLS::GetCurrentThreadId())
+			{
+				++NumAllocations;
+			}
+		}
+
+	private:
+		FMalloc* Inner = nullptr;
+
+		TAtomic<uint32> CountedThreadId { 0 };
+
+		uint64 NumAllocations = 0;
+	};
+
+	/** Puts the counting allocator in front of GMalloc for its lifetime, the previous allocator is back once it goes */
+	class FScopedCountingMalloc
+	{
+	public:
+		FScopedCountingMalloc()
+			: Previous(GMalloc)
+		{
+			GetCountingMalloc().SetInner(Previous);
+			GMalloc = &GetCountingMalloc();
+		}
+
+		~FScopedCountingMalloc()
+		{
+			GMalloc = Previous;
+		}
+
+		FCountingMalloc& Get() { return GetCountingMalloc(); }
+
+	private:
+		/** Never destroyed, other threads may still be in it right after GMalloc is restored. It only forwards to Previous,
+			which owns every block allocated through it */
+		static FCountingMalloc& GetCountingMalloc()
+		{
+			static FCountingMalloc CountingMalloc;
+			return CountingMalloc;
+		}
+
+	private:
+		FMalloc* Previous;
+	};
+}
+
+UClimbingBenchmarkCommandlet::UClimbingBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClimbingBenchmarkCommandlet::Main(const FString& Params)
+{
+	FString ClimbersParam = TEXT("1,100,1000");
+	FParse::Value(*Params, TEXT("Climbers="), ClimbersParam, false);
+
+	int32 NumFrames = 600;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	NumFrames = FMath::Max(NumFrames, BenchmarkWarmupFrames + 1);
+
+	float Tolerance = 0.15f;
+	FParse::Value(*Params, TEXT("Tolerance="), Tolerance);
+
+	FString BaselinePath = FPaths::ProjectSavedDir() / TEXT("Benchmarks") / TEXT("ClimbingBenchmark.txt");
+	FParse::Value(*Params, TEXT("Baseline="), BaselinePath);
+
+	const bool Batched = FParse::Param(*Params, TEXT("Batched"));
+	const bool CoreOnly = FParse::Param(*Params, TEXT("Core"));
+	const bool Classify = FParse::Param(*Params, TEXT("Classify"));
+	const bool Crowd = FParse::Param(*Params, TEXT("Crowd"));
+	const bool UpdateBaseline = FParse::Param(*Params, TEXT("UpdateBaseline"));
+
+	int32 WalkingPercent = 0;
+	FParse::Value(*Params, TEXT("Walking="), WalkingPercent);
+	WalkingPercent = FMath::Clamp(WalkingPercent, 0, 100);
+
+	const bool Dense = FParse::Param(*Params, TEXT("Dense"));
+
+	int32 PropsPerClimber = 8;
+	FParse::Value(*Params, TEXT("Props="), PropsPerClimber);
+	PropsPerClimber = FMath::Max(PropsPerClimber, 1);
+
+	int32 Channel = ECC_GameTraceChannel1;
+	FParse::Value(*Params, TEXT("Channel="), Channel);
+
+	TArray<FString> ClimberCounts;
+	ClimbersParam.ParseIntoArray(ClimberCounts, TEXT(","));
+
+	if (FParse::Param(*Params, TEXT("AsyncLOD")))
+	{
+		int32 NumFailures = 0;
+		for (const FString& Count : ClimberCounts)
+		{
+			const int32 NumClimbers = FCString::Atoi(*Count);
+			if (NumClimbers > 0)
+			{
+				NumFailures += RunAsyncLODScenario(NumClimbers, NumFrames, EClimbingLOD::Medium) ? 0 : 1;
+				NumFailures += RunAsyncLODScenario(NumClimbers, NumFrames, EClimbingLOD::Low) ? 0 : 1;
+			}
+		}
+		return NumFailures == 0 ? 0 : 1;
+	}
+
+	if (FParse::Param(*Params, TEXT("Allocs")))
+	{
+		int32 NumFailures = 0;
+		for (const FString& Count : ClimberCounts)
+		{
+			const int32 NumClimbers = FCString::Atoi(*Count);
+			if (NumClimbers > 0)
+			{
+				NumFailures += RunAllocationScenario(NumClimbers, NumFrames) ? 0 : 1;
+			}
+		}
+		return NumFailures == 0 ? 0 : 1;
+	}
+
+	TArray<FClimbingBenchmarkResult> Results;
+	int32 Mismatches = 0;
+	for (const FString& Count : ClimberCounts)
+	{
+		const int32 NumClimbers = FCString::Atoi(*Count);
+		if (NumClimbers <= 0)
+		{
+			continue;
+		}
+
+		if (Classify)
+		{
+			Mismatches += RunClassifyScenario(NumClimbers, NumFrames, Results) ? 0 : 1;
+		}
+		else if (Crowd)
+		{
+			Results.Add(RunCrowdScenario(NumClimbers, NumFrames));
+		}
+		else if (Dense)
+		{
+			RunDenseScenario(NumClimbers, NumFrames, Batched, PropsPerClimber, (ECollisionChannel)Channel, Results);
+		}
+		else
+		{
+			Results.Add(CoreOnly ? RunCoreScenario(NumClimbers, NumFrames) : RunScenario(NumClimbers, NumFrames, Batched, WalkingPercent, 0));
+		}
+	}
+
+	for (const FClimbingBenchmarkResult& Result : Results)
+	{
+		UE_LOG(LogTemp, Display, TEXT("[%s] %s: mean %.4f ms, p99 %.4f ms, %.2f queries per frame"),
+			*FString(__FUNCTION__), *Result.Name, Result.MeanMs, Result.P99Ms, Result.QueriesPerFrame);
+	}
+
+	if (Mismatches > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] The batched classification disagrees with the scalar one."), *FString(__FUNCTION__));
+		return 1;
+	}
+
+	if (UpdateBaseline)
+	{
+		return SaveBaseline(BaselinePath, Results) ? 0 : 1;
+	}
+
+	TMap<FString, FClimbingBenchmarkResult> Baseline;
+	if (!LoadBaseline(BaselinePath, Baseline))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] No baseline at %s, run with -UpdateBaseline to create one."), *FString(__FUNCTION__), *BaselinePath);
+		return 1;
+	}
+
+	// A result nothing is compared to would pass whatever it is
+	int32 Regressions = 0;
+	for (const FClimbingBenchmarkResult& Result : Results)
+	{
+		const FClimbingBenchmarkResult* Reference = Baseline.Find(Result.Name);
+		if (!Reference)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[%s] %s is not in the baseline at %s, run with -UpdateBaseline to add it."),
+				*FString(__FUNCTION__), *Result.Name, *BaselinePath);
+			++Regressions;
+			continue;
+		}
+
+		const bool MeanRegressed = Result.MeanMs > Reference->MeanMs * (1.f + Tolerance);
+		const bool P99Regressed = Result.P99Ms > Reference->P99Ms * (1.f + Tolerance);
+		const bool QueriesRegressed = Result.QueriesPerFrame > Reference->QueriesPerFrame * (1.f + Tolerance) + 0.5;
+
+		if (MeanRegressed || P99Regressed || QueriesRegressed)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[%s] %s regressed: mean %.4f/%.4f ms, p99 %.4f/%.4f ms, queries %.2f/%.2f"),
+				*FString(__FUNCTION__), *Result.Name, Result.MeanMs, Reference->MeanMs, Result.P99Ms, Reference->P99Ms,
+				Result.QueriesPerFrame, Reference->QueriesPerFrame);
+			++Regressions;
+		}
+	}
+
+	return Regressions == 0 ? 0 : 1;
+}
+
+FClimbingBenchmarkResult UClimbingBenchmarkCommandlet::RunScenario(int32 InNumClimbers, int32 InNumFrames, bool InBatched, int32 InWalkingPercent,
+	int32 InPropsPerClimber)
+{
+	FString Name = FString::Printf(TEXT("%s_%d"), InBatched ? TEXT("Batched") : TEXT("Component"), InNumClimbers);
+	if (InWalkingPercent > 0)
+	{
+		Name += FString::Printf(TEXT("_Walking%d"), InWalkingPercent);
+	}
+
+	if (InPropsPerClimber > 0)
+	{
+		Name += FString::Printf(TEXT("_Props%d_Channel%d"), InPropsPerClimber, (int32)UClimbabilitySubsystem::GetTraceChannel());
+	}
+
+	UWorld* World = CreateWorld();
+
+	TArray<UClimbingComponent*> Climbers;
+	PopulateWorld(World, InNumClimbers, InBatched, InWalkingPercent, InPropsPerClimber, Climbers);
+
+	// The components are ticked by the world, on the intervals their LOD, sleep and climb end schedule, as in a game
+	TArray<FClimberDriver> Drivers;
+	for (UClimbingComponent* Climber : Climbers)
+	{
+		FClimberDriver Driver;
+		Driver.Climber = Climber;
+		Drivers.Add(Driver);
+	}
+
+	SpawnViewer(World);
+
+	UClimbingSubsystem* ClimbingSubsystem = World->GetSubsystem<UClimbingSubsystem>();
+	if (ClimbingSubsystem)
+	{
+		ClimbingSubsystem->SetTickedManually(true);
+		ClimbingSubsystem->GetLatency().Reset();
+	}
+
+	const FClimbingBenchmarkResult Result = MeasureFrames(Name, InNumFrames, [&Drivers, World, ClimbingSubsystem, InBatched](uint64& OutNumQueries)
+	{
+		// Nothing else counts the frames in a commandlet, the climbing latencies are measured in them
+		++GFrameCounter;
+
+		GClimbingSceneQueryCounter.Reset();
+		GClimbingTickCycles.Reset();
+		uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (FClimberDriver& Driver : Drivers)
+		{
+			DriveClimber(Driver);
+		}
+
+		if (InBatched && ClimbingSubsystem)
+		{
+			ClimbingSubsystem->Tick(BenchmarkDeltaTime);
+		}
+
+		uint64 ClimbingCycles = FPlatformTime::Cycles64() - StartCycles;
+
+		// Movement and everything else, the components' ticks are all that's timed of it
+		World->Tick(LEVELTICK_All, BenchmarkDeltaTime);
+		ClimbingCycles += GClimbingTickCycles.GetValue();
+
+		OutNumQueries = GClimbingSceneQueryCounter.GetValue();
+		return FPlatformTime::ToMilliseconds64(ClimbingCycles);
+	});
+
+	// In world time, the frames are BenchmarkDeltaTime apart
+	if (ClimbingSubsystem)
+	{
+		UE_LOG(LogTemp, Display, TEXT("[%s] %s latency:"), *FString(__FUNCTION__), *Result.Name);
+		ClimbingSubsystem->GetLatency().Print(Result.Name);
+	}
+
+	DestroyWorld(World);
+
+	return Result;
+}
+
+void UClimbingBenchmarkCommandlet::RunDenseScenario(int32 InNumClimbers, int32 InNumFrames, bool InBatched, int32 InPropsPerClimber,
+	ECollisionChannel InChannel, TArray<FClimbingBenchmarkResult>& OutResults)
+{
+	IConsoleVariable* TraceChannel = IConsoleManager::Get().FindConsoleVariable(TEXT("Climbing.TraceChannel"));
+	if (!(TraceChannel))
+	{
+		return;
+	}
+
+	const int32 PreviousChannel = TraceChannel->GetInt();
+
+	// Same world and climbers, the props are only culled by the broadphase of the second run
+	TraceChannel->Set((int32)ECC_WorldStatic, ECVF_SetByCode);
+	const FClimbingBenchmarkResult WorldStatic = RunScenario(InNumClimbers, InNumFrames, InBatched, 0, InPropsPerClimber);
+
+	TraceChannel->Set((int32)InChannel, ECVF_SetByCode);
+	if (UClimbabilitySubsystem::GetTraceChannel() != InChannel)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] %d is not a trace channel, see Climbing.TraceChannel."), *FString(__FUNCTION__), (int32)InChannel);
+		TraceChannel->Set(PreviousChannel, ECVF_SetByCode);
+		OutResults.Add(WorldStatic);
+		return;
+	}
+
+	const FClimbingBenchmarkResult Climbable = RunScenario(InNumClimbers, InNumFrames, InBatched, 0, InPropsPerClimber);
+	TraceChannel->Set(PreviousChannel, ECVF_SetByCode);
+
+	const double SavedMs = WorldStatic.MeanMs - Climbable.MeanMs;
+	UE_LOG(LogTemp, Display, TEXT("[%s] %d climbers, %d props each: the climbable channel saves %.4f ms per frame (%.1f%%), p99 %.4f to %.4f ms"),
+		*FString(__FUNCTION__), InNumClimbers, InPropsPerClimber, SavedMs, WorldStatic.MeanMs > 0.0 ? 100.0 * SavedMs / WorldStatic.MeanMs : 0.0,
+		WorldStatic.P99Ms, Climbable.P99Ms);
+
+	OutResults.Add(WorldStatic);
+	OutResults.Add(Climbable);
+}
+
+FClimbingBenchmarkResult UClimbingBenchmarkCommandlet::RunCoreScenario(int32 InNumClimbers, int32 InNumFrames)
+{
+	FAnalyticClimbingWorld World;
+	TArray<TUniquePtr<FAnalyticClimbingBody>> Bodies;
+	TArray<TUniquePtr<FClimbingCore>> Cores;
+	TArray<FCoreDriver> Drivers;
+	PopulateCoreClimbers(World, InNumClimbers, Bodies, Cores, Drivers);
+
+	return MeasureFrames(FString::Printf(TEXT("Core_%d"), InNumClimbers), InNumFrames, [this, &World, &Bodies, &Drivers](uint64& OutNumQueries)
+	{
+		// Movement
+		for (TUniquePtr<FAnalyticClimbingBody>& Body : Bodies)
+		{
+			Body->Step(BenchmarkDeltaTime);
+		}
+
+		World.ResetNumQueries();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (FCoreDriver& Driver : Drivers)
+		{
+			DriveCore(Driver, BenchmarkDeltaTime);
+			Driver.Core->Tick(BenchmarkDeltaTime);
+		}
+
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+
+		OutNumQueries = World.GetNumQueries();
+		return FPlatformTime::ToMilliseconds64(EndCycles - StartCycles);
+	});
+}
+
+FClimbingBenchmarkResult UClimbingBenchmarkCommandlet::RunCrowdScenario(int32 InNumClimbers, int32 InNumFrames)
+{
+	const FString Name = FString::Printf(TEXT("Crowd_%d"), InNumClimbers);
+
+	UWorld* World = CreateWorld();
+	SpawnWalls(World, InNumClimbers, 0);
+
+	UClimbingCrowdSubsystem* CrowdSubsystem = World->GetSubsystem<UClimbingCrowdSubsystem>();
+	if (!(CrowdSubsystem))
+	{
+		DestroyWorld(World);
+
+		FClimbingBenchmarkResult Result;
+		Result.Name = Name;
+		return Result;
+	}
+
+	CrowdSubsystem->SetTickedManually(true);
+	CrowdSubsystem->Settings.IsClimbOnHitAllowed = true;
+	CrowdSubsystem->AgentRadius = AnalyticRadius;
+	CrowdSubsystem->AgentHalfHeight = AnalyticHalfHeight;
+	CrowdSubsystem->AgentChestHeight = AnalyticHalfHeight * 0.5f;
+
+	// Same places as the characters of RunScenario, walking into their wall
+	TArray<int32> Agents;
+	for (int32 i = 0; i < InNumClimbers; ++i)
+	{
+		const int32 Wall = i / ClimbersPerWall;
+		const int32 Slot = i % ClimbersPerWall;
+		const FVector Location(Wall * WallRowSpacing - 25.f - AnalyticRadius - 1.f, (Slot + 0.5f) * ClimberSpacing, AnalyticHalfHeight + 1.f);
+
+		const int32 Agent = CrowdSubsystem->AddAgent(Location, FRotator::ZeroRotator);
+		CrowdSubsystem->SetAgentVelocity(Agent, FVector(50.f, 0.f, 0.f));
+		Agents.Add(Agent);
+	}
+
+	TArray<int32> HangingFrames;
+	HangingFrames.SetNumZeroed(InNumClimbers);
+
+	const FClimbingBenchmarkResult Result = MeasureFrames(Name, InNumFrames, [CrowdSubsystem, &Agents, &HangingFrames](uint64& OutNumQueries)
+	{
+		// Hang, then let go
+		for (int32 i = 0; i < Agents.Num(); ++i)
+		{
+			if (CrowdSubsystem->GetAgentState(Agents[i]) == EClimbingCrowdState::Hanging && ++HangingFrames[i] > HangFrames)
+			{
+				HangingFrames[i] = 0;
+				CrowdSubsystem->ReleaseAgent(Agents[i]);
+			}
+		}
+
+		GClimbingSceneQueryCounter.Reset();
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		CrowdSubsystem->Tick(BenchmarkDeltaTime);
+
+		const uint64 EndCycles = FPlatformTime::Cycles64();
+
+		OutNumQueries = GClimbingSceneQueryCounter.GetValue();
+		return FPlatformTime::ToMilliseconds64(EndCycles - StartCycles);
+	});
+
+	DestroyWorld(World);
+
+	return Result;
+}
+
+bool UClimbingBenchmarkCommandlet::RunAllocationScenario(int32 InNumClimbers, int32 InNumFrames)
+{
+	enum EUpdateKind { Ground, Climb, Hang, Strafe, NumUpdateKinds };
+	const TCHAR* UpdateKindNames[NumUpdateKinds] = { TEXT("Ground"), TEXT("Climb"), TEXT("Hang"), TEXT("Strafe") };
+
+	UWorld* World = CreateWorld();
+
+	TArray<UClimbingComponent*> Climbers;
+	PopulateWorld(World, InNumClimbers, false, 0, 0, Climbers);
+
+	// Both grab searches, the probe grid and the single trace down, and both ways of running the traces
+	UClimbingProfile* SingleProbeProfile = NewObject<UClimbingProfile>(GetTransientPackage());
+	SingleProbeProfile->GrabProbeColumns = 1;
+	SingleProbeProfile->GrabProbeRows = 1;
+	SingleProbeProfile->UpdateSettings();
+
+	TArray<FClimberDriver> Drivers;
+	for (int32 i = 0; i < Climbers.Num(); ++i)
+	{
+		UClimbingComponent* Climber = Climbers[i];
+		if (i % 2 == 1)
+		{
+			Climber->SetProfile(SingleProbeProfile);
+		}
+		Climber->UseAsyncTraces = (i / 2) % 2 == 1;
+
+		// Ticked by hand below, one counted update per climber and frame
+		Climber->SetComponentTickEnabled(false);
+
+		FClimberDriver Driver;
+		Driver.Climber = Climber;
+		Driver.IdleHangFrames = AllocationIdleHangFrames;
+		Drivers.Add(Driver);
+	}
+
+	FScopedCountingMalloc ScopedMalloc;
+	FCountingMalloc& CountingMalloc = ScopedMalloc.Get();
+	uint64 NumAllocations[NumUpdateKinds] = {};
+	uint64 NumUpdates[NumUpdateKinds] = {};
+
+	for (int32 Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		++GFrameCounter;
+
+		// Movement and the async traces, not counted
+		World->Tick(LEVELTICK_All, BenchmarkDeltaTime);
+
+		for (FClimberDriver& Driver : Drivers)
+		{
+			const UClimbingComponent* Climber = Driver.Climber;
+			const EUpdateKind Kind = Climber->IsHanging ? (Driver.HangingFrames < Driver.IdleHangFrames ? Hang : Strafe)
+				: (Climber->IsClimbing ? Climb : Ground);
+
+			CountingMalloc.BeginCounting();
+			DriveClimber(Driver);
+			Driver.Climber->TickComponent(BenchmarkDeltaTime, LEVELTICK_All, nullptr);
+			const uint64 Allocations = CountingMalloc.EndCounting();
+
+			// The first climb, hang and strafe grow what is kept for reuse
+			if (Driver.NumReleases > 0)
+			{
+				NumAllocations[Kind] += Allocations;
+				++NumUpdates[Kind];
+			}
+		}
+	}
+
+	DestroyWorld(World);
+
+	bool IsAllocationFree = true;
+	for (int32 Kind = 0; Kind < NumUpdateKinds; ++Kind)
+	{
+		UE_LOG(LogTemp, Display, TEXT("[%s] Allocs_%d %s: %llu updates, %llu allocations"), *FString(__FUNCTION__),
+			InNumClimbers, UpdateKindNames[Kind], NumUpdates[Kind], NumAllocations[Kind]);
+
+		if (NumAllocations[Kind] > 0)
+		{
+			UE_LOG(LogTemp, Error, TEXT("[%s] The %s updates allocate."), *FString(__FUNCTION__), UpdateKindNames[Kind]);
+			IsAllocationFree = false;
+		}
+		else if (Kind != Ground && NumUpdates[Kind] < AllocationIdleHangFrames)
+		{
+			// Nothing checked, the phase has to be held for a while after the warm-up
+			UE_LOG(LogTemp, Error, TEXT("[%s] Only %llu %s updates after the warm-up, increase -Frames."), *FString(__FUNCTION__),
+				NumUpdates[Kind], UpdateKindNames[Kind]);
+			IsAllocationFree = false;
+		}
+	}
+
+	return IsAllocationFree;
+}
+
+bool UClimbingBenchmarkCommandlet::RunAsyncLODScenario(int32 InNumClimbers, int32 InNumFrames, EClimbingLOD InLOD)
+{
+	UWorld* World = CreateWorld();
+
+	TArray<UClimbingComponent*> Climbers;
+	PopulateWorld(World, InNumClimbers, false, 0, 0, Climbers);
+
+	TArray<FClimberDriver> Drivers;
+	for (UClimbingComponent* Climber : Climbers)
+	{
+		// Held there, the LOD is never evaluated again
+		Climber->UseAsyncTraces = true;
+		Climber->SetClimbingLOD(InLOD);
+		Climber->Runtime.TimeToLODEvaluation = MAX_flt;
+
+		FClimberDriver Driver;
+		Driver.Climber = Climber;
+		Drivers.Add(Driver);
+	}
+
+	for (int32 Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		++GFrameCounter;
+
+		for (FClimberDriver& Driver : Drivers)
+		{
+			DriveClimber(Driver);
+		}
+
+		World->Tick(LEVELTICK_All, BenchmarkDeltaTime);
+	}
+
+	DestroyWorld(World);
+
+	int32 NumStuck = 0;
+	for (const FClimberDriver& Driver : Drivers)
+	{
+		NumStuck += Driver.NumReleases == 0 ? 1 : 0;
+	}
+
+	const UEnum* LODEnum = StaticEnum<EClimbingLOD>();
+	UE_LOG(LogTemp, Display, TEXT("[%s] AsyncLOD_%d %s: %d climbers never hung."), *FString(__FUNCTION__), InNumClimbers,
+		*LODEnum->GetNameStringByValue((int64)InLOD), NumStuck);
+
+	if (NumStuck > 0)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] The async traces don't resolve at %s LOD, or increase -Frames."), *FString(__FUNCTION__),
+			*LODEnum->GetNameStringByValue((int64)InLOD));
+	}
+
+	return NumStuck == 0;
+}
+
+bool UClimbingBenchmarkCommandlet::RunClassifyScenario(int32 InNumSurfaces, int32 InNumFrames, TArray<FClimbingBenchmarkResult>& OutResults) const
+{
+	FRandomStream Random(InNumSurfaces);
+
+	// Walls, slopes, floors and ceilings, seen from any direction, with the default thresholds and a few overrides
+	TArray<FClimbingHit> Hits;
+	TArray<FVector> Forwards;
+	TArray<float> CaptureAngleCosines;
+	const float DefaultWalkableFloorZ = 0.71f;
+
+	for (int32 i = 0; i < InNumSurfaces; ++i)
+	{
+		FClimbingHit& Hit = Hits.AddDefaulted_GetRef();
+		Hit.ImpactNormal = Random.GetUnitVector();
+		Hit.WalkableFloorZ = Random.FRand() < 0.1f ? Random.FRand() : -1.f;
+
+		Forwards.Add(FRotator(0.f, Random.FRandRange(0.f, 360.f), 0.f).Vector());
+		CaptureAngleCosines.Add(FMath::Cos(FMath::DegreesToRadians(180.f - Random.FRandRange(0.f, 90.f))));
+	}
+
+	FClimbingSurfaceBatch Batch;
+	Batch.Reserve(InNumSurfaces);
+	TArray<bool> ScalarClimbable;
+	ScalarClimbable.SetNumUninitialized(InNumSurfaces);
+	TArray<bool> BatchClimbable;
+
+	OutResults.Add(MeasureFrames(FString::Printf(TEXT("ClassifyScalar_%d"), InNumSurfaces), InNumFrames, [&](uint64& OutNumQueries)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		for (int32 i = 0; i < InNumSurfaces; ++i)
+		{
+			ScalarClimbable[i] = FClimbingCore::IsClimbableSurface(Hits[i], Forwards[i], DefaultWalkableFloorZ, CaptureAngleCosines[i]);
+		}
+
+		return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	}));
+
+	OutResults.Add(MeasureFrames(FString::Printf(TEXT("ClassifyBatch_%d"), InNumSurfaces), InNumFrames, [&](uint64& OutNumQueries)
+	{
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+
+		// Filling the columns is part of the cost, the hits come as structures
+		Batch.Reset();
+		for (int32 i = 0; i < InNumSurfaces; ++i)
+		{
+			Batch.Add(Hits[i], Forwards[i], DefaultWalkableFloorZ, CaptureAngleCosines[i]);
+		}
+		FClimbingCore::ClassifySurfaces(Batch, BatchClimbable);
+
+		return FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles);
+	}));
+
+	return ScalarClimbable == BatchClimbable;
+}
+
+void UClimbingBenchmarkCommandlet::DriveCore(FCoreDriver& InOutDriver, float InDeltaTime) const
+{
+	FClimbingCore* Core = InOutDriver.Core;
+
+	if (Core->IsHanging())
+	{
+		++InOutDriver.HangingFrames;
+
+		if (InOutDriver.HangingFrames > HangFrames)
+		{
+			InOutDriver.HangingFrames = 0;
+			Core->HangRelease();
+		}
+		else
+		{
+			// Left and right, so nobody leaves its wall
+			const float Scale = ((InOutDriver.HangingFrames / StrafeFrames) % 2 == 0) ? 1.f : -1.f;
+			Core->MoveSideways(Scale, InDeltaTime);
+		}
+		return;
+	}
+
+	if (!Core->IsClimbing())
+	{
+		const bool IsInAir = !InOutDriver.Body->IsMovingOnGround();
+		if (InOutDriver.WasInAir && !IsInAir)
+		{
+			Core->ResetStates();
+		}
+		InOutDriver.WasInAir = IsInAir;
+	}
+}
+
+void UClimbingBenchmarkCommandlet::PopulateCoreClimbers(FAnalyticClimbingWorld& InOutWorld, int32 InNumClimbers,
+	TArray<TUniquePtr<FAnalyticClimbingBody>>& OutBodies, TArray<TUniquePtr<FClimbingCore>>& OutCores, TArray<FCoreDriver>& OutDrivers) const
+{
+	TArray<FVector> StartLocations;
+	PopulateAnalyticWorld(InOutWorld, InNumClimbers, AnalyticRadius, AnalyticHalfHeight, StartLocations);
+
+	for (const FVector& StartLocation : StartLocations)
+	{
+		FAnalyticClimbingBody* Body = OutBodies.Add_GetRef(MakeUnique<FAnalyticClimbingBody>(InOutWorld)).Get();
+		Body->Location = StartLocation;
+		Body->Radius = AnalyticRadius;
+		Body->HalfHeight = AnalyticHalfHeight;
+		Body->ChestHeight = AnalyticHalfHeight * 0.5f;
+
+		FClimbingCore* Core = OutCores.Add_GetRef(MakeUnique<FClimbingCore>(*Body, InOutWorld)).Get();
+		Core->Settings.IsClimbOnHitAllowed = true;
+
+		FCoreDriver Driver;
+		Driver.Body = Body;
+		Driver.Core = Core;
+		OutDrivers.Add(Driver);
+	}
+}
+
+void UClimbingBenchmarkCommandlet::PopulateAnalyticWorld(FAnalyticClimbingWorld& InOutWorld, int32 InNumClimbers, float InRadius, float InHalfHeight, TArray<FVector>& OutStartLocations) const
+{
+	const int32 NumWalls = FMath::DivideAndRoundUp(InNumClimbers, ClimbersPerWall);
+	const float WallLength = ClimbersPerWall * ClimberSpacing;
+
+	auto AddBox = [&InOutWorld](const FVector& InCenter, const FVector& InSize)
+	{
+		InOutWorld.AddBox(FBox::BuildAABB(InCenter, InSize * 0.5f));
+	};
+
+	// Floor under everything
+	AddBox(FVector(NumWalls * WallRowSpacing * 0.5f, WallLength * 0.5f, -50.f),
+		FVector(NumWalls * WallRowSpacing + 1000.f, WallLength + 1000.f, 100.f));
+
+	for (int32 Wall = 0; Wall < NumWalls; ++Wall)
+	{
+		AddBox(FVector(Wall * WallRowSpacing, WallLength * 0.5f, WallHeight * 0.5f), FVector(50.f, WallLength, WallHeight));
+	}
+
+	for (int32 i = 0; i < InNumClimbers; ++i)
+	{
+		const int32 Wall = i / ClimbersPerWall;
+		const int32 Slot = i % ClimbersPerWall;
+
+		// Touching the wall's -X face, looking at it
+		OutStartLocations.Add(FVector(Wall * WallRowSpacing - 25.f - InRadius - 1.f, (Slot + 0.5f) * ClimberSpacing, InHalfHeight + 1.f));
+	}
+}
+
+bool UClimbingBenchmarkCommandlet::LoadBaseline(const FString& InPath, TMap<FString, FClimbingBenchmarkResult>& OutBaseline) const
+{
+	TArray<FString> Lines;
+	if (!FFileHelper::LoadFileToStringArray(Lines, *InPath))
+	{
+		return false;
+	}
+
+	// <Name> <MeanMs> <P99Ms> <QueriesPerFrame>
+	for (const FString& Line : Lines)
+	{
+		TArray<FString> Fields;
+		if (Line.ParseIntoArrayWS(Fields) != 4)
+		{
+			continue;
+		}
+
+		FClimbingBenchmarkResult Result;
+		Result.Name = Fields[0];
+		Result.MeanMs = FCString::Atod(*Fields[1]);
+		Result.P99Ms = FCString::Atod(*Fields[2]);
+		Result.QueriesPerFrame = FCString::Atod(*Fields[3]);
+		OutBaseline.Add(Result.Name, Result);
+	}
+
+	return true;
+}
+
+bool UClimbingBenchmarkCommandlet::SaveBaseline(const FString& InPath, const TArray<FClimbingBenchmarkResult>& InResults) const
+{
+	// Keep the other scenarios of the file, e.g. the batched ones when updating the per component ones
+	TMap<FString, FClimbingBenchmarkResult> Baseline;
+	LoadBaseline(InPath, Baseline);
+
+	for (const FClimbingBenchmarkResult& Result : InResults)
+	{
+		Baseline.Add(Result.Name, Result);
+	}
+
+	Baseline.KeySort(TLess<FString>());
+
+	FString Content;
+	for (const auto& Pair : Baseline)
+	{
+		Content += FString::Printf(TEXT("%s %.6f %.6f %.4f\n"), *Pair.Value.Name, Pair.Value.MeanMs, Pair.Value.P99Ms, Pair.Value.QueriesPerFrame);
+	}
+
+	return FFileHelper::SaveStringToFile(Content, *InPath);
+}
@@ -0,0 +1,249 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingBenchmarkWorld.h"
+#include "Engine/World.h"
+#include "Engine/Engine.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/StaticMeshActor.h"
+#include "Components/StaticMeshComponent.h"
+#include "Components/ArrowComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "GameFramework/PlayerController.h"
+#include "Camera/PlayerCameraManager.h"
+
+#include "ClimbingComponent.h"
+#include "ClimbabilitySubsystem.h"
+
+namespace
+{
+	double Percentile(TArray<double>& InOutSamples, float InPercentile)
+	{
+		if (InOutSamples.Num() == 0)
+		{
+			return 0.0;
+		}
+
+		InOutSamples.Sort();
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(InPercentile * InOutSamples.Num()) - 1, 0, InOutSamples.Num() - 1);
+		return InOutSamples[Index];
+	}
+}
+
+UWorld* ClimbingBenchmark::CreateWorld()
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	const FURL URL;
+	World->SetGameMode(URL);
+	World->InitializeActorsForPlay(URL);
+	World->BeginPlay();
+
+	return World;
+}
+
+void ClimbingBenchmark::DestroyWorld(UWorld* InWorld)
+{
+	GEngine->DestroyWorldContext(InWorld);
+	InWorld->DestroyWorld(false);
+	CollectGarbage(RF_NoFlags);
+}
+
+void ClimbingBenchmark::SpawnViewer(UWorld* InWorld)
+{
+	const float WallLength = ClimbersPerWall * ClimberSpacing;
+
+	// Behind the first row, looking down the rows: the closest climbers at full detail, the last ones far out of it
+	const FVector ViewLocation(-WallRowSpacing * 0.5f, WallLength * 0.5f, 170.f);
+	APlayerController* Viewer = InWorld->SpawnActor<APlayerController>(ViewLocation, FRotator::ZeroRotator);
+	if (!(Viewer))
+	{
+		return;
+	}
+
+	// Nothing updates a camera with no player, the view point is the controller's own
+	if (Viewer->PlayerCameraManager)
+	{
+		Viewer->PlayerCameraManager->Destroy();
+		Viewer->PlayerCameraManager = nullptr;
+	}
+	Viewer->SetControlRotation(FRotator::ZeroRotator);
+}
+
+bool ClimbingBenchmark::SpawnWalls(UWorld* InWorld, int32 InNumClimbers, int32 InPropsPerClimber)
+{
+	UStaticMesh* Cube = LoadObject<UStaticMesh>(nullptr, TEXT("/Engine/BasicShapes/Cube.Cube"));
+	if (!(Cube))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Can't load the cube mesh."), *FString(__FUNCTION__));
+		return false;
+	}
+
+	const int32 NumWalls = FMath::DivideAndRoundUp(InNumClimbers, ClimbersPerWall);
+	const float WallLength = ClimbersPerWall * ClimberSpacing;
+
+	// The walls get the project's climbable profile when it blocks the channel, as a level would set them up.
+	// Otherwise nothing sets up the responses to the channel here, the walls are made the only ones to block it
+	const ECollisionChannel Channel = UClimbabilitySubsystem::GetTraceChannel();
+	const bool UseClimbableProfile = Channel != ECC_WorldStatic && UClimbabilitySubsystem::IsClimbableProfileBlocking(Channel);
+
+	auto SpawnBox = [InWorld, Cube, Channel, UseClimbableProfile](const FVector& InCenter, const FVector& InSize, bool InClimbable)
+	{
+		// Deferred, so the mesh is set before the static component gets registered
+		AStaticMeshActor* Box = InWorld->SpawnActorDeferred<AStaticMeshActor>(AStaticMeshActor::StaticClass(), FTransform(InCenter));
+		UStaticMeshComponent* MeshComponent = Box->GetStaticMeshComponent();
+		MeshComponent->SetStaticMesh(Cube);
+		if (InClimbable && UseClimbableProfile)
+		{
+			MeshComponent->SetCollisionProfileName(UClimbabilitySubsystem::ClimbableProfileName);
+		}
+		else if (Channel != ECC_WorldStatic)
+		{
+			MeshComponent->SetCollisionResponseToChannel(Channel, InClimbable ? ECR_Block : ECR_Ignore);
+		}
+		Box->FinishSpawning(FTransform(FRotator::ZeroRotator, InCenter, InSize / 100.f));
+		return Box;
+	};
+
+	// Floor under everything
+	SpawnBox(FVector(NumWalls * WallRowSpacing * 0.5f, WallLength * 0.5f, -50.f), 
+		FVector(NumWalls * WallRowSpacing + 1000.f, WallLength + 1000.f, 100.f), false);
+
+	for (int32 Wall = 0; Wall < NumWalls; ++Wall)
+	{
+		SpawnBox(FVector(Wall * WallRowSpacing, WallLength * 0.5f, WallHeight * 0.5f), FVector(50.f, WallLength, WallHeight), true);
+	}
+
+	// Around where PopulateWorld puts the climbers, from one side to the other through their back, away from the wall
+	for (int32 i = 0; i < InNumClimbers && InPropsPerClimber > 0; ++i)
+	{
+		const FVector Climber((i / ClimbersPerWall) * WallRowSpacing - 25.f - AnalyticRadius - 1.f, (i % ClimbersPerWall + 0.5f) * ClimberSpacing, 0.f);
+
+		for (int32 Prop = 0; Prop < InPropsPerClimber; ++Prop)
+		{
+			const float Angle = PI * (0.5f + (Prop + 0.5f) / InPropsPerClimber);
+			const FVector Offset = FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.f) * (AnalyticRadius + PropDistance);
+			AStaticMeshActor* Box = SpawnBox(Climber + Offset + FVector(0.f, 0.f, PropSize * 0.5f), FVector(PropSize), false);
+			Box->Tags.Add(UClimbabilitySubsystem::NotClimbableTag);
+		}
+	}
+
+	return true;
+}
+
+void ClimbingBenchmark::PopulateWorld(UWorld* InWorld, int32 InNumClimbers, bool InBatched, int32 InWalkingPercent, int32 InPropsPerClimber,
+	TArray<UClimbingComponent*>& OutClimbers)
+{
+	const ECollisionChannel Channel = UClimbabilitySubsystem::GetTraceChannel();
+
+	if (!SpawnWalls(InWorld, InNumClimbers, InPropsPerClimber))
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < InNumClimbers; ++i)
+	{
+		const int32 Wall = i / ClimbersPerWall;
+		const int32 Slot = i % ClimbersPerWall;
+
+		ACharacter* Character = InWorld->SpawnActorDeferred<ACharacter>(ACharacter::StaticClass(), FTransform::Identity,
+			nullptr, nullptr, ESpawnActorCollisionHandlingMethod::AlwaysSpawn);
+
+		const float Radius = Character->GetCapsuleComponent()->GetScaledCapsuleRadius();
+		const float HalfHeight = Character->GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
+
+		// Touching the wall's -X face, looking at it, or halfway to the previous row with nothing in reach
+		const bool IsWalking = i * 100 < InNumClimbers * InWalkingPercent;
+		const float X = IsWalking ? Wall * WallRowSpacing - WallRowSpacing * 0.5f : Wall * WallRowSpacing - 25.f - Radius - 1.f;
+		const FVector Location(X, (Slot + 0.5f) * ClimberSpacing, HalfHeight + 1.f);
+		Character->FinishSpawning(FTransform(FRotator::ZeroRotator, Location));
+
+		// Nobody possesses the benchmark characters
+		Character->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+
+		// The climbing queries hit the other climbers on either channel
+		UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+		Capsule->SetCollisionResponseToChannel(Channel, Capsule->GetCollisionResponseToChannel(ECC_WorldStatic));
+
+		UArrowComponent* TraceArrow = NewObject<UArrowComponent>(Character);
+		TraceArrow->ComponentTags.Add(FName("TraceArrow"));
+		TraceArrow->SetupAttachment(Character->GetRootComponent());
+		TraceArrow->SetRelativeLocation(FVector(0.f, 0.f, HalfHeight * 0.5f));
+		TraceArrow->RegisterComponent();
+
+		UClimbingComponent* Climber = NewObject<UClimbingComponent>(Character);
+		Climber->SetClimbOnHitAllowed(true);
+		Climber->UseClimbingSubsystem = InBatched;
+		Climber->RegisterComponent();
+
+		OutClimbers.Add(Climber);
+	}
+}
+
+void ClimbingBenchmark::DriveClimber(FClimberDriver& InOutDriver)
+{
+	UClimbingComponent* Climber = InOutDriver.Climber;
+	UCharacterMovementComponent* MovementComp = Climber->MovementComp;
+
+	if (Climber->IsHanging)
+	{
+		++InOutDriver.HangingFrames;
+
+		if (InOutDriver.HangingFrames > HangFrames)
+		{
+			InOutDriver.HangingFrames = 0;
+			++InOutDriver.NumReleases;
+			Climber->OnHangRelease();
+		}
+		else if (InOutDriver.HangingFrames > InOutDriver.IdleHangFrames)
+		{
+			// Left and right, so nobody leaves its wall
+			const float Scale = ((InOutDriver.HangingFrames / StrafeFrames) % 2 == 0) ? 1.f : -1.f;
+			Climber->OnMoveRight(Scale);
+		}
+		return;
+	}
+
+	if (!Climber->IsClimbing && MovementComp)
+	{
+		const bool IsInAir = !MovementComp->IsMovingOnGround();
+		if (InOutDriver.WasInAir && !IsInAir)
+		{
+			Climber->OnCharacterLanded();
+		}
+		InOutDriver.WasInAir = IsInAir;
+	}
+}
+
+FClimbingBenchmarkResult ClimbingBenchmark::MeasureFrames(const FString& InName, int32 InNumFrames, TFunctionRef<double(uint64& OutNumQueries)> InFrame)
+{
+	TArray<double> FrameTimes;
+	FrameTimes.Reserve(InNumFrames);
+	uint64 TotalQueries = 0;
+	double TotalMs = 0.0;
+
+	for (int32 Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		uint64 NumQueries = 0;
+		const double FrameMs = InFrame(NumQueries);
+
+		if (Frame >= BenchmarkWarmupFrames)
+		{
+			FrameTimes.Add(FrameMs);
+			TotalMs += FrameMs;
+			TotalQueries += NumQueries;
+		}
+	}
+
+	FClimbingBenchmarkResult Result;
+	Result.Name = InName;
+	Result.MeanMs = FrameTimes.Num() > 0 ? TotalMs / FrameTimes.Num() : 0.0;
+	Result.P99Ms = Percentile(FrameTimes, 0.99f);
+	Result.QueriesPerFrame = FrameTimes.Num() > 0 ? (double)TotalQueries / FrameTimes.Num() : 0.0;
+
+	return Result;
+}
@@ -0,0 +1,80 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Templates/Function.h"
+#include "ClimbingBenchmarkCommandlet.h"
+
+class UWorld;
+class UClimbingComponent;
+
+/** Procedural world and scripted climbers of the climbing commandlets: walls in rows, climbers in front of them */
+namespace ClimbingBenchmark
+{
+	const float BenchmarkDeltaTime = 1.f / 60.f;
+
+	/** Frames left out of the results, while everyone climbs for the first time */
+	const int32 BenchmarkWarmupFrames = 60;
+
+	const int32 ClimbersPerWall = 10;
+
+	const float ClimberSpacing = 150.f;
+
+	const float WallRowSpacing = 400.f;
+
+	/** Lower than MaxClimbingDistance over the chest, so every climb ends hanging */
+	const float WallHeight = 250.f;
+
+	const int32 StrafeFrames = 30;
+
+	/** Clutter of the dense scenario, on the floor behind and beside the climbers */
+	const float PropSize = 20.f;
+
+	const float PropDistance = 40.f;
+
+	const int32 HangFrames = 90;
+
+	/** Default character capsule, for the scenarios without a character */
+	const float AnalyticRadius = 34.f;
+
+	const float AnalyticHalfHeight = 88.f;
+
+	/** What the scripted player does with its climber */
+	struct FClimberDriver
+	{
+		UClimbingComponent* Climber = nullptr;
+
+		int32 HangingFrames = 0;
+
+		/** Hanging still before the strafes start */
+		int32 IdleHangFrames = 0;
+
+		int32 NumReleases = 0;
+
+		bool WasInAir = false;
+	};
+
+	UWorld* CreateWorld();
+
+	void DestroyWorld(UWorld* InWorld);
+
+	/** Player view the climbers' LOD is evaluated against, as in a game. Without one every climber is at full detail */
+	void SpawnViewer(UWorld* InWorld);
+
+	/** Floor and walls in rows, for InNumClimbers climbers, with InPropsPerClimber props on the floor around each climber.
+		Only the walls block the climbing channel, when it isn't WorldStatic. Returns false if the mesh can't be loaded */
+	bool SpawnWalls(UWorld* InWorld, int32 InNumClimbers, int32 InPropsPerClimber);
+
+	/** Walls in rows, climbers in front of them, but InWalkingPercent of them halfway between two rows.
+		Returns the climbing components */
+	void PopulateWorld(UWorld* InWorld, int32 InNumClimbers, bool InBatched, int32 InWalkingPercent, int32 InPropsPerClimber,
+		TArray<UClimbingComponent*>& OutClimbers);
+
+	/** Climb, hang, strafe left and right, drop, land, repeat */
+	void DriveClimber(FClimberDriver& InOutDriver);
+
+	/** Runs InFrame InNumFrames times. InFrame returns the milliseconds its frame spent climbing and adds the scene queries
+		it made to OutNumQueries. The frames past the warm-up make the result */
+	FClimbingBenchmarkResult MeasureFrames(const FString& InName, int32 InNumFrames, TFunctionRef<double(uint64& OutNumQueries)> InFrame);
+}
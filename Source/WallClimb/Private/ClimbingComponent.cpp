@@ -9,7 +9,119 @@
 #include "Components/ArrowComponent.h"
 #include "Components/SkinnedMeshComponent.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
 #include "Engine/Public/DrawDebugHelpers.h"
+#include "Net/UnrealNetwork.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/UObjectIterator.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeLock.h"
+#include "Misc/ScopeExit.h"
+#include "LedgeCacheSubsystem.h"
+#include "BakedLedgeSubsystem.h"
+#include "ClimbingSubsystem.h"
+#include "ClimbabilitySubsystem.h"
+#include "ClimbingMovementComponent.h"
+#include "LedgeGeometry.h"
+#include "ClimbingCapture.h"
+#include "ClimbingStats.h"
+
+namespace
+{
+	void ToggleClimbingCapture(const TArray<FString>& InArgs, UWorld* InWorld)
+	{
+		const bool Start = InArgs.Num() > 0 && InArgs[0] == TEXT("Start");
+		const FString Directory = FPaths::ProjectSavedDir() / TEXT("ClimbingCaptures");
+		const FString Stamp = FDateTime::Now().ToString();
+		int32 NumClimbers = 0;
+
+		for (TObjectIterator<UClimbingComponent> It; It; ++It)
+		{
+			UClimbingComponent* Climber = *It;
+			if (Climber->GetWorld() != InWorld || !Climber->GetOwner() || !Climber->HasBegunPlay())
+			{
+				continue;
+			}
+
+			if (!Start)
+			{
+				Climber->StopCapture();
+			}
+			else if (!Climber->StartCapture(Directory / FString::Printf(TEXT("%s_%s.clcap"), *Climber->GetOwner()->GetName(), *Stamp)))
+			{
+				continue;
+			}
+
+			++NumClimbers;
+		}
+
+		UE_LOG(LogTemp, Display, TEXT("Climbing capture %s for %d climbers, in %s"), Start ? TEXT("started") : TEXT("stopped"), NumClimbers, *Directory);
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs ClimbingCaptureCommand(
+		TEXT("Climbing.Capture"),
+		TEXT("Climbing.Capture Start|Stop. Records the climbing inputs and scene query results of every climber of the world ")
+		TEXT("to Saved/ClimbingCaptures, one file each. Replay them with -run=ClimbingReplay -File=<file>."),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateStatic(&ToggleClimbingCapture));
+
+	/** How far the top of a ledge may be from the grabbed height */
+	const float LedgeHeightTolerance = 2.f;
+
+	/** Above the rim of a baked or cached grab, where the column check ends so it doesn't touch the wall's own top */
+	const float GrabColumnClearance = 1.f;
+
+	/** Grabs further apart in height are on different ledges */
+	const float NetGrabHeightTolerance = 10.f;
+
+	/** Predicted state changes kept to compare with the server's */
+	const int32 MaxPredictions = 8;
+
+	/** Strafing time a client may save up on the server, e.g. over a hitch of its connection */
+	const float MaxServerStrafeTimeBudget = 0.25f;
+
+	/** Lowest significance of each LOD, Minimal takes the rest */
+	const float LODSignificances[] = { 0.75f, 0.5f, 0.25f };
+
+	/** Margin below a LOD's significance before detail is removed, so it doesn't flicker */
+	const float LODHysteresis = 0.05f;
+
+	/** Time between the climbing updates of each LOD, 0 for every frame */
+	const float LODUpdateIntervals[] = { 0.f, 1.f / 30.f, 0.1f, 0.25f };
+
+	const float LODEvaluationPeriod = 0.25f;
+
+	/** Climb target above the grab height, for the chest to be past it despite the rounding */
+	const float ClimbTargetTolerance = 0.1f;
+
+	/** Hits facing less the climbed wall's way are not on it */
+	const float ClimbedWallMinDot = 0.9f;
+
+	/** How far past the expected contact the limb probes go, each way */
+	const float LimbProbeReach = 30.f;
+
+	/** From the rim into the grabbed ledge, where the hands rest */
+	const float HandLedgeDepth = 10.f;
+
+	/** Above the chest, where the hands reach while climbing */
+	const float HandClimbReach = 40.f;
+
+	/** Turns smaller than that keep the limb targets */
+	const float LimbProbeRotationTolerance = 0.01f;
+
+	EClimbingLOD GetLODForSignificance(float InSignificance)
+	{
+		for (int32 i = 0; i < UE_ARRAY_COUNT(LODSignificances); ++i)
+		{
+			if (InSignificance >= LODSignificances[i])
+			{
+				return (EClimbingLOD)i;
+			}
+		}
+
+		return EClimbingLOD::Minimal;
+	}
+}
 
 // Sets default values for this component's properties
 UClimbingComponent::UClimbingComponent()
@@ -18,8 +130,90 @@ UClimbingComponent::UClimbingComponent()
 	// off to improve performance if you don't need them.
 	PrimaryComponentTick.bCanEverTick = true;
 
-	ObjectsToTrace = FCollisionObjectQueryParams::AllStaticObjects;
-	
+	SetIsReplicatedByDefault(true);
+
+	Core = MakeUnique<FClimbingCore>(*this, *this);
+}
+
+void UClimbingComponent::PostLoad()
+{
+	Super::PostLoad();
+
+#if WITH_EDITORONLY_DATA
+	// Tuning saved on the component before the profiles. The values that differ from the defaults go into an override profile
+	// of the archetype, based on the one set, so nothing tuned in a Blueprint is lost. The instances share the archetype's
+	const UClimbingProfile& Defaults = UClimbingProfile::GetDefaultProfile();
+
+#define CLIMBING_DEPRECATED_PROPERTIES(Op) \
+	Op(MaxClimbingDistance) \
+	Op(MaxClimbingSpeed) \
+	Op(MaxClimbingStrafeSpeed) \
+	Op(MaxSurfaceCaptureAngle) \
+	Op(UseLedgeFollowing) \
+	Op(ClimbAroundCorners) \
+	Op(GrabProbeColumns) \
+	Op(GrabProbeRows) \
+	Op(LODMaxDistance) \
+	Op(HiddenSignificanceScale) \
+	Op(WakeDistance) \
+	Op(ProximityCheckInterval) \
+	Op(MaxPredictionAge) \
+	Op(HandSpacing) \
+	Op(FootSpacing) \
+	Op(FootHeight) \
+	Op(LimbProbeMoveThreshold)
+
+#define CLIMBING_DESCRIBE_PROPERTY(Name) \
+	if (Name##_DEPRECATED != Defaults.Name) \
+	{ \
+		Migrated += FString::Printf(TEXT("%s=%s;"), TEXT(#Name), *LexToString(Name##_DEPRECATED)); \
+	}
+
+#define CLIMBING_MIGRATE_PROPERTY(Name) \
+	Override->Name = Name##_DEPRECATED;
+
+#define CLIMBING_RESET_PROPERTY(Name) \
+	Name##_DEPRECATED = Defaults.Name;
+
+	FString Migrated;
+	CLIMBING_DEPRECATED_PROPERTIES(CLIMBING_DESCRIBE_PROPERTY)
+
+	if (!Migrated.IsEmpty())
+	{
+		if (HasAnyFlags(RF_ClassDefaultObject | RF_ArchetypeObject))
+		{
+			// One override per base profile and set of values in the package, whatever number of archetypes carry them
+			UPackage* Package = GetOutermost();
+			const FString OverrideName = FString::Printf(TEXT("%s_Migrated_%08X"), Profile ? *Profile->GetName() : TEXT("ClimbingProfile"),
+				FCrc::StrCrc32(*(Migrated + GetPathNameSafe(Profile))));
+
+			UClimbingProfile* Override = FindObject<UClimbingProfile>(Package, *OverrideName);
+			if (!Override)
+			{
+				Override = NewObject<UClimbingProfile>(Package, *OverrideName, RF_Transactional, Profile);
+				CLIMBING_DEPRECATED_PROPERTIES(CLIMBING_MIGRATE_PROPERTY)
+				Override->UpdateSettings();
+			}
+
+			Profile = Override;
+			UE_LOG(LogTemp, Log, TEXT("%s: moved the climbing tuning into the override profile %s, resave to keep it"), *GetPathName(), *Override->GetName());
+		}
+		else if (UClimbingComponent* Archetype = Cast<UClimbingComponent>(GetArchetype()))
+		{
+			// Tuning of its own isn't kept, the instance goes by the archetype's profile
+			Archetype->ConditionalPostLoad();
+			Profile = Archetype->Profile;
+			UE_LOG(LogTemp, Log, TEXT("%s: goes by the climbing profile of %s, resave to keep it"), *GetPathName(), *Archetype->GetPathName());
+		}
+	}
+
+	CLIMBING_DEPRECATED_PROPERTIES(CLIMBING_RESET_PROPERTY)
+
+#undef CLIMBING_RESET_PROPERTY
+#undef CLIMBING_MIGRATE_PROPERTY
+#undef CLIMBING_DESCRIBE_PROPERTY
+#undef CLIMBING_DEPRECATED_PROPERTIES
+#endif
 }
 
 // Called when the game starts
@@ -42,487 +236,1874 @@ void UClimbingComponent::BeginPlay()
 	MovementComp = Cast<UCharacterMovementComponent>(Owner->GetComponentByClass(UCharacterMovementComponent::StaticClass()));
 	CapsuleComp = Cast<UCapsuleComponent>(Owner->GetComponentByClass(UCapsuleComponent::StaticClass()));
 
-	HasAbilityToClimb = true;
-	IsClimbing = false;
-	IsHanging = false;
+	// The climbing moves are made by the movement pass that follows the climbing update
+	ClimbingMovementComp = Cast<UClimbingMovementComponent>(MovementComp);
+	if (ClimbingMovementComp)
+	{
+		ClimbingMovementComp->AddTickPrerequisiteComponent(this);
+		ClimbingMovementComp->OnClimbTargetReached.AddUObject(this, &UClimbingComponent::OnClimbTargetReached);
+	}
+
+	ACharacter* Character = Cast<ACharacter>(Owner);
+	if (Character)
+	{
+		Character->MovementModeChangedDelegate.AddDynamic(this, &UClimbingComponent::OnOwnerMovementModeChanged);
+
+		// The default movement has no climb target, the body is stopped at the grab height after its pass instead
+		if (!ClimbingMovementComp)
+		{
+			Character->OnCharacterMovementUpdated.AddDynamic(this, &UClimbingComponent::OnOwnerMovementUpdated);
+		}
+	}
+
+	// Running into a wall wakes a sleeping component before its next proximity check
+	if (CapsuleComp)
+	{
+		CapsuleComp->OnComponentHit.AddDynamic(this, &UClimbingComponent::OnCapsuleHit);
+	}
+
+	PushSettings();
+	PullState();
+
+	if (GetOwnerRole() == ROLE_Authority && GetNetMode() != NM_Standalone)
+	{
+		Runtime.IsNetClimber = true;
+		GClimbingNetClimbers.Increment();
+	}
+
+	// The subsystem runs the scan and the state update for all the climbers at once
+	auto ClimbingSubsystem = GetWorld()->GetSubsystem<UClimbingSubsystem>();
+	if (ClimbingSubsystem)
+	{
+		SetScratch(&ClimbingSubsystem->GetScratch());
+		LatencyTracker.SetStats(&ClimbingSubsystem->GetLatency());
+	}
+
+	if (UseClimbingSubsystem && ClimbingSubsystem)
+	{
+		ClimbingSubsystem->RegisterClimber(this);
+		SetComponentTickEnabled(false);
+	}
 }
 
 void UClimbingComponent::OnMoveRight_Implementation(const float& Scale)
 {
-	MoveSideways(Scale);
-}
+	if (IsSimulatedProxy())
+	{
+		return;
+	}
 
-void UClimbingComponent::OnHangRelease_Implementation()
-{
-	if (IsHanging)
+	const float DeltaTime = GetWorld()->DeltaTimeSeconds;
+
+	// Below the core's dead zone there is nothing to send
+	if (IsPredicting() && FMath::Abs(Scale) >= 0.1f)
 	{
-		StopHanging();
+		ServerMoveSideways((int8)FMath::Clamp(FMath::RoundToInt(Scale * 127.f), -127, 127),
+			(uint8)FMath::Clamp(FMath::RoundToInt(DeltaTime * 1000.f), 0, 255));
+		CLIMBING_COUNT_NET_BITS(16);
 	}
+
+	MoveSideways(Scale, DeltaTime);
 }
 
-void UClimbingComponent::OnJumpPressed_Implementation()
+void UClimbingComponent::ServerMoveSideways_Implementation(int8 InScale, uint8 InDeltaTimeMs)
 {
-	// For later
+	// The client's frame times are only trusted up to the time that went by on the server, however often they come
+	const float Now = GetWorld()->GetTimeSeconds();
+	Runtime.ServerStrafeTimeBudget = FMath::Min(Runtime.ServerStrafeTimeBudget + FMath::Max(Now - Runtime.ServerStrafeBudgetTime, 0.f),
+		MaxServerStrafeTimeBudget);
+	Runtime.ServerStrafeBudgetTime = Now;
+
+	const float DeltaTime = FMath::Min(InDeltaTimeMs / 1000.f, Runtime.ServerStrafeTimeBudget);
+	Runtime.ServerStrafeTimeBudget -= DeltaTime;
+
+	MoveSideways(InScale / 127.f, DeltaTime);
 }
 
-void UClimbingComponent::OnJumpReleased_Implementation()
+bool UClimbingComponent::ServerMoveSideways_Validate(int8 InScale, uint8 InDeltaTimeMs)
 {
-	// For later
+	// Never sent by OnMoveRight
+	return InScale >= -127;
 }
 
-
-// Called every frame
-void UClimbingComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+void UClimbingComponent::OnHangRelease_Implementation()
 {
-	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	if (IsSimulatedProxy())
+	{
+		return;
+	}
 
-	/* TODO: A Freeze should be considered for the ScanForClimbingData */
-	ScanForClimbingData();
-	if (!IsClimbing)
+	if (IsPredicting())
+	{
+		ServerHangRelease();
+	}
+
+	const bool WasHanging = Core->IsHanging();
 	{
-		StartClimbing();
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::HangRelease, *Core);
+		Core->HangRelease();
 	}
-	else if (IsClimbing)
+
+	if (WasHanging && !Core->IsOnTheWall())
 	{
-		UpdateClimbing();
+		LatencyTracker.Start(EClimbingLatency::ReleaseToLanding, GetWorld()->GetTimeSeconds());
 	}
-	
+	PullState();
 }
 
-bool UClimbingComponent::IsClimbable(const FHitResult & HitResult)
+void UClimbingComponent::ServerHangRelease_Implementation()
 {
-	auto Owner = GetOwner();
+	OnHangRelease();
+}
 
-	if (!(Owner && MovementComp))
+void UClimbingComponent::OnJumpPressed_Implementation()
+{
+	if (!HasValidSetup())
 	{
 		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return false;
+		return;
 	}
 
-	/* Walkable surface check*/
-	if (MovementComp->IsWalkable(HitResult))
+	if (IsSimulatedProxy())
 	{
-		return false;
+		return;
 	}
 
-	/* Negative slope check*/
-	//if ((HitResult.ImpactNormal.Z > -0.05f))
-	//{
-	//	return false;
-	//}
-
-	auto ActorFwdVec = Owner->GetActorForwardVector();
-	float Dot = FVector2D::DotProduct(FVector2D(ActorFwdVec.X, ActorFwdVec.Y), 
-		FVector2D(HitResult.ImpactNormal.X, HitResult.ImpactNormal.Y));
-	
-	/* Check the capture angle */
-	float temp = FMath::Cos(FMath::DegreesToRadians(180.f - MaxSurfaceCaptureAngle));
-
-	if (Dot > temp)
+	if (IsPredicting())
 	{
-		return false;		
+		ServerJumpPressed();
 	}
 
-	return true;
+	PushSettings();
+	{
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::JumpPressed, *Core);
+		Core->JumpPressed();
+	}
+	PullState();
 }
 
-void UClimbingComponent::OnCharacterLanded_Implementation()
+void UClimbingComponent::ServerJumpPressed_Implementation()
 {
-	ResetClimbingStates();
+	OnJumpPressed();
 }
 
-void UClimbingComponent::OnLocationTransition_Implementation()
+void UClimbingComponent::SetClimbOnHitAllowed(bool InAllowed)
 {
-	// For later
-}
+	if (IsPredicting() && InAllowed != IsClimbOnHitAllowed)
+	{
+		ServerSetClimbOnHitAllowed(InAllowed);
+		CLIMBING_COUNT_NET_BITS(1);
+	}
 
-void UClimbingComponent::OnLocationTransitionFinished_Implementation()
-{
-	// For later
+	IsClimbOnHitAllowed = InAllowed;
 }
 
-bool UClimbingComponent::CanStartClimbing()
+void UClimbingComponent::ServerSetClimbOnHitAllowed_Implementation(bool InAllowed)
 {
-	// Check if we are allowed to climb, have something to climb and not climbing already
-	return HasAbilityToClimb && IsClimbOnHitAllowed 
-		&& (TickTraceHitResult.Actor != nullptr) && !IsOnTheWall() ;
+	IsClimbOnHitAllowed = InAllowed;
 }
 
-bool UClimbingComponent::IsOnTheWall()
+void UClimbingComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
-	return IsClimbing || IsHanging;
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(UClimbingComponent, NetState);
 }
 
-bool UClimbingComponent::UpdateClimbedDistance()
+void UClimbingComponent::GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize)
 {
-	auto Owner = GetOwner();
+	Super::GetResourceSizeEx(CumulativeResourceSize);
 
-	if (!(Owner))
+	SIZE_T Bytes = sizeof(FClimbingCore) + Core->GetAllocatedSize();
+	if (PredictionState)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return false;
+		Bytes += sizeof(FClimbingPredictionState) + PredictionState->Predictions.GetAllocatedSize();
+	}
+
+	Bytes += Runtime.WallsInReach.GetAllocatedSize();
+	for (const FClimbingWallInReach& Wall : Runtime.WallsInReach)
+	{
+		Bytes += Wall.Shape.Points.GetAllocatedSize() + Wall.Shape.Normals.GetAllocatedSize();
 	}
 
-	ClimbedDistance = (ClimbingStartLocation - Owner->GetActorLocation()).Size();
+	// The shared scratch belongs to the subsystem
+	if (OwnScratch)
+	{
+		Bytes += sizeof(FClimbingComponentScratch) + OwnScratch->VerticalHitResults.GetAllocatedSize() + OwnScratch->GrabOverlaps.GetAllocatedSize();
+	}
 
-	return MaxClimbingDistance > ClimbedDistance;
+	CumulativeResourceSize.AddDedicatedSystemMemoryBytes(Bytes);
 }
 
-bool UClimbingComponent::GetLocationToGrab()
+FClimbingComponentScratch& UClimbingComponent::GetScratch()
 {
-	TArray<FHitResult> VerticalHitResults;
-	FHitResult ClosestGrabableHit;
-	bool HitRetrieved = false;
-	
-
-	if (UpwardTrace(VerticalHitResults))
+	if (!Scratch)
 	{
-		HitRetrieved = FindClosestVerticalHit(VerticalHitResults, ClosestGrabableHit);
+		OwnScratch = MakeUnique<FClimbingComponentScratch>();
+		Scratch = OwnScratch.Get();
 	}
 
-	if (HitRetrieved)
-	{
-		LocationToGrab = ClosestGrabableHit.ImpactPoint;
-		return true;
-	}
+	return *Scratch;
+}
 
-	return false;
+void UClimbingComponent::SetScratch(FClimbingComponentScratch* InScratch)
+{
+	Scratch = InScratch;
+	Core->SetQueryScratch(InScratch ? &InScratch->Core : nullptr);
 }
 
-bool UClimbingComponent::FindClosestVerticalHit(const TArray<FHitResult>& InHitResults, 
-	FHitResult & HitResult) const
+void UClimbingComponent::OnRep_NetState()
 {
-	if (!(ChestBoneSocket))
+	FClimbingStateSnapshot Snapshot;
+	if (!NetState.Decode(Snapshot))
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return false;
+		// The ledge isn't resolved yet, the next update will tell
+		return;
 	}
 
-	if (InHitResults.Num() == 0)
+	ClimbingDirection = (EClimbDirection)NetState.Direction;
+
+	if (IsPredicting())
 	{
-		return false;
+		FClimbingPredictionState& Prediction = GetPredictionState();
+		Prediction.ServerSnapshot = Snapshot;
+		Prediction.HasServerSnapshot = true;
+		ReconcilePrediction();
+		return;
 	}
 
-	for (int32 i = InHitResults.Num() - 1; i >= 0; --i)
+	// The movement of other clients' characters is replicated, only the state is mirrored
 	{
-		FVector ActorBoundsOrigin, ActorBoundsExtent;
-		InHitResults[i].GetActor()->GetActorBounds(false, ActorBoundsOrigin, ActorBoundsExtent);
-		const float ComparisonTollerance = 1.f;
-
-		// check that ImpactPoint is on the top of the Actor's box, not inside
-		if ((ActorBoundsOrigin + ActorBoundsExtent).Z - InHitResults[i].ImpactPoint.Z > ComparisonTollerance)
-		{
-			continue;
-		}
-
-		if (InHitResults[i].ImpactPoint.Z >= ChestBoneSocket->GetComponentLocation().Z)
-		{
-			HitResult = InHitResults[i];
-			return true;
-		}
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::ApplySnapshot, *Core);
+		Capture << Snapshot << false;
+		Core->ApplySnapshot(Snapshot, false);
 	}
-
-	return false;
+	PullState();
 }
 
-bool UClimbingComponent::UpwardTrace(TArray<FHitResult>& OutHitResults) const
+UClimbingComponent::FClimbingPredictionState& UClimbingComponent::GetPredictionState()
 {
-	auto Owner = GetOwner();
-	if (!(Owner && ChestBoneSocket && CapsuleComp))
+	if (!PredictionState)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return false;
+		PredictionState = MakeUnique<FClimbingPredictionState>();
 	}
 
-	// Trace top-down
-	
-	// TODO: think it over again later, what location to take as a base.
-	FVector TraceEnd = TickTraceHitResult.ImpactPoint + (TickTraceHitResult.ImpactNormal * -1.f * CapsuleComp->GetScaledCapsuleRadius());
-
-	FVector TraceBegin = TraceEnd +
-		FVector(0.f, 0.f, 1.f) * (MaxClimbingDistance - ClimbedDistance);
-
-	DrawDebugLine(GetWorld(), TraceBegin, TraceEnd, FColor::Blue, false, 5.f, 0, 2.f);
-	FCollisionQueryParams Params(FName("UpwardTrace"), false, Owner);
-	return GetWorld()->LineTraceMultiByChannel(OutHitResults, TraceBegin, TraceEnd, ECC_WorldStatic, Params);
+	return *PredictionState;
 }
 
-bool UClimbingComponent::TickTrace(FHitResult & outHitResult)
+void UClimbingComponent::RecordPrediction()
 {
-	auto Owner = GetOwner();
-
-	if (!(Owner && CapsuleComp))
+	auto& Predictions = GetPredictionState().Predictions;
+	const FClimbingStateSnapshot Snapshot = Core->GetSnapshot();
+	if (Predictions.Num() > 0 && IsSameState(Predictions.Last().Snapshot, Snapshot))
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return false;
+		return;
 	}
 
-	float CapsuleHalfHeight, CapsuleRadius;
-	auto ActorRot = Owner->GetActorRotation().Quaternion();
-	auto ActorLoc = Owner->GetActorLocation();
-	auto ActorForwardVector = Owner->GetActorForwardVector();
-
-	CapsuleComp->GetScaledCapsuleSize(CapsuleRadius, CapsuleHalfHeight);
-
-	// TODO: This sensor should be rethinked
-	FCollisionShape CapsuleCollision = FCollisionShape::MakeCapsule(CapsuleRadius * 1.1, CapsuleHalfHeight * 0.75f);	
-	FCollisionQueryParams Params(FName("TickTrace"), false, Owner);
-
-	//FVector TraceCenter = ActorLoc + (ActorForwardVector * (CapsuleRadius * 1.5f));
+	if (Predictions.Num() == MaxPredictions)
+	{
+		Predictions.RemoveAt(0, 1, false);
+	}
 
-	return GetWorld()->SweepSingleByChannel(outHitResult, ActorLoc, ActorLoc, ActorRot, ECC_WorldStatic, CapsuleCollision, Params);
+	Predictions.Add({ GetWorld()->GetTimeSeconds(), Snapshot });
 }
 
-void UClimbingComponent::ScanForClimbingData()
+void UClimbingComponent::ReconcilePrediction()
 {
-	// If climbing is not allowed by the user and we are not on the wall, no need to update any data for climbing
-	if (!IsClimbOnHitAllowed)
+	if (!(PredictionState && PredictionState->HasServerSnapshot))
 	{
 		return;
 	}
-	if (IsOnTheWall())
+
+	const FClimbingStateSnapshot& ServerSnapshot = PredictionState->ServerSnapshot;
+	if (IsSameState(Core->GetSnapshot(), ServerSnapshot))
 	{
 		return;
 	}
 
-	FHitResult HitResult;
-
-	if (! TickTrace(HitResult))
+	auto& Predictions = PredictionState->Predictions;
+	const float MaxPredictionAge = GetProfile().MaxPredictionAge;
+	const float Now = GetWorld()->GetTimeSeconds();
+	for (const FClimbingPrediction& Prediction : Predictions)
 	{
-		/* TODO: Get rid of this ugly work around */
-		if (!IsHanging)
+		// The server is behind, in a state the client went through lately
+		if (Now - Prediction.Time <= MaxPredictionAge && IsSameState(Prediction.Snapshot, ServerSnapshot))
 		{
-			ActorToClimbOn = nullptr;
-			CurrentSurfaceNormal = FVector::ZeroVector;
+			return;
 		}
-		return;
 	}
 
- 	if (IsClimbable(HitResult))
+	// The client changed state lately, the server may still follow
+	if (Predictions.Num() > 0 && Now - Predictions.Last().Time <= MaxPredictionAge)
 	{
-		ActorToClimbOn = HitResult.GetActor();
-		CurrentSurfaceNormal = HitResult.ImpactNormal;
-		TickTraceHitResult = std::move(HitResult);
+		return;
 	}
-	else
+
+	INC_DWORD_STAT(STAT_Climbing_NetCorrections);
+	Predictions.Reset();
+
 	{
-		TickTraceHitResult = FHitResult();
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::ApplySnapshot, *Core);
+		Capture << ServerSnapshot << true;
+		Core->ApplySnapshot(ServerSnapshot, true);
 	}
+	PullState();
 }
 
-void UClimbingComponent::StartClimbing()
+bool UClimbingComponent::IsSameState(const FClimbingStateSnapshot& InA, const FClimbingStateSnapshot& InB)
 {
-	auto Owner = GetOwner();
-
-	if (!(Owner && MovementComp))
+	if (InA.Climbing != InB.Climbing || InA.Hanging != InB.Hanging)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return;
+		return false;
 	}
 
-	if (!CanStartClimbing())
-	{
-		return;
-	}
-	
-	IsClimbing = true;
-	HasAbilityToClimb = false;
+	// Moving along a ledge is corrected by the character movement, a different ledge isn't
+	return !InA.Hanging || FMath::Abs(InA.LocationToGrab.Z - InB.LocationToGrab.Z) <= NetGrabHeightTolerance;
+}
 
-	// by default we assume anything is potentially grabable
-	IsLocationPotentiallyReachable = true;
-	
-	LocationToGrab = FVector::ZeroVector;
-	MovementComp->SetMovementMode(EMovementMode::MOVE_Flying);
-	MovementComp->GravityScale = 0.f;
+void UClimbingComponent::OnJumpReleased_Implementation()
+{
+	// For later
+}
 
-	FVector LaunchVelocity = (CurrentSurfaceNormal * -1.f) + FVector(0.f, 0.f, 1.f);
-	LaunchVelocity.Normalize();
-	LaunchVelocity *= MaxClimbingSpeed;
 
-	ClimbingStartLocation = Owner->GetActorLocation();
+// Called every frame
+void UClimbingComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(TickComponent);
 
-	ACharacter* Character = Cast<ACharacter>(Owner);
-	if (Character)
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	ON_SCOPE_EXIT
 	{
-		Character->LaunchCharacter(LaunchVelocity, true, true);
-	}
-}
+		GClimbingTickCycles.Add(FPlatformTime::Cycles64() - StartCycles);
+	};
 
-void UClimbingComponent::StopClimbing(const EReasonToStopClimbing InReason)
-{
-	auto Owner = GetOwner();
-	if (!(Owner && MovementComp))
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (Recorder)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return;
+		Recorder->RecordFrame(DeltaTime);
 	}
-	// Wipe all the climbing related data.
 
-	IsClimbing = false;
-	LocationToGrab = FVector::ZeroVector;
-	IsLocationPotentiallyReachable = true;
-	ClimbedDistance = 0.f;
+	UpdateClimbingLOD(DeltaTime);
 
-	switch (InReason)
+	if (!UpdateSleep(DeltaTime))
 	{
-	case EReasonToStopClimbing::StartFalling:
-		MovementComp->GravityScale = 1.f;
-   		MovementComp->SetMovementMode(EMovementMode::MOVE_Walking);
-		break;
-	case EReasonToStopClimbing::StartHanging:
-		StartHanging();
-		break;
+		return;
 	}
+
+	/* TODO: A Freeze should be considered for the ScanForClimbingData */
+	ScanForClimbingData();
+	UpdateClimbingState();
+	UpdateLimbTargets();
 }
 
-void UClimbingComponent::UpdateClimbing()
+void UClimbingComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
 {
-	auto Owner = GetOwner();
-
-	if (!(Owner && ChestBoneSocket))
+	if (Runtime.IsNetClimber)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return;
+		Runtime.IsNetClimber = false;
+		GClimbingNetClimbers.Decrement();
 	}
 
-	// check if grab location not Zero, but potentially is reachable
-	if (LocationToGrab == FVector::ZeroVector &&
-		IsLocationPotentiallyReachable)
+	if (CapsuleComp)
 	{
-		IsLocationPotentiallyReachable = GetLocationToGrab();
+		CapsuleComp->OnComponentHit.RemoveDynamic(this, &UClimbingComponent::OnCapsuleHit);
 	}
 
-	if (LocationToGrab != FVector::ZeroVector)
+	if (ClimbingMovementComp)
 	{
-		if (ChestBoneSocket->GetComponentLocation().Z >= LocationToGrab.Z)
-		{
-			// Compensate Tick location update step
-			FVector DeltaLocation = FVector(0.f, 0.f, ChestBoneSocket->GetComponentLocation().Z - LocationToGrab.Z);
-			Owner->AddActorWorldOffset(DeltaLocation, false, nullptr, ETeleportType::TeleportPhysics);
+		ClimbingMovementComp->OnClimbTargetReached.RemoveAll(this);
+	}
 
-			// Stop climbing
-			StopClimbing(EReasonToStopClimbing::StartHanging);
-		}
+	if (AActor* TickBase = TickBaseActor.Get())
+	{
+		RemoveTickPrerequisiteActor(TickBase);
 	}
-	
-	if (!UpdateClimbedDistance())
+	TickBaseActor.Reset();
+
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (Character)
 	{
-		StopClimbing(EReasonToStopClimbing::StartFalling);
-	}	
-}
+		Character->MovementModeChangedDelegate.RemoveDynamic(this, &UClimbingComponent::OnOwnerMovementModeChanged);
+		Character->OnCharacterMovementUpdated.RemoveDynamic(this, &UClimbingComponent::OnOwnerMovementUpdated);
+	}
 
-void UClimbingComponent::StartHanging()
-{
-	HasAbilityToClimb = true;
-	IsHanging = true;
-	MovementComp->StopMovementImmediately();
-}
+	if (IsAsleep)
+	{
+		IsAsleep = false;
+		DEC_DWORD_STAT(STAT_Climbing_SleepingClimbers);
+	}
 
-void UClimbingComponent::StopHanging()
-{
-	if (!(MovementComp))
+	auto ClimbingSubsystem = GetWorld()->GetSubsystem<UClimbingSubsystem>();
+	if (ClimbingSubsystem)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return;
+		ClimbingSubsystem->UnregisterClimber(this);
 	}
 
-	IsHanging = false;
-	MovementComp->SetMovementMode(EMovementMode::MOVE_Walking);
-	MovementComp->GravityScale = 1.f;
+	// The subsystem's scratch and latencies may go before the component
+	SetScratch(nullptr);
+	LatencyTracker.SetStats(nullptr);
+
+	StopCapture();
+
+	Super::EndPlay(EndPlayReason);
 }
 
-void UClimbingComponent::UpdateHanging(float InDeltaTime)
+bool UClimbingComponent::HasValidSetup() const
 {
-	// most probably the best place to override the tick trace with 
-	// a bit cheaper trace to update current values. E.g. CurrentSurfaceNormal
+	return GetOwner() && MovementComp && CapsuleComp && ChestBoneSocket;
 }
 
-bool UClimbingComponent::BoxContainsVector(const FVector& Origin, const FVector& Extent, const FVector& InVector) const
+bool UClimbingComponent::StartCapture(const FString& InPath)
 {
-	FVector NegativeExtent = Extent * -1.f;
-	FVector LocalSpaceVector = Origin - InVector;
+	StopCapture();
+
+	Recorder = MakeUnique<FClimbingCaptureRecorder>(*this, *this);
+	RebindCore(*Recorder, *Recorder);
 
-	bool InsideX = ((LocalSpaceVector.X > NegativeExtent.X) && (LocalSpaceVector.X < Extent.X)) ? true : false;
-	bool InsideY = ((LocalSpaceVector.Y > NegativeExtent.Y) && (LocalSpaceVector.Y < Extent.Y)) ? true : false;
-	bool InsideZ = ((LocalSpaceVector.Z > NegativeExtent.Z) && (LocalSpaceVector.Z < Extent.Z)) ? true : false;
+	if (!Recorder->Open(InPath, *Core))
+	{
+		StopCapture();
+		return false;
+	}
 
-	return InsideX && InsideY && InsideZ;
+	return true;
 }
 
-void UClimbingComponent::ResetClimbingStates()
+void UClimbingComponent::StopCapture()
 {
-	IsClimbing = false;
-	IsHanging = false;
-	HasAbilityToClimb = true;
-
-	// Just in case of immergency use, try reset movement component to walking
-	if (!(MovementComp))
+	if (!Recorder)
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
 		return;
 	}
 
-	if (MovementComp->MovementMode != EMovementMode::MOVE_Walking)
-	{
-		MovementComp->SetMovementMode(EMovementMode::MOVE_Walking);
-		MovementComp->GravityScale = 1.f;
-	}	
+	RebindCore(*this, *this);
+	Recorder.Reset();
 }
 
-void UClimbingComponent::MoveSideways(const float& Scale)
+void UClimbingComponent::TakeOverState(const FClimbingStateSnapshot& InSnapshot, const FClimbingHit& InWall, UPrimitiveComponent* InWallComponent)
 {
-	if (!IsHanging)
+	PushSettings();
+
+	// The wall first, a climb goes on looking for its ledge from it
+	if (InWallComponent)
 	{
-		return;
+		WallComponent = InWallComponent;
+
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::ApplyScan, *Core);
+		Capture << true << InWall << true;
+		Core->ApplyScan(true, InWall, true);
 	}
 
-	if (FMath::Abs(Scale) < 0.1f)
 	{
-		return;
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::ApplySnapshot, *Core);
+		Capture << InSnapshot << true;
+		Core->ApplySnapshot(InSnapshot, true);
 	}
+	PullState();
+}
 
-	auto Owner = GetOwner();
-	
-	if (!(Owner))
+void UClimbingComponent::RebindCore(IClimbingBody& InBody, IClimbingCollision& InCollision)
+{
+	// The core keeps its body and collision for life
+	TArray<uint8> State;
+	FMemoryWriter Writer(State);
+	Core->SerializeState(Writer);
+
+	Core = MakeUnique<FClimbingCore>(InBody, InCollision);
+	Runtime.SeenAbortedGrabs = 0;
+
+	// Same scratch as the previous core
+	SetScratch(Scratch);
+
+	FMemoryReader Reader(State);
+	Core->SerializeState(Reader);
+}
+
+void UClimbingComponent::PushSettings()
+{
+	// Derived values included, they were computed when the profile was loaded
+	FClimbingSettings& Settings = Core->Settings;
+	Settings = GetProfile().GetSettings();
+	Settings.IsClimbOnHitAllowed = IsClimbOnHitAllowed;
+	Settings.ScanWithRay = ClimbingLOD >= EClimbingLOD::Low;
+
+	// A single probe goes through TraceDown, answered from the baked or cached ledges. The overlap is a scene query
+	if (ClimbingLOD == EClimbingLOD::Minimal)
+	{
+		Settings.GrabProbeColumns = 1;
+	}
+}
+
+void UClimbingComponent::PullState()
+{
+	// E.g. a snapshot from the server, the climb can't wait for the next proximity check
+	if (IsAsleep && Core->IsOnTheWall())
+	{
+		WakeUp();
+	}
+
+	const bool WasClimbing = IsClimbing;
+	IsClimbing = Core->IsClimbing();
+	IsHanging = Core->IsHanging();
+
+	// E.g. a snapshot from the server ended the climb early
+	if (Runtime.IsWaitingForClimbEnd && !IsClimbing)
+	{
+		ResumeClimbUpdates();
+	}
+
+	TrackLatency(WasClimbing);
+	UpdateBaseTickDependency();
+
+	if (GetOwnerRole() == ROLE_Authority && GetNetMode() != NM_Standalone)
+	{
+		// Only replicated when it actually changes
+		FClimbingNetState NewNetState;
+		NewNetState.Encode(Core->GetSnapshot(), (uint8)ClimbingDirection, WallComponent.Get());
+		if (NewNetState != NetState)
+		{
+			NetState = NewNetState;
+		}
+	}
+	else if (IsPredicting())
+	{
+		RecordPrediction();
+	}
+}
+
+void UClimbingComponent::UpdateBaseTickDependency()
+{
+	AActor* Base = Core->IsOnMovingBase() && WallComponent.IsValid() ? WallComponent->GetOwner() : nullptr;
+	if (Base == TickBaseActor.Get())
+	{
+		return;
+	}
+
+	if (AActor* PreviousBase = TickBaseActor.Get())
+	{
+		RemoveTickPrerequisiteActor(PreviousBase);
+	}
+
+	if (Base)
+	{
+		AddTickPrerequisiteActor(Base);
+	}
+
+	TickBaseActor = Base;
+}
+
+void UClimbingComponent::TrackLatency(bool InWasClimbing)
+{
+	// Other clients only see the server's transitions, late by the network
+	if (IsSimulatedProxy())
+	{
+		return;
+	}
+
+	const float Time = GetWorld()->GetTimeSeconds();
+
+	// Waiting for the climb to start from the first hit on a climbable wall, as long as it is allowed
+	const bool IsWallScanned = IsClimbOnHitAllowed && Core->GetWallHit().Surface && !Core->GetSurfaceNormal().IsZero();
+	if (!IsClimbing && !IsHanging)
+	{
+		if (IsWallScanned)
+		{
+			LatencyTracker.Start(EClimbingLatency::ScanToClimb, Time);
+		}
+		else
+		{
+			LatencyTracker.Cancel(EClimbingLatency::ScanToClimb);
+		}
+	}
+
+	if (IsClimbing && !InWasClimbing)
+	{
+		// From the ground, climbs on from a ledge have no scan to wait for
+		LatencyTracker.Stop(EClimbingLatency::ScanToClimb, ClimbingLOD, Time);
+		LatencyTracker.Cancel(EClimbingLatency::ReleaseToLanding);
+		LatencyTracker.Cancel(EClimbingLatency::ClimbToGrab);
+		LatencyTracker.Start(EClimbingLatency::ClimbToGrab, Time);
+		if (LatencyTracker.GetStats())
+		{
+			LatencyTracker.GetStats()->CountClimb(ClimbingLOD);
+		}
+	}
+	else if (!IsClimbing && InWasClimbing)
+	{
+		if (IsHanging)
+		{
+			LatencyTracker.Stop(EClimbingLatency::ClimbToGrab, ClimbingLOD, Time);
+		}
+		else
+		{
+			LatencyTracker.Cancel(EClimbingLatency::ClimbToGrab);
+		}
+	}
+
+	const uint32 NumAbortedGrabs = Core->GetNumAbortedGrabs();
+	if (NumAbortedGrabs != Runtime.SeenAbortedGrabs)
+	{
+		if (LatencyTracker.GetStats())
+		{
+			LatencyTracker.GetStats()->CountAbortedGrabs(ClimbingLOD, NumAbortedGrabs - Runtime.SeenAbortedGrabs);
+		}
+		Runtime.SeenAbortedGrabs = NumAbortedGrabs;
+	}
+}
+
+bool UClimbingComponent::ShouldScanForClimbingData()
+{
+	if (IsSimulatedProxy())
+	{
+		return false;
+	}
+
+	PushSettings();
+	return Core->ShouldScan();
+}
+
+void UClimbingComponent::ScanForClimbingData()
+{
+	if (!HasValidSetup())
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
+		return;
+	}
+
+	if (IsSimulatedProxy())
+	{
+		return;
+	}
+
+	PushSettings();
+	{
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::Scan, *Core);
+		Core->Scan();
+	}
+	PullState();
+}
+
+void UClimbingComponent::ApplyClimbingScan(bool HasHit, FHitResult& HitResult, bool IsHitClimbable)
+{
+	if (HasHit)
+	{
+		WallComponent = HitResult.Component;
+	}
+
+	const FClimbingHit Hit = MakeClimbingHit(HitResult, GetBodyWalkableFloorZ());
+
+	FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::ApplyScan, *Core);
+	Capture << HasHit << Hit << IsHitClimbable;
+	Core->ApplyScan(HasHit, Hit, IsHitClimbable);
+}
+
+void UClimbingComponent::UpdateClimbingState()
+{
+	if (!HasValidSetup())
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
+		return;
+	}
+
+	if (IsSimulatedProxy())
+	{
+		return;
+	}
+
+	PushSettings();
+	{
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::UpdateState, *Core);
+		Core->UpdateState();
+	}
+	PullState();
+
+	// A server that didn't follow is caught up with once the prediction is old enough
+	if (IsPredicting())
+	{
+		ReconcilePrediction();
+	}
+
+	ScheduleNextUpdate();
+}
+
+float UClimbingComponent::GetSignificance() const
+{
+	const APawn* Pawn = Cast<APawn>(GetOwner());
+	if (Pawn && Pawn->IsPlayerControlled())
+	{
+		return 1.f;
+	}
+
+	const FVector Location = GetOwner()->GetActorLocation();
+	float ClosestDistanceSquared = MAX_flt;
+	bool HasViewer = false;
+
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (!PlayerController)
+		{
+			continue;
+		}
+
+		FVector ViewLocation;
+		FRotator ViewRotation;
+		PlayerController->GetPlayerViewPoint(ViewLocation, ViewRotation);
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector::DistSquared(ViewLocation, Location));
+		HasViewer = true;
+	}
+
+	// Nobody to save the time for, e.g. in tools
+	if (!HasViewer)
+	{
+		return 1.f;
+	}
+
+	float Significance = 1.f - FMath::Clamp(FMath::Sqrt(ClosestDistanceSquared) / GetProfile().LODMaxDistance, 0.f, 1.f);
+
+	// Nothing is rendered on a dedicated server
+	if (GetNetMode() != NM_DedicatedServer && !GetOwner()->WasRecentlyRendered(LODEvaluationPeriod * 2.f))
+	{
+		Significance *= GetProfile().HiddenSignificanceScale;
+	}
+
+	return Significance;
+}
+
+void UClimbingComponent::UpdateClimbingLOD(float InDeltaTime)
+{
+	if (!UseClimbingLOD)
+	{
+		if (ClimbingLOD != EClimbingLOD::High)
+		{
+			SetClimbingLOD(EClimbingLOD::High);
+		}
+		return;
+	}
+
+	Runtime.TimeToLODEvaluation -= InDeltaTime;
+	if (Runtime.TimeToLODEvaluation > 0.f)
+	{
+		return;
+	}
+
+	Runtime.TimeToLODEvaluation = LODEvaluationPeriod;
+
+	const float Significance = GetSignificance();
+	const EClimbingLOD TargetLOD = GetLODForSignificance(Significance);
+	if (TargetLOD == ClimbingLOD)
+	{
+		return;
+	}
+
+	// Removing detail mid climb would change how it goes on
+	if (TargetLOD > ClimbingLOD && (Core->IsOnTheWall() || GetLODForSignificance(Significance + LODHysteresis) <= ClimbingLOD))
+	{
+		return;
+	}
+
+	SetClimbingLOD(TargetLOD);
+}
+
+void UClimbingComponent::SetClimbingLOD(EClimbingLOD InLOD)
+{
+	const bool IsAddingDetail = InLOD < ClimbingLOD;
+	ClimbingLOD = InLOD;
+
+	// The scan may change from a capsule to a ray, an async sweep in flight is of no use anymore
+	CancelPendingQueries();
+
+	if (IsAddingDetail)
+	{
+		Runtime.TimeToUpdate = 0.f;
+	}
+
+	ScheduleNextUpdate();
+}
+
+void UClimbingComponent::ScheduleNextUpdate()
+{
+	float Interval = LODUpdateIntervals[(int32)ClimbingLOD];
+
+	if (IsAsleep)
+	{
+		Interval = FMath::Max(Interval, GetProfile().ProximityCheckInterval);
+	}
+
+	// The grab data only follows a moving base as often as it is updated, and the end of the climb moves with it
+	const bool IsOnMovingBase = Core->IsOnMovingBase();
+	if (IsOnMovingBase)
+	{
+		Interval = 0.f;
+	}
+
+	// Be there when the climb ends, not a whole interval after, to grab the ledge where the full rate would
+	const float TimeToClimbEnd = Core->GetTimeToClimbEnd();
+	const bool WasWaitingForClimbEnd = Runtime.IsWaitingForClimbEnd;
+	Runtime.IsWaitingForClimbEnd = UseClimbTimer && TimeToClimbEnd >= 0.f && !Core->GetLocationToGrab().IsZero() && !IsSimulatedProxy()
+		&& !IsOnMovingBase;
+	if (Runtime.IsWaitingForClimbEnd)
+	{
+		// The grab is known and the climb goes at a constant velocity, nothing changes until it ends
+		Interval = TimeToClimbEnd;
+
+		if (ClimbingMovementComp)
+		{
+			const float ChestHeight = GetBodyChestZ() - GetBodyLocation().Z;
+			ClimbingMovementComp->SetClimbTarget(Core->GetLocationToGrab().Z - ChestHeight + ClimbTargetTolerance);
+		}
+	}
+	else if (Interval > 0.f && TimeToClimbEnd >= 0.f)
+	{
+		Interval = FMath::Min(Interval, TimeToClimbEnd);
+	}
+
+	Runtime.UpdateInterval = Interval;
+	Runtime.TimeToUpdate = Runtime.IsWaitingForClimbEnd ? Interval : FMath::Min(Runtime.TimeToUpdate, Interval);
+
+	if (PrimaryComponentTick.TickInterval != Interval)
+	{
+		// The climb ended before the scheduled update, e.g. at the climb target, the wait is cut short
+		if (WasWaitingForClimbEnd && !Runtime.IsWaitingForClimbEnd)
+		{
+			SetComponentTickIntervalAndCooldown(Interval);
+		}
+		else
+		{
+			SetComponentTickInterval(Interval);
+		}
+	}
+}
+
+bool UClimbingComponent::ConsumeUpdateTime(float InDeltaTime)
+{
+	if (Recorder)
+	{
+		Recorder->RecordFrame(InDeltaTime);
+	}
+
+	UpdateClimbingLOD(InDeltaTime);
+
+	if (!UpdateSleep(InDeltaTime))
+	{
+		return false;
+	}
+
+	Runtime.TimeToUpdate -= InDeltaTime;
+	if (Runtime.TimeToUpdate > 0.f)
+	{
+		return false;
+	}
+
+	Runtime.TimeToUpdate = Runtime.UpdateInterval;
+	return true;
+}
+
+bool UClimbingComponent::UpdateSleep(float InDeltaTime)
+{
+	// Simulated proxies don't scan anyway, and a climb goes on until it ends
+	if (!UseSleep || IsSimulatedProxy() || !HasValidSetup() || Core->IsOnTheWall())
+	{
+		if (IsAsleep)
+		{
+			WakeUp();
+		}
+		return true;
+	}
+
+	Runtime.TimeToProximityCheck -= InDeltaTime;
+	if (Runtime.TimeToProximityCheck <= 0.f)
+	{
+		Runtime.TimeToProximityCheck = GetProfile().ProximityCheckInterval;
+
+		const bool IsWallInReach = HasWallInReach();
+		if (IsWallInReach && IsAsleep)
+		{
+			WakeUp();
+		}
+		else if (!IsWallInReach && !IsAsleep)
+		{
+			FallAsleep();
+		}
+	}
+
+	return !IsAsleep;
+}
+
+bool UClimbingComponent::HasWallInReach()
+{
+	FVector Location;
+	FQuat Rotation;
+	float Radius, HalfHeight;
+	Core->GetScanCapsule(Location, Rotation, Radius, HalfHeight);
+
+	// Widened sideways only, the bottom stays as high as the scan's, over the floor the character walks on
+	const float Reach = Radius + GetProfile().WakeDistance;
+	const FCollisionShape Shape = FCollisionShape::MakeBox(FVector(Reach, Reach, HalfHeight));
+
+	FCollisionQueryParams Params(FName("ProximityCheck"), false, GetOwner());
+
+	Runtime.WallsInReach.Reset();
+	Runtime.AreWallsInReachResolved = false;
+
+	if (ClimbingLOD != EClimbingLOD::Minimal)
+	{
+		CLIMBING_COUNT_SCENE_QUERY();
+		return GetWorld()->OverlapAnyTestByChannel(Location, Rotation, UClimbabilitySubsystem::GetTraceChannel(), Shape, Params);
+	}
+
+	// Same overlap, the walls it finds are kept for the scans until the next check
+	TArray<FOverlapResult>& Overlaps = GetScratch().GrabOverlaps;
+	Overlaps.Reset();
+	CLIMBING_COUNT_SCENE_QUERY();
+	GetWorld()->OverlapMultiByChannel(Overlaps, Location, Rotation, UClimbabilitySubsystem::GetTraceChannel(), Shape, Params);
+
+	bool IsResolved = true;
+	for (const FOverlapResult& Overlap : Overlaps)
+	{
+		UPrimitiveComponent* Primitive = Overlap.Component.Get();
+		if (!(Overlap.bBlockingHit && Primitive))
+		{
+			continue;
+		}
+
+		// Something moving, or a side that can't be told from the collision, is left to the traces
+		FClimbingWallInReach Wall;
+		if (Primitive->Mobility != EComponentMobility::Static || !FLedgeShape::FromPrimitive(Primitive, Wall.Shape))
+		{
+			IsResolved = false;
+			break;
+		}
+
+		Wall.Primitive = Primitive;
+		Wall.BottomZ = (Primitive->Bounds.Origin - Primitive->Bounds.BoxExtent).Z;
+		Runtime.WallsInReach.Add(MoveTemp(Wall));
+	}
+
+	if (!IsResolved)
+	{
+		Runtime.WallsInReach.Reset();
+	}
+
+	Runtime.AreWallsInReachResolved = IsResolved;
+	Runtime.WallsInReachLocation = GetBodyLocation();
+	return Overlaps.Num() > 0;
+}
+
+bool UClimbingComponent::CanScanWithoutQueries() const
+{
+	// The body has to be within the margin the check was widened by, or the scan may reach past what it found
+	return ClimbingLOD == EClimbingLOD::Minimal && UseSleep && !IsAsleep && Runtime.AreWallsInReachResolved
+		&& FVector::DistSquared2D(GetBodyLocation(), Runtime.WallsInReachLocation) <= FMath::Square(GetProfile().WakeDistance);
+}
+
+EClimbingQueryStatus UClimbingComponent::TraceWallsInReach(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit)
+{
+	// The scan ray is horizontal, it hits the side of a wall between its bottom and its rim
+	const FVector2D Start(InStart.X, InStart.Y);
+	FVector2D Direction(InEnd.X - InStart.X, InEnd.Y - InStart.Y);
+	const float Length = Direction.Size();
+	if (Length < KINDA_SMALL_NUMBER)
+	{
+		return EClimbingQueryStatus::Miss;
+	}
+	Direction /= Length;
+
+	UPrimitiveComponent* ClosestWall = nullptr;
+	float ClosestDistance = Length;
+	FVector2D ClosestNormal = FVector2D::ZeroVector;
+
+	for (const FClimbingWallInReach& Wall : Runtime.WallsInReach)
+	{
+		UPrimitiveComponent* Primitive = Wall.Primitive.Get();
+		if (!(Primitive) || InStart.Z < Wall.BottomZ || InStart.Z > Wall.Shape.TopZ)
+		{
+			continue;
+		}
+
+		int32 Segment;
+		const float Distance = Wall.Shape.RaycastSides(Start, Direction, ClosestDistance, Segment);
+		if (Distance >= 0.f && (!ClosestWall || Distance < ClosestDistance))
+		{
+			ClosestWall = Primitive;
+			ClosestDistance = Distance;
+			ClosestNormal = Wall.Shape.Normals[Segment];
+		}
+	}
+
+	if (!ClosestWall)
+	{
+		return EClimbingQueryStatus::Miss;
+	}
+
+	// Converted as a traced hit would be
+	FHitResult HitResult;
+	HitResult.bBlockingHit = true;
+	HitResult.Component = ClosestWall;
+	HitResult.Actor = ClosestWall->GetOwner();
+	HitResult.ImpactPoint = FVector(Start + Direction * ClosestDistance, InStart.Z);
+	HitResult.ImpactNormal = FVector(ClosestNormal, 0.f);
+	HitResult.Location = HitResult.ImpactPoint;
+	HitResult.Normal = HitResult.ImpactNormal;
+
+	WallComponent = ClosestWall;
+	OutHit = MakeClimbingHit(HitResult, GetBodyWalkableFloorZ());
+	return EClimbingQueryStatus::Hit;
+}
+
+void UClimbingComponent::WakeUp()
+{
+	IsAsleep = false;
+	DEC_DWORD_STAT(STAT_Climbing_SleepingClimbers);
+
+	Runtime.TimeToProximityCheck = GetProfile().ProximityCheckInterval;
+	Runtime.TimeToUpdate = 0.f;
+	ScheduleNextUpdate();
+}
+
+void UClimbingComponent::FallAsleep()
+{
+	IsAsleep = true;
+	INC_DWORD_STAT(STAT_Climbing_SleepingClimbers);
+
+	// The skipped scans would find nothing, the core is told once
+	CancelPendingQueries();
+	FHitResult NoHit;
+	ApplyClimbingScan(false, NoHit, false);
+
+	ScheduleNextUpdate();
+}
+
+void UClimbingComponent::ResumeClimbUpdates()
+{
+	Runtime.IsWaitingForClimbEnd = false;
+
+	if (ClimbingMovementComp)
+	{
+		ClimbingMovementComp->ClearClimbTarget();
+	}
+
+	// The next update reschedules from there
+	Runtime.UpdateInterval = 0.f;
+	Runtime.TimeToUpdate = 0.f;
+	SetComponentTickIntervalAndCooldown(0.f);
+}
+
+void UClimbingComponent::OnClimbTargetReached()
+{
+	// Hang now, not at the next update
+	if (Runtime.IsWaitingForClimbEnd && Core->IsClimbing())
+	{
+		UpdateClimbingState();
+	}
+}
+
+void UClimbingComponent::OnOwnerMovementUpdated(float DeltaSeconds, FVector OldLocation, FVector OldVelocity)
+{
+	if (!(Runtime.IsWaitingForClimbEnd && Core->IsClimbing() && MovementComp && MovementComp->UpdatedComponent))
+	{
+		return;
+	}
+
+	// Replayed moves end where the server put the body
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (Character && Character->bClientUpdating)
+	{
+		return;
+	}
+
+	// Same target as UClimbingMovementComponent's
+	const float ChestHeight = GetBodyChestZ() - GetBodyLocation().Z;
+	const float TargetZ = Core->GetLocationToGrab().Z - ChestHeight + ClimbTargetTolerance;
+
+	USceneComponent* UpdatedComponent = MovementComp->UpdatedComponent;
+	const FVector Location = UpdatedComponent->GetComponentLocation();
+	if (Location.Z < TargetZ)
+	{
+		return;
+	}
+
+	// Back down the overshoot of the last pass, along the wall it came up. Swept, whatever moved under the body since stops it
+	FHitResult Hit;
+	MovementComp->SafeMoveUpdatedComponent(FVector(0.f, 0.f, TargetZ - Location.Z), UpdatedComponent->GetComponentQuat(), true, Hit);
+	OnClimbTargetReached();
+}
+
+void UClimbingComponent::OnOwnerMovementModeChanged(ACharacter* Character, EMovementMode PrevMovementMode, uint8 PreviousCustomMode)
+{
+	// E.g. launched by the game
+	const bool IsClimbMovement = ClimbingMovementComp ? ClimbingMovementComp->IsClimbMovement() : MovementComp && MovementComp->MovementMode == MOVE_Flying;
+	if (Runtime.IsWaitingForClimbEnd && !IsClimbMovement)
+	{
+		ResumeClimbUpdates();
+	}
+}
+
+void UClimbingComponent::OnCapsuleHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit)
+{
+	// Something else than the climbed wall got in the way
+	if (Runtime.IsWaitingForClimbEnd && FVector::DotProduct(Hit.ImpactNormal, Core->GetSurfaceNormal()) < ClimbedWallMinDot)
+	{
+		ResumeClimbUpdates();
+	}
+
+	// Walking hits the floor too, only the walls wake up
+	if (IsAsleep && Hit.ImpactNormal.Z < GetBodyWalkableFloorZ())
+	{
+		// A wall the last check didn't find, the scans trace until the next one
+		Runtime.AreWallsInReachResolved = false;
+		WakeUp();
+	}
+}
+
+void UClimbingComponent::OnCharacterLanded_Implementation()
+{
+	if (IsSimulatedProxy())
+	{
+		return;
+	}
+
+	LatencyTracker.Stop(EClimbingLatency::ReleaseToLanding, ClimbingLOD, GetWorld()->GetTimeSeconds());
+	ResetClimbingStates();
+}
+
+void UClimbingComponent::OnLocationTransition_Implementation()
+{
+	Runtime.IsInLocationTransition = true;
+	ClearLimbTargets();
+}
+
+void UClimbingComponent::OnLocationTransitionFinished_Implementation()
+{
+	Runtime.IsInLocationTransition = false;
+}
+
+FClimbingLimbTargets UClimbingComponent::GetLimbTargets() const
+{
+	FScopeLock Lock(&LimbTargetsLock);
+	return LimbTargets;
+}
+
+void UClimbingComponent::UpdateLimbTargets()
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(LimbTargets);
+
+	// Nobody sees the limbs of a dedicated server's characters, nor the details of distant ones
+	if (!UseLimbTargets || !HasValidSetup() || !Core->IsOnTheWall() || Runtime.IsInLocationTransition
+		|| ClimbingLOD != EClimbingLOD::High || GetNetMode() == NM_DedicatedServer)
+	{
+		ClearLimbTargets();
+		return;
+	}
+
+	// Last frame's probes, used only as a whole set
+	if (LimbTraceHandles[0].IsValid())
+	{
+		FClimbingLimbTargets Targets;
+		bool IsReady = true;
+
+		for (int32 Limb = 0; Limb < (int32)EClimbingLimb::Num; ++Limb)
+		{
+			FTraceDatum TraceDatum;
+			if (ConsumeAsyncTrace(LimbTraceHandles[Limb], TraceDatum) != EClimbingAsyncTrace::Ready)
+			{
+				IsReady = false;
+				continue;
+			}
+
+			const FHitResult* Hit = TraceDatum.OutHits.FindByPredicate([](const FHitResult& InHit) { return InHit.bBlockingHit; });
+			if (Hit)
+			{
+				FClimbingLimbTarget& Target = Targets.Get((EClimbingLimb)Limb);
+				Target.Location = Hit->ImpactPoint;
+				Target.Normal = Hit->ImpactNormal;
+				Target.HasContact = true;
+			}
+		}
+
+		if (IsReady)
+		{
+			FScopeLock Lock(&LimbTargetsLock);
+			Targets.Revision = LimbTargets.Revision + 1;
+			LimbTargets = Targets;
+		}
+		else
+		{
+			// Expired, e.g. the component skipped a frame, the targets are probed again
+			Runtime.HasLimbProbes = false;
+		}
+	}
+
+	const FVector Location = GetBodyLocation();
+	const FQuat Rotation = GetBodyRotation();
+	const bool IsCurrent = Runtime.HasLimbProbes && Runtime.LimbProbeHanging == Core->IsHanging()
+		&& FVector::DistSquared(Location, Runtime.LimbProbeLocation) <= FMath::Square(GetProfile().LimbProbeMoveThreshold)
+		&& Rotation.Equals(Runtime.LimbProbeRotation, LimbProbeRotationTolerance);
+	if (IsCurrent)
+	{
+		return;
+	}
+
+	SubmitLimbProbes();
+	Runtime.LimbProbeLocation = Location;
+	Runtime.LimbProbeRotation = Rotation;
+	Runtime.LimbProbeHanging = Core->IsHanging();
+	Runtime.HasLimbProbes = true;
+}
+
+void UClimbingComponent::SubmitLimbProbes()
+{
+	FCollisionQueryParams Params(FName("LimbProbe"), false, GetOwner());
+
+	for (int32 Limb = 0; Limb < (int32)EClimbingLimb::Num; ++Limb)
+	{
+		FVector Start, End;
+		GetLimbProbe((EClimbingLimb)Limb, Start, End);
+		CLIMBING_DRAW_DEBUG_LINE(GetWorld(), Start, End, FColor::Green, -1.f);
+
+		CLIMBING_COUNT_SCENE_QUERY();
+		LimbTraceHandles[Limb] = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End,
+			UClimbabilitySubsystem::GetTraceChannel(), Params);
+	}
+}
+
+void UClimbingComponent::GetLimbProbe(EClimbingLimb InLimb, FVector& OutStart, FVector& OutEnd) const
+{
+	float Radius, HalfHeight;
+	GetBodyCapsuleSize(Radius, HalfHeight);
+
+	const UClimbingProfile& Tuning = GetProfile();
+	const FVector Location = GetBodyLocation();
+	FVector Normal = Core->GetSurfaceNormal().GetSafeNormal2D();
+	if (Normal.IsZero())
+	{
+		Normal = -GetBodyRotation().GetForwardVector();
+	}
+
+	// Same right as the sideways moves
+	const FVector Right = FVector::CrossProduct(Normal, FVector::UpVector);
+	const bool IsHand = InLimb == EClimbingLimb::LeftHand || InLimb == EClimbingLimb::RightHand;
+	const float Side = (InLimb == EClimbingLimb::LeftHand || InLimb == EClimbingLimb::LeftFoot) ? -1.f : 1.f;
+
+	if (IsHand && Core->IsHanging())
+	{
+		// Down onto the grabbed ledge
+		const FVector Rest = Core->GetLocationToGrab() + Right * (Side * Tuning.HandSpacing) - Normal * HandLedgeDepth;
+		OutStart = Rest + FVector::UpVector * LimbProbeReach;
+		OutEnd = Rest - FVector::UpVector * LimbProbeReach;
+		return;
+	}
+
+	// Into the wall, from within the capsule
+	const float Z = IsHand ? GetBodyChestZ() + HandClimbReach : Location.Z - HalfHeight + Tuning.FootHeight;
+	OutStart = FVector(Location.X, Location.Y, Z) + Right * (Side * (IsHand ? Tuning.HandSpacing : Tuning.FootSpacing));
+	OutEnd = OutStart - Normal * (Radius + LimbProbeReach);
+}
+
+void UClimbingComponent::ClearLimbTargets()
+{
+	for (FTraceHandle& Handle : LimbTraceHandles)
+	{
+		Handle = FTraceHandle();
+	}
+	Runtime.HasLimbProbes = false;
+
+	FScopeLock Lock(&LimbTargetsLock);
+	if (LimbTargets.LeftHand.HasContact || LimbTargets.RightHand.HasContact || LimbTargets.LeftFoot.HasContact || LimbTargets.RightFoot.HasContact)
+	{
+		const int32 Revision = LimbTargets.Revision + 1;
+		LimbTargets = FClimbingLimbTargets();
+		LimbTargets.Revision = Revision;
+	}
+}
+
+void UClimbingComponent::UpdateHanging(float InDeltaTime)
+{
+	// most probably the best place to override the tick trace with
+	// a bit cheaper trace to update current values. E.g. CurrentSurfaceNormal
+}
+
+void UClimbingComponent::ResetClimbingStates()
+{
+	{
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::ResetStates, *Core);
+		Core->ResetStates();
+	}
+	PullState();
+}
+
+void UClimbingComponent::MoveSideways(float Scale, float DeltaTime)
+{
+	if (!HasValidSetup())
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
+		return;
+	}
+
+	PushSettings();
+	{
+		FClimbingCaptureCallScope Capture(Recorder.Get(), EClimbingCaptureRecord::MoveSideways, *Core);
+		Capture << Scale << DeltaTime;
+		Core->MoveSideways(Scale, DeltaTime);
+	}
+	PullState();
+}
+
+FVector UClimbingComponent::GetBodyLocation() const
+{
+	// Where the body will be once the movement pass made the moves asked for
+	const FVector PendingMove = ClimbingMovementComp ? ClimbingMovementComp->GetPendingClimbMove() : FVector::ZeroVector;
+	return GetOwner()->GetActorLocation() + PendingMove;
+}
+
+FQuat UClimbingComponent::GetBodyRotation() const
+{
+	return GetOwner()->GetActorQuat();
+}
+
+float UClimbingComponent::GetBodyChestZ() const
+{
+	const float PendingZ = ClimbingMovementComp ? ClimbingMovementComp->GetPendingClimbMove().Z : 0.f;
+	return ChestBoneSocket->GetComponentLocation().Z + PendingZ;
+}
+
+void UClimbingComponent::GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const
+{
+	CapsuleComp->GetScaledCapsuleSize(OutRadius, OutHalfHeight);
+}
+
+float UClimbingComponent::GetBodyWalkableFloorZ() const
+{
+	return MovementComp ? MovementComp->GetWalkableFloorZ() : 0.f;
+}
+
+void UClimbingComponent::LaunchClimbMovement(const FVector& InVelocity)
+{
+	if (ClimbingMovementComp)
+	{
+		ClimbingMovementComp->StartClimbMovement(InVelocity);
+		return;
+	}
+
+	MovementComp->SetMovementMode(EMovementMode::MOVE_Flying);
+	MovementComp->GravityScale = 0.f;
+
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (Character)
+	{
+		Character->LaunchCharacter(InVelocity, true, true);
+	}
+}
+
+void UClimbingComponent::ExitClimbMovement()
+{
+	if (!(MovementComp))
 	{
 		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
 		return;
 	}
 
-	FVector SurfaceRightVector = CurrentSurfaceNormal;
-	SurfaceRightVector = FVector::CrossProduct(SurfaceRightVector, FVector::UpVector);
-	SurfaceRightVector.Normalize();
+	if (ClimbingMovementComp)
+	{
+		ClimbingMovementComp->StopClimbMovement();
+		return;
+	}
+
+	if (MovementComp->MovementMode != EMovementMode::MOVE_Walking)
+	{
+		MovementComp->SetMovementMode(EMovementMode::MOVE_Walking);
+		MovementComp->GravityScale = 1.f;
+	}
+}
+
+void UClimbingComponent::StopBodyMovement()
+{
+	// The core only stops the body to hang
+	if (ClimbingMovementComp)
+	{
+		ClimbingMovementComp->StartHangMovement();
+		return;
+	}
+
+	MovementComp->StopMovementImmediately();
+}
+
+void UClimbingComponent::OffsetBody(const FVector& InDelta)
+{
+	if (ClimbingMovementComp && ClimbingMovementComp->IsClimbMovement())
+	{
+		ClimbingMovementComp->AddClimbMove(InDelta);
+		return;
+	}
+
+	GetOwner()->AddActorWorldOffset(InDelta, false, nullptr, ETeleportType::TeleportPhysics);
+}
+
+void UClimbingComponent::SetBodyLocation(const FVector& InLocation)
+{
+	if (ClimbingMovementComp && ClimbingMovementComp->IsClimbMovement())
+	{
+		ClimbingMovementComp->AddClimbMove(InLocation - GetBodyLocation());
+		return;
+	}
+
+	GetOwner()->SetActorLocation(InLocation);
+}
+
+void UClimbingComponent::FaceBody(const FVector& InDirection)
+{
+	GetOwner()->SetActorRotation(FRotator(0.f, InDirection.Rotation().Yaw, 0.f));
+}
+
+EClimbingQueryStatus UClimbingComponent::SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit)
+{
+	const FCollisionShape CapsuleCollision = FCollisionShape::MakeCapsule(InRadius, InHalfHeight);
 
-	FVector MoveVelocity = SurfaceRightVector * Scale * GetWorld()->DeltaTimeSeconds * MaxClimbingStrafeSpeed;
+	FHitResult HitResult;
+	bool HasHit = false;
 
-	FVector NextLocation = FMath::VInterpTo(Owner->GetActorLocation(), Owner->GetActorLocation() + MoveVelocity, GetWorld()->DeltaTimeSeconds, 0.f);
-	FHitResult NewLocationHitResult;
-	if (CanMoveSidewaysToLocation(NextLocation, NewLocationHitResult))
+	if (CanUseAsyncTraces())
 	{
-		Owner->SetActorLocation(NextLocation);
-		// In case of curved surfaces
-		CurrentSurfaceNormal = NewLocationHitResult.ImpactNormal;
+		// Pick up last frame's sweep before submitting the next one
+		FTraceDatum TraceDatum;
+		const EClimbingAsyncTrace Previous = ConsumeAsyncTrace(TickTraceHandle, TraceDatum);
+		SubmitTickTrace(InLocation, InRotation, CapsuleCollision);
+
+		if (Previous == EClimbingAsyncTrace::None)
+		{
+			return EClimbingQueryStatus::Pending;
+		}
+
+		if (Previous == EClimbingAsyncTrace::Ready)
+		{
+			HasHit = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit;
+			if (HasHit)
+			{
+				HitResult = TraceDatum.OutHits[0];
+			}
+		}
+		else
+		{
+			// A frame was skipped, e.g. a hitch. Waiting again could go on forever, this one blocks
+			HasHit = TickTrace(InLocation, InRotation, CapsuleCollision, HitResult);
+		}
 	}
 	else
 	{
-		// climb around the corner
+		TickTraceHandle = FTraceHandle();
+		HasHit = TickTrace(InLocation, InRotation, CapsuleCollision, HitResult);
+	}
+
+	if (!HasHit)
+	{
+		return EClimbingQueryStatus::Miss;
 	}
+
+	WallComponent = HitResult.Component;
+	OutHit = MakeClimbingHit(HitResult, GetBodyWalkableFloorZ());
+	return EClimbingQueryStatus::Hit;
 }
 
-bool UClimbingComponent::CanMoveSidewaysToLocation(const FVector & InTargetLocation, FHitResult& OutHitResult) const
+EClimbingQueryStatus UClimbingComponent::TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit)
 {
-	auto Owner = GetOwner();
-	if (!(CapsuleComp && Owner))
+	CLIMBING_SCOPE_CYCLE_COUNTER(TickTrace);
+
+	if (CanScanWithoutQueries())
 	{
-		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
-		return false;
+		return TraceWallsInReach(InStart, InEnd, OutHit);
+	}
+
+	FCollisionQueryParams Params(FName("TickTrace"), false, GetOwner());
+
+	CLIMBING_COUNT_SCENE_QUERY();
+	FHitResult HitResult;
+	if (!GetWorld()->LineTraceSingleByChannel(HitResult, InStart, InEnd, UClimbabilitySubsystem::GetTraceChannel(), Params))
+	{
+		return EClimbingQueryStatus::Miss;
+	}
+
+	WallComponent = HitResult.Component;
+	OutHit = MakeClimbingHit(HitResult, GetBodyWalkableFloorZ());
+	return EClimbingQueryStatus::Hit;
+}
+
+EClimbingQueryStatus UClimbingComponent::TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits)
+{
+	FVector GrabLocation;
+	const bool HasLedgeGrab = FindBakedLocationToGrab(InBegin, InEnd, InMinZ, InWall, GrabLocation)
+		|| (UseLedgeCache && FindCachedLocationToGrab(InBegin, InEnd, InMinZ, InWall, GrabLocation));
+	if (HasLedgeGrab && IsGrabColumnClear(GrabLocation, InBegin.Z))
+	{
+		// Answered without a trace: the rims come from the collision elements, and the ledges that can't be read from them
+		// (several elements, complex collision, no flat top) were left out, their grabs fall through to the trace
+		FClimbingHit Hit;
+		Hit.ImpactPoint = GrabLocation;
+		Hit.ImpactNormal = FVector::UpVector;
+		Hit.SurfaceTopZ = GrabLocation.Z;
+		Hit.Surface = InWall.Surface;
+		OutHits.Add(Hit);
+		return EClimbingQueryStatus::Hit;
+	}
+
+	TArray<FHitResult>& VerticalHitResults = GetScratch().VerticalHitResults;
+	VerticalHitResults.Reset();
+
+	// Sync, or a result that expired: the trace blocks, it isn't submitted again
+	FTraceDatum TraceDatum;
+	EClimbingAsyncTrace Previous = EClimbingAsyncTrace::Expired;
+	if (CanUseAsyncTraces())
+	{
+		Previous = ConsumeAsyncTrace(UpwardTraceHandle, TraceDatum);
+	}
+	else
+	{
+		UpwardTraceHandle = FTraceHandle();
+	}
+
+	if (Previous == EClimbingAsyncTrace::None)
+	{
+		SubmitUpwardTrace(InBegin, InEnd);
+		return EClimbingQueryStatus::Pending;
+	}
+
+	if (Previous == EClimbingAsyncTrace::Ready)
+	{
+		VerticalHitResults.Append(TraceDatum.OutHits);
+	}
+	else if (!UpwardTrace(InBegin, InEnd, VerticalHitResults))
+	{
+		return EClimbingQueryStatus::Miss;
+	}
+
+	const float WalkableFloorZ = GetBodyWalkableFloorZ();
+	for (const FHitResult& HitResult : VerticalHitResults)
+	{
+		float SurfaceTopZ;
+		if (GetSurfaceTopZ(HitResult, SurfaceTopZ))
+		{
+			FClimbingHit& Hit = OutHits.Add_GetRef(MakeClimbingHit(HitResult, WalkableFloorZ));
+			Hit.SurfaceTopZ = SurfaceTopZ;
+		}
+	}
+
+	return OutHits.Num() > 0 ? EClimbingQueryStatus::Hit : EClimbingQueryStatus::Miss;
+}
+
+bool UClimbingComponent::SupportsGrabSurfaces() const
+{
+	// The overlap finds the ledges of every actor in reach, baked or not
+	return true;
+}
+
+EClimbingQueryStatus UClimbingComponent::OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(UpwardTrace);
+
+	if (ClimbingLOD == EClimbingLOD::High)
+	{
+		CLIMBING_DRAW_DEBUG_BOX(GetWorld(), InBounds.GetCenter(), InBounds.GetExtent(), FColor::Blue, 5.f);
+	}
+
+	FCollisionQueryParams Params(FName("UpwardTrace"), false, GetOwner());
+	CLIMBING_COUNT_SCENE_QUERY();
+
+	TArray<FOverlapResult>& GrabOverlaps = GetScratch().GrabOverlaps;
+	GrabOverlaps.Reset();
+	GetWorld()->OverlapMultiByChannel(GrabOverlaps, InBounds.GetCenter(), FQuat::Identity, UClimbabilitySubsystem::GetTraceChannel(),
+		FCollisionShape::MakeBox(InBounds.GetExtent()), Params);
+
+	for (const FOverlapResult& Overlap : GrabOverlaps)
+	{
+		const UPrimitiveComponent* Primitive = Overlap.Component.Get();
+		if (!(Overlap.bBlockingHit && Primitive))
+		{
+			continue;
+		}
+
+		// Its top could be anywhere, only a trace can tell
+		FLedgeShape Shape;
+		if (!FLedgeShape::FromPrimitive(Primitive, Shape))
+		{
+			if (UClimbabilitySubsystem::IsPrimitiveClimbable(Primitive))
+			{
+				return EClimbingQueryStatus::Unsupported;
+			}
+			continue;
+		}
+
+		FClimbingGrabSurface& Surface = OutSurfaces.AddDefaulted_GetRef();
+		Surface.Points.Append(Shape.Points);
+		Surface.TopZ = Shape.TopZ;
+		Surface.BottomZ = (Primitive->Bounds.Origin - Primitive->Bounds.BoxExtent).Z;
+		Surface.Surface = Primitive;
+	}
+
+	return OutSurfaces.Num() > 0 ? EClimbingQueryStatus::Hit : EClimbingQueryStatus::Miss;
+}
+
+bool UClimbingComponent::TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit)
+{
+	// The baked sides of the wall we are on are as good as a traced one, any other wall is traced
+	auto BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	const UPrimitiveComponent* Wall = WallComponent.Get();
+	if (BakedLedges && Wall)
+	{
+		FVector WallLocation, WallNormal;
+		if (BakedLedges->FindWall(Wall->GetOwner(), InStart, InEnd - InStart, InMaxDepth, WallLocation, WallNormal))
+		{
+			OutHit = FClimbingHit();
+			OutHit.ImpactPoint = WallLocation;
+			OutHit.ImpactNormal = WallNormal;
+			return true;
+		}
 	}
 
+	FCollisionQueryParams Params(FName("MoveSidewaysTrace"), false, GetOwner());
+
+	if (ClimbingLOD == EClimbingLOD::High)
+	{
+		CLIMBING_DRAW_DEBUG_LINE(GetWorld(), InStart, InEnd, FColor::Purple, 0.1f);
+	}
+	CLIMBING_COUNT_SCENE_QUERY();
 	FHitResult HitResult;
-	FVector Offset = (CurrentSurfaceNormal * -1.f) *
-		(CapsuleComp->GetScaledCapsuleRadius() * 1.1f);
-	FCollisionQueryParams Params(FName("MoveSidewaysTrace"), false, Owner);
-	
-	DrawDebugLine(GetWorld(), InTargetLocation, InTargetLocation + Offset, FColor::Purple, false, 0.1f, 0, 2.f);
-	return GetWorld()->LineTraceSingleByChannel(HitResult, InTargetLocation, InTargetLocation + Offset, ECC_WorldStatic, Params);
+	if (!GetWorld()->LineTraceSingleByChannel(HitResult, InStart, InEnd, UClimbabilitySubsystem::GetTraceChannel(), Params))
+	{
+		return false;
+	}
+
+	OutHit = MakeClimbingHit(HitResult, GetBodyWalkableFloorZ());
+	return true;
+}
+
+bool UClimbingComponent::FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge)
+{
+	const FLedgeShape* Shape = nullptr;
+	HangLedgeActor.Reset();
+	OutLedge.Surface = nullptr;
+	OutLedge.Revision = 0;
+
+	const UPrimitiveComponent* Wall = IsSurfaceValid(InWall.Surface) ? WallComponent.Get() : nullptr;
+	const AActor* WallActor = Wall ? Wall->GetOwner() : nullptr;
+
+	// Baked ledges never move
+	auto BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	if (BakedLedges && WallActor)
+	{
+		Shape = BakedLedges->FindLedge(WallActor, InLocation, LedgeHeightTolerance);
+	}
+
+	auto LedgeCache = GetWorld()->GetSubsystem<ULedgeCacheSubsystem>();
+	if (!Shape && UseLedgeCache && LedgeCache && WallActor)
+	{
+		Shape = LedgeCache->FindLedge(WallActor, InLocation, OutLedge.Revision);
+		if (Shape)
+		{
+			HangLedgeActor = WallActor;
+			OutLedge.Surface = WallActor;
+		}
+	}
+
+	if (!Shape)
+	{
+		return false;
+	}
+
+	OutLedge.Points.Reset();
+	OutLedge.Points.Append(Shape->Points);
+	OutLedge.Normals.Reset();
+	OutLedge.Normals.Append(Shape->Normals);
+	OutLedge.TopZ = Shape->TopZ;
+	return true;
+}
+
+bool UClimbingComponent::IsLedgeCurrent(const FClimbingLedge& InLedge) const
+{
+	if (!InLedge.Surface)
+	{
+		return true;
+	}
+
+	const AActor* LedgeActor = HangLedgeActor.Get();
+	auto LedgeCache = GetWorld()->GetSubsystem<ULedgeCacheSubsystem>();
+	return LedgeActor && LedgeActor == InLedge.Surface && LedgeCache && LedgeCache->IsCurrent(LedgeActor, InLedge.Revision);
+}
+
+bool UClimbingComponent::IsSurfaceValid(const void* InSurface) const
+{
+	return InSurface && WallComponent.Get() == InSurface;
+}
+
+bool UClimbingComponent::GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const
+{
+	// Static and stationary walls never move, there is nothing to follow
+	const UPrimitiveComponent* Wall = IsSurfaceValid(InSurface) ? WallComponent.Get() : nullptr;
+	if (!(Wall && Wall->Mobility == EComponentMobility::Movable))
+	{
+		return false;
+	}
+
+	OutTransform = Wall->GetComponentTransform();
+	return true;
+}
+
+void UClimbingComponent::CancelPendingQueries()
+{
+	TickTraceHandle = FTraceHandle();
+	UpwardTraceHandle = FTraceHandle();
+}
+
+FClimbingHit UClimbingComponent::MakeClimbingHit(const FHitResult& InHitResult, float InWalkableFloorZ)
+{
+	FClimbingHit Hit;
+	Hit.ImpactPoint = InHitResult.ImpactPoint;
+	Hit.ImpactNormal = InHitResult.ImpactNormal;
+	Hit.WalkableFloorZ = InWalkableFloorZ;
+
+	// Unknown top, never taken for one
+	Hit.SurfaceTopZ = MAX_flt;
+
+	const UPrimitiveComponent* HitComponent = InHitResult.Component.Get();
+	if (HitComponent)
+	{
+		Hit.Surface = HitComponent;
+		Hit.IsSurfaceClimbable = UClimbabilitySubsystem::IsPrimitiveClimbable(HitComponent);
+		Hit.SurfaceTopZ = (HitComponent->Bounds.Origin + HitComponent->Bounds.BoxExtent).Z;
+		Hit.WalkableFloorZ = HitComponent->GetWalkableSlopeOverride().ModifyWalkableFloorZ(InWalkableFloorZ);
+	}
+
+	return Hit;
+}
+
+bool UClimbingComponent::GetSurfaceTopZ(const FHitResult& InHitResult, float& OutTopZ) const
+{
+	// The hit primitive's own bounds are kept up to date by the engine, and are the right ones for composite actors
+	const UPrimitiveComponent* HitComponent = InHitResult.Component.Get();
+	if (HitComponent)
+	{
+		OutTopZ = (HitComponent->Bounds.Origin + HitComponent->Bounds.BoxExtent).Z;
+		return true;
+	}
+
+	auto LedgeCache = GetWorld()->GetSubsystem<ULedgeCacheSubsystem>();
+	FVector BoundsOrigin, BoundsExtent;
+	if (LedgeCache && LedgeCache->GetActorBounds(InHitResult.GetActor(), BoundsOrigin, BoundsExtent))
+	{
+		OutTopZ = (BoundsOrigin + BoundsExtent).Z;
+		return true;
+	}
+
+	return false;
+}
+
+bool UClimbingComponent::FindBakedLocationToGrab(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FVector& OutLocation) const
+{
+	const UPrimitiveComponent* Wall = IsSurfaceValid(InWall.Surface) ? WallComponent.Get() : nullptr;
+	auto BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	if (!(BakedLedges && Wall))
+	{
+		return false;
+	}
+
+	return BakedLedges->FindGrabLocation(Wall->GetOwner(), InEnd, InMinZ, InBegin.Z, OutLocation);
+}
+
+bool UClimbingComponent::FindCachedLocationToGrab(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FVector& OutLocation) const
+{
+	const UPrimitiveComponent* Wall = IsSurfaceValid(InWall.Surface) ? WallComponent.Get() : nullptr;
+	AActor* HitActor = Wall ? Wall->GetOwner() : nullptr;
+	if (!(HitActor))
+	{
+		return false;
+	}
+
+	auto LedgeCache = GetWorld()->GetSubsystem<ULedgeCacheSubsystem>();
+	if (!(LedgeCache))
+	{
+		return false;
+	}
+
+	return LedgeCache->FindGrabLocation(HitActor, InEnd, InMinZ, InBegin.Z, OutLocation);
+}
+
+bool UClimbingComponent::IsGrabColumnClear(const FVector& InGrabLocation, float InTopZ) const
+{
+	const FVector End = InGrabLocation + FVector(0.f, 0.f, GrabColumnClearance);
+	if (InTopZ <= End.Z)
+	{
+		return true;
+	}
+
+	// A test is enough, whatever is hit means the full trace has to tell the grab
+	FCollisionQueryParams Params(FName("GrabColumnCheck"), false, GetOwner());
+	CLIMBING_COUNT_SCENE_QUERY();
+	return !GetWorld()->LineTraceTestByChannel(FVector(End.X, End.Y, InTopZ), End, UClimbabilitySubsystem::GetTraceChannel(), Params);
+}
+
+bool UClimbingComponent::UpwardTrace(const FVector& InBegin, const FVector& InEnd, TArray<FHitResult>& OutHitResults) const
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(UpwardTrace);
+
+	// Trace top-down
+	if (ClimbingLOD == EClimbingLOD::High)
+	{
+		CLIMBING_DRAW_DEBUG_LINE(GetWorld(), InBegin, InEnd, FColor::Blue, 5.f);
+	}
+	FCollisionQueryParams Params(FName("UpwardTrace"), false, GetOwner());
+	CLIMBING_COUNT_SCENE_QUERY();
+	return GetWorld()->LineTraceMultiByChannel(OutHitResults, InBegin, InEnd, UClimbabilitySubsystem::GetTraceChannel(), Params);
+}
+
+void UClimbingComponent::SubmitUpwardTrace(const FVector& InBegin, const FVector& InEnd)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(UpwardTrace);
+
+	if (ClimbingLOD == EClimbingLOD::High)
+	{
+		CLIMBING_DRAW_DEBUG_LINE(GetWorld(), InBegin, InEnd, FColor::Blue, 5.f);
+	}
+	FCollisionQueryParams Params(FName("UpwardTrace"), false, GetOwner());
+	CLIMBING_COUNT_SCENE_QUERY();
+	UpwardTraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Multi, InBegin, InEnd, UClimbabilitySubsystem::GetTraceChannel(), Params);
+}
+
+bool UClimbingComponent::TickTrace(const FVector& InLocation, const FQuat& InRotation, const FCollisionShape& InShape, FHitResult& OutHitResult) const
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(TickTrace);
+
+	FCollisionQueryParams Params(FName("TickTrace"), false, GetOwner());
+
+	CLIMBING_COUNT_SCENE_QUERY();
+	return GetWorld()->SweepSingleByChannel(OutHitResult, InLocation, InLocation, InRotation, UClimbabilitySubsystem::GetTraceChannel(), InShape, Params);
+}
+
+void UClimbingComponent::SubmitTickTrace(const FVector& InLocation, const FQuat& InRotation, const FCollisionShape& InShape)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(TickTrace);
+
+	FCollisionQueryParams Params(FName("TickTrace"), false, GetOwner());
+
+	CLIMBING_COUNT_SCENE_QUERY();
+	TickTraceHandle = GetWorld()->AsyncSweepByChannel(EAsyncTraceType::Single, InLocation, InLocation, InRotation, UClimbabilitySubsystem::GetTraceChannel(), InShape, Params);
+}
+
+EClimbingAsyncTrace UClimbingComponent::ConsumeAsyncTrace(FTraceHandle& InOutHandle, FTraceDatum& OutDatum) const
+{
+	if (!InOutHandle.IsValid())
+	{
+		return EClimbingAsyncTrace::None;
+	}
+
+	// Only answers on the frame right after the submission. The callers block on an expired one rather than submit it again
+	const bool IsReady = GetWorld()->QueryTraceData(InOutHandle, OutDatum);
+	InOutHandle = FTraceHandle();
+
+	return IsReady ? EClimbingAsyncTrace::Ready : EClimbingAsyncTrace::Expired;
+}
+
+bool UClimbingComponent::CanUseAsyncTraces() const
+{
+	// UClimbingSubsystem batches the queries of its climbers itself
+	return UseAsyncTraces && !UseClimbingSubsystem && Runtime.UpdateInterval <= 0.f && !IsAsleep && !Runtime.IsWaitingForClimbEnd;
 }
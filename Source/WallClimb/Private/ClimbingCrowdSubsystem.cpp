@@ -0,0 +1,479 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingCrowdSubsystem.h"
+#include "Engine/World.h"
+
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/PrimitiveComponent.h"
+#include "Async/ParallelFor.h"
+#include "ClimbingComponent.h"
+#include "ClimbabilitySubsystem.h"
+#include "ClimbingStats.h"
+
+int32 FClimbingCrowdAgents::Add(const FVector& InLocation, const FVector& InForward)
+{
+	Locations.Add(InLocation);
+	Forwards.Add(InForward);
+	Velocities.Add(FVector::ZeroVector);
+	States.Add(EClimbingCrowdState::Walking);
+	WallHits.AddDefaulted();
+	WallComponents.AddDefaulted();
+	LocationsToGrab.Add(FVector::ZeroVector);
+	ClimbStartLocations.Add(InLocation);
+	ClimbedDistances.Add(0.f);
+	IsGrabReachable.Add(true);
+	ScanHits.AddDefaulted();
+	ScanComponents.AddDefaulted();
+	HasScanHit.Add(false);
+
+	return Locations.Num() - 1;
+}
+
+void FClimbingCrowdAgents::RemoveAtSwap(int32 InIndex)
+{
+	Locations.RemoveAtSwap(InIndex, 1, false);
+	Forwards.RemoveAtSwap(InIndex, 1, false);
+	Velocities.RemoveAtSwap(InIndex, 1, false);
+	States.RemoveAtSwap(InIndex, 1, false);
+	WallHits.RemoveAtSwap(InIndex, 1, false);
+	WallComponents.RemoveAtSwap(InIndex, 1, false);
+	LocationsToGrab.RemoveAtSwap(InIndex, 1, false);
+	ClimbStartLocations.RemoveAtSwap(InIndex, 1, false);
+	ClimbedDistances.RemoveAtSwap(InIndex, 1, false);
+	IsGrabReachable.RemoveAtSwap(InIndex, 1, false);
+	ScanHits.RemoveAtSwap(InIndex, 1, false);
+	ScanComponents.RemoveAtSwap(InIndex, 1, false);
+	HasScanHit.RemoveAtSwap(InIndex, 1, false);
+}
+
+void FClimbingCrowdAgents::Empty()
+{
+	Locations.Empty();
+	Forwards.Empty();
+	Velocities.Empty();
+	States.Empty();
+	WallHits.Empty();
+	WallComponents.Empty();
+	LocationsToGrab.Empty();
+	ClimbStartLocations.Empty();
+	ClimbedDistances.Empty();
+	IsGrabReachable.Empty();
+	ScanHits.Empty();
+	ScanComponents.Empty();
+	HasScanHit.Empty();
+}
+
+void UClimbingCrowdSubsystem::Deinitialize()
+{
+	Agents.Empty();
+	AgentIndices.Empty();
+	AgentHandles.Empty();
+	FreeHandles.Empty();
+
+	Super::Deinitialize();
+}
+
+int32 UClimbingCrowdSubsystem::AddAgent(const FVector& InLocation, const FRotator& InRotation)
+{
+	const int32 Index = Agents.Add(InLocation, FRotator(0.f, InRotation.Yaw, 0.f).Vector());
+
+	int32 Handle;
+	if (FreeHandles.Num() > 0)
+	{
+		Handle = FreeHandles.Pop(false);
+		AgentIndices[Handle] = Index;
+	}
+	else
+	{
+		Handle = AgentIndices.Add(Index);
+	}
+
+	AgentHandles.Add(Handle);
+	return Handle;
+}
+
+int32 UClimbingCrowdSubsystem::AddAgentFromClimber(UClimbingComponent* InClimber)
+{
+	if (!(InClimber && InClimber->HasValidSetup()))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
+		return INDEX_NONE;
+	}
+
+	const AActor* Owner = InClimber->GetOwner();
+	const int32 Handle = AddAgent(Owner->GetActorLocation(), Owner->GetActorRotation());
+	const int32 Index = AgentIndices[Handle];
+
+	const FVector Velocity = InClimber->MovementComp->Velocity;
+	Agents.Velocities[Index] = FVector(Velocity.X, Velocity.Y, 0.f);
+
+	const FClimbingCore& Core = *InClimber->Core;
+	if (!Core.IsOnTheWall())
+	{
+		return Handle;
+	}
+
+	Agents.States[Index] = Core.IsHanging() ? EClimbingCrowdState::Hanging : EClimbingCrowdState::Climbing;
+	Agents.WallHits[Index] = Core.GetWallHit();
+	Agents.WallHits[Index].ImpactNormal = Core.GetSurfaceNormal();
+	Agents.WallComponents[Index] = InClimber->WallComponent;
+	Agents.LocationsToGrab[Index] = Core.GetLocationToGrab();
+	Agents.ClimbedDistances[Index] = Core.GetClimbedDistance();
+
+	// As far down the launch direction as it climbed
+	Agents.ClimbStartLocations[Index] = Agents.Locations[Index] -
+		FClimbingCore::GetLaunchVelocity(Core.GetSurfaceNormal(), 1.f) * Core.GetClimbedDistance();
+
+	return Handle;
+}
+
+bool UClimbingCrowdSubsystem::MoveAgentToClimber(int32 InAgent, UClimbingComponent* InClimber)
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	if (Index == INDEX_NONE || !(InClimber && InClimber->HasValidSetup()))
+	{
+		return false;
+	}
+
+	AActor* Owner = InClimber->GetOwner();
+	Owner->SetActorLocationAndRotation(Agents.Locations[Index], Agents.Forwards[Index].Rotation(), false, nullptr, ETeleportType::TeleportPhysics);
+
+	const EClimbingCrowdState State = Agents.States[Index];
+	if (State == EClimbingCrowdState::Walking)
+	{
+		InClimber->MovementComp->Velocity = Agents.Velocities[Index];
+	}
+
+	FClimbingStateSnapshot Snapshot;
+	Snapshot.Climbing = State == EClimbingCrowdState::Climbing;
+	Snapshot.Hanging = State == EClimbingCrowdState::Hanging;
+	Snapshot.LocationToGrab = Agents.LocationsToGrab[Index];
+	Snapshot.SurfaceNormal = Agents.WallHits[Index].ImpactNormal;
+
+	// The wall's surface is dropped with its component, the climber then only knows its point and normal
+	FClimbingHit Wall = Agents.WallHits[Index];
+	UPrimitiveComponent* WallComponent = Agents.WallComponents[Index].Get();
+	if (!WallComponent)
+	{
+		Wall.Surface = nullptr;
+	}
+
+	InClimber->TakeOverState(Snapshot, Wall, WallComponent);
+
+	RemoveAgent(InAgent);
+	return true;
+}
+
+void UClimbingCrowdSubsystem::RemoveAgent(int32 InAgent)
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	// The last agent takes the removed one's place
+	const int32 LastHandle = AgentHandles.Last();
+	Agents.RemoveAtSwap(Index);
+	AgentHandles.RemoveAtSwap(Index, 1, false);
+	AgentIndices[LastHandle] = Index;
+
+	AgentIndices[InAgent] = INDEX_NONE;
+	FreeHandles.Add(InAgent);
+}
+
+bool UClimbingCrowdSubsystem::IsValidAgent(int32 InAgent) const
+{
+	return GetAgentIndex(InAgent) != INDEX_NONE;
+}
+
+int32 UClimbingCrowdSubsystem::GetAgentIndex(int32 InAgent) const
+{
+	return AgentIndices.IsValidIndex(InAgent) ? AgentIndices[InAgent] : INDEX_NONE;
+}
+
+void UClimbingCrowdSubsystem::SetAgentVelocity(int32 InAgent, const FVector& InVelocity)
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	const FVector Velocity(InVelocity.X, InVelocity.Y, 0.f);
+	Agents.Velocities[Index] = Velocity;
+
+	if (Agents.States[Index] == EClimbingCrowdState::Walking && !Velocity.IsNearlyZero())
+	{
+		Agents.Forwards[Index] = Velocity.GetSafeNormal();
+	}
+}
+
+void UClimbingCrowdSubsystem::JumpAgent(int32 InAgent)
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	if (Index == INDEX_NONE || Agents.States[Index] != EClimbingCrowdState::Hanging)
+	{
+		return;
+	}
+
+	// Nothing to climb on, let go
+	if (!(Settings.IsClimbOnHitAllowed && Agents.WallComponents[Index].IsValid()))
+	{
+		DropAgent(Index);
+		return;
+	}
+
+	StartClimb(Index);
+}
+
+void UClimbingCrowdSubsystem::ReleaseAgent(int32 InAgent)
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	if (Index != INDEX_NONE && Agents.States[Index] == EClimbingCrowdState::Hanging)
+	{
+		DropAgent(Index);
+	}
+}
+
+FVector UClimbingCrowdSubsystem::GetAgentLocation(int32 InAgent) const
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	return Index != INDEX_NONE ? Agents.Locations[Index] : FVector::ZeroVector;
+}
+
+EClimbingCrowdState UClimbingCrowdSubsystem::GetAgentState(int32 InAgent) const
+{
+	const int32 Index = GetAgentIndex(InAgent);
+	return Index != INDEX_NONE ? Agents.States[Index] : EClimbingCrowdState::Walking;
+}
+
+void UClimbingCrowdSubsystem::Tick(float DeltaTime)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(Crowd);
+
+	MoveAgents(DeltaTime);
+	ScanAgents();
+	ClassifyScans();
+	UpdateClimbs();
+}
+
+bool UClimbingCrowdSubsystem::IsTickable() const
+{
+	return !IsTemplate() && !IsTickedManually && Agents.Num() > 0;
+}
+
+UWorld* UClimbingCrowdSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UClimbingCrowdSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClimbingCrowdSubsystem, STATGROUP_Tickables);
+}
+
+void UClimbingCrowdSubsystem::ForEachChunk(TFunctionRef<void(int32 InBegin, int32 InEnd)> InBody) const
+{
+	const int32 Num = Agents.Num();
+	ParallelFor(FMath::DivideAndRoundUp(Num, ChunkSize), [Num, &InBody](int32 Chunk)
+	{
+		const int32 Begin = Chunk * ChunkSize;
+		InBody(Begin, FMath::Min(Begin + ChunkSize, Num));
+	});
+}
+
+void UClimbingCrowdSubsystem::MoveAgents(float InDeltaTime)
+{
+	const float ClimbingSpeed = Settings.MaxClimbingSpeed;
+
+	ForEachChunk([this, InDeltaTime, ClimbingSpeed](int32 InBegin, int32 InEnd)
+	{
+		for (int32 i = InBegin; i < InEnd; ++i)
+		{
+			switch (Agents.States[i])
+			{
+			case EClimbingCrowdState::Walking:
+				Agents.Locations[i] += Agents.Velocities[i] * InDeltaTime;
+				break;
+			case EClimbingCrowdState::Climbing:
+				// The wall takes the horizontal part of the launch velocity away
+				Agents.Locations[i].Z += FClimbingCore::GetLaunchVelocity(Agents.WallHits[i].ImpactNormal, ClimbingSpeed).Z * InDeltaTime;
+				break;
+			default:
+				break;
+			}
+		}
+	});
+}
+
+void UClimbingCrowdSubsystem::ScanAgents()
+{
+	// Same as FClimbingCore::ShouldScan, nobody is allowed to climb
+	if (!Settings.IsClimbOnHitAllowed)
+	{
+		for (bool& HasHit : Agents.HasScanHit)
+		{
+			HasHit = false;
+		}
+		return;
+	}
+
+	UWorld* World = GetWorld();
+	const FCollisionQueryParams Params(FName("CrowdScan"), false);
+
+	ForEachChunk([this, World, &Params](int32 InBegin, int32 InEnd)
+	{
+		CLIMBING_SCOPE_CYCLE_COUNTER(TickTrace);
+
+		FHitResult HitResult;
+		for (int32 i = InBegin; i < InEnd; ++i)
+		{
+			Agents.HasScanHit[i] = false;
+			if (Agents.States[i] != EClimbingCrowdState::Walking)
+			{
+				continue;
+			}
+
+			FVector RayStart, RayEnd;
+			FClimbingCore::MakeScanRay(Agents.Locations[i], Agents.Forwards[i], AgentRadius, RayStart, RayEnd);
+
+			CLIMBING_COUNT_SCENE_QUERY();
+			if (World->LineTraceSingleByChannel(HitResult, RayStart, RayEnd, UClimbabilitySubsystem::GetTraceChannel(), Params))
+			{
+				Agents.ScanHits[i] = UClimbingComponent::MakeClimbingHit(HitResult, AgentWalkableFloorZ);
+				Agents.ScanComponents[i] = HitResult.Component;
+				Agents.HasScanHit[i] = true;
+			}
+		}
+	});
+}
+
+void UClimbingCrowdSubsystem::ClassifyScans()
+{
+	Surfaces.Reset();
+	ScannedAgents.Reset();
+
+	const float CaptureAngleCos = Settings.GetCaptureAngleCos();
+	for (int32 i = 0; i < Agents.Num(); ++i)
+	{
+		if (Agents.HasScanHit[i])
+		{
+			Surfaces.Add(Agents.ScanHits[i], Agents.Forwards[i], AgentWalkableFloorZ, CaptureAngleCos);
+			ScannedAgents.Add(i);
+		}
+	}
+
+	FClimbingCore::ClassifySurfaces(Surfaces, Climbable);
+
+	for (int32 k = 0; k < ScannedAgents.Num(); ++k)
+	{
+		const int32 i = ScannedAgents[k];
+		if (Climbable[k] && Agents.ScanComponents[i].IsValid())
+		{
+			Agents.WallHits[i] = Agents.ScanHits[i];
+			Agents.WallComponents[i] = Agents.ScanComponents[i];
+			StartClimb(i);
+		}
+	}
+}
+
+void UClimbingCrowdSubsystem::UpdateClimbs()
+{
+	UWorld* World = GetWorld();
+	const FCollisionQueryParams Params(FName("CrowdUpwardTrace"), false);
+
+	ForEachChunk([this, World, &Params](int32 InBegin, int32 InEnd)
+	{
+		// Per chunk, a ledge search runs once per climb at most
+		TArray<FHitResult> HitResults;
+		FClimbingHitArray Hits;
+
+		for (int32 i = InBegin; i < InEnd; ++i)
+		{
+			if (Agents.States[i] != EClimbingCrowdState::Climbing)
+			{
+				continue;
+			}
+
+			FVector& Location = Agents.Locations[i];
+			FVector& LocationToGrab = Agents.LocationsToGrab[i];
+			const FClimbingHit& Wall = Agents.WallHits[i];
+
+			// Same search as FClimbingCore::FindLocationToGrabWithTrace, the step is FClimbingCore::StepClimb
+			if (LocationToGrab == FVector::ZeroVector && Agents.IsGrabReachable[i])
+			{
+				CLIMBING_SCOPE_CYCLE_COUNTER(UpwardTrace);
+
+				FVector RangeBegin, RangeEnd;
+				FClimbingCore::MakeUpwardTraceRange(Wall.ImpactPoint, Wall.ImpactNormal, AgentRadius,
+					Settings.MaxClimbingDistance - Agents.ClimbedDistances[i], RangeBegin, RangeEnd);
+
+				HitResults.Reset();
+				Hits.Reset();
+
+				CLIMBING_COUNT_SCENE_QUERY();
+				World->LineTraceMultiByChannel(HitResults, RangeBegin, RangeEnd, UClimbabilitySubsystem::GetTraceChannel(), Params);
+				for (const FHitResult& HitResult : HitResults)
+				{
+					Hits.Add(UClimbingComponent::MakeClimbingHit(HitResult, AgentWalkableFloorZ));
+				}
+
+				FClimbingHit GrabHit;
+				Agents.IsGrabReachable[i] = FClimbingCore::FindClosestVerticalHit(Hits, Location.Z + AgentChestHeight, GrabHit);
+				if (Agents.IsGrabReachable[i])
+				{
+					LocationToGrab = GrabHit.ImpactPoint;
+				}
+			}
+
+			float HangOffsetZ = 0.f;
+			const EClimbingStep Step = FClimbingCore::StepClimb(Agents.ClimbStartLocations[i], Location, Location.Z + AgentChestHeight, LocationToGrab,
+				Settings.MaxClimbingDistance, Agents.ClimbedDistances[i], HangOffsetZ);
+
+			if (Step == EClimbingStep::Hang)
+			{
+				Location.Z += HangOffsetZ;
+				Agents.States[i] = EClimbingCrowdState::Hanging;
+			}
+			else if (Step == EClimbingStep::Drop)
+			{
+				DropAgent(i);
+			}
+		}
+	});
+}
+
+void UClimbingCrowdSubsystem::StartClimb(int32 InIndex)
+{
+	Agents.States[InIndex] = EClimbingCrowdState::Climbing;
+	Agents.ClimbStartLocations[InIndex] = Agents.Locations[InIndex];
+	Agents.ClimbedDistances[InIndex] = 0.f;
+	Agents.LocationsToGrab[InIndex] = FVector::ZeroVector;
+	Agents.IsGrabReachable[InIndex] = true;
+}
+
+void UClimbingCrowdSubsystem::DropAgent(int32 InIndex)
+{
+	FVector& Location = Agents.Locations[InIndex];
+	const FVector Start = Location;
+	const FVector End = Start - FVector(0.f, 0.f, Settings.MaxClimbingDistance + AgentHalfHeight * 2.f);
+
+	FHitResult HitResult;
+	const FCollisionQueryParams Params(FName("CrowdDrop"), false);
+
+	CLIMBING_COUNT_SCENE_QUERY();
+	if (GetWorld()->LineTraceSingleByChannel(HitResult, Start, End, ECC_WorldStatic, Params) && HitResult.ImpactNormal.Z >= AgentWalkableFloorZ)
+	{
+		Location.Z = HitResult.ImpactPoint.Z + AgentHalfHeight;
+	}
+	else
+	{
+		Location.Z = Agents.ClimbStartLocations[InIndex].Z;
+	}
+
+	Agents.States[InIndex] = EClimbingCrowdState::Walking;
+	Agents.LocationsToGrab[InIndex] = FVector::ZeroVector;
+	Agents.ClimbedDistances[InIndex] = 0.f;
+}
@@ -0,0 +1,350 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingLatency.h"
+#include "CoreGlobals.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#include "ClimbingSubsystem.h"
+
+namespace
+{
+	const TCHAR* LatencyNames[] = { TEXT("ScanToClimb"), TEXT("ClimbToGrab"), TEXT("ReleaseToLanding") };
+
+	const TCHAR* LODNames[] = { TEXT("High"), TEXT("Medium"), TEXT("Low"), TEXT("Minimal") };
+
+	const float Percentiles[] = { 0.5f, 0.9f, 0.99f };
+
+	int32 ToLODIndex(EClimbingLOD InLOD)
+	{
+		return FMath::Clamp((int32)InLOD, 0, FClimbingLatencyStats::NumLODs - 1);
+	}
+
+	/** E.g. "ThirdPersonMap, Client 1", to tell the worlds of a PIE session apart */
+	FString GetWorldName(const FWorldContext& InContext)
+	{
+		const UWorld* World = InContext.World();
+		const TCHAR* NetMode = TEXT("Standalone");
+		switch (World->GetNetMode())
+		{
+		case NM_DedicatedServer:
+			NetMode = TEXT("Dedicated Server");
+			break;
+		case NM_ListenServer:
+			NetMode = TEXT("Listen Server");
+			break;
+		case NM_Client:
+			NetMode = TEXT("Client");
+			break;
+		default:
+			break;
+		}
+
+		return InContext.PIEInstance > 0 ? FString::Printf(TEXT("%s, %s %d"), *World->GetName(), NetMode, InContext.PIEInstance)
+			: FString::Printf(TEXT("%s, %s"), *World->GetName(), NetMode);
+	}
+
+	void RunClimbingLatencyCommand(const TArray<FString>& InArgs)
+	{
+		if (!GEngine)
+		{
+			return;
+		}
+
+		const bool IsReset = InArgs.Num() > 0 && InArgs[0] == TEXT("Reset");
+		const bool IsCsv = InArgs.Num() > 0 && InArgs[0] == TEXT("Csv");
+		FString Content = FClimbingLatencyStats::CsvHeader;
+
+		for (const FWorldContext& Context : GEngine->GetWorldContexts())
+		{
+			UWorld* World = Context.World();
+			UClimbingSubsystem* ClimbingSubsystem = World ? World->GetSubsystem<UClimbingSubsystem>() : nullptr;
+			if (!ClimbingSubsystem)
+			{
+				continue;
+			}
+
+			FClimbingLatencyStats& Stats = ClimbingSubsystem->GetLatency();
+			if (IsReset)
+			{
+				Stats.Reset();
+			}
+			else if (IsCsv)
+			{
+				Stats.AppendCsv(GetWorldName(Context), Content);
+			}
+			else
+			{
+				Stats.Print(GetWorldName(Context));
+			}
+		}
+
+		if (IsReset)
+		{
+			UE_LOG(LogTemp, Display, TEXT("Climbing latency reset"));
+		}
+		else if (IsCsv)
+		{
+			const FString Path = InArgs.Num() > 1 ? InArgs[1]
+				: FPaths::ProfilingDir() / FString::Printf(TEXT("ClimbingLatency_%s.csv"), *FDateTime::Now().ToString());
+			if (FFileHelper::SaveStringToFile(Content, *Path))
+			{
+				UE_LOG(LogTemp, Display, TEXT("Climbing latency written to %s"), *Path);
+			}
+			else
+			{
+				UE_LOG(LogTemp, Error, TEXT("Can't write the climbing latency to %s"), *Path);
+			}
+		}
+	}
+
+	FAutoConsoleCommand ClimbingLatencyCommand(
+		TEXT("Climbing.Latency"),
+		TEXT("Climbing.Latency [Reset|Csv [File]]. Prints the latency percentiles of the climbing transitions of every world, ")
+		TEXT("for each LOD, and how often climbs run out of distance with a ledge in sight. Reset starts over, e.g. before ")
+		TEXT("switching async traces or LOD settings. Csv writes every bucket, to Saved/Profiling by default."),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunClimbingLatencyCommand));
+}
+
+void FClimbingLatencyHistogram::Add(uint32 InValue)
+{
+	int32 Bucket = InValue;
+	if (InValue >= (1u << MaxExponent))
+	{
+		Bucket = NumBuckets - 1;
+	}
+	else if (InValue >= NumLinearBuckets)
+	{
+		// The top 3 bits under the leading one pick the sub-bucket
+		const int32 Exponent = FMath::FloorLog2(InValue);
+		const int32 SubBucket = (InValue >> (Exponent - 3)) - NumSubBuckets;
+		Bucket = NumLinearBuckets + (Exponent - 4) * NumSubBuckets + SubBucket;
+	}
+
+	Buckets[Bucket].Increment();
+}
+
+int32 FClimbingLatencyHistogram::GetTotal() const
+{
+	int32 Total = 0;
+	for (int32 i = 0; i < NumBuckets; ++i)
+	{
+		Total += Buckets[i].GetValue();
+	}
+	return Total;
+}
+
+uint32 FClimbingLatencyHistogram::GetBucketMin(int32 InBucket)
+{
+	if (InBucket < NumLinearBuckets)
+	{
+		return InBucket;
+	}
+
+	if (InBucket == NumBuckets - 1)
+	{
+		return 1u << MaxExponent;
+	}
+
+	const int32 Exponent = 4 + (InBucket - NumLinearBuckets) / NumSubBuckets;
+	const uint32 SubBucket = (InBucket - NumLinearBuckets) % NumSubBuckets;
+	return (NumSubBuckets + SubBucket) << (Exponent - 3);
+}
+
+uint32 FClimbingLatencyHistogram::GetBucketMax(int32 InBucket)
+{
+	if (InBucket < NumLinearBuckets)
+	{
+		return InBucket;
+	}
+
+	if (InBucket == NumBuckets - 1)
+	{
+		return MAX_uint32;
+	}
+
+	const int32 Exponent = 4 + (InBucket - NumLinearBuckets) / NumSubBuckets;
+	return GetBucketMin(InBucket) + (1u << (Exponent - 3)) - 1;
+}
+
+uint32 FClimbingLatencyHistogram::GetPercentile(float InPercentile) const
+{
+	const int32 Total = GetTotal();
+	if (Total == 0)
+	{
+		return 0;
+	}
+
+	const int32 Rank = FMath::Max(FMath::CeilToInt(Total * InPercentile), 1);
+	int32 Count = 0;
+	for (int32 i = 0; i < NumBuckets; ++i)
+	{
+		Count += Buckets[i].GetValue();
+		if (Count >= Rank)
+		{
+			return GetBucketMax(i);
+		}
+	}
+
+	return GetBucketMax(NumBuckets - 1);
+}
+
+void FClimbingLatencyHistogram::Reset()
+{
+	for (int32 i = 0; i < NumBuckets; ++i)
+	{
+		Buckets[i].Reset();
+	}
+}
+
+void FClimbingLatencyStats::Record(EClimbingLatency InLatency, EClimbingLOD InLOD, float InSeconds, uint64 InFrames)
+{
+	const int32 LOD = ToLODIndex(InLOD);
+	MillisecondHistograms[(int32)InLatency][LOD].Add((uint32)FMath::Max(FMath::RoundToInt(InSeconds * 1000.f), 0));
+	FrameHistograms[(int32)InLatency][LOD].Add((uint32)FMath::Min(InFrames, (uint64)MAX_uint32));
+}
+
+void FClimbingLatencyStats::CountClimb(EClimbingLOD InLOD)
+{
+	NumClimbs[ToLODIndex(InLOD)].Increment();
+}
+
+void FClimbingLatencyStats::CountAbortedGrabs(EClimbingLOD InLOD, uint32 InCount)
+{
+	NumAbortedGrabs[ToLODIndex(InLOD)].Add(InCount);
+}
+
+const FClimbingLatencyHistogram& FClimbingLatencyStats::GetMilliseconds(EClimbingLatency InLatency, EClimbingLOD InLOD) const
+{
+	return MillisecondHistograms[(int32)InLatency][ToLODIndex(InLOD)];
+}
+
+const FClimbingLatencyHistogram& FClimbingLatencyStats::GetFrames(EClimbingLatency InLatency, EClimbingLOD InLOD) const
+{
+	return FrameHistograms[(int32)InLatency][ToLODIndex(InLOD)];
+}
+
+void FClimbingLatencyStats::Print(const FString& InWorldName) const
+{
+	for (int32 Latency = 0; Latency < (int32)EClimbingLatency::Num; ++Latency)
+	{
+		for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+		{
+			const FClimbingLatencyHistogram& Milliseconds = MillisecondHistograms[Latency][LOD];
+			const FClimbingLatencyHistogram& Frames = FrameHistograms[Latency][LOD];
+			const int32 Total = Milliseconds.GetTotal();
+			if (Total == 0)
+			{
+				continue;
+			}
+
+			// Upper bounds of the buckets, the values are at most these
+			FString Line = FString::Printf(TEXT("%s: climbing latency %s, %s: %d samples"), *InWorldName, LatencyNames[Latency], LODNames[LOD], Total);
+			for (float Percentile : Percentiles)
+			{
+				Line += FString::Printf(TEXT(", p%d <= %u ms / %u frames"), FMath::RoundToInt(Percentile * 100.f),
+					Milliseconds.GetPercentile(Percentile), Frames.GetPercentile(Percentile));
+			}
+			UE_LOG(LogTemp, Display, TEXT("%s"), *Line);
+		}
+	}
+
+	for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+	{
+		const int32 Climbs = NumClimbs[LOD].GetValue();
+		if (Climbs == 0)
+		{
+			continue;
+		}
+
+		const int32 Aborted = NumAbortedGrabs[LOD].GetValue();
+		UE_LOG(LogTemp, Display, TEXT("%s: climbing aborted grabs, %s: %d of %d climbs (%.1f%%)"), *InWorldName, LODNames[LOD], Aborted, Climbs,
+			100.f * Aborted / Climbs);
+	}
+}
+
+const TCHAR* FClimbingLatencyStats::CsvHeader = TEXT("World,Latency,LOD,Unit,BucketMin,BucketMax,Count\n");
+
+void FClimbingLatencyStats::AppendCsv(const FString& InWorldName, FString& InOutContent) const
+{
+	// Commas would split the world's column
+	const FString World = InWorldName.Replace(TEXT(","), TEXT(""));
+
+	for (int32 Latency = 0; Latency < (int32)EClimbingLatency::Num; ++Latency)
+	{
+		for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+		{
+			const FClimbingLatencyHistogram* Histograms[] = { &MillisecondHistograms[Latency][LOD], &FrameHistograms[Latency][LOD] };
+			const TCHAR* Units[] = { TEXT("ms"), TEXT("frames") };
+
+			for (int32 Unit = 0; Unit < UE_ARRAY_COUNT(Histograms); ++Unit)
+			{
+				for (int32 Bucket = 0; Bucket < FClimbingLatencyHistogram::NumBuckets; ++Bucket)
+				{
+					InOutContent += FString::Printf(TEXT("%s,%s,%s,%s,%u,%u,%d\n"), *World, LatencyNames[Latency], LODNames[LOD], Units[Unit],
+						FClimbingLatencyHistogram::GetBucketMin(Bucket), FClimbingLatencyHistogram::GetBucketMax(Bucket),
+						Histograms[Unit]->GetCount(Bucket));
+				}
+			}
+		}
+	}
+
+	// Climb counts as rows of their own, with no bucket
+	for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+	{
+		InOutContent += FString::Printf(TEXT("%s,Climbs,%s,climbs,,,%d\n"), *World, LODNames[LOD], NumClimbs[LOD].GetValue());
+		InOutContent += FString::Printf(TEXT("%s,AbortedGrabs,%s,climbs,,,%d\n"), *World, LODNames[LOD], NumAbortedGrabs[LOD].GetValue());
+	}
+}
+
+void FClimbingLatencyStats::Reset()
+{
+	for (int32 Latency = 0; Latency < (int32)EClimbingLatency::Num; ++Latency)
+	{
+		for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+		{
+			MillisecondHistograms[Latency][LOD].Reset();
+			FrameHistograms[Latency][LOD].Reset();
+		}
+	}
+
+	for (int32 LOD = 0; LOD < NumLODs; ++LOD)
+	{
+		NumClimbs[LOD].Reset();
+		NumAbortedGrabs[LOD].Reset();
+	}
+}
+
+void FClimbingLatencyTracker::Start(EClimbingLatency InLatency, float InTime)
+{
+	if (IsStarted(InLatency))
+	{
+		return;
+	}
+
+	StartTimes[(int32)InLatency] = InTime;
+	StartFrames[(int32)InLatency] = GFrameCounter;
+}
+
+void FClimbingLatencyTracker::Stop(EClimbingLatency InLatency, EClimbingLOD InLOD, float InTime)
+{
+	if (!IsStarted(InLatency))
+	{
+		return;
+	}
+
+	if (Stats)
+	{
+		Stats->Record(InLatency, InLOD, InTime - StartTimes[(int32)InLatency], GFrameCounter - StartFrames[(int32)InLatency]);
+	}
+	Cancel(InLatency);
+}
+
+void FClimbingLatencyTracker::Cancel(EClimbingLatency InLatency)
+{
+	StartTimes[(int32)InLatency] = -1.f;
+}
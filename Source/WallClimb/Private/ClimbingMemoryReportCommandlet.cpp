@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingMemoryReportCommandlet.h"
+#include "Engine/World.h"
+
+#include "ClimbingComponent.h"
+#include "ClimbingProfile.h"
+#include "ClimbingCore.h"
+#include "ClimbingBenchmarkWorld.h"
+
+using namespace ClimbingBenchmark;
+
+UClimbingMemoryReportCommandlet::UClimbingMemoryReportCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClimbingMemoryReportCommandlet::Main(const FString& Params)
+{
+	FString ClimbersParam = TEXT("1000");
+	FParse::Value(*Params, TEXT("Climbers="), ClimbersParam, false);
+
+	int32 NumFrames = 600;
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+
+	TArray<FString> ClimberCounts;
+	ClimbersParam.ParseIntoArray(ClimberCounts, TEXT(","));
+
+	for (const FString& Count : ClimberCounts)
+	{
+		const int32 NumClimbers = FCString::Atoi(*Count);
+		if (NumClimbers > 0)
+		{
+			RunMemoryReport(NumClimbers, NumFrames);
+		}
+	}
+
+	return 0;
+}
+
+void UClimbingMemoryReportCommandlet::RunMemoryReport(int32 InNumClimbers, int32 InNumFrames)
+{
+	UWorld* World = CreateWorld();
+
+	TArray<UClimbingComponent*> Climbers;
+	PopulateWorld(World, InNumClimbers, false, 0, 0, Climbers);
+
+	// Through a few climbs first, what the climbers own out of line is allocated as they go
+	TArray<FClimberDriver> Drivers;
+	for (UClimbingComponent* Climber : Climbers)
+	{
+		FClimberDriver Driver;
+		Driver.Climber = Climber;
+		Drivers.Add(Driver);
+	}
+
+	for (int32 Frame = 0; Frame < InNumFrames; ++Frame)
+	{
+		++GFrameCounter;
+		World->Tick(LEVELTICK_All, BenchmarkDeltaTime);
+
+		for (FClimberDriver& Driver : Drivers)
+		{
+			DriveClimber(Driver);
+		}
+	}
+
+	SIZE_T OutOfLineBytes = 0;
+	for (UClimbingComponent* Climber : Climbers)
+	{
+		OutOfLineBytes += Climber->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+	const int32 NumClimbers = FMath::Max(Climbers.Num(), 1);
+	const double BytesPerClimber = sizeof(UClimbingComponent) + (double)OutOfLineBytes / NumClimbers;
+
+	// Not in the figures above: the tuning, shared by the climbers of a profile, and the query scratch, by the climbers of a world.
+	// The predictions are in the out of line bytes, of the climbers that make them
+	const SIZE_T TuningBytes = sizeof(UClimbingProfile) - sizeof(UDataAsset);
+	const SIZE_T ScratchBytes = sizeof(FClimbingComponentScratch);
+	const SIZE_T PredictionBytes = sizeof(UClimbingComponent::FClimbingPredictionState);
+
+	UE_LOG(LogTemp, Display, TEXT("[%s] %d climbers: %.0f bytes per component (%d inline, of which %d of runtime state, %.0f out of line, %d of them the core), %.1f KB in all"),
+		*FString(__FUNCTION__), Climbers.Num(), BytesPerClimber, (int32)sizeof(UClimbingComponent), (int32)sizeof(UClimbingComponent::FClimbingRuntimeState),
+		(double)OutOfLineBytes / NumClimbers, (int32)sizeof(FClimbingCore), BytesPerClimber * Climbers.Num() / 1024.0);
+	UE_LOG(LogTemp, Display, TEXT("[%s] Shared: %d bytes of tuning per profile, %d bytes of query scratch per world, %d bytes of predictions per predicting climber"),
+		*FString(__FUNCTION__), (int32)TuningBytes, (int32)ScratchBytes, (int32)PredictionBytes);
+
+	DestroyWorld(World);
+}
@@ -0,0 +1,332 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingMovementComponent.h"
+#include "GameFramework/Character.h"
+#include "ClimbingComponent.h"
+
+void UClimbingMovementComponent::StartClimbMovement(const FVector& InVelocity)
+{
+	WantedClimbingMode = EClimbingMovementMode::Climb;
+	ClimbVelocity = InVelocity;
+	Velocity = InVelocity;
+
+	if (GetClimbingMovementMode() != EClimbingMovementMode::Climb)
+	{
+		SetMovementMode(MOVE_Custom, (uint8)EClimbingMovementMode::Climb);
+	}
+}
+
+void UClimbingMovementComponent::StartHangMovement()
+{
+	WantedClimbingMode = EClimbingMovementMode::Hang;
+	ClimbVelocity = FVector::ZeroVector;
+	Velocity = FVector::ZeroVector;
+
+	if (GetClimbingMovementMode() != EClimbingMovementMode::Hang)
+	{
+		SetMovementMode(MOVE_Custom, (uint8)EClimbingMovementMode::Hang);
+	}
+}
+
+void UClimbingMovementComponent::StopClimbMovement()
+{
+	WantedClimbingMode = EClimbingMovementMode::None;
+
+	if (IsClimbMovement())
+	{
+		SetMovementMode(MOVE_Walking);
+	}
+}
+
+void UClimbingMovementComponent::AddClimbMove(const FVector& InDelta)
+{
+	if (!IsClimbMovement())
+	{
+		return;
+	}
+
+	// Nothing runs the movement passes of a character without a controller, the move can't wait for one
+	if (CharacterOwner && !CharacterOwner->Controller && !bRunPhysicsWithNoController)
+	{
+		UpdatedComponent->AddWorldOffset(InDelta, false, nullptr, ETeleportType::TeleportPhysics);
+		return;
+	}
+
+	PendingClimbMove += InDelta;
+}
+
+void UClimbingMovementComponent::SetClimbTarget(float InZ)
+{
+	HasClimbTarget = GetClimbingMovementMode() == EClimbingMovementMode::Climb;
+	ClimbTargetZ = InZ;
+}
+
+bool UClimbingMovementComponent::IsClimbMovement() const
+{
+	return GetClimbingMovementMode() != EClimbingMovementMode::None;
+}
+
+EClimbingMovementMode UClimbingMovementComponent::GetClimbingMovementMode() const
+{
+	if (MovementMode != MOVE_Custom)
+	{
+		return EClimbingMovementMode::None;
+	}
+
+	switch ((EClimbingMovementMode)CustomMovementMode)
+	{
+	case EClimbingMovementMode::Climb:
+	case EClimbingMovementMode::Hang:
+		return (EClimbingMovementMode)CustomMovementMode;
+	default:
+		return EClimbingMovementMode::None;
+	}
+}
+
+void UClimbingMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
+{
+	Super::UpdateFromCompressedFlags(Flags);
+
+	EClimbingMovementMode RequestedMode = EClimbingMovementMode::None;
+	if (Flags & FSavedMove_Character::FLAG_Custom_0)
+	{
+		RequestedMode = EClimbingMovementMode::Climb;
+	}
+	else if (Flags & FSavedMove_Character::FLAG_Custom_1)
+	{
+		RequestedMode = EClimbingMovementMode::Hang;
+	}
+
+	// A request the server's climbing rules don't agree with keeps the server's mode, the client gets corrected to it
+	if (IsClimbingModeAllowed(RequestedMode))
+	{
+		WantedClimbingMode = RequestedMode;
+	}
+}
+
+bool UClimbingMovementComponent::IsClimbingModeAllowed(EClimbingMovementMode InMode) const
+{
+	if (!(CharacterOwner && CharacterOwner->GetLocalRole() == ROLE_Authority && !CharacterOwner->IsLocallyControlled()))
+	{
+		return true;
+	}
+
+	const UClimbingComponent* Climbing = CharacterOwner->FindComponentByClass<UClimbingComponent>();
+	if (!(Climbing))
+	{
+		return InMode == EClimbingMovementMode::None;
+	}
+
+	switch (InMode)
+	{
+	case EClimbingMovementMode::Climb:
+		return Climbing->IsClimbingState();
+	case EClimbingMovementMode::Hang:
+		return Climbing->IsHangingState();
+	default:
+		return !Climbing->IsClimbingState() && !Climbing->IsHangingState();
+	}
+}
+
+void UClimbingMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	// Moves received by the server and moves replayed after a correction carry their mode in the flags
+	const EClimbingMovementMode CurrentMode = GetClimbingMovementMode();
+	if (WantedClimbingMode == CurrentMode)
+	{
+		return;
+	}
+
+	if (WantedClimbingMode == EClimbingMovementMode::None)
+	{
+		SetMovementMode(MOVE_Walking);
+	}
+	else
+	{
+		SetMovementMode(MOVE_Custom, (uint8)WantedClimbingMode);
+	}
+}
+
+FNetworkPredictionData_Client* UClimbingMovementComponent::GetPredictionData_Client() const
+{
+	if (!ClientPredictionData)
+	{
+		UClimbingMovementComponent* MutableThis = const_cast<UClimbingMovementComponent*>(this);
+		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_Climbing(*this);
+	}
+
+	return ClientPredictionData;
+}
+
+void UClimbingMovementComponent::PhysCustom(float deltaTime, int32 Iterations)
+{
+	if (IsClimbMovement())
+	{
+		PhysClimbing(deltaTime, Iterations);
+		return;
+	}
+
+	Super::PhysCustom(deltaTime, Iterations);
+}
+
+void UClimbingMovementComponent::OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode)
+{
+	Super::OnMovementModeChanged(PreviousMovementMode, PreviousCustomMode);
+
+	if (GetClimbingMovementMode() != EClimbingMovementMode::Climb)
+	{
+		HasClimbTarget = false;
+	}
+
+	// Left the wall, e.g. launched by the game. What the climbing rules asked for is of no use anymore
+	if (!IsClimbMovement())
+	{
+		WantedClimbingMode = EClimbingMovementMode::None;
+		PendingClimbMove = FVector::ZeroVector;
+		ClimbVelocity = FVector::ZeroVector;
+	}
+}
+
+void UClimbingMovementComponent::PhysClimbing(float deltaTime, int32 Iterations)
+{
+	if (deltaTime < MIN_TICK_TIME || !HasValidData())
+	{
+		return;
+	}
+
+	float RemainingTime = deltaTime;
+	while (RemainingTime >= MIN_TICK_TIME && Iterations < MaxSimulationIterations)
+	{
+		Iterations++;
+		const float TimeTick = GetSimulationTimeStep(RemainingTime, Iterations);
+		RemainingTime -= TimeTick;
+
+		Velocity = GetClimbingMovementMode() == EClimbingMovementMode::Climb ? ClimbVelocity : FVector::ZeroVector;
+
+		// The moves of the climbing rules go with the first step
+		FVector Delta = Velocity * TimeTick + PendingClimbMove;
+		PendingClimbMove = FVector::ZeroVector;
+
+		// Stop right at the target, the climbing rules don't have to catch the body after it passed
+		bool IsTargetReached = false;
+		if (HasClimbTarget && Delta.Z > 0.f)
+		{
+			const float RemainingZ = ClimbTargetZ - UpdatedComponent->GetComponentLocation().Z;
+			if (Delta.Z >= RemainingZ)
+			{
+				Delta.Z = FMath::Max(RemainingZ, 0.f);
+				IsTargetReached = true;
+			}
+		}
+
+		if (!Delta.IsNearlyZero())
+		{
+			MoveAlongWall(Delta, TimeTick);
+		}
+
+		// Once, the climb goes on if the rules don't take it from here
+		if (IsTargetReached)
+		{
+			HasClimbTarget = false;
+
+			if (!CharacterOwner->bClientUpdating)
+			{
+				OnClimbTargetReached.Broadcast();
+			}
+		}
+
+		// A hit changed the mode, the rest of the time goes to the new one
+		if (!IsClimbMovement())
+		{
+			StartNewPhysics(RemainingTime, Iterations);
+			return;
+		}
+	}
+}
+
+void UClimbingMovementComponent::MoveAlongWall(const FVector& InDelta, float InDeltaTime)
+{
+	FHitResult Hit(1.f);
+	SafeMoveUpdatedComponent(InDelta, UpdatedComponent->GetComponentQuat(), true, Hit);
+
+	if (Hit.Time < 1.f)
+	{
+		HandleImpact(Hit, InDeltaTime, InDelta);
+		SlideAlongSurface(InDelta, 1.f - Hit.Time, Hit.Normal, Hit, true);
+	}
+}
+
+void FSavedMove_Climbing::Clear()
+{
+	Super::Clear();
+
+	WantedClimbingMode = EClimbingMovementMode::None;
+	ClimbVelocity = FVector::ZeroVector;
+}
+
+uint8 FSavedMove_Climbing::GetCompressedFlags() const
+{
+	uint8 Result = Super::GetCompressedFlags();
+
+	switch (WantedClimbingMode)
+	{
+	case EClimbingMovementMode::Climb:
+		Result |= FLAG_Custom_0;
+		break;
+	case EClimbingMovementMode::Hang:
+		Result |= FLAG_Custom_1;
+		break;
+	default:
+		break;
+	}
+
+	return Result;
+}
+
+bool FSavedMove_Climbing::CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const
+{
+	const FSavedMove_Climbing* Other = static_cast<const FSavedMove_Climbing*>(NewMove.Get());
+	if (WantedClimbingMode != Other->WantedClimbingMode || ClimbVelocity != Other->ClimbVelocity)
+	{
+		return false;
+	}
+
+	return Super::CanCombineWith(NewMove, InCharacter, MaxDelta);
+}
+
+void FSavedMove_Climbing::SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, FNetworkPredictionData_Client_Character& ClientData)
+{
+	Super::SetMoveFor(C, InDeltaTime, NewAccel, ClientData);
+
+	const UClimbingMovementComponent* Movement = Cast<UClimbingMovementComponent>(C->GetCharacterMovement());
+	if (Movement)
+	{
+		WantedClimbingMode = Movement->WantedClimbingMode;
+		ClimbVelocity = Movement->ClimbVelocity;
+	}
+}
+
+void FSavedMove_Climbing::PrepMoveFor(ACharacter* C)
+{
+	Super::PrepMoveFor(C);
+
+	// The mode comes back with the flags
+	UClimbingMovementComponent* Movement = Cast<UClimbingMovementComponent>(C->GetCharacterMovement());
+	if (Movement)
+	{
+		Movement->ClimbVelocity = ClimbVelocity;
+	}
+}
+
+FNetworkPredictionData_Client_Climbing::FNetworkPredictionData_Client_Climbing(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+{
+}
+
+FSavedMovePtr FNetworkPredictionData_Client_Climbing::AllocateNewMove()
+{
+	return FSavedMovePtr(new FSavedMove_Climbing());
+}
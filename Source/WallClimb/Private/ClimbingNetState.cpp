@@ -0,0 +1,202 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingNetState.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "UObject/CoreNet.h"
+#include "Serialization/BitWriter.h"
+#include "HAL/PlatformTime.h"
+#include "LedgeGeometry.h"
+#include "ClimbingStats.h"
+
+namespace
+{
+	/** How far the top of a ledge may be from the grab height */
+	const float NetLedgeHeightTolerance = 2.f;
+
+	double NetStatsStartTime = FPlatformTime::Seconds();
+
+	void PrintClimbingNetStats()
+	{
+		const double Now = FPlatformTime::Seconds();
+		const double Elapsed = FMath::Max(Now - NetStatsStartTime, 0.001);
+		const int64 Bits = GClimbingNetBitsSent.Set(0);
+		const int32 NumClimbers = FMath::Max(GClimbingNetClimbers.GetValue(), 1);
+
+		UE_LOG(LogTemp, Display, TEXT("Climbing net: %.1f bytes per climber per second (%lld bytes, %d climbers, %.1f s)"),
+			Bits / 8.0 / NumClimbers / Elapsed, Bits / 8, GClimbingNetClimbers.GetValue(), Elapsed);
+
+		NetStatsStartTime = Now;
+	}
+
+	FAutoConsoleCommand ClimbingNetStatsCommand(
+		TEXT("Climbing.NetStats"),
+		TEXT("Prints the climbing state and input payload sent per climber per second, since the previous call. ")
+		TEXT("Run it in a listen server session with clients in the same process, to see both directions."),
+		FConsoleCommandDelegate::CreateStatic(&PrintClimbingNetStats));
+}
+
+void FClimbingNetState::Encode(const FClimbingStateSnapshot& InSnapshot, uint8 InDirection, const UPrimitiveComponent* InLedge)
+{
+	Climbing = InSnapshot.Climbing;
+	Hanging = InSnapshot.Hanging;
+	Direction = InDirection;
+	NormalYaw = FRotator::CompressAxisToByte(InSnapshot.SurfaceNormal.Rotation().Yaw);
+	GrabLocation = InSnapshot.LocationToGrab;
+	IsOnLedge = false;
+	Ledge = nullptr;
+	Segment = 0;
+	Distance = 0;
+	Inset = 0;
+
+	FLedgeShape Shape;
+	if (!(Climbing || Hanging) || InSnapshot.LocationToGrab.IsZero() || !FLedgeShape::FromPrimitive(InLedge, Shape))
+	{
+		return;
+	}
+
+	const int32 NumPoints = Shape.Points.Num();
+	if (NumPoints > MAX_uint8 || FMath::Abs(Shape.TopZ - InSnapshot.LocationToGrab.Z) > NetLedgeHeightTolerance)
+	{
+		return;
+	}
+
+	// Closest rim segment to the grab location
+	const FVector2D Grab(InSnapshot.LocationToGrab.X, InSnapshot.LocationToGrab.Y);
+	float ClosestDistanceSquared = MAX_flt;
+	float ClosestAlong = 0.f;
+	int32 ClosestSegment = INDEX_NONE;
+
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		const FVector2D& A = Shape.Points[i];
+		const FVector2D SegmentVector = Shape.Points[(i + 1) % NumPoints] - A;
+		const float Length = SegmentVector.Size();
+		if (Length < KINDA_SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		const float Along = FMath::Clamp(FVector2D::DotProduct(Grab - A, SegmentVector) / Length, 0.f, Length);
+		const float DistanceSquared = FVector2D::DistSquared(Grab, A + SegmentVector / Length * Along);
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			ClosestAlong = Along;
+			ClosestSegment = i;
+		}
+	}
+
+	const float InsetDistance = FMath::Sqrt(ClosestDistanceSquared);
+	if (ClosestSegment == INDEX_NONE || ClosestAlong > MAX_uint16 || InsetDistance > MAX_uint8 || !Shape.ContainsPoint(Grab))
+	{
+		return;
+	}
+
+	IsOnLedge = true;
+	Ledge = const_cast<UPrimitiveComponent*>(InLedge);
+	Segment = (uint8)ClosestSegment;
+	Distance = (uint16)FMath::RoundToInt(ClosestAlong);
+	Inset = (uint8)FMath::RoundToInt(InsetDistance);
+}
+
+bool FClimbingNetState::Decode(FClimbingStateSnapshot& OutSnapshot) const
+{
+	OutSnapshot.Climbing = Climbing;
+	OutSnapshot.Hanging = Hanging;
+	OutSnapshot.SurfaceNormal = FRotator(0.f, FRotator::DecompressAxisFromByte(NormalYaw), 0.f).Vector();
+	OutSnapshot.LocationToGrab = (Climbing || Hanging) ? FVector(GrabLocation) : FVector::ZeroVector;
+
+	if (!IsOnLedge)
+	{
+		return true;
+	}
+
+	FLedgeShape Shape;
+	if (!FLedgeShape::FromPrimitive(Ledge.Get(), Shape) || Segment >= Shape.Points.Num())
+	{
+		return false;
+	}
+
+	const FVector2D& Start = Shape.Points[Segment];
+	const FVector2D Direction2D = (Shape.Points[(Segment + 1) % Shape.Points.Num()] - Start).GetSafeNormal();
+	const FVector2D Location = Start + Direction2D * Distance - Shape.Normals[Segment] * Inset;
+
+	OutSnapshot.LocationToGrab = FVector(Location.X, Location.Y, Shape.TopZ);
+	return true;
+}
+
+bool FClimbingNetState::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
+{
+	// Net archives are bit writers, their size is what goes on the wire
+	const int64 StartBits = Ar.IsSaving() ? static_cast<FBitWriter&>(Ar).GetNumBits() : 0;
+
+	uint8 Flags = (Climbing ? 1 : 0) | (Hanging ? 2 : 0) | (IsOnLedge ? 4 : 0);
+	Ar.SerializeBits(&Flags, 3);
+	Ar.SerializeBits(&Direction, 3);
+
+	if (Ar.IsLoading())
+	{
+		Climbing = (Flags & 1) != 0;
+		Hanging = (Flags & 2) != 0;
+		IsOnLedge = (Flags & 4) != 0;
+	}
+
+	bOutSuccess = true;
+
+	// Nothing else matters on the ground
+	if (Climbing || Hanging)
+	{
+		Ar << NormalYaw;
+
+		if (IsOnLedge)
+		{
+			UObject* LedgeObject = Ledge.Get();
+			bOutSuccess &= Map->SerializeObject(Ar, UPrimitiveComponent::StaticClass(), LedgeObject);
+			Ar << Segment;
+			Ar << Distance;
+			Ar << Inset;
+
+			if (Ar.IsLoading())
+			{
+				Ledge = Cast<UPrimitiveComponent>(LedgeObject);
+			}
+		}
+		else
+		{
+			bool LocationSuccess = true;
+			GrabLocation.NetSerialize(Ar, Map, LocationSuccess);
+			bOutSuccess &= LocationSuccess;
+		}
+	}
+
+	if (Ar.IsSaving())
+	{
+		CLIMBING_COUNT_NET_BITS(static_cast<FBitWriter&>(Ar).GetNumBits() - StartBits);
+	}
+
+	return true;
+}
+
+bool FClimbingNetState::operator==(const FClimbingNetState& Other) const
+{
+	if (Climbing != Other.Climbing || Hanging != Other.Hanging || Direction != Other.Direction)
+	{
+		return false;
+	}
+
+	if (!(Climbing || Hanging))
+	{
+		return true;
+	}
+
+	if (NormalYaw != Other.NormalYaw || IsOnLedge != Other.IsOnLedge)
+	{
+		return false;
+	}
+
+	return IsOnLedge ?
+		Ledge == Other.Ledge && Segment == Other.Segment && Distance == Other.Distance && Inset == Other.Inset :
+		GrabLocation == Other.GrabLocation;
+}
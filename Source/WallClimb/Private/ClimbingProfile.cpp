@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingProfile.h"
+
+const UClimbingProfile& UClimbingProfile::GetDefaultProfile()
+{
+	return *GetDefault<UClimbingProfile>();
+}
+
+void UClimbingProfile::PostInitProperties()
+{
+	Super::PostInitProperties();
+
+	UpdateSettings();
+}
+
+void UClimbingProfile::PostLoad()
+{
+	Super::PostLoad();
+
+	UpdateSettings();
+}
+
+#if WITH_EDITOR
+void UClimbingProfile::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+
+	UpdateSettings();
+}
+#endif
+
+void UClimbingProfile::UpdateSettings()
+{
+	Settings.MaxClimbingDistance = MaxClimbingDistance;
+	Settings.MaxClimbingSpeed = MaxClimbingSpeed;
+	Settings.MaxClimbingStrafeSpeed = MaxClimbingStrafeSpeed;
+	Settings.MaxSurfaceCaptureAngle = MaxSurfaceCaptureAngle;
+	Settings.FollowLedges = UseLedgeFollowing;
+	Settings.ClimbAroundCorners = ClimbAroundCorners;
+	Settings.GrabProbeColumns = GrabProbeColumns;
+	Settings.GrabProbeRows = GrabProbeRows;
+	Settings.UpdateDerived();
+}
@@ -0,0 +1,57 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingReplayCommandlet.h"
+
+#include "ClimbingCore.h"
+#include "ClimbingCapture.h"
+
+UClimbingReplayCommandlet::UClimbingReplayCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UClimbingReplayCommandlet::Main(const FString& Params)
+{
+	FString ReplayPath;
+	if (!FParse::Value(*Params, TEXT("File="), ReplayPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] No capture, pass -File=<File>."), *FString(__FUNCTION__));
+		return 1;
+	}
+
+	int64 ReplayFrames = -1;
+	FParse::Value(*Params, TEXT("Frames="), ReplayFrames);
+
+	return RunReplay(ReplayPath, ReplayFrames, !FParse::Param(*Params, TEXT("KeepGoing"))) ? 0 : 1;
+}
+
+bool UClimbingReplayCommandlet::RunReplay(const FString& InPath, int64 InMaxFrames, bool InStopOnMismatch) const
+{
+	FClimbingCaptureReplay Replay;
+	if (!Replay.Open(InPath))
+	{
+		return false;
+	}
+
+	const FClimbingCaptureReplayResult Result = Replay.Run(InMaxFrames, InStopOnMismatch);
+	const FClimbingCore& Core = Replay.GetCore();
+
+	UE_LOG(LogTemp, Display, TEXT("[%s] %lld frames, %lld calls in %.3f s (%.0f frames per second)%s"), *FString(__FUNCTION__),
+		Result.NumFrames, Result.NumCalls, Result.Seconds, Result.NumFrames / FMath::Max(Result.Seconds, 0.000001),
+		Result.IsTruncated ? TEXT(", the capture is cut short") : TEXT(""));
+	UE_LOG(LogTemp, Display, TEXT("[%s] Final state: climbing %d, hanging %d, location to grab %s"), *FString(__FUNCTION__),
+		Core.IsClimbing(), Core.IsHanging(), *Core.GetLocationToGrab().ToString());
+
+	if (Result.FirstMismatchCall != INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] The replay went off the capture at call %lld, in frame %lld."), *FString(__FUNCTION__),
+			Result.FirstMismatchCall, Result.FirstMismatchFrame);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,283 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingRouteComponent.h"
+#include "Engine/World.h"
+
+#include "GameFramework/Pawn.h"
+#include "ClimbingComponent.h"
+#include "LedgeGraphSubsystem.h"
+
+UClimbingRouteComponent::UClimbingRouteComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+}
+
+void UClimbingRouteComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	Climber = GetOwner()->FindComponentByClass<UClimbingComponent>();
+	if (!Climber)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] %s has no climbing component to drive."), *FString(__FUNCTION__), *GetOwner()->GetName());
+	}
+}
+
+void UClimbingRouteComponent::ClimbTo(const FVector& InGoal)
+{
+	if (!(Climber && Climber->HasValidSetup()))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Use of unintialized pointers."), *FString(__FUNCTION__));
+		return;
+	}
+
+	if (!IsFollowing)
+	{
+		WasClimbOnHitAllowed = Climber->IsClimbOnHitAllowed;
+	}
+
+	Goal = InGoal;
+	IsFollowing = true;
+	Route.Reset();
+	RequestRoute();
+}
+
+void UClimbingRouteComponent::StopRoute()
+{
+	if (IsFollowing)
+	{
+		FinishRoute();
+	}
+}
+
+void UClimbingRouteComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	if (!IsFollowing || PendingRequest != INDEX_NONE)
+	{
+		return;
+	}
+
+	const ULedgeGraphSubsystem* Planner = GetWorld()->GetSubsystem<ULedgeGraphSubsystem>();
+	const TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe> Graph = Planner ? Planner->GetGraph() : nullptr;
+	if (!Graph)
+	{
+		return;
+	}
+
+	// Rebuilt since, the route's nodes are gone
+	if (Graph != RouteGraph)
+	{
+		RequestRoute();
+		return;
+	}
+
+	StepTime += DeltaTime;
+	if (StepTime > ReplanDelay)
+	{
+		RequestRoute();
+		return;
+	}
+
+	FollowRoute(*Graph);
+}
+
+void UClimbingRouteComponent::RequestRoute()
+{
+	ULedgeGraphSubsystem* Planner = GetWorld()->GetSubsystem<ULedgeGraphSubsystem>();
+	if (!Planner)
+	{
+		FinishRoute();
+		return;
+	}
+
+	const FClimbingCore& Core = *Climber->Core;
+
+	// Mid climb the character is neither on a ledge nor on the ground, wait for it to be somewhere
+	if (Core.IsClimbing())
+	{
+		StepTime = 0.f;
+		return;
+	}
+
+	FLedgePathQuery Query;
+	Query.StartsHanging = Core.IsHanging();
+	Query.Start = Query.StartsHanging ? Core.GetLocationToGrab() : GetOwner()->GetActorLocation();
+	Query.Goal = Goal;
+
+	PendingRequest = Planner->RequestPath(Query, FOnLedgePathFound::CreateUObject(this, &UClimbingRouteComponent::OnRouteFound));
+}
+
+void UClimbingRouteComponent::OnRouteFound(int32 InRequestId, bool InFound, const TArray<FLedgePathStep>& InRoute)
+{
+	if (InRequestId != PendingRequest)
+	{
+		return;
+	}
+
+	PendingRequest = INDEX_NONE;
+
+	if (!InFound)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[%s] %s can't climb to %s."), *FString(__FUNCTION__), *GetOwner()->GetName(), *Goal.ToString());
+		FinishRoute();
+		return;
+	}
+
+	Route = InRoute;
+	Step = 0;
+	StepTime = 0.f;
+
+	// Results are delivered before a newer graph is swapped in
+	const ULedgeGraphSubsystem* Planner = GetWorld()->GetSubsystem<ULedgeGraphSubsystem>();
+	RouteGraph = Planner ? Planner->GetGraph() : nullptr;
+	StartNode = RouteGraph && Climber->Core->IsHanging() ? RouteGraph->FindClosestNode(Climber->Core->GetLocationToGrab(), HangTolerance) : INDEX_NONE;
+
+	// The first wall is grabbed by walking into it
+	Climber->SetClimbOnHitAllowed(true);
+}
+
+void UClimbingRouteComponent::FollowRoute(const FLedgeGraph& InGraph)
+{
+	const FClimbingCore& Core = *Climber->Core;
+
+	if (Step >= Route.Num())
+	{
+		if (!Core.IsClimbing())
+		{
+			FinishRoute();
+		}
+		return;
+	}
+
+	const FLedgePathStep& Next = Route[Step];
+
+	if (Core.IsHanging())
+	{
+		const FVector Hands = Core.GetLocationToGrab();
+		const int32 PreviousNode = Step > 0 ? Route[Step - 1].Node : StartNode;
+		const float PreviousDistance = PreviousNode != INDEX_NONE ? InGraph.GetNodeDistance(PreviousNode, Hands) : HangTolerance;
+
+		// Where two segments meet, the hands are on both
+		if (Next.Node != INDEX_NONE && InGraph.GetNodeDistance(Next.Node, Hands) <= FMath::Min(PreviousDistance, HangTolerance))
+		{
+			AdvanceStep();
+			return;
+		}
+
+		// Grabbed a ledge the route doesn't go through
+		if (PreviousNode == INDEX_NONE || PreviousDistance > HangTolerance)
+		{
+			RequestRoute();
+			return;
+		}
+
+		MakeHangingStep(InGraph, PreviousNode, Next);
+	}
+	else if (!Core.IsClimbing())
+	{
+		if (Step == 0 && Next.Type == ELedgeEdgeType::ClimbUp)
+		{
+			ApproachWall(InGraph, Next);
+		}
+		else
+		{
+			// Fell off the route
+			RequestRoute();
+		}
+	}
+}
+
+void UClimbingRouteComponent::MakeHangingStep(const FLedgeGraph& InGraph, int32 InNode, const FLedgePathStep& InStep)
+{
+	switch (InStep.Type)
+	{
+	case ELedgeEdgeType::StrafeLeft:
+		Climber->ClimbingDirection = EClimbDirection::LEFT;
+		Climber->OnMoveRight(-1.f);
+		break;
+	case ELedgeEdgeType::StrafeRight:
+		Climber->ClimbingDirection = EClimbDirection::RIGHT;
+		Climber->OnMoveRight(1.f);
+		break;
+	case ELedgeEdgeType::AroundCornerLeft:
+		Climber->ClimbingDirection = EClimbDirection::LEFT_ARROUND_CORNER;
+		Climber->OnMoveRight(-1.f);
+		break;
+	case ELedgeEdgeType::AroundCornerRight:
+		Climber->ClimbingDirection = EClimbDirection::RIGHT_AROUND_CORNER;
+		Climber->OnMoveRight(1.f);
+		break;
+	case ELedgeEdgeType::ClimbUp:
+	{
+		// Strafe under the ledge above first, the climb goes straight up
+		const FLedgeGraphNode& Current = InGraph.GetNode(InNode);
+		const FLedgeGraphNode& Target = InGraph.GetNode(InStep.Node);
+		const FVector Hands = Climber->Core->GetLocationToGrab();
+		const FVector Tangent = (Current.End - Current.Start).GetSafeNormal2D();
+		const float Offset = (FMath::ClosestPointOnSegment(Hands, Target.Start, Target.End) - Hands) | Tangent;
+
+		float Radius, HalfHeight;
+		Climber->GetBodyCapsuleSize(Radius, HalfHeight);
+
+		if (FMath::Abs(Offset) > Radius)
+		{
+			Climber->ClimbingDirection = Offset > 0.f ? EClimbDirection::LEFT : EClimbDirection::RIGHT;
+			Climber->OnMoveRight(Offset > 0.f ? -1.f : 1.f);
+		}
+		else
+		{
+			Climber->ClimbingDirection = EClimbDirection::UPWARDS;
+			Climber->OnJumpPressed();
+		}
+		break;
+	}
+	case ELedgeEdgeType::Drop:
+		// Not to grab the wall again on the way down
+		Climber->ClimbingDirection = EClimbDirection::NONE;
+		Climber->SetClimbOnHitAllowed(false);
+		Climber->OnHangRelease();
+		AdvanceStep();
+		break;
+	}
+}
+
+void UClimbingRouteComponent::ApproachWall(const FLedgeGraph& InGraph, const FLedgePathStep& InStep)
+{
+	APawn* Pawn = Cast<APawn>(GetOwner());
+	if (!Pawn)
+	{
+		return;
+	}
+
+	const FLedgeGraphNode& Target = InGraph.GetNode(InStep.Node);
+	const FVector Location = Pawn->GetActorLocation();
+	const FVector ToWall = FMath::ClosestPointOnSegment(Location, Target.Start, Target.End) - Location;
+
+	Climber->ClimbingDirection = EClimbDirection::UPWARDS;
+	Pawn->AddMovementInput(FVector(ToWall.X, ToWall.Y, 0.f).GetSafeNormal());
+}
+
+void UClimbingRouteComponent::AdvanceStep()
+{
+	++Step;
+	StepTime = 0.f;
+}
+
+void UClimbingRouteComponent::FinishRoute()
+{
+	IsFollowing = false;
+	PendingRequest = INDEX_NONE;
+	Route.Reset();
+	RouteGraph.Reset();
+	Step = 0;
+	StartNode = INDEX_NONE;
+
+	if (Climber)
+	{
+		Climber->SetClimbOnHitAllowed(WasClimbOnHitAllowed);
+		Climber->ClimbingDirection = Climber->IsHanging ? EClimbDirection::IDLE : EClimbDirection::NONE;
+	}
+}
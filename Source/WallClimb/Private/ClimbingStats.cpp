@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingStats.h"
+
+DEFINE_STAT(STAT_Climbing_TickComponent);
+DEFINE_STAT(STAT_Climbing_TickTrace);
+DEFINE_STAT(STAT_Climbing_UpwardTrace);
+DEFINE_STAT(STAT_Climbing_LimbTargets);
+DEFINE_STAT(STAT_Climbing_BuildLedgeGraph);
+DEFINE_STAT(STAT_Climbing_FindPaths);
+DEFINE_STAT(STAT_Climbing_Crowd);
+
+DEFINE_STAT(STAT_Climbing_SceneQueries);
+DEFINE_STAT(STAT_Climbing_NetBits);
+DEFINE_STAT(STAT_Climbing_NetCorrections);
+DEFINE_STAT(STAT_Climbing_SleepingClimbers);
+
+FThreadSafeCounter GClimbingSceneQueryCounter;
+
+FThreadSafeCounter64 GClimbingTickCycles;
+
+FThreadSafeCounter64 GClimbingNetBitsSent;
+
+FThreadSafeCounter GClimbingNetClimbers;
+
+#if CLIMBING_DEBUG_DRAW
+TAutoConsoleVariable<int32> CVarClimbingDebugDraw(
+	TEXT("Climbing.DebugDraw"),
+	0,
+	TEXT("Draws the climbing traces. 0: off, 1: on."));
+#endif
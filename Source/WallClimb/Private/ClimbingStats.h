@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/ThreadSafeCounter.h"
+#include "HAL/ThreadSafeCounter64.h"
+#include "ClimbingCoreStats.h"
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TickComponent"), STAT_Climbing_TickComponent, STATGROUP_Climbing, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("TickTrace"), STAT_Climbing_TickTrace, STATGROUP_Climbing, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("UpwardTrace"), STAT_Climbing_UpwardTrace, STATGROUP_Climbing, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("LimbTargets"), STAT_Climbing_LimbTargets, STATGROUP_Climbing, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("BuildLedgeGraph"), STAT_Climbing_BuildLedgeGraph, STATGROUP_Climbing, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("FindPaths"), STAT_Climbing_FindPaths, STATGROUP_Climbing, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Crowd"), STAT_Climbing_Crowd, STATGROUP_Climbing, );
+
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Scene queries"), STAT_Climbing_SceneQueries, STATGROUP_Climbing, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net bits sent"), STAT_Climbing_NetBits, STATGROUP_Climbing, );
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Net corrections"), STAT_Climbing_NetCorrections, STATGROUP_Climbing, );
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Sleeping climbers"), STAT_Climbing_SleepingClimbers, STATGROUP_Climbing, );
+
+/** Scene queries issued since the last reset, for tools that can't read stats (e.g. the benchmark commandlet) */
+extern FThreadSafeCounter GClimbingSceneQueryCounter;
+
+/** Cycles spent in UClimbingComponent::TickComponent since the last reset, for tools that let the engine schedule the ticks
+	and can't read stats (e.g. the benchmark commandlet) */
+extern FThreadSafeCounter64 GClimbingTickCycles;
+
+/** Bits written for the replicated climbing state and the climbing RPCs' parameters, for the Climbing.NetStats command */
+extern FThreadSafeCounter64 GClimbingNetBitsSent;
+
+/** Climbers simulated by a server, the bits sent are shared among them */
+extern FThreadSafeCounter GClimbingNetClimbers;
+
+/** To be placed next to every scene query issued for climbing, safe on any thread */
+#define CLIMBING_COUNT_SCENE_QUERY() \
+	do \
+	{ \
+		INC_DWORD_STAT(STAT_Climbing_SceneQueries); \
+		GClimbingSceneQueryCounter.Increment(); \
+		CSV_CUSTOM_STAT(Climbing, SceneQueries, 1, ECsvCustomStatOp::Accumulate); \
+	} while (0)
+
+/** To be placed next to every climbing payload written for the network */
+#define CLIMBING_COUNT_NET_BITS(Bits) \
+	do \
+	{ \
+		INC_DWORD_STAT_BY(STAT_Climbing_NetBits, Bits); \
+		GClimbingNetBitsSent.Add(Bits); \
+		CSV_CUSTOM_STAT(Climbing, NetBits, (int32)(Bits), ECsvCustomStatOp::Accumulate); \
+	} while (0)
+
+/** Debug drawing is compiled out of Shipping and Test, and off by default elsewhere */
+#define CLIMBING_DEBUG_DRAW !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+
+/** The macros below are single statements, safe in an unbraced if/else */
+#if CLIMBING_DEBUG_DRAW
+extern TAutoConsoleVariable<int32> CVarClimbingDebugDraw;
+
+#define CLIMBING_DRAW_DEBUG_LINE(World, Start, End, Color, LifeTime) \
+	do \
+	{ \
+		if (CVarClimbingDebugDraw.GetValueOnGameThread() > 0) \
+		{ \
+			DrawDebugLine(World, Start, End, Color, false, LifeTime, 0, 2.f); \
+		} \
+	} while (0)
+
+#define CLIMBING_DRAW_DEBUG_BOX(World, Center, Extent, Color, LifeTime) \
+	do \
+	{ \
+		if (CVarClimbingDebugDraw.GetValueOnGameThread() > 0) \
+		{ \
+			DrawDebugBox(World, Center, Extent, Color, false, LifeTime, 0, 2.f); \
+		} \
+	} while (0)
+#else
+#define CLIMBING_DRAW_DEBUG_LINE(World, Start, End, Color, LifeTime) do {} while (0)
+#define CLIMBING_DRAW_DEBUG_BOX(World, Center, Extent, Color, LifeTime) do {} while (0)
+#endif
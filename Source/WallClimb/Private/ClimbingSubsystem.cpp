@@ -0,0 +1,184 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ClimbingSubsystem.h"
+#include "Engine/World.h"
+
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/CapsuleComponent.h"
+#include "Async/ParallelFor.h"
+#include "ClimbingComponent.h"
+#include "ClimbabilitySubsystem.h"
+#include "ClimbingStats.h"
+
+void UClimbingSubsystem::Deinitialize()
+{
+	Climbers.Empty();
+
+	Super::Deinitialize();
+}
+
+void UClimbingSubsystem::RegisterClimber(UClimbingComponent* InClimber)
+{
+	if (InClimber)
+	{
+		Climbers.AddUnique(InClimber);
+		UnregisteredWhileTicking.RemoveSwap(InClimber);
+	}
+}
+
+void UClimbingSubsystem::UnregisterClimber(UClimbingComponent* InClimber)
+{
+	// An update may end another climber's play, the list is only changed once they are all done
+	if (IsTicking)
+	{
+		UnregisteredWhileTicking.AddUnique(InClimber);
+		return;
+	}
+
+	Climbers.Remove(InClimber);
+}
+
+void UClimbingSubsystem::Tick(float DeltaTime)
+{
+	TGuardValue<bool> TickingGuard(IsTicking, true);
+
+	// Gather
+	Queries.Reset();
+	DueClimbers.Reset();
+	DueQueries.Reset();
+
+	for (int32 i = 0; i < Climbers.Num(); ++i)
+	{
+		UClimbingComponent* Climber = Climbers[i];
+		if (!(Climber && Climber->ConsumeUpdateTime(DeltaTime)))
+		{
+			continue;
+		}
+
+		DueClimbers.Add(Climber);
+
+		FClimbingScanQuery Query;
+		DueQueries.Add(GatherQuery(Climber, Query) ? Queries.Add(Query) : INDEX_NONE);
+	}
+
+	// Scene queries and classification, off the game thread
+	Results.SetNum(Queries.Num(), false);
+	ParallelFor(Queries.Num(), [this](int32 Index)
+	{
+		RunQuery(Queries[Index], Results[Index]);
+	});
+
+	// Classification of all the hits, vectorized
+	Surfaces.Reset();
+	HitResults.Reset();
+	for (int32 i = 0; i < Results.Num(); ++i)
+	{
+		if (Results[i].HasHit)
+		{
+			const FClimbingScanQuery& Query = Queries[i];
+			Surfaces.Add(UClimbingComponent::MakeClimbingHit(Results[i].HitResult, Query.WalkableFloorZ), Query.ActorForwardVector,
+				Query.WalkableFloorZ, Query.CaptureAngleCos);
+			HitResults.Add(i);
+		}
+	}
+
+	FClimbingCore::ClassifySurfaces(Surfaces, Climbable);
+	for (int32 i = 0; i < HitResults.Num(); ++i)
+	{
+		Results[HitResults[i]].IsClimbable = Climbable[i];
+	}
+
+	// Apply, in registration order. The updates may destroy or unregister climbers, even the ones not applied yet
+	for (int32 i = 0; i < DueClimbers.Num(); ++i)
+	{
+		UClimbingComponent* Climber = DueClimbers[i].Get();
+		if (!(Climber) || UnregisteredWhileTicking.Contains(Climber))
+		{
+			continue;
+		}
+
+		if (DueQueries[i] != INDEX_NONE)
+		{
+			FClimbingScanResult& Result = Results[DueQueries[i]];
+			Climber->ApplyClimbingScan(Result.HasHit, Result.HitResult, Result.IsClimbable);
+		}
+		else if (Climber->CanScanWithoutQueries())
+		{
+			// Minimal LOD, the ray is resolved on the walls in reach, nothing to batch
+			Climber->ScanForClimbingData();
+		}
+
+		Climber->UpdateClimbingState();
+		Climber->UpdateLimbTargets();
+	}
+
+	for (UClimbingComponent* Climber : UnregisteredWhileTicking)
+	{
+		Climbers.Remove(Climber);
+	}
+	UnregisteredWhileTicking.Reset();
+}
+
+bool UClimbingSubsystem::IsTickable() const
+{
+	return !IsTemplate() && !IsTickedManually && Climbers.Num() > 0;
+}
+
+UWorld* UClimbingSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UClimbingSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UClimbingSubsystem, STATGROUP_Tickables);
+}
+
+bool UClimbingSubsystem::GatherQuery(UClimbingComponent* InClimber, FClimbingScanQuery& OutQuery) const
+{
+	if (!(InClimber && InClimber->HasValidSetup()) || !InClimber->ShouldScanForClimbingData() || InClimber->CanScanWithoutQueries())
+	{
+		return false;
+	}
+
+	const FClimbingCore& Core = *InClimber->Core;
+
+	OutQuery.IsRay = Core.Settings.ScanWithRay;
+	if (OutQuery.IsRay)
+	{
+		Core.GetScanRay(OutQuery.Location, OutQuery.RayEnd);
+		OutQuery.Rotation = FQuat::Identity;
+	}
+	else
+	{
+		float CapsuleRadius, CapsuleHalfHeight;
+		Core.GetScanCapsule(OutQuery.Location, OutQuery.Rotation, CapsuleRadius, CapsuleHalfHeight);
+		OutQuery.Shape = FCollisionShape::MakeCapsule(CapsuleRadius, CapsuleHalfHeight);
+	}
+
+	const AActor* Owner = InClimber->GetOwner();
+	OutQuery.ActorForwardVector = Owner->GetActorForwardVector();
+	OutQuery.WalkableFloorZ = InClimber->GetBodyWalkableFloorZ();
+	OutQuery.CaptureAngleCos = Core.Settings.GetCaptureAngleCos();
+	OutQuery.IgnoredActor = Owner;
+
+	return true;
+}
+
+void UClimbingSubsystem::RunQuery(const FClimbingScanQuery& InQuery, FClimbingScanResult& OutResult) const
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(TickTrace);
+
+	FCollisionQueryParams Params(FName("TickTrace"), false, InQuery.IgnoredActor);
+	CLIMBING_COUNT_SCENE_QUERY();
+
+	OutResult.HitResult = FHitResult();
+	OutResult.HasHit = InQuery.IsRay ?
+		GetWorld()->LineTraceSingleByChannel(OutResult.HitResult, InQuery.Location, InQuery.RayEnd, UClimbabilitySubsystem::GetTraceChannel(), Params) :
+		GetWorld()->SweepSingleByChannel(OutResult.HitResult, InQuery.Location, InQuery.Location, 
+			InQuery.Rotation, UClimbabilitySubsystem::GetTraceChannel(), InQuery.Shape, Params);
+
+	// Classified with the other climbers' hits, after the queries
+	OutResult.IsClimbable = false;
+}
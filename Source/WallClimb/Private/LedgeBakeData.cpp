@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeBakeData.h"
+#include "Algo/BinarySearch.h"
+
+namespace
+{
+	/** Bump on any change of the serialized layout */
+	const int32 LedgeBakeDataVersion = 2;
+}
+
+void ULedgeBakeData::Serialize(FArchive& Ar)
+{
+	Super::Serialize(Ar);
+
+	int32 Version = LedgeBakeDataVersion;
+	Ar << Version;
+
+	if (Ar.IsLoading() && Version != LedgeBakeDataVersion)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("[%s] %s is outdated, the level needs to be rebaked."), *FString(__FUNCTION__), *GetPathName());
+		Records.Empty();
+		QuantizedLedges.Empty();
+		return;
+	}
+
+	Ar << Records;
+	Ar << QuantizedLedges;
+}
+
+void ULedgeBakeData::PostLoad()
+{
+	Super::PostLoad();
+
+	RebuildLedges();
+}
+
+void ULedgeBakeData::SetBakedData(TArray<FLedgeBakeActorRecord>&& InRecords, TArray<FQuantizedLedge>&& InLedges)
+{
+	Records = MoveTemp(InRecords);
+	QuantizedLedges = MoveTemp(InLedges);
+
+	RebuildLedges();
+}
+
+const FLedgeBakeActorRecord* ULedgeBakeData::FindRecord(FName InActorName) const
+{
+	const int32 Index = Algo::LowerBoundBy(Records, InActorName, &FLedgeBakeActorRecord::ActorName,
+		[](FName A, FName B) { return A.LexicalLess(B); });
+
+	return Records.IsValidIndex(Index) && Records[Index].ActorName == InActorName ? &Records[Index] : nullptr;
+}
+
+bool ULedgeBakeData::Quantize(const FLedgeShape& InShape, FQuantizedLedge& OutLedge)
+{
+	const int32 NumPoints = InShape.Points.Num();
+	if (NumPoints < 2 || InShape.Normals.Num() != NumPoints)
+	{
+		return false;
+	}
+
+	OutLedge.Anchor = FIntVector(
+		FMath::RoundToInt(InShape.Points[0].X / LedgeQuantizationStep),
+		FMath::RoundToInt(InShape.Points[0].Y / LedgeQuantizationStep),
+		FMath::RoundToInt(InShape.TopZ / LedgeQuantizationStep));
+
+	OutLedge.Deltas.Reset(2 * (NumPoints - 1));
+	for (int32 i = 1; i < NumPoints; ++i)
+	{
+		const int32 DeltaX = FMath::RoundToInt(InShape.Points[i].X / LedgeQuantizationStep) - OutLedge.Anchor.X;
+		const int32 DeltaY = FMath::RoundToInt(InShape.Points[i].Y / LedgeQuantizationStep) - OutLedge.Anchor.Y;
+
+		if (DeltaX < MIN_int16 || DeltaX > MAX_int16 || DeltaY < MIN_int16 || DeltaY > MAX_int16)
+		{
+			return false;
+		}
+
+		OutLedge.Deltas.Add((int16)DeltaX);
+		OutLedge.Deltas.Add((int16)DeltaY);
+	}
+
+	OutLedge.NormalYaws.Reset(NumPoints);
+	for (const FVector2D& Normal : InShape.Normals)
+	{
+		const float Turns = FMath::Atan2(Normal.Y, Normal.X) / (2.f * PI);
+		OutLedge.NormalYaws.Add((uint8)(FMath::RoundToInt(Turns * 256.f) & 0xFF));
+	}
+
+	return true;
+}
+
+void ULedgeBakeData::Dequantize(const FQuantizedLedge& InLedge, FLedgeShape& OutShape)
+{
+	const FVector2D Anchor(InLedge.Anchor.X, InLedge.Anchor.Y);
+
+	OutShape.Points.Reset();
+	OutShape.Points.Add(Anchor * LedgeQuantizationStep);
+	for (int32 i = 0; i + 1 < InLedge.Deltas.Num(); i += 2)
+	{
+		OutShape.Points.Add((Anchor + FVector2D(InLedge.Deltas[i], InLedge.Deltas[i + 1])) * LedgeQuantizationStep);
+	}
+
+	OutShape.Normals.Reset();
+	for (uint8 Yaw : InLedge.NormalYaws)
+	{
+		const float Angle = Yaw * (2.f * PI / 256.f);
+		OutShape.Normals.Add(FVector2D(FMath::Cos(Angle), FMath::Sin(Angle)));
+	}
+
+	OutShape.TopZ = InLedge.Anchor.Z * LedgeQuantizationStep;
+}
+
+void ULedgeBakeData::RebuildLedges()
+{
+	Ledges.SetNum(QuantizedLedges.Num());
+	for (int32 i = 0; i < QuantizedLedges.Num(); ++i)
+	{
+		Dequantize(QuantizedLedges[i], Ledges[i]);
+	}
+}
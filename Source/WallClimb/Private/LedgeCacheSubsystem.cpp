@@ -0,0 +1,270 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeCacheSubsystem.h"
+
+#include "GameFramework/Actor.h"
+#include "Components/PrimitiveComponent.h"
+#include "ClimbabilitySubsystem.h"
+#include "HAL/IConsoleManager.h"
+
+namespace
+{
+	/** How far the top of a rim may be from the height asked for */
+	const float LedgeHeightTolerance = 2.f;
+
+	/** How far from its rim a ledge is still found */
+	const float LedgeMaxRimDistance = 100.f;
+}
+
+static TAutoConsoleVariable<int32> CVarLedgeCacheMaxEntries(
+	TEXT("Climbing.LedgeCache.MaxEntries"),
+	256,
+	TEXT("Max amount of climbable actors kept in the ledge cache, least recently used ones are evicted first."));
+
+void ULedgeCacheSubsystem::Deinitialize()
+{
+	for (auto& Pair : Entries)
+	{
+		Unbind(Pair.Value);
+	}
+	Entries.Empty();
+
+	Super::Deinitialize();
+}
+
+bool ULedgeCacheSubsystem::FindGrabLocation(const AActor* InActor, const FVector& InProbe, float InMinZ, float InMaxZ, FVector& OutLocation)
+{
+	const FLedgeCacheEntry* Entry = FindOrExtract(InActor);
+	if (!(Entry && Entry->Shapes.Num() > 0))
+	{
+		return false;
+	}
+
+	// The rim of a shape could be under geometry we know nothing about
+	for (const FBox& Bounds : Entry->UnresolvedBounds)
+	{
+		if (Bounds.Max.Z >= InMinZ && Bounds.Min.Z < InMaxZ &&
+			InProbe.X >= Bounds.Min.X && InProbe.X <= Bounds.Max.X && InProbe.Y >= Bounds.Min.Y && InProbe.Y <= Bounds.Max.Y)
+		{
+			return false;
+		}
+	}
+
+	const FVector2D ProbeXY(InProbe.X, InProbe.Y);
+	const FLedgeShape* Closest = nullptr;
+
+	// Every rim is the top of its own primitive, only the reach is left to check
+	for (const FLedgeShape& Shape : Entry->Shapes)
+	{
+		if (Shape.TopZ < InMinZ || Shape.TopZ >= InMaxZ)
+		{
+			continue;
+		}
+
+		if ((!Closest || Shape.TopZ < Closest->TopZ) && Shape.ContainsPoint(ProbeXY))
+		{
+			Closest = &Shape;
+		}
+	}
+
+	if (!Closest)
+	{
+		return false;
+	}
+
+	OutLocation = FVector(InProbe.X, InProbe.Y, Closest->TopZ);
+	return true;
+}
+
+const FLedgeShape* ULedgeCacheSubsystem::FindLedge(const AActor* InActor, const FVector& InLocation, uint32& OutRevision)
+{
+	const FLedgeCacheEntry* Entry = FindOrExtract(InActor);
+	if (!(Entry))
+	{
+		return nullptr;
+	}
+
+	const FVector2D LocationXY(InLocation.X, InLocation.Y);
+	const FLedgeShape* Closest = nullptr;
+	float ClosestDistance = LedgeMaxRimDistance;
+
+	for (const FLedgeShape& Shape : Entry->Shapes)
+	{
+		if (FMath::Abs(Shape.TopZ - InLocation.Z) > LedgeHeightTolerance)
+		{
+			continue;
+		}
+
+		const float Distance = Shape.GetRimDistance(LocationXY);
+		if (Distance <= ClosestDistance)
+		{
+			ClosestDistance = Distance;
+			Closest = &Shape;
+		}
+	}
+
+	OutRevision = Entry->Revision;
+	return Closest;
+}
+
+bool ULedgeCacheSubsystem::IsCurrent(const AActor* InActor, uint32 InRevision) const
+{
+	const FLedgeCacheEntry* Entry = Entries.Find(InActor);
+	return Entry && !Entry->IsStale && Entry->Revision == InRevision;
+}
+
+bool ULedgeCacheSubsystem::GetActorBounds(const AActor* InActor, FVector& OutOrigin, FVector& OutExtent)
+{
+	const FLedgeCacheEntry* Entry = FindOrExtract(InActor);
+	if (!(Entry && Entry->ActorBounds.IsValid))
+	{
+		return false;
+	}
+
+	Entry->ActorBounds.GetCenterAndExtents(OutOrigin, OutExtent);
+	return true;
+}
+
+void ULedgeCacheSubsystem::Invalidate(const AActor* InActor)
+{
+	FLedgeCacheEntry* Entry = Entries.Find(InActor);
+	if (Entry)
+	{
+		Unbind(*Entry);
+		Entries.Remove(InActor);
+	}
+}
+
+const FLedgeCacheEntry* ULedgeCacheSubsystem::FindOrExtract(const AActor* InActor)
+{
+	if (!(InActor))
+	{
+		return nullptr;
+	}
+
+	FLedgeCacheEntry* Entry = Entries.Find(InActor);
+	if (!Entry)
+	{
+		if (Entries.Num() >= FMath::Max(1, CVarLedgeCacheMaxEntries.GetValueOnGameThread()))
+		{
+			EvictLeastRecentlyUsed();
+		}
+
+		Entry = &Entries.Add(InActor);
+		Extract(InActor, *Entry);
+	}
+	else if (Entry->IsStale)
+	{
+		Extract(InActor, *Entry);
+	}
+
+	Entry->LastUsed = ++AccessCounter;
+
+	return Entry;
+}
+
+void ULedgeCacheSubsystem::Extract(const AActor* InActor, FLedgeCacheEntry& OutEntry)
+{
+	OutEntry.Shapes.Reset();
+	OutEntry.UnresolvedBounds.Reset();
+	OutEntry.ActorBounds = FBox(ForceInit);
+	OutEntry.IsStale = false;
+	OutEntry.Revision = ++RevisionCounter;
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(InActor);
+	for (const UPrimitiveComponent* Primitive : Primitives)
+	{
+		if (!Primitive->IsRegistered())
+		{
+			continue;
+		}
+
+		OutEntry.ActorBounds += Primitive->Bounds.GetBox();
+
+		FLedgeShape Shape;
+		if (FLedgeShape::FromPrimitive(Primitive, Shape))
+		{
+			OutEntry.Shapes.Add(MoveTemp(Shape));
+		}
+		else if (Primitive->IsCollisionEnabled() &&
+			Primitive->GetCollisionResponseToChannel(UClimbabilitySubsystem::GetTraceChannel()) == ECR_Block)
+		{
+			OutEntry.UnresolvedBounds.Add(Primitive->Bounds.GetBox());
+		}
+	}
+
+	// The primitives may have changed since the last extraction
+	Bind(InActor, OutEntry);
+}
+
+void ULedgeCacheSubsystem::EvictLeastRecentlyUsed()
+{
+	TWeakObjectPtr<const AActor> Oldest;
+	uint64 OldestStamp = MAX_uint64;
+
+	for (auto& Pair : Entries)
+	{
+		// Destroyed actors go first
+		if (!Pair.Key.IsValid())
+		{
+			Oldest = Pair.Key;
+			break;
+		}
+
+		if (Pair.Value.LastUsed < OldestStamp)
+		{
+			OldestStamp = Pair.Value.LastUsed;
+			Oldest = Pair.Key;
+		}
+	}
+
+	FLedgeCacheEntry* Entry = Entries.Find(Oldest);
+	if (Entry)
+	{
+		Unbind(*Entry);
+		Entries.Remove(Oldest);
+	}
+}
+
+void ULedgeCacheSubsystem::Bind(const AActor* InActor, FLedgeCacheEntry& InEntry)
+{
+	Unbind(InEntry);
+
+	// Every primitive, not only the root: a child may be moved on its own, and a moved root updates its children too
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(InActor);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		if (Primitive->IsRegistered())
+		{
+			InEntry.TransformBindings.Emplace(Primitive, Primitive->TransformUpdated.AddUObject(this, &ULedgeCacheSubsystem::OnTransformUpdated));
+		}
+	}
+}
+
+void ULedgeCacheSubsystem::Unbind(FLedgeCacheEntry& InEntry)
+{
+	for (const auto& Binding : InEntry.TransformBindings)
+	{
+		if (USceneComponent* Component = Binding.Key.Get())
+		{
+			Component->TransformUpdated.Remove(Binding.Value);
+		}
+	}
+	InEntry.TransformBindings.Reset();
+}
+
+void ULedgeCacheSubsystem::OnTransformUpdated(USceneComponent* InComponent, EUpdateTransformFlags InFlags, ETeleportType InTeleport)
+{
+	if (!(InComponent))
+	{
+		return;
+	}
+
+	// Re-extracted lazily, on the next climb of that actor
+	FLedgeCacheEntry* Entry = Entries.Find(InComponent->GetOwner());
+	if (Entry)
+	{
+		Entry->IsStale = true;
+	}
+}
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeDataActor.h"
+#include "Engine/World.h"
+
+#include "BakedLedgeSubsystem.h"
+#include "LedgeBakeData.h"
+
+void ALedgeDataActor::BeginPlay()
+{
+	Super::BeginPlay();
+
+	auto BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	if (BakedLedges && LedgeData)
+	{
+		BakedLedges->Register(LedgeData, GetLevel());
+	}
+}
+
+void ALedgeDataActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	// Streamed out levels take their ledges with them
+	auto BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	if (BakedLedges && LedgeData)
+	{
+		BakedLedges->Unregister(LedgeData);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
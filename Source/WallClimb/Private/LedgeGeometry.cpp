@@ -0,0 +1,261 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeGeometry.h"
+
+#include "Components/PrimitiveComponent.h"
+#include "PhysicsEngine/BodySetup.h"
+#include "ClimbabilitySubsystem.h"
+#include "Algo/Reverse.h"
+
+bool FLedgeShape::ContainsPoint(const FVector2D& InPoint) const
+{
+	const int32 NumPoints = Points.Num();
+	if (NumPoints < 3)
+	{
+		return false;
+	}
+
+	// Even-odd rule, works for both windings
+	bool Inside = false;
+	for (int32 i = 0, j = NumPoints - 1; i < NumPoints; j = i++)
+	{
+		const FVector2D& A = Points[i];
+		const FVector2D& B = Points[j];
+
+		if (((A.Y > InPoint.Y) != (B.Y > InPoint.Y)) &&
+			(InPoint.X < (B.X - A.X) * (InPoint.Y - A.Y) / (B.Y - A.Y) + A.X))
+		{
+			Inside = !Inside;
+		}
+	}
+
+	return Inside;
+}
+
+void FLedgeShape::ComputeNormals()
+{
+	const int32 NumPoints = Points.Num();
+	Normals.Reset();
+
+	if (NumPoints < 2)
+	{
+		return;
+	}
+
+	// Mirrored transforms flip the winding
+	float DoubleArea = 0.f;
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		DoubleArea += FVector2D::CrossProduct(Points[i], Points[(i + 1) % NumPoints]);
+	}
+
+	if (DoubleArea < 0.f)
+	{
+		Algo::Reverse(Points);
+	}
+
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		const FVector2D Segment = Points[(i + 1) % NumPoints] - Points[i];
+		Normals.Add(FVector2D(Segment.Y, -Segment.X).GetSafeNormal());
+	}
+}
+
+float FLedgeShape::GetRimDistance(const FVector2D& InPoint) const
+{
+	const int32 NumPoints = Points.Num();
+	float ClosestDistanceSquared = MAX_flt;
+
+	for (int32 i = 0; i < NumPoints; ++i)
+	{
+		const FVector2D& A = Points[i];
+		const FVector2D Segment = Points[(i + 1) % NumPoints] - A;
+		const float LengthSquared = Segment.SizeSquared();
+
+		const float Along = LengthSquared > KINDA_SMALL_NUMBER ? 
+			FMath::Clamp(FVector2D::DotProduct(InPoint - A, Segment) / LengthSquared, 0.f, 1.f) : 0.f;
+		ClosestDistanceSquared = FMath::Min(ClosestDistanceSquared, FVector2D::DistSquared(InPoint, A + Segment * Along));
+	}
+
+	return FMath::Sqrt(ClosestDistanceSquared);
+}
+
+float FLedgeShape::RaycastSides(const FVector2D& InStart, const FVector2D& InDirection, float InMaxDistance, int32& OutSegment) const
+{
+	const int32 NumPoints = Points.Num();
+	float ClosestDistance = -1.f;
+	OutSegment = INDEX_NONE;
+
+	for (int32 i = 0; i < Normals.Num(); ++i)
+	{
+		const float Approach = FVector2D::DotProduct(InDirection, Normals[i]);
+
+		// Only the sides facing the ray
+		if (Approach > -KINDA_SMALL_NUMBER)
+		{
+			continue;
+		}
+
+		const FVector2D& A = Points[i];
+		const FVector2D& B = Points[(i + 1) % NumPoints];
+		const float Distance = FVector2D::DotProduct(A - InStart, Normals[i]) / Approach;
+
+		if (Distance < 0.f || Distance > InMaxDistance || (ClosestDistance >= 0.f && Distance >= ClosestDistance))
+		{
+			continue;
+		}
+
+		const FVector2D HitPoint = InStart + InDirection * Distance;
+		const FVector2D Segment = B - A;
+		const float Along = FVector2D::DotProduct(HitPoint - A, Segment);
+
+		if (Along < 0.f || Along > Segment.SizeSquared())
+		{
+			continue;
+		}
+
+		ClosestDistance = Distance;
+		OutSegment = i;
+	}
+
+	return ClosestDistance;
+}
+
+namespace
+{
+	/** Vertices this close to the highest one belong to the top face */
+	constexpr float TopFaceTolerance = 1.f;
+
+	/** Counter-clockwise convex hull of the vertices of the top face, monotone chain */
+	bool BuildTopFace(const TArray<FVector, TInlineAllocator<16>>& InVertices, FLedgeShape& OutShape)
+	{
+		float TopZ = -MAX_flt;
+		for (const FVector& Vertex : InVertices)
+		{
+			TopZ = FMath::Max(TopZ, Vertex.Z);
+		}
+
+		TArray<FVector2D, TInlineAllocator<16>> TopVertices;
+		for (const FVector& Vertex : InVertices)
+		{
+			if (Vertex.Z >= TopZ - TopFaceTolerance)
+			{
+				TopVertices.Add(FVector2D(Vertex.X, Vertex.Y));
+			}
+		}
+
+		// A sloped or pointed top has no rim to hang from
+		if (TopVertices.Num() < 3)
+		{
+			return false;
+		}
+
+		TopVertices.Sort([](const FVector2D& A, const FVector2D& B)
+		{
+			return A.X < B.X || (A.X == B.X && A.Y < B.Y);
+		});
+
+		const int32 NumVertices = TopVertices.Num();
+		TArray<FVector2D, TInlineAllocator<16>> Hull;
+		Hull.SetNumUninitialized(NumVertices * 2);
+		int32 NumHull = 0;
+
+		for (int32 i = 0; i < NumVertices; ++i)
+		{
+			while (NumHull >= 2 && FVector2D::CrossProduct(Hull[NumHull - 1] - Hull[NumHull - 2], TopVertices[i] - Hull[NumHull - 2]) <= KINDA_SMALL_NUMBER)
+			{
+				--NumHull;
+			}
+			Hull[NumHull++] = TopVertices[i];
+		}
+
+		for (int32 i = NumVertices - 2, LowerHull = NumHull + 1; i >= 0; --i)
+		{
+			while (NumHull >= LowerHull && FVector2D::CrossProduct(Hull[NumHull - 1] - Hull[NumHull - 2], TopVertices[i] - Hull[NumHull - 2]) <= KINDA_SMALL_NUMBER)
+			{
+				--NumHull;
+			}
+			Hull[NumHull++] = TopVertices[i];
+		}
+
+		// The last point closes the loop
+		--NumHull;
+		if (NumHull < 3)
+		{
+			return false;
+		}
+
+		OutShape.Points.Reset();
+		OutShape.Points.Append(Hull.GetData(), NumHull);
+		OutShape.TopZ = TopZ;
+		OutShape.ComputeNormals();
+
+		return true;
+	}
+}
+
+bool FLedgeShape::FromPrimitive(const UPrimitiveComponent* InPrimitive, FLedgeShape& OutShape)
+{
+	if (!(InPrimitive))
+	{
+		return false;
+	}
+
+	if (!InPrimitive->IsCollisionEnabled() ||
+		InPrimitive->GetCollisionResponseToChannel(UClimbabilitySubsystem::GetTraceChannel()) != ECR_Block ||
+		!UClimbabilitySubsystem::IsPrimitiveClimbable(InPrimitive))
+	{
+		return false;
+	}
+
+	// The queries run against simple collision, a complex-as-simple mesh has no elements to read the rim from
+	UBodySetup* BodySetup = InPrimitive->GetBodySetup();
+	if (!(BodySetup) || BodySetup->GetCollisionTraceFlag() == CTF_UseComplexAsSimple)
+	{
+		return false;
+	}
+
+	// A single box or convex has one top face. Anything else, several elements, spheres, capsules, is left to the traces
+	const FKAggregateGeom& AggGeom = BodySetup->AggGeom;
+	if (AggGeom.GetElementCount() != 1)
+	{
+		return false;
+	}
+
+	const FTransform& ComponentTransform = InPrimitive->GetComponentTransform();
+	TArray<FVector, TInlineAllocator<16>> Vertices;
+
+	if (AggGeom.BoxElems.Num() == 1)
+	{
+		const FKBoxElem& Box = AggGeom.BoxElems[0];
+		const FTransform BoxTransform = Box.GetTransform() * ComponentTransform;
+		const FVector HalfExtent(Box.X * 0.5f, Box.Y * 0.5f, Box.Z * 0.5f);
+
+		for (int32 Corner = 0; Corner < 8; ++Corner)
+		{
+			const FVector LocalCorner(
+				(Corner & 1) ? HalfExtent.X : -HalfExtent.X,
+				(Corner & 2) ? HalfExtent.Y : -HalfExtent.Y,
+				(Corner & 4) ? HalfExtent.Z : -HalfExtent.Z);
+			Vertices.Add(BoxTransform.TransformPosition(LocalCorner));
+		}
+	}
+	else if (AggGeom.ConvexElems.Num() == 1)
+	{
+		const FKConvexElem& Convex = AggGeom.ConvexElems[0];
+		const FTransform ConvexTransform = Convex.GetTransform() * ComponentTransform;
+
+		Vertices.Reserve(Convex.VertexData.Num());
+		for (const FVector& Vertex : Convex.VertexData)
+		{
+			Vertices.Add(ConvexTransform.TransformPosition(Vertex));
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	return BuildTopFace(Vertices, OutShape);
+}
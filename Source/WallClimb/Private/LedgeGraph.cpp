@@ -0,0 +1,391 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeGraph.h"
+
+#include "LedgeGeometry.h"
+#include "Algo/Reverse.h"
+
+namespace
+{
+	const float LedgeGraphCellSize = 500.f;
+
+	/** Ledges closer in height are at the same level */
+	const float LedgeGraphHeightTolerance = 2.f;
+
+	/** Sharpest turn taken while strafing, the same as FClimbingCore's when following a ledge */
+	const float LedgeGraphMaxTurnCos = 0.866f;
+
+	FVector Flatten(const FVector& InVector)
+	{
+		return FVector(InVector.X, InVector.Y, 0.f);
+	}
+}
+
+void FLedgeGraph::Build(const TArray<FLedgeShape>& InLedges, const FBuildSettings& InSettings)
+{
+	Settings = InSettings;
+	Nodes.Reset();
+	EdgeOffsets.Reset();
+	Edges.Reset();
+	Grid.Reset();
+
+	for (int32 i = 0; i < InLedges.Num(); ++i)
+	{
+		const FLedgeShape& Ledge = InLedges[i];
+		const int32 NumPoints = Ledge.Points.Num();
+		if (NumPoints < 3 || Ledge.Normals.Num() != NumPoints)
+		{
+			continue;
+		}
+
+		for (int32 Segment = 0; Segment < NumPoints; ++Segment)
+		{
+			const FVector2D& Start = Ledge.Points[Segment];
+			const FVector2D& End = Ledge.Points[(Segment + 1) % NumPoints];
+
+			FLedgeGraphNode& Node = Nodes.AddDefaulted_GetRef();
+			Node.Start = FVector(Start.X, Start.Y, Ledge.TopZ);
+			Node.End = FVector(End.X, End.Y, Ledge.TopZ);
+			Node.Normal = Ledge.Normals[Segment];
+			Node.Ledge = i;
+		}
+	}
+
+	TArray<FIntPoint, TInlineAllocator<8>> Cells;
+	for (int32 i = 0; i < Nodes.Num(); ++i)
+	{
+		GetCells(Nodes[i].Start, Nodes[i].End, Settings.MaxGap, Cells);
+		for (const FIntPoint& Cell : Cells)
+		{
+			Grid.FindOrAdd(Cell).Add(i);
+		}
+	}
+
+	TArray<TArray<FLedgeGraphEdge>> NodeEdges;
+	NodeEdges.SetNum(Nodes.Num());
+
+	int32 FirstNode = 0;
+	for (const FLedgeShape& Ledge : InLedges)
+	{
+		if (Ledge.Points.Num() < 3 || Ledge.Normals.Num() != Ledge.Points.Num())
+		{
+			continue;
+		}
+
+		ConnectLedge(Ledge, FirstNode, NodeEdges);
+		FirstNode += Ledge.Points.Num();
+	}
+
+	for (int32 i = 0; i < Nodes.Num(); ++i)
+	{
+		ConnectNeighbours(i, NodeEdges);
+	}
+
+	// Flatten, the edges of a node are searched together
+	EdgeOffsets.SetNum(Nodes.Num() + 1);
+	for (int32 i = 0; i < Nodes.Num(); ++i)
+	{
+		EdgeOffsets[i] = Edges.Num();
+		Edges.Append(NodeEdges[i]);
+	}
+	EdgeOffsets[Nodes.Num()] = Edges.Num();
+}
+
+int32 FLedgeGraph::FindClosestNode(const FVector& InLocation, float InMaxDistance) const
+{
+	TArray<FIntPoint, TInlineAllocator<8>> Cells;
+	GetCells(InLocation, InLocation, InMaxDistance, Cells);
+
+	int32 Closest = INDEX_NONE;
+	float ClosestDistance = InMaxDistance;
+
+	for (const FIntPoint& Cell : Cells)
+	{
+		const TArray<int32>* CellNodes = Grid.Find(Cell);
+		if (!CellNodes)
+		{
+			continue;
+		}
+
+		for (int32 Node : *CellNodes)
+		{
+			const float Distance = GetPointDistance(Nodes[Node], InLocation);
+			if (Distance <= ClosestDistance)
+			{
+				ClosestDistance = Distance;
+				Closest = Node;
+			}
+		}
+	}
+
+	return Closest;
+}
+
+bool FLedgeGraph::FindPath(const FLedgePathQuery& InQuery, FLedgePathScratch& InScratch, TArray<FLedgePathStep>& OutPath) const
+{
+	OutPath.Reset();
+
+	// One past the nodes stands for the goal reached by a Drop
+	const int32 GoalNode = Nodes.Num();
+
+	if (InScratch.Visits.Num() != GoalNode + 1)
+	{
+		InScratch.Costs.SetNumUninitialized(GoalNode + 1);
+		InScratch.Parents.SetNumUninitialized(GoalNode + 1);
+		InScratch.Types.SetNumUninitialized(GoalNode + 1);
+		InScratch.Visits.Init(0, GoalNode + 1);
+		InScratch.Visit = 0;
+	}
+
+	const uint32 Visit = ++InScratch.Visit;
+	InScratch.Open.Reset();
+
+	auto Heuristic = [this, &InQuery, GoalNode](int32 InNode)
+	{
+		return InNode == GoalNode ? 0.f : FMath::Max(GetPointDistance(Nodes[InNode], InQuery.Goal) - Settings.GoalRadius, 0.f);
+	};
+
+	auto HeapPredicate = [](const TPair<float, int32>& A, const TPair<float, int32>& B) { return A.Key < B.Key; };
+
+	auto Relax = [&InScratch, &Heuristic, &HeapPredicate, Visit](int32 InNode, int32 InParent, ELedgeEdgeType InType, float InCost)
+	{
+		if (InScratch.Visits[InNode] == Visit && InScratch.Costs[InNode] <= InCost)
+		{
+			return;
+		}
+
+		InScratch.Visits[InNode] = Visit;
+		InScratch.Costs[InNode] = InCost;
+		InScratch.Parents[InNode] = InParent;
+		InScratch.Types[InNode] = InType;
+		InScratch.Open.HeapPush(TPair<float, int32>(InCost + Heuristic(InNode), InNode), HeapPredicate);
+	};
+
+	// Seed with where the climb can start
+	if (InQuery.StartsHanging)
+	{
+		const int32 StartNode = FindClosestNode(InQuery.Start, Settings.MaxGap);
+		if (StartNode == INDEX_NONE)
+		{
+			return false;
+		}
+
+		Relax(StartNode, INDEX_NONE, ELedgeEdgeType::ClimbUp, 0.f);
+	}
+	else
+	{
+		if (FVector::Dist(InQuery.Start, InQuery.Goal) <= Settings.GoalRadius)
+		{
+			return true;
+		}
+
+		TArray<FIntPoint, TInlineAllocator<8>> Cells;
+		GetCells(InQuery.Start, InQuery.Start, Settings.MaxGroundReach, Cells);
+
+		for (const FIntPoint& Cell : Cells)
+		{
+			const TArray<int32>* CellNodes = Grid.Find(Cell);
+			if (!CellNodes)
+			{
+				continue;
+			}
+
+			for (int32 Node : *CellNodes)
+			{
+				const FLedgeGraphNode& Candidate = Nodes[Node];
+				const float Height = Candidate.Start.Z - InQuery.Start.Z;
+				if (Height <= 0.f || Height > Settings.MaxClimbingDistance)
+				{
+					continue;
+				}
+
+				const FVector ToStart = Flatten(InQuery.Start - FMath::ClosestPointOnSegment(InQuery.Start, Candidate.Start, Candidate.End));
+				if (ToStart.Size() > Settings.MaxGroundReach || (FVector2D(ToStart) | Candidate.Normal) <= 0.f)
+				{
+					continue;
+				}
+
+				Relax(Node, INDEX_NONE, ELedgeEdgeType::ClimbUp, ToStart.Size() + Height);
+			}
+		}
+	}
+
+	int32 EndNode = INDEX_NONE;
+	while (InScratch.Open.Num() > 0)
+	{
+		TPair<float, int32> Top;
+		InScratch.Open.HeapPop(Top, HeapPredicate, false);
+
+		const int32 Node = Top.Value;
+		const float Cost = InScratch.Costs[Node];
+		if (Top.Key > Cost + Heuristic(Node) + KINDA_SMALL_NUMBER)
+		{
+			// Outdated, the node was reached cheaper since
+			continue;
+		}
+
+		if (Node == GoalNode || GetPointDistance(Nodes[Node], InQuery.Goal) <= Settings.GoalRadius)
+		{
+			EndNode = Node;
+			break;
+		}
+
+		for (int32 i = EdgeOffsets[Node]; i < EdgeOffsets[Node + 1]; ++i)
+		{
+			const FLedgeGraphEdge& Edge = Edges[i];
+			Relax(Edge.Target, Node, Edge.Type, Cost + Edge.Cost);
+		}
+
+		const float DropCost = GetDropCost(Nodes[Node], InQuery.Goal);
+		if (DropCost >= 0.f)
+		{
+			Relax(GoalNode, Node, ELedgeEdgeType::Drop, Cost + DropCost);
+		}
+	}
+
+	if (EndNode == INDEX_NONE)
+	{
+		return false;
+	}
+
+	for (int32 Node = EndNode; Node != INDEX_NONE; Node = InScratch.Parents[Node])
+	{
+		// The ledge hung on at the start is no move
+		if (InScratch.Parents[Node] != INDEX_NONE || !InQuery.StartsHanging)
+		{
+			OutPath.Add({ InScratch.Types[Node], Node == GoalNode ? INDEX_NONE : Node });
+		}
+	}
+
+	Algo::Reverse(OutPath);
+	return true;
+}
+
+void FLedgeGraph::ConnectLedge(const FLedgeShape& InLedge, int32 InFirstNode, TArray<TArray<FLedgeGraphEdge>>& InOutEdges) const
+{
+	const int32 NumPoints = InLedge.Points.Num();
+	for (int32 Segment = 0; Segment < NumPoints; ++Segment)
+	{
+		const int32 Next = (Segment + 1) % NumPoints;
+		const int32 Node = InFirstNode + Segment;
+		const int32 NextNode = InFirstNode + Next;
+		const float Cost = FVector::Dist(Nodes[Node].GetCenter(), Nodes[NextNode].GetCenter());
+
+		// Going forward along the counter-clockwise rim is going left, when facing the wall
+		if ((InLedge.Normals[Segment] | InLedge.Normals[Next]) >= LedgeGraphMaxTurnCos)
+		{
+			InOutEdges[Node].Add({ NextNode, ELedgeEdgeType::StrafeLeft, Cost });
+			InOutEdges[NextNode].Add({ Node, ELedgeEdgeType::StrafeRight, Cost });
+			continue;
+		}
+
+		// Only outer corners can be gone around
+		const FVector2D Direction = InLedge.Points[Next] - InLedge.Points[Segment];
+		const FVector2D NextDirection = InLedge.Points[(Next + 1) % NumPoints] - InLedge.Points[Next];
+		if (FVector2D::CrossProduct(Direction, NextDirection) > 0.f)
+		{
+			InOutEdges[Node].Add({ NextNode, ELedgeEdgeType::AroundCornerLeft, Cost });
+			InOutEdges[NextNode].Add({ Node, ELedgeEdgeType::AroundCornerRight, Cost });
+		}
+	}
+}
+
+void FLedgeGraph::ConnectNeighbours(int32 InNode, TArray<TArray<FLedgeGraphEdge>>& InOutEdges) const
+{
+	const FLedgeGraphNode& Node = Nodes[InNode];
+	const FVector Tangent = Flatten(Node.End - Node.Start).GetSafeNormal();
+
+	TArray<FIntPoint, TInlineAllocator<8>> Cells;
+	GetCells(Node.Start, Node.End, Settings.MaxGap, Cells);
+
+	TArray<int32, TInlineAllocator<16>> Connected;
+	for (const FIntPoint& Cell : Cells)
+	{
+		const TArray<int32>* CellNodes = Grid.Find(Cell);
+		if (!CellNodes)
+		{
+			continue;
+		}
+
+		for (int32 Other : *CellNodes)
+		{
+			const FLedgeGraphNode& Neighbour = Nodes[Other];
+			if (Neighbour.Ledge == Node.Ledge || Connected.Contains(Other))
+			{
+				continue;
+			}
+
+			// Has to be the same wall
+			if ((Node.Normal | Neighbour.Normal) < LedgeGraphMaxTurnCos || GetSegmentGap(Node, Neighbour) > Settings.MaxGap)
+			{
+				continue;
+			}
+
+			const float Height = Neighbour.Start.Z - Node.Start.Z;
+			const float Cost = FVector::Dist(Node.GetCenter(), Neighbour.GetCenter());
+
+			if (FMath::Abs(Height) <= LedgeGraphHeightTolerance)
+			{
+				const bool IsLeft = ((Neighbour.GetCenter() - Node.GetCenter()) | Tangent) > 0.f;
+				InOutEdges[InNode].Add({ Other, IsLeft ? ELedgeEdgeType::StrafeLeft : ELedgeEdgeType::StrafeRight, Cost });
+				Connected.Add(Other);
+			}
+			else if (Height > 0.f && Height <= Settings.MaxClimbingDistance)
+			{
+				InOutEdges[InNode].Add({ Other, ELedgeEdgeType::ClimbUp, Cost });
+				Connected.Add(Other);
+			}
+		}
+	}
+}
+
+void FLedgeGraph::GetCells(const FVector& InStart, const FVector& InEnd, float InReach, TArray<FIntPoint, TInlineAllocator<8>>& OutCells) const
+{
+	OutCells.Reset();
+
+	const FIntPoint Min(
+		FMath::FloorToInt((FMath::Min(InStart.X, InEnd.X) - InReach) / LedgeGraphCellSize),
+		FMath::FloorToInt((FMath::Min(InStart.Y, InEnd.Y) - InReach) / LedgeGraphCellSize));
+	const FIntPoint Max(
+		FMath::FloorToInt((FMath::Max(InStart.X, InEnd.X) + InReach) / LedgeGraphCellSize),
+		FMath::FloorToInt((FMath::Max(InStart.Y, InEnd.Y) + InReach) / LedgeGraphCellSize));
+
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			OutCells.Add(FIntPoint(X, Y));
+		}
+	}
+}
+
+float FLedgeGraph::GetSegmentGap(const FLedgeGraphNode& InA, const FLedgeGraphNode& InB)
+{
+	FVector ClosestA, ClosestB;
+	FMath::SegmentDistToSegmentSafe(Flatten(InA.Start), Flatten(InA.End), Flatten(InB.Start), Flatten(InB.End), ClosestA, ClosestB);
+	return FVector::Dist(ClosestA, ClosestB);
+}
+
+float FLedgeGraph::GetPointDistance(const FLedgeGraphNode& InNode, const FVector& InPoint)
+{
+	return FMath::PointDistToSegment(InPoint, InNode.Start, InNode.End);
+}
+
+float FLedgeGraph::GetDropCost(const FLedgeGraphNode& InNode, const FVector& InGoal) const
+{
+	const float Height = InNode.Start.Z - InGoal.Z;
+	if (Height <= 0.f || Height > Settings.MaxDropHeight)
+	{
+		return -1.f;
+	}
+
+	// The fall starts in front of the wall
+	const FVector ToGoal = Flatten(InGoal - FMath::ClosestPointOnSegment(InGoal, InNode.Start, InNode.End));
+	if (ToGoal.Size() > Settings.MaxGroundReach || (FVector2D(ToGoal) | InNode.Normal) < 0.f)
+	{
+		return -1.f;
+	}
+
+	return Height + ToGoal.Size();
+}
@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeGraphSubsystem.h"
+#include "Engine/World.h"
+
+#include "EngineUtils.h"
+#include "Components/PrimitiveComponent.h"
+#include "Async/Async.h"
+#include "Async/ParallelFor.h"
+#include "BakedLedgeSubsystem.h"
+#include "LedgeGeometry.h"
+#include "ClimbingStats.h"
+
+void ULedgeGraphSubsystem::Deinitialize()
+{
+	// The workers only hold the batch and the graph, still nothing should outlive the world
+	if (PendingBatch.IsValid())
+	{
+		PendingBatch.Wait();
+	}
+
+	if (PendingGraph.IsValid())
+	{
+		PendingGraph.Wait();
+	}
+
+	Requests.Empty();
+	BatchRequests.Empty();
+	Batch.Reset();
+	Graph.Reset();
+
+	Super::Deinitialize();
+}
+
+int32 ULedgeGraphSubsystem::RequestPath(const FLedgePathQuery& InQuery, const FOnLedgePathFound& InOnFound)
+{
+	const int32 Id = NextRequestId++;
+	Requests.Add({ Id, InQuery, InOnFound });
+	return Id;
+}
+
+void ULedgeGraphSubsystem::SetBuildSettings(const FLedgeGraph::FBuildSettings& InSettings)
+{
+	BuildSettings = InSettings;
+	MarkGraphDirty();
+}
+
+void ULedgeGraphSubsystem::Tick(float DeltaTime)
+{
+	if (Batch && PendingBatch.IsReady())
+	{
+		FinishBatch();
+	}
+
+	if (PendingGraph.IsValid() && PendingGraph.IsReady())
+	{
+		Graph = PendingGraph.Get();
+		PendingGraph = TFuture<TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe>>();
+	}
+
+	if (Requests.Num() == 0 || PendingGraph.IsValid())
+	{
+		return;
+	}
+
+	if (IsGraphOutdated())
+	{
+		StartGraphBuild();
+		return;
+	}
+
+	if (!Batch && Graph)
+	{
+		StartBatch();
+	}
+}
+
+bool ULedgeGraphSubsystem::IsTickable() const
+{
+	return !IsTemplate() && (Requests.Num() > 0 || Batch.IsValid() || PendingGraph.IsValid());
+}
+
+UWorld* ULedgeGraphSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId ULedgeGraphSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(ULedgeGraphSubsystem, STATGROUP_Tickables);
+}
+
+bool ULedgeGraphSubsystem::IsGraphOutdated() const
+{
+	if (IsGraphDirty || !Graph)
+	{
+		return true;
+	}
+
+	const UBakedLedgeSubsystem* BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	return BakedLedges && BakedLedges->GetRevision() != BakedRevision;
+}
+
+void ULedgeGraphSubsystem::StartGraphBuild()
+{
+	TArray<FLedgeShape> Ledges;
+
+	const UBakedLedgeSubsystem* BakedLedges = GetWorld()->GetSubsystem<UBakedLedgeSubsystem>();
+	BakedRevision = BakedLedges ? BakedLedges->GetRevision() : 0;
+
+	for (TActorIterator<AActor> It(GetWorld()); It; ++It)
+	{
+		if (BakedLedges && BakedLedges->GetActorLedges(*It, Ledges))
+		{
+			continue;
+		}
+
+		// Not baked, every static primitive's top is grabbable, as for the traced hits
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(*It);
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			FLedgeShape Shape;
+			if (Primitive->Mobility == EComponentMobility::Static && FLedgeShape::FromPrimitive(Primitive, Shape))
+			{
+				Ledges.Add(MoveTemp(Shape));
+			}
+		}
+	}
+
+	IsGraphDirty = false;
+
+	PendingGraph = Async(EAsyncExecution::ThreadPool, [Ledges = MoveTemp(Ledges), Settings = BuildSettings]()
+	{
+		CLIMBING_SCOPE_CYCLE_COUNTER(BuildLedgeGraph);
+
+		TSharedPtr<FLedgeGraph, ESPMode::ThreadSafe> NewGraph = MakeShared<FLedgeGraph, ESPMode::ThreadSafe>();
+		NewGraph->Build(Ledges, Settings);
+		return TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe>(NewGraph);
+	});
+}
+
+void ULedgeGraphSubsystem::StartBatch()
+{
+	Batch = MakeShared<FLedgePathBatch, ESPMode::ThreadSafe>();
+	Batch->Graph = Graph;
+
+	Swap(BatchRequests, Requests);
+	Requests.Reset();
+
+	Batch->Queries.Reserve(BatchRequests.Num());
+	for (const FLedgePathRequest& Request : BatchRequests)
+	{
+		Batch->Queries.Add(Request.Query);
+	}
+
+	PendingBatch = Async(EAsyncExecution::ThreadPool, [RunningBatch = Batch]()
+	{
+		RunBatch(*RunningBatch);
+	});
+}
+
+void ULedgeGraphSubsystem::FinishBatch()
+{
+	// Callbacks may queue new requests
+	TArray<FLedgePathRequest> Finished = MoveTemp(BatchRequests);
+	TSharedPtr<FLedgePathBatch, ESPMode::ThreadSafe> FinishedBatch = MoveTemp(Batch);
+	BatchRequests.Reset();
+	Batch.Reset();
+	PendingBatch = TFuture<void>();
+
+	for (int32 i = 0; i < Finished.Num(); ++i)
+	{
+		Finished[i].OnFound.ExecuteIfBound(Finished[i].Id, FinishedBatch->Found[i], FinishedBatch->Paths[i]);
+	}
+}
+
+void ULedgeGraphSubsystem::RunBatch(FLedgePathBatch& InOutBatch)
+{
+	CLIMBING_SCOPE_CYCLE_COUNTER(FindPaths);
+
+	const int32 NumQueries = InOutBatch.Queries.Num();
+	InOutBatch.Paths.SetNum(NumQueries);
+	InOutBatch.Found.SetNumZeroed(NumQueries);
+
+	// A chunk per worker, each with its own search buffers
+	const int32 NumChunks = FMath::Min(NumQueries, FMath::Max(FTaskGraphInterface::Get().GetNumWorkerThreads(), 1));
+	const FLedgeGraph& SearchedGraph = *InOutBatch.Graph;
+
+	ParallelFor(NumChunks, [&InOutBatch, &SearchedGraph, NumQueries, NumChunks](int32 Chunk)
+	{
+		FLedgePathScratch Scratch;
+		for (int32 i = Chunk; i < NumQueries; i += NumChunks)
+		{
+			InOutBatch.Found[i] = SearchedGraph.FindPath(InOutBatch.Queries[i], Scratch, InOutBatch.Paths[i]);
+		}
+	});
+}
@@ -0,0 +1,75 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BakedLedgeSubsystem.generated.h"
+
+class ULedgeBakeData;
+class ULevel;
+struct FLedgeShape;
+struct FLedgeBakeActorRecord;
+
+/** Spatial lookup over the ledge data of all currently loaded levels.
+	The queries only answer for the ledges of a baked actor, anything else is left to the ledge cache and the traces */
+UCLASS()
+class WALLCLIMB_API UBakedLedgeSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** InLevel is the level the data was baked for, its actors are the ones the records name */
+	void Register(const ULedgeBakeData* InData, const ULevel* InLevel);
+
+	void Unregister(const ULedgeBakeData* InData);
+
+	/** Whether the ledges of the actor were baked, and are still where they were baked */
+	bool IsActorBaked(const AActor* InActor) const;
+
+	/** Changes every time ledge data is registered or unregistered */
+	uint32 GetRevision() const { return Revision; }
+
+	/** Appends the baked ledges of the actor. Returns false, with nothing appended, if it wasn't baked */
+	bool GetActorLedges(const AActor* InActor, TArray<FLedgeShape>& OutLedges) const;
+
+	/** Lowest baked ledge of InActor containing InProbe in its footprint, with its top within [InMinZ, InMaxZ) */
+	bool FindGrabLocation(const AActor* InActor, const FVector& InProbe, float InMinZ, float InMaxZ, FVector& OutLocation) const;
+
+	/** Baked ledge of InActor with its top within InHeightTolerance of InLocation.Z, with the closest rim to InLocation */
+	const FLedgeShape* FindLedge(const AActor* InActor, const FVector& InLocation, float InHeightTolerance) const;
+
+	/** Baked counterpart of a horizontal line trace against the walls of InActor. Only walls with their top
+		above InStart and no higher than InMaxDepth over it are considered */
+	bool FindWall(const AActor* InActor, const FVector& InStart, const FVector& InDelta, float InMaxDepth, FVector& OutLocation, FVector& OutNormal) const;
+
+private:
+	struct FBakedLedgeRef
+	{
+		const ULedgeBakeData* Data;
+		int32 Index;
+	};
+
+	/** Cells overlapped by a ledge, grown by the max query reach */
+	void GetCells(const FLedgeShape& InShape, TArray<FIntPoint, TInlineAllocator<8>>& OutCells) const;
+
+	FIntPoint GetCell(const FVector& InLocation) const;
+
+	const FLedgeShape& Resolve(const FBakedLedgeRef& InRef) const;
+
+	/** Data and record of a baked actor, false for any other */
+	bool FindActorRecord(const AActor* InActor, const ULedgeBakeData*& OutData, const FLedgeBakeActorRecord*& OutRecord) const;
+
+	/** Whether the ref is one of the record's ledges */
+	static bool IsRecordLedge(const FBakedLedgeRef& InRef, const ULedgeBakeData* InData, const FLedgeBakeActorRecord& InRecord);
+
+private:
+	TArray<const ULedgeBakeData*> Registered;
+
+	/** Registered data by the level it was baked for */
+	TMap<const ULevel*, const ULedgeBakeData*> LevelData;
+
+	TMap<FIntPoint, TArray<FBakedLedgeRef, TInlineAllocator<4>>> Grid;
+
+	uint32 Revision = 0;
+};
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/ObjectKey.h"
+#include "ClimbabilitySubsystem.generated.h"
+
+class UPrimitiveComponent;
+
+/** Which primitives can be climbed, resolved once per primitive.
+	The climbing queries run on the channel of Climbing.TraceChannel, WorldStatic by default. A project with a Climbable
+	trace channel (ignored by default, blocked by the Climbable collision profile given to the walls) selects it there,
+	so everything else is culled by the broadphase. Primitives the channel still hits are not climbable if they, or their actor,
+	have the NotClimbable tag, or if their physical material is a UClimbingPhysicalMaterial that isn't climbable */
+UCLASS()
+class WALLCLIMB_API UClimbabilitySubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	/** Channel of all the climbing queries, safe from any thread */
+	static ECollisionChannel GetTraceChannel();
+
+	/** Collision profile of the climbable primitives, when the project defines one */
+	static const FName ClimbableProfileName;
+
+	/** Whether the project's ClimbableProfileName exists and blocks InChannel, i.e. gives the walls to the climbing queries */
+	static bool IsClimbableProfileBlocking(ECollisionChannel InChannel);
+
+	/** Tag of the primitives or actors that can't be climbed */
+	static const FName NotClimbableTag;
+
+	/** Climbability of InPrimitive, through the subsystem of its world if there is one. Safe from any thread */
+	static bool IsPrimitiveClimbable(const UPrimitiveComponent* InPrimitive);
+
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Cached after the first call for a primitive. Safe from any thread */
+	bool IsClimbable(const UPrimitiveComponent* InPrimitive);
+
+	/** Resolved again on the next call, e.g. after its tags or material changed */
+	void Invalidate(const UPrimitiveComponent* InPrimitive);
+
+	void InvalidateAll();
+
+	/** Primitives resolved so far */
+	int32 Num() const;
+
+private:
+	/** The rules, uncached */
+	static bool ResolveClimbable(const UPrimitiveComponent* InPrimitive);
+
+	void OnLevelRemoved(ULevel* InLevel, UWorld* InWorld);
+
+private:
+	/** Read by the parallel passes of the crowd, written on the first query of a primitive */
+	mutable FRWLock Lock;
+
+	TMap<FObjectKey, bool> Climbable;
+
+	FDelegateHandle LevelRemovedHandle;
+};
@@ -0,0 +1,103 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClimbingBenchmarkCommandlet.generated.h"
+
+class FClimbingCore;
+class FAnalyticClimbingWorld;
+class FAnalyticClimbingBody;
+enum class EClimbingLOD : uint8;
+
+/** Per frame cost of the climbing code for one crowd size */
+struct FClimbingBenchmarkResult
+{
+	FString Name;
+
+	double MeanMs = 0.0;
+
+	double P99Ms = 0.0;
+
+	double QueriesPerFrame = 0.0;
+};
+
+/** Headless climbing benchmark. Spawns walls and climbers in a procedural world, drives them through
+	climb, hang, strafe and drop cycles, and compares the results against a stored baseline. Fails without a baseline
+	for every result, unless -UpdateBaseline writes one.
+	The climbing components are ticked by the world, seen from a player view behind the first row, so the times include
+	what their LOD, sleep and climb end scheduling save.
+	-Walking=<Percent> puts that share of the climbers in the open, away from the walls, e.g. to time a crowd that
+	mostly walks around.
+	-Core runs the same scenario on FClimbingCore and FAnalyticClimbingWorld only, without a world.
+	-Classify times the scalar and the batched surface classification on as many random hits as climbers,
+	and fails if they disagree.
+	-Crowd runs the same walls and climbers as agents of UClimbingCrowdSubsystem.
+	-Dense clutters the floor around every climber with -Props=<N> props that can't be climbed, and runs the scenario
+	on WorldStatic, then on the climbable channel -Channel=<N> (GameTraceChannel1 by default), to tell the query time it saves.
+	-AsyncLOD drives climbers with async traces held at Medium, then Low LOD, and fails if any of them never hangs.
+	-Allocs drives climbing components through climbs, still hangs and strafes, with async and sync traces and both grab searches,
+	and fails if an update allocates once warmed up.
+	The memory report and the capture replay are commandlets of their own, UClimbingMemoryReportCommandlet and
+	UClimbingReplayCommandlet. The fuzzing of the rules needs no engine, it is in the ClimbingCoreTests program.
+	Usage: -run=ClimbingBenchmark -nullrhi [-Climbers=1,100,1000] [-Frames=600] [-Batched] [-Walking=0] [-Dense [-Props=8] [-Channel=14]] [-Crowd] [-Core] [-Classify] [-AsyncLOD] [-Allocs]
+		[-Baseline=<file>] [-UpdateBaseline] [-Tolerance=0.15] */
+UCLASS()
+class WALLCLIMB_API UClimbingBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClimbingBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** Same as ClimbingBenchmark::FClimberDriver, for a core on the analytic world */
+	struct FCoreDriver
+	{
+		FAnalyticClimbingBody* Body = nullptr;
+
+		FClimbingCore* Core = nullptr;
+
+		int32 HangingFrames = 0;
+
+		bool WasInAir = false;
+	};
+
+	FClimbingBenchmarkResult RunScenario(int32 InNumClimbers, int32 InNumFrames, bool InBatched, int32 InWalkingPercent, int32 InPropsPerClimber);
+
+	/** RunScenario with InPropsPerClimber props on WorldStatic, then on InChannel, which only the walls block */
+	void RunDenseScenario(int32 InNumClimbers, int32 InNumFrames, bool InBatched, int32 InPropsPerClimber, ECollisionChannel InChannel,
+		TArray<FClimbingBenchmarkResult>& OutResults);
+
+	FClimbingBenchmarkResult RunCoreScenario(int32 InNumClimbers, int32 InNumFrames);
+
+	/** One result for FClimbingCore::IsClimbableSurface and one for FClimbingCore::ClassifySurfaces, per frame
+		of InNumSurfaces hits. Returns false if they don't classify the same */
+	bool RunClassifyScenario(int32 InNumSurfaces, int32 InNumFrames, TArray<FClimbingBenchmarkResult>& OutResults) const;
+
+	FClimbingBenchmarkResult RunCrowdScenario(int32 InNumClimbers, int32 InNumFrames);
+
+	/** Counts the heap allocations of each climbing component update, by what the climber is doing: climb, hang still, strafe.
+		Returns false if any is made after the first full cycle, or if a phase wasn't held long enough to tell */
+	bool RunAllocationScenario(int32 InNumClimbers, int32 InNumFrames);
+
+	/** Climbers with async traces, updated less than every frame. Returns false if any of them never climbed up to a hang */
+	bool RunAsyncLODScenario(int32 InNumClimbers, int32 InNumFrames, EClimbingLOD InLOD);
+
+	/** Analytic world and one core per climber. The cores keep references to their bodies, both need stable addresses */
+	void PopulateCoreClimbers(FAnalyticClimbingWorld& InOutWorld, int32 InNumClimbers, TArray<TUniquePtr<FAnalyticClimbingBody>>& OutBodies,
+		TArray<TUniquePtr<FClimbingCore>>& OutCores, TArray<FCoreDriver>& OutDrivers) const;
+
+	/** Same walls as PopulateWorld, as analytic boxes. Returns where the climbers start */
+	void PopulateAnalyticWorld(FAnalyticClimbingWorld& InOutWorld, int32 InNumClimbers, float InRadius, float InHalfHeight, TArray<FVector>& OutStartLocations) const;
+
+	/** Same as ClimbingBenchmark::DriveClimber, for a core */
+	void DriveCore(FCoreDriver& InOutDriver, float InDeltaTime) const;
+
+	bool LoadBaseline(const FString& InPath, TMap<FString, FClimbingBenchmarkResult>& OutBaseline) const;
+
+	bool SaveBaseline(const FString& InPath, const TArray<FClimbingBenchmarkResult>& InResults) const;
+};
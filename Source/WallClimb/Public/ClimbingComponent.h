@@ -5,18 +5,37 @@
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
 #include "Engine/Public/CollisionQueryParams.h"
+#include "Engine/Public/WorldCollision.h"
+#include "ClimbingCore.h"
+#include "ClimbingCapture.h"
+#include "ClimbingNetState.h"
+#include "ClimbingLatency.h"
+#include "ClimbingLimbTargets.h"
+#include "ClimbingProfile.h"
+#include "LedgeGeometry.h"
+#include "HAL/CriticalSection.h"
 #include "ClimbingComponent.generated.h"
 
-namespace
+/** Results of the engine's multi-hit queries and of the core's, only used within a query. Shared by the climbers of a world,
+	see UClimbingSubsystem::GetScratch: they are updated one after another on the game thread */
+struct FClimbingComponentScratch
 {
-	/** Reasons to leave the clambing state */
-	UENUM()
-	enum class EReasonToStopClimbing : uint8
-	{
-		StartFalling,
-		StartHanging
-	};
-}
+	FClimbingQueryScratch Core;
+
+	TArray<FHitResult> VerticalHitResults;
+
+	TArray<FOverlapResult> GrabOverlaps;
+};
+
+/** What an async trace handle gave, see UClimbingComponent::ConsumeAsyncTrace */
+enum class EClimbingAsyncTrace : uint8
+{
+	/** Nothing in flight */
+	None,
+	Ready,
+	/** Submitted before the last frame, the engine doesn't keep the result that long */
+	Expired
+};
 
 /** For later use in Animation state machine */
 UENUM()
@@ -32,11 +51,34 @@ enum class EClimbDirection : uint8
 	NONE					UMETA(DisplayName = "None")
 };
 
+/** Level of detail of the climbing updates, from the character's significance to the players */
+UENUM(BlueprintType)
+enum class EClimbingLOD : uint8
+{
+	/** Every frame, capsule scan */
+	High			UMETA(DisplayName = "High"),
+	/** Lower update rate, no debug drawing */
+	Medium			UMETA(DisplayName = "Medium"),
+	/** Low update rate, ray scan */
+	Low				UMETA(DisplayName = "Low"),
+	/** Lowest update rate, climbs are only checked when they are computed to end. The ray scan is resolved on the rims
+		of the static walls found by the proximity check, and the grab on the baked or cached ledges, with no scene query.
+		Either is traced when the walls in reach have no rim to tell. A ledge grab still takes a single test trace,
+		checking that nothing lies on the rim */
+	Minimal			UMETA(DisplayName = "Minimal")
+};
+
+/** Engine side of FClimbingCore: feeds it the owning character as the body and the world's scene queries as the collision */
 UCLASS( Blueprintable, ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
-class WALLCLIMB_API UClimbingComponent : public UActorComponent
+class WALLCLIMB_API UClimbingComponent : public UActorComponent, public IClimbingBody, public IClimbingCollision
 {
 	GENERATED_BODY()
 
+	friend class UClimbingSubsystem;
+	friend class UClimbingCrowdSubsystem;
+	friend class UClimbingBenchmarkCommandlet;
+	friend class UClimbingRouteComponent;
+
 public:	
 	// Sets default values for this component's properties
 	UClimbingComponent();
@@ -45,6 +87,10 @@ protected:
 	// Called when the game starts
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	virtual void PostLoad() override;
+
 	/** Has to be triggered when the player presses Jump */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Event")
 	void OnJumpPressed();
@@ -65,7 +111,8 @@ protected:
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Event")
 	void OnCharacterLanded();
 
-	/** A signal method for the component to process the time of the animation being played on the Character's side */
+	/** A signal method for the component to process the time of the animation being played on the Character's side.
+		The animation owns the limbs meanwhile, there are no limb targets */
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Event")
 	void OnLocationTransition();
 
@@ -74,23 +121,36 @@ protected:
 	UFUNCTION(BlueprintNativeEvent, BlueprintCallable, Category = "Event")
 	void OnLocationTransitionFinished();
 
-	/** A set of checks before starting a climb */
-	bool CanStartClimbing();
+	/** Inputs of the owning client, replayed on the server. The scale and the frame time are quantized to a byte each.
+		The server never moves for more time than went by on its side, see ServerStrafeTimeBudget */
+	UFUNCTION(Server, Unreliable, WithValidation)
+	void ServerMoveSideways(int8 InScale, uint8 InDeltaTimeMs);
 
-	bool TickTrace(FHitResult& outHitResult);
+	UFUNCTION(Server, Reliable)
+	void ServerJumpPressed();
 
-	/** Prepare data, that will be used on StartClimbing */
-	void ScanForClimbingData();
+	UFUNCTION(Server, Reliable)
+	void ServerHangRelease();
 
-	void StartClimbing();
+	UFUNCTION(Server, Reliable)
+	void ServerSetClimbOnHitAllowed(bool InAllowed);
 
-	void StopClimbing(const EReasonToStopClimbing InReason);
+	UFUNCTION()
+	void OnRep_NetState();
 
-	void UpdateClimbing();
+	/** Async counterpart of TickTrace, the result is picked up by the next SweepCapsule */
+	void SubmitTickTrace(const FVector& InLocation, const FQuat& InRotation, const FCollisionShape& InShape);
 
-	void StartHanging();
+	/** Prepare data, that will be used on StartClimbing */
+	void ScanForClimbingData();
+
+	bool ShouldScanForClimbingData();
+
+	/** Stores the result of a TickTrace, however it was run */
+	void ApplyClimbingScan(bool HasHit, FHitResult& HitResult, bool IsHitClimbable);
 
-	void StopHanging();
+	/** Starts or updates the climb, according to the latest scan */
+	void UpdateClimbingState();
 
 	void UpdateHanging(float InDeltaTime);	
 
@@ -98,6 +158,42 @@ public:
 	// Called every frame
 	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
 
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+	/** Adds what the component owns out of line, the core and the predictions. The profile and the query scratch are shared */
+	virtual void GetResourceSizeEx(FResourceSizeEx& CumulativeResourceSize) override;
+
+	/** Animations and IK should skip their climbing work below High */
+	UFUNCTION(BlueprintPure, Category = "Climbing")
+	EClimbingLOD GetClimbingLOD() const { return ClimbingLOD; }
+
+	/** Hand and foot IK targets while on the wall. A copy, safe to call from the animation worker thread */
+	UFUNCTION(BlueprintPure, Category = "Climbing", meta = (BlueprintThreadSafe))
+	FClimbingLimbTargets GetLimbTargets() const;
+
+	/** State of the climbing rules as this machine runs them, the authoritative one on the server */
+	bool IsClimbingState() const { return Core->IsClimbing(); }
+
+	bool IsHangingState() const { return Core->IsHanging(); }
+
+	/** Tuning in use, the default profile when none is set */
+	const UClimbingProfile& GetProfile() const { return Profile ? *Profile : UClimbingProfile::GetDefaultProfile(); }
+
+	/** Switches to the tuning of another archetype, from the next climbing update */
+	UFUNCTION(BlueprintCallable, Category = "Climbing")
+	void SetProfile(UClimbingProfile* InProfile) { Profile = InProfile; }
+
+	/** Sets IsClimbOnHitAllowed, on the server too when called by the owning client */
+	UFUNCTION(BlueprintCallable, Category = "Climbing")
+	void SetClimbOnHitAllowed(bool InAllowed);
+
+	/** Records the climbing inputs and scene query results to InPath, for FClimbingCaptureReplay. See Climbing.Capture */
+	bool StartCapture(const FString& InPath);
+
+	void StopCapture();
+
+	bool IsCapturing() const { return Recorder.IsValid(); }
+
 protected:
 	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Climbing|Values", meta = (DisplayName = "Is Climbing"))
 	bool IsClimbing;
@@ -120,83 +216,412 @@ protected:
 	UPROPERTY(BlueprintReadWrite, VisibleAnywhere, Category = "Climbing|Setup", meta = (DisplayName = "Movement Component Ref"))
 	class UCharacterMovementComponent* MovementComp;
 
-	/** Max height that can be climbed */
-	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Climbing Distance"))
-	float MaxClimbingDistance = 200;
+	/** Tuning shared with the other climbers of the archetype, see GetProfile */
+	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Profile"))
+	UClimbingProfile* Profile = nullptr;
+
+#if WITH_EDITORONLY_DATA
+	/** The tuning from before UClimbingProfile, only loaded to be moved into an override profile in PostLoad */
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float MaxClimbingDistance_DEPRECATED = 200.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float MaxClimbingSpeed_DEPRECATED = 200.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float MaxClimbingStrafeSpeed_DEPRECATED = 200.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float MaxSurfaceCaptureAngle_DEPRECATED = 45.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	bool UseLedgeFollowing_DEPRECATED = true;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	bool ClimbAroundCorners_DEPRECATED = true;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	int32 GrabProbeColumns_DEPRECATED = 5;
 
-	/** Speed with which a character moves on the walls vertically */
-	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Climbing Speed"))
-	float MaxClimbingSpeed = 200.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	int32 GrabProbeRows_DEPRECATED = 2;
 
-	/** Speed with which a character moves on the walls sideways */
-	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Climbing Strafe Speed"))
-	float MaxClimbingStrafeSpeed = 200.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float LODMaxDistance_DEPRECATED = 8000.f;
 
-	/** An angle of capturing a surface */
-	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Capture Angle", ClampMin = "0", ClampMax = "45"))
-	float MaxSurfaceCaptureAngle = 45.f;
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float HiddenSignificanceScale_DEPRECATED = 0.5f;
 
-	/** Should be allowed by the Component's user, to specify when it must be activated. E.g. on sprinting or jumping */
-	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Is Climb On Hit Allowed"))
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float WakeDistance_DEPRECATED = 100.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float ProximityCheckInterval_DEPRECATED = 0.25f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float MaxPredictionAge_DEPRECATED = 0.5f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float HandSpacing_DEPRECATED = 20.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float FootSpacing_DEPRECATED = 15.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float FootHeight_DEPRECATED = 15.f;
+
+	UPROPERTY(meta = (DeprecatedProperty, DeprecationMessage = "Moved to the climbing profile"))
+	float LimbProbeMoveThreshold_DEPRECATED = 5.f;
+#endif
+
+	/** Should be allowed by the Component's user, to specify when it must be activated. E.g. on sprinting or jumping.
+		Set through SetClimbOnHitAllowed, from Blueprints too, so the server follows the owning client */
+	UPROPERTY(BlueprintReadWrite, BlueprintSetter = SetClimbOnHitAllowed, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Is Climb On Hit Allowed"))
 	bool IsClimbOnHitAllowed = false;
 
+	/** Answer grab location queries from the shared ledge cache, before falling back to traces */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Use Ledge Cache"))
+	bool UseLedgeCache = true;
+
+	/** Lower the update rate and the scan cost of characters that matter less to the players */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|LOD", meta = (DisplayName = "Use Climbing LOD"))
+	bool UseClimbingLOD = true;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Climbing|LOD", meta = (DisplayName = "Climbing LOD"))
+	EClimbingLOD ClimbingLOD = EClimbingLOD::High;
+
+	/** Sleep while no wall is in reach: no scan and no state update, only a coarse overlap once in a while.
+		A hit of the capsule against a wall wakes the component up right away */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Sleep", meta = (DisplayName = "Use Sleep"))
+	bool UseSleep = true;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly, Category = "Climbing|Sleep", meta = (DisplayName = "Is Asleep"))
+	bool IsAsleep = false;
+
+	/** The server's state, quantized */
+	UPROPERTY(ReplicatedUsing = OnRep_NetState)
+	FClimbingNetState NetState;
+
+	/** Run TickTrace and UpwardTrace as async scene queries. Takes them off the game thread, 
+		but their results are used one frame later. Only while updated every frame, see CanUseAsyncTraces */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Use Async Traces"))
+	bool UseAsyncTraces = false;
+
+	/** Let UClimbingSubsystem batch the scene queries of all climbers instead of ticking on its own.
+		Async traces are not used in this mode */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Use Climbing Subsystem"))
+	bool UseClimbingSubsystem = false;
+
+	/** Once the location to grab is known, skip the climbing updates until the climb is computed to end.
+		With UClimbingMovementComponent the climb stops right at the grab height and hangs from there */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Setup", meta = (DisplayName = "Use Climb Timer"))
+	bool UseClimbTimer = true;
+
+	/** Probe where the hands and feet touch the wall while on it, for the IK. High LOD only, and not on dedicated servers.
+		The four probes go as one set of async traces, their results are used one frame later */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|IK", meta = (DisplayName = "Use Limb Targets"))
+	bool UseLimbTargets = true;
+
+public:
+	// IClimbingBody
+	virtual FVector GetBodyLocation() const override;
+	virtual FQuat GetBodyRotation() const override;
+	virtual float GetBodyChestZ() const override;
+	virtual void GetBodyCapsuleSize(float& OutRadius, float& OutHalfHeight) const override;
+	virtual float GetBodyWalkableFloorZ() const override;
+	virtual void LaunchClimbMovement(const FVector& InVelocity) override;
+	virtual void ExitClimbMovement() override;
+	virtual void StopBodyMovement() override;
+	virtual void OffsetBody(const FVector& InDelta) override;
+	virtual void SetBodyLocation(const FVector& InLocation) override;
+	virtual void FaceBody(const FVector& InDirection) override;
+
+	// IClimbingCollision
+	virtual EClimbingQueryStatus SweepCapsule(const FVector& InLocation, const FQuat& InRotation, float InRadius, float InHalfHeight, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceDown(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FClimbingHitArray& OutHits) override;
+	virtual bool TraceWall(const FVector& InStart, const FVector& InEnd, float InMaxDepth, FClimbingHit& OutHit) override;
+	virtual EClimbingQueryStatus TraceScanRay(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit) override;
+	virtual bool SupportsGrabSurfaces() const override;
+	virtual EClimbingQueryStatus OverlapGrabSurfaces(const FBox& InBounds, const FClimbingHit& InWall, FClimbingGrabSurfaceArray& OutSurfaces) override;
+	virtual bool FindLedge(const FVector& InLocation, const FClimbingHit& InWall, FClimbingLedge& OutLedge) override;
+	virtual bool IsLedgeCurrent(const FClimbingLedge& InLedge) const override;
+	virtual bool IsSurfaceValid(const void* InSurface) const override;
+	virtual bool GetSurfaceTransform(const void* InSurface, FTransform& OutTransform) const override;
+	virtual void CancelPendingQueries() override;
+
 private:
-	bool CanStartHanging;
+	/** Climbing rules, the component only adapts them to the engine */
+	TUniquePtr<FClimbingCore> Core;
+
+	/** Between the core and this component while capturing */
+	TUniquePtr<FClimbingCaptureRecorder> Recorder;
+
+	/** MovementComp, when the character climbs in its custom modes. Otherwise the body is flown and teleported */
+	UPROPERTY()
+	class UClimbingMovementComponent* ClimbingMovementComp = nullptr;
+
+	/** Last wall hit by the tick trace, FClimbingHit::Surface is only trusted while this is valid */
+	TWeakObjectPtr<UPrimitiveComponent> WallComponent;
+
+	/** Actor of the ledge followed while hanging, FClimbingLedge::Surface is only trusted while this is valid */
+	TWeakObjectPtr<const AActor> HangLedgeActor;
+
+	/** Moving base the component ticks after, so the grab data follows where it is this frame */
+	TWeakObjectPtr<AActor> TickBaseActor;
+
+	/** In flight async traces, valid for one frame after the submission */
+	FTraceHandle TickTraceHandle;
+
+	FTraceHandle UpwardTraceHandle;
+
+	/** A state the owning client went into ahead of the server */
+	struct FClimbingPrediction
+	{
+		float Time;
+
+		FClimbingStateSnapshot Snapshot;
+	};
+
+	/** What the owning client keeps to reconcile with the server */
+	struct FClimbingPredictionState
+	{
+		/** Latest predicted state changes, oldest first */
+		TArray<FClimbingPrediction, TInlineAllocator<8>> Predictions;
+
+		/** Last state received from the server */
+		FClimbingStateSnapshot ServerSnapshot;
+
+		bool HasServerSnapshot = false;
+	};
+
+	/** Only allocated on the owning client, the other climbers never predict. See GetPredictionState */
+	TUniquePtr<FClimbingPredictionState> PredictionState;
+
+	/** The world's shared scratch, or OwnScratch outside of play. See GetScratch */
+	FClimbingComponentScratch* Scratch = nullptr;
+
+	TUniquePtr<FClimbingComponentScratch> OwnScratch;
+
+	/** Static wall in reach with the rim read from its collision, what the scans of Minimal are resolved on */
+	struct FClimbingWallInReach
+	{
+		TWeakObjectPtr<UPrimitiveComponent> Primitive;
+
+		FLedgeShape Shape;
+
+		float BottomZ = 0.f;
+	};
+
+	/** Scheduling, LOD, sleep and limb probe state, packed. The tuning they go by is in the profile */
+	struct FClimbingRuntimeState
+	{
+		/** Found by the last proximity check at Minimal, see CanScanWithoutQueries */
+		TArray<FClimbingWallInReach, TInlineAllocator<2>> WallsInReach;
+
+		/** Where the body was at that check */
+		FVector WallsInReachLocation = FVector::ZeroVector;
+
+		/** Body and state the limb targets were probed for, see LimbProbeMoveThreshold */
+		FQuat LimbProbeRotation = FQuat::Identity;
+
+		FVector LimbProbeLocation = FVector::ZeroVector;
+
+		/** Time until the significance is evaluated again */
+		float TimeToLODEvaluation = 0.f;
+
+		/** Time between the climbing updates at the current LOD */
+		float UpdateInterval = 0.f;
 
-	/** Resets on touching the groung, or hanging */
-	bool HasAbilityToClimb;
+		/** Time until the next climbing update, when ticked by UClimbingSubsystem */
+		float TimeToUpdate = 0.f;
 
-	/** An actor to climb on*/
-	AActor* ActorToClimbOn;
+		/** Time until the next look for a wall in reach */
+		float TimeToProximityCheck = 0.f;
 
-	/** Or height to climb */
-	FVector LocationToGrab;
+		/** On the server, the strafing time the owning client may still report, and the world time it was topped up at */
+		float ServerStrafeTimeBudget = 0.f;
 
-	bool IsLocationPotentiallyReachable;
+		float ServerStrafeBudgetTime = 0.f;
 
-	/** An object we've already climbed
-		- Uses as a filter, so we don't try to hang on the same object */
-	AActor* LastClimbedObject;
-	
-	/** A surface we are currently operating with */
-	FVector CurrentSurfaceNormal;
+		/** Core's aborted grabs already counted */
+		uint32 SeenAbortedGrabs = 0;
 
-	/** Filter for traces for objects */
-	FCollisionObjectQueryParams ObjectsToTrace;
+		/** Counted in GClimbingNetClimbers */
+		uint8 IsNetClimber : 1;
 
-	/** To track the climbed distance */
-	FVector ClimbingStartLocation;
+		/** The next update is scheduled at the computed end of the climb, see UseClimbTimer */
+		uint8 IsWaitingForClimbEnd : 1;
 
-	/** How far we've already climbed */
-	float ClimbedDistance;
+		uint8 LimbProbeHanging : 1;
 
-	/** To store initial data, retrieved from a hit on object to climb */
-	FHitResult TickTraceHitResult;
+		uint8 HasLimbProbes : 1;
+
+		/** Between OnLocationTransition and OnLocationTransitionFinished */
+		uint8 IsInLocationTransition : 1;
+
+		/** WallsInReach is everything the proximity check found, none of it has to be traced */
+		uint8 AreWallsInReachResolved : 1;
+
+		FClimbingRuntimeState()
+			: IsNetClimber(false)
+			, IsWaitingForClimbEnd(false)
+			, LimbProbeHanging(false)
+			, HasLimbProbes(false)
+			, IsInLocationTransition(false)
+			, AreWallsInReachResolved(false)
+		{
+		}
+	};
+
+	FClimbingRuntimeState Runtime;
+
+	/** Transitions being timed, see Climbing.Latency */
+	FClimbingLatencyTracker LatencyTracker;
+
+	/** Written on the game thread, read by the animation through GetLimbTargets */
+	FClimbingLimbTargets LimbTargets;
+
+	mutable FCriticalSection LimbTargetsLock;
+
+	/** In flight limb probes, one per EClimbingLimb */
+	FTraceHandle LimbTraceHandles[(int32)EClimbingLimb::Num];
 
 private:
+	/** Copies the profile's settings and the per instance ones to the core, the profile may be switched at any time */
+	void PushSettings();
+
+	/** Mirrors the core state into the Blueprint visible properties */
+	void PullState();
+
+	/** Times the transitions the core just went through, from PullState */
+	void TrackLatency(bool InWasClimbing);
+
+	/** Ticks after the moving base the core is on, from PullState */
+	void UpdateBaseTickDependency();
+
+	/** Picks up the limb probes of the last frame and probes again once the body moved enough, after each climbing update */
+	void UpdateLimbTargets();
+
+	void SubmitLimbProbes();
+
+	/** Probe segment of a limb, towards the wall or down onto the grabbed ledge */
+	void GetLimbProbe(EClimbingLimb InLimb, FVector& OutStart, FVector& OutEnd) const;
+
+	/** No contact for any limb, probes in flight dropped */
+	void ClearLimbTargets();
+
+	/** Whether the references to the owner's components are set */
+	bool HasValidSetup() const;
+
+	/** Takes over a state from elsewhere, e.g. a crowd agent turned into this actor. The climbed distance starts over */
+	void TakeOverState(const FClimbingStateSnapshot& InSnapshot, const FClimbingHit& InWall, UPrimitiveComponent* InWallComponent);
+
+	/** Moves the core's state to a new core on another body and collision */
+	void RebindCore(IClimbingBody& InBody, IClimbingCollision& InCollision);
+
+	/** Other clients' characters only display the replicated state, their movement is replicated */
+	bool IsSimulatedProxy() const { return GetOwnerRole() == ROLE_SimulatedProxy; }
+
+	/** The owning client runs the rules ahead of the server */
+	bool IsPredicting() const { return GetOwnerRole() == ROLE_AutonomousProxy; }
+
+	/** Significance to the players, from 0 to 1: their distance, whether the character is seen and whether it is one of them */
+	float GetSignificance() const;
+
+	/** Picks the LOD from the significance. Detail is added right away, but only removed off the wall and past a margin */
+	void UpdateClimbingLOD(float InDeltaTime);
+
+	void SetClimbingLOD(EClimbingLOD InLOD);
+
+	/** Next update time at the current LOD, early enough not to miss the end of a climb */
+	void ScheduleNextUpdate();
+
+	/** Advances the time of a climber ticked by UClimbingSubsystem, returns whether it is to be updated this frame */
+	bool ConsumeUpdateTime(float InDeltaTime);
+
+	/** Wakes up or falls asleep by whether a wall is in reach, returns whether the climbing update is to run */
+	bool UpdateSleep(float InDeltaTime);
+
+	/** Coarse overlap around the scan capsule, for anything the scan could hit soon. At Minimal, also keeps the walls
+		found with their rims, see CanScanWithoutQueries */
+	bool HasWallInReach();
+
+	/** At Minimal, when every wall in reach has a rim and the body is still around where they were found */
+	bool CanScanWithoutQueries() const;
+
+	/** The scan ray against the sides of the walls in reach, as a trace would hit them */
+	EClimbingQueryStatus TraceWallsInReach(const FVector& InStart, const FVector& InEnd, FClimbingHit& OutHit);
+
+	void WakeUp();
+
+	void FallAsleep();
+
+	/** Back to the LOD's update rate while waiting for the end of a climb, which may not go as computed anymore */
+	void ResumeClimbUpdates();
+
+	/** The climbing movement stopped at the grab height */
+	void OnClimbTargetReached();
+
+	/** Stops the climb of the default movement at the grab height, as UClimbingMovementComponent's climb target does */
+	UFUNCTION()
+	void OnOwnerMovementUpdated(float DeltaSeconds, FVector OldLocation, FVector OldVelocity);
+
+	UFUNCTION()
+	void OnOwnerMovementModeChanged(class ACharacter* Character, EMovementMode PrevMovementMode, uint8 PreviousCustomMode);
+
+	UFUNCTION()
+	void OnCapsuleHit(UPrimitiveComponent* HitComponent, AActor* OtherActor, UPrimitiveComponent* OtherComp, FVector NormalImpulse, const FHitResult& Hit);
+
+	/** Allocated on first use */
+	FClimbingPredictionState& GetPredictionState();
+
+	/** The subsystem's once playing, an own one allocated on first use otherwise */
+	FClimbingComponentScratch& GetScratch();
+
+	/** Points the component and its core at the scratch they use from now on, nullptr to let them allocate their own */
+	void SetScratch(FClimbingComponentScratch* InScratch);
+
+	/** Remembers a predicted state change, to tell a late server from a wrong prediction */
+	void RecordPrediction();
+
+	/** Snaps to the server's state, unless it is one the client went through lately or it may still catch up */
+	void ReconcilePrediction();
+
+	/** Same climbing state, the location along the ledge aside */
+	static bool IsSameState(const FClimbingStateSnapshot& InA, const FClimbingStateSnapshot& InB);
+
+	/** Engine hit to the core's hit. InWalkableFloorZ is the body's one, the surface's override is applied to it.
+		Only reads the hit component, safe to run off the game thread */
+	static FClimbingHit MakeClimbingHit(const FHitResult& InHitResult, float InWalkableFloorZ);
+
+	bool TickTrace(const FVector& InLocation, const FQuat& InRotation, const FCollisionShape& InShape, FHitResult& OutHitResult) const;
+
+	bool UpwardTrace(const FVector& InBegin, const FVector& InEnd, TArray<FHitResult>& OutHitResults) const;
 
-	/** Surface check*/
-	bool IsClimbable(const FHitResult& HitResult);
+	void SubmitUpwardTrace(const FVector& InBegin, const FVector& InEnd);
 
-	/** Climbing states check */
-	bool IsOnTheWall();
+	/** Fetches and releases the result of an async trace, which is only kept for the frame after its submission */
+	EClimbingAsyncTrace ConsumeAsyncTrace(FTraceHandle& InOutHandle, FTraceDatum& OutDatum) const;
 
-	/** Updates the value of Climbed distance, returns MaxClimbingDistance > ClimbedDistance */
-	bool UpdateClimbedDistance();
+	/** UseAsyncTraces, when the next update is sure to be on the next frame to pick the result up. At a reduced update rate,
+		asleep or waiting for the end of a climb, the results would expire before they are used: the queries block instead */
+	bool CanUseAsyncTraces() const;
 
-	/** Updates LocationToGrab. Returns if there is a reachable location to grab */
-	bool GetLocationToGrab();
+	/** Baked data query replacing UpwardTrace on the walls of baked actors */
+	bool FindBakedLocationToGrab(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FVector& OutLocation) const;
 
-	bool UpwardTrace(TArray<FHitResult>& OutHitResult) const;
+	/** Cache query replacing UpwardTrace for already known actors */
+	bool FindCachedLocationToGrab(const FVector& InBegin, const FVector& InEnd, float InMinZ, const FClimbingHit& InWall, FVector& OutLocation) const;
 
-	bool FindClosestVerticalHit(const TArray<FHitResult>& InHitResults, FHitResult& HitResult) const;
+	/** Whether nothing blocks the column from InTopZ down to a baked or cached grab, e.g. a prop put on the wall.
+		The ledge data only knows the wall's own geometry, UpwardTrace would stop at whatever lies on it */
+	bool IsGrabColumnClear(const FVector& InGrabLocation, float InTopZ) const;
 
-	bool BoxContainsVector(const FVector& Origin, const FVector& Extent, const FVector& InVector) const;
+	/** Top of the hit primitive's bounds, from the ledge cache when the hit has no component */
+	bool GetSurfaceTopZ(const FHitResult& InHitResult, float& OutTopZ) const;
 
 	/** Reset values that define any climbing state, reset a climbing ability */
 	void ResetClimbingStates();
 
-	void MoveSideways(const float& Scale);
-	
-	bool CanMoveSidewaysToLocation(const FVector & InTargetLocation, FHitResult& OutHitResult) const;
+	void MoveSideways(float Scale, float DeltaTime);
 };
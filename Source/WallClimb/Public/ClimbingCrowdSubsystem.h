@@ -0,0 +1,177 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "ClimbingCore.h"
+#include "ClimbingCrowdSubsystem.generated.h"
+
+class UClimbingComponent;
+class UPrimitiveComponent;
+
+/** What a crowd agent is doing */
+enum class EClimbingCrowdState : uint8
+{
+	Walking,
+	Climbing,
+	Hanging
+};
+
+/** State of the crowd agents, one column per value. Index i of every column is agent i */
+struct WALLCLIMB_API FClimbingCrowdAgents
+{
+	TArray<FVector> Locations;
+
+	/** Horizontal, the agents face where they walk */
+	TArray<FVector> Forwards;
+
+	/** Walking velocity, set by the game. Kept while on the wall, the agent walks on with it once back on the ground */
+	TArray<FVector> Velocities;
+
+	TArray<EClimbingCrowdState> States;
+
+	/** Wall climbed or hung on. FClimbingHit::Surface is only trusted while WallComponents is valid */
+	TArray<FClimbingHit> WallHits;
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> WallComponents;
+
+	TArray<FVector> LocationsToGrab;
+
+	TArray<FVector> ClimbStartLocations;
+
+	TArray<float> ClimbedDistances;
+
+	/** Cleared once a ledge search found nothing, the climb then goes on to its max distance */
+	TArray<bool> IsGrabReachable;
+
+	/** Latest scan of the walking agents */
+	TArray<FClimbingHit> ScanHits;
+
+	TArray<TWeakObjectPtr<UPrimitiveComponent>> ScanComponents;
+
+	TArray<bool> HasScanHit;
+
+	int32 Num() const { return Locations.Num(); }
+
+	/** Returns the new agent's index */
+	int32 Add(const FVector& InLocation, const FVector& InForward);
+
+	/** Moves the last agent to InIndex */
+	void RemoveAtSwap(int32 InIndex);
+
+	void Empty();
+};
+
+/** Climbing for large crowds, with no actor nor component per climber. The agents' state lives in columns,
+	the frame runs a few passes over all of them in parallel chunks: move, scan, classify and climb.
+	The passes use the rules of FClimbingCore, an agent climbs as a UClimbingComponent on the Low LOD would,
+	but it doesn't follow ledges and it is put back on the ground when it lets go. Agents don't collide while walking,
+	the game steers them (e.g. along navigation paths). Agents can be turned into actors and back, e.g. when they come close to the players */
+UCLASS()
+class WALLCLIMB_API UClimbingCrowdSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Returns the agent's handle, stable until it is removed */
+	int32 AddAgent(const FVector& InLocation, const FRotator& InRotation);
+
+	/** Takes over a climber's state. The actor is left as it is, to be hidden, pooled or destroyed by the caller.
+		Returns the agent's handle, INDEX_NONE if the climber isn't set up */
+	int32 AddAgentFromClimber(UClimbingComponent* InClimber);
+
+	/** Moves the climber's owner where the agent is, hands the agent's state over to it and removes the agent */
+	bool MoveAgentToClimber(int32 InAgent, UClimbingComponent* InClimber);
+
+	void RemoveAgent(int32 InAgent);
+
+	bool IsValidAgent(int32 InAgent) const;
+
+	/** Walking velocity, the agent turns to face it. Ignored while on the wall */
+	void SetAgentVelocity(int32 InAgent, const FVector& InVelocity);
+
+	/** Climbs on from the ledge, as FClimbingCore::JumpPressed */
+	void JumpAgent(int32 InAgent);
+
+	/** Lets go of the ledge, the agent is put back on the ground */
+	void ReleaseAgent(int32 InAgent);
+
+	FVector GetAgentLocation(int32 InAgent) const;
+
+	EClimbingCrowdState GetAgentState(int32 InAgent) const;
+
+	int32 NumAgents() const { return Agents.Num(); }
+
+	/** All agents at once, e.g. to update instanced meshes. Not in handle order */
+	const FClimbingCrowdAgents& GetAgents() const { return Agents; }
+
+	/** Stops the world from ticking the subsystem, so a tool can call Tick itself (e.g. to time it) */
+	void SetTickedManually(bool InTickedManually) { IsTickedManually = InTickedManually; }
+
+	/** Rules of all the agents */
+	FClimbingSettings Settings;
+
+	/** Capsule of all the agents, the default character's */
+	float AgentRadius = 34.f;
+
+	float AgentHalfHeight = 88.f;
+
+	/** Above the location */
+	float AgentChestHeight = 44.f;
+
+	float AgentWalkableFloorZ = 0.71f;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	/** Agents per parallel task, their columns stay in the cache of one worker */
+	static const int32 ChunkSize = 64;
+
+	int32 GetAgentIndex(int32 InAgent) const;
+
+	void MoveAgents(float InDeltaTime);
+
+	/** Scan rays of the walking agents */
+	void ScanAgents();
+
+	/** Vectorized classification of the scan hits, climbable ones start a climb */
+	void ClassifyScans();
+
+	/** Ledge search, hanging and climbed distance of the climbing agents */
+	void UpdateClimbs();
+
+	void StartClimb(int32 InIndex);
+
+	/** Back on the ground under the agent, or where its climb started if there is none. Safe off the game thread */
+	void DropAgent(int32 InIndex);
+
+	/** Runs InBody over every agent in parallel chunks */
+	void ForEachChunk(TFunctionRef<void(int32 InBegin, int32 InEnd)> InBody) const;
+
+private:
+	FClimbingCrowdAgents Agents;
+
+	/** AgentIndices[Handle] is the agent's index, INDEX_NONE for a free handle. AgentHandles is the other way around */
+	TArray<int32> AgentIndices;
+
+	TArray<int32> AgentHandles;
+
+	TArray<int32> FreeHandles;
+
+	/** Per frame buffers, kept to avoid reallocations. Surfaces[i] is the scan hit of agent ScannedAgents[i] */
+	FClimbingSurfaceBatch Surfaces;
+
+	TArray<int32> ScannedAgents;
+
+	TArray<bool> Climbable;
+
+	bool IsTickedManually = false;
+};
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/ThreadSafeCounter.h"
+
+enum class EClimbingLOD : uint8;
+
+/** Climbing transitions whose latency is measured, as the player feels it */
+enum class EClimbingLatency : uint8
+{
+	/** First scan hit on a climbable wall, climbing on hit allowed, to the climb start */
+	ScanToClimb,
+	/** Climb start to the grab of the ledge */
+	ClimbToGrab,
+	/** Hang release to the landing */
+	ReleaseToLanding,
+
+	Num
+};
+
+/** Fixed buckets of lock-free counters, safe to add to from any thread.
+	One bucket per value below 16, then each power of two is split in 8, so a bucket is at most an eighth of its values wide.
+	The last one counts everything from 2^MaxExponent */
+class WALLCLIMB_API FClimbingLatencyHistogram
+{
+public:
+	static const int32 NumLinearBuckets = 16;
+
+	static const int32 NumSubBuckets = 8;
+
+	static const int32 MaxExponent = 20;
+
+	static const int32 NumBuckets = NumLinearBuckets + (MaxExponent - 4) * NumSubBuckets + 1;
+
+	void Add(uint32 InValue);
+
+	int32 GetCount(int32 InBucket) const { return Buckets[InBucket].GetValue(); }
+
+	int32 GetTotal() const;
+
+	/** Smallest value of a bucket */
+	static uint32 GetBucketMin(int32 InBucket);
+
+	/** Largest value of a bucket, MAX_uint32 for the last one */
+	static uint32 GetBucketMax(int32 InBucket);
+
+	/** Upper bound of the bucket the percentile falls in, 0 if empty */
+	uint32 GetPercentile(float InPercentile) const;
+
+	void Reset();
+
+private:
+	FThreadSafeCounter Buckets[NumBuckets];
+};
+
+/** Latencies of the climbers of one world, in milliseconds of world time and in frames, for each LOD.
+	Kept by the world's UClimbingSubsystem, so a listen server and its clients aren't mixed. See the Climbing.Latency command */
+class WALLCLIMB_API FClimbingLatencyStats
+{
+public:
+	static const int32 NumLODs = 4;
+
+	void Record(EClimbingLatency InLatency, EClimbingLOD InLOD, float InSeconds, uint64 InFrames);
+
+	/** A climb started, counted to tell how often they are aborted */
+	void CountClimb(EClimbingLOD InLOD);
+
+	/** Climbs that ran out of distance with a location to grab in sight */
+	void CountAbortedGrabs(EClimbingLOD InLOD, uint32 InCount);
+
+	const FClimbingLatencyHistogram& GetMilliseconds(EClimbingLatency InLatency, EClimbingLOD InLOD) const;
+
+	const FClimbingLatencyHistogram& GetFrames(EClimbingLatency InLatency, EClimbingLOD InLOD) const;
+
+	/** InWorldName starts every line */
+	void Print(const FString& InWorldName) const;
+
+	/** Every bucket as a row, see CsvHeader */
+	void AppendCsv(const FString& InWorldName, FString& InOutContent) const;
+
+	static const TCHAR* CsvHeader;
+
+	void Reset();
+
+private:
+	FClimbingLatencyHistogram MillisecondHistograms[(int32)EClimbingLatency::Num][NumLODs];
+
+	FClimbingLatencyHistogram FrameHistograms[(int32)EClimbingLatency::Num][NumLODs];
+
+	FThreadSafeCounter NumClimbs[NumLODs];
+
+	FThreadSafeCounter NumAbortedGrabs[NumLODs];
+};
+
+/** Start times of the transitions a climber is in, to be ended or cancelled */
+class WALLCLIMB_API FClimbingLatencyTracker
+{
+public:
+	/** Where the latencies go, the stats of the climber's world. Nothing is recorded without */
+	void SetStats(FClimbingLatencyStats* InStats) { Stats = InStats; }
+
+	FClimbingLatencyStats* GetStats() const { return Stats; }
+
+	/** Starts measuring, unless it already is */
+	void Start(EClimbingLatency InLatency, float InTime);
+
+	/** Records the latency, if it was being measured */
+	void Stop(EClimbingLatency InLatency, EClimbingLOD InLOD, float InTime);
+
+	void Cancel(EClimbingLatency InLatency);
+
+	bool IsStarted(EClimbingLatency InLatency) const { return StartTimes[(int32)InLatency] >= 0.f; }
+
+private:
+	float StartTimes[(int32)EClimbingLatency::Num] = { -1.f, -1.f, -1.f };
+
+	uint64 StartFrames[(int32)EClimbingLatency::Num] = {};
+
+	FClimbingLatencyStats* Stats = nullptr;
+};
@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ClimbingLimbTargets.generated.h"
+
+/** Limbs with an IK target while on the wall */
+UENUM(BlueprintType)
+enum class EClimbingLimb : uint8
+{
+	LeftHand		UMETA(DisplayName = "Left Hand"),
+	RightHand		UMETA(DisplayName = "Right Hand"),
+	LeftFoot		UMETA(DisplayName = "Left Foot"),
+	RightFoot		UMETA(DisplayName = "Right Foot"),
+
+	Num				UMETA(Hidden)
+};
+
+/** Where a limb touches the wall or the ledge */
+USTRUCT(BlueprintType)
+struct WALLCLIMB_API FClimbingLimbTarget
+{
+	GENERATED_BODY()
+
+	/** World space */
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	FVector Location = FVector::ZeroVector;
+
+	/** Of the touched surface, for the limb's orientation */
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	FVector Normal = FVector::ZeroVector;
+
+	/** Nothing in reach, the limb is left to the animation */
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	bool HasContact = false;
+};
+
+/** IK targets of the hands and feet, copied as a whole. See UClimbingComponent::GetLimbTargets */
+USTRUCT(BlueprintType)
+struct WALLCLIMB_API FClimbingLimbTargets
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	FClimbingLimbTarget LeftHand;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	FClimbingLimbTarget RightHand;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	FClimbingLimbTarget LeftFoot;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	FClimbingLimbTarget RightFoot;
+
+	/** Changes with every new set of probes, e.g. to blend from the previous targets */
+	UPROPERTY(BlueprintReadOnly, Category = "Climbing")
+	int32 Revision = 0;
+
+	FClimbingLimbTarget& Get(EClimbingLimb InLimb)
+	{
+		FClimbingLimbTarget* Targets[] = { &LeftHand, &RightHand, &LeftFoot, &RightFoot };
+		return *Targets[(int32)InLimb];
+	}
+
+	const FClimbingLimbTarget& Get(EClimbingLimb InLimb) const
+	{
+		return const_cast<FClimbingLimbTargets*>(this)->Get(InLimb);
+	}
+};
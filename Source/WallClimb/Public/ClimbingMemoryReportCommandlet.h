@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClimbingMemoryReportCommandlet.generated.h"
+
+/** Reports the bytes per climbing component after the climbs of the benchmark's world, and the size of what they share,
+	e.g. with -Climbers=1000,5000. Compare with a run of the same command on an earlier build.
+	Usage: -run=ClimbingMemoryReport -nullrhi [-Climbers=1000] [-Frames=600] */
+UCLASS()
+class WALLCLIMB_API UClimbingMemoryReportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClimbingMemoryReportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** Logs the bytes per component of InNumClimbers climbers, once driven for InNumFrames */
+	void RunMemoryReport(int32 InNumClimbers, int32 InNumFrames);
+};
@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "ClimbingMovementComponent.generated.h"
+
+/** Custom movement modes of UClimbingMovementComponent */
+UENUM(BlueprintType)
+enum class EClimbingMovementMode : uint8
+{
+	None			UMETA(Hidden),
+	/** Up the wall at the climbing velocity */
+	Climb			UMETA(DisplayName = "Climb"),
+	/** Still on the ledge, only moved by the climbing rules */
+	Hang			UMETA(DisplayName = "Hang")
+};
+
+/** Character movement with climbing and hanging as custom modes. UClimbingComponent drives it when the character uses it:
+	the climb velocity and the moves the climbing rules make to the body are taken by the mode's phys function,
+	so all the climbing motion is a single swept, sub-stepped movement pass, predicted and smoothed as any other */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class WALLCLIMB_API UClimbingMovementComponent : public UCharacterMovementComponent
+{
+	GENERATED_BODY()
+
+	friend class FSavedMove_Climbing;
+
+public:
+	/** Climbs at InVelocity, from the next movement pass */
+	void StartClimbMovement(const FVector& InVelocity);
+
+	/** Holds still on the wall */
+	void StartHangMovement();
+
+	/** Back to walking, falling if there is no floor */
+	void StopClimbMovement();
+
+	/** Moves the body by InDelta in the next movement pass, swept. Only while in a climbing mode */
+	void AddClimbMove(const FVector& InDelta);
+
+	/** Moves added and not made yet */
+	const FVector& GetPendingClimbMove() const { return PendingClimbMove; }
+
+	/** Stops the climb with the updated component at height InZ instead of passing it, then calls OnClimbTargetReached.
+		Dropped when the Climb mode is left */
+	void SetClimbTarget(float InZ);
+
+	void ClearClimbTarget() { HasClimbTarget = false; }
+
+	/** The climb got to its target. Not called for the moves replayed after a correction */
+	FSimpleMulticastDelegate OnClimbTargetReached;
+
+	UFUNCTION(BlueprintPure, Category = "Climbing")
+	bool IsClimbMovement() const;
+
+	UFUNCTION(BlueprintPure, Category = "Climbing")
+	EClimbingMovementMode GetClimbingMovementMode() const;
+
+	// UCharacterMovementComponent
+	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+	virtual class FNetworkPredictionData_Client* GetPredictionData_Client() const override;
+
+protected:
+	virtual void PhysCustom(float deltaTime, int32 Iterations) override;
+	virtual void OnMovementModeChanged(EMovementMode PreviousMovementMode, uint8 PreviousCustomMode) override;
+
+	/** Sub-stepped as the other modes, by MaxSimulationTimeStep and MaxSimulationIterations */
+	void PhysClimbing(float deltaTime, int32 Iterations);
+
+	/** Swept move along the wall, sliding on what blocks it */
+	void MoveAlongWall(const FVector& InDelta, float InDeltaTime);
+
+private:
+	/** Requested mode, sent with the saved moves as compressed flags */
+	EClimbingMovementMode WantedClimbingMode = EClimbingMovementMode::None;
+
+	/** On the server, whether a remote client may be moved in InMode: its climbing component has to be in that state too.
+		Always true for the moves of locally controlled characters */
+	bool IsClimbingModeAllowed(EClimbingMovementMode InMode) const;
+
+	/** Velocity of the Climb mode */
+	FVector ClimbVelocity = FVector::ZeroVector;
+
+	/** Moves of the climbing rules, made by the next movement pass */
+	FVector PendingClimbMove = FVector::ZeroVector;
+
+	bool HasClimbTarget = false;
+
+	float ClimbTargetZ = 0.f;
+};
+
+/** Saved move with the requested climbing mode. Moves of different modes are not combined */
+class WALLCLIMB_API FSavedMove_Climbing : public FSavedMove_Character
+{
+public:
+	typedef FSavedMove_Character Super;
+
+	virtual void Clear() override;
+	virtual uint8 GetCompressedFlags() const override;
+	virtual bool CanCombineWith(const FSavedMovePtr& NewMove, ACharacter* InCharacter, float MaxDelta) const override;
+	virtual void SetMoveFor(ACharacter* C, float InDeltaTime, FVector const& NewAccel, class FNetworkPredictionData_Client_Character& ClientData) override;
+	virtual void PrepMoveFor(ACharacter* C) override;
+
+	EClimbingMovementMode WantedClimbingMode = EClimbingMovementMode::None;
+
+	/** Restored when the move is replayed after a correction */
+	FVector ClimbVelocity = FVector::ZeroVector;
+};
+
+class WALLCLIMB_API FNetworkPredictionData_Client_Climbing : public FNetworkPredictionData_Client_Character
+{
+public:
+	typedef FNetworkPredictionData_Client_Character Super;
+
+	FNetworkPredictionData_Client_Climbing(const UCharacterMovementComponent& ClientMovement);
+
+	virtual FSavedMovePtr AllocateNewMove() override;
+};
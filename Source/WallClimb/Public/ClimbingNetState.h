@@ -0,0 +1,67 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/NetSerialization.h"
+#include "ClimbingCore.h"
+#include "ClimbingNetState.generated.h"
+
+class UPrimitiveComponent;
+
+/** Replicated climbing state. The grab location is sent as a ledge reference, a rim segment and a distance
+	along it, full vectors only go when the grabbed primitive has no ledge (e.g. it is tilted) */
+USTRUCT()
+struct WALLCLIMB_API FClimbingNetState
+{
+	GENERATED_BODY()
+
+	bool Climbing = false;
+
+	bool Hanging = false;
+
+	/** EClimbDirection, for the animations */
+	uint8 Direction = 0;
+
+	/** Whether the grab location is on the rim of Ledge, or sent as GrabLocation */
+	bool IsOnLedge = false;
+
+	/** Primitive with the grab location on its top */
+	TWeakObjectPtr<UPrimitiveComponent> Ledge;
+
+	/** Rim segment of the ledge, as in FLedgeShape */
+	uint8 Segment = 0;
+
+	/** Along the rim segment, in cm */
+	uint16 Distance = 0;
+
+	/** From the rim into the ledge, in cm */
+	uint8 Inset = 0;
+
+	FVector_NetQuantize GrabLocation = FVector::ZeroVector;
+
+	/** Yaw of the wall's normal, compressed to a byte */
+	uint8 NormalYaw = 0;
+
+	/** Quantizes a core state. InLedge is the primitive the grab location is expected to be on */
+	void Encode(const FClimbingStateSnapshot& InSnapshot, uint8 InDirection, const UPrimitiveComponent* InLedge);
+
+	/** Back to a core state. Returns false while the referenced ledge is not resolved on this side */
+	bool Decode(FClimbingStateSnapshot& OutSnapshot) const;
+
+	bool NetSerialize(FArchive& Ar, class UPackageMap* Map, bool& bOutSuccess);
+
+	bool operator==(const FClimbingNetState& Other) const;
+
+	bool operator!=(const FClimbingNetState& Other) const { return !(*this == Other); }
+};
+
+template<>
+struct TStructOpsTypeTraits<FClimbingNetState> : public TStructOpsTypeTraitsBase2<FClimbingNetState>
+{
+	enum
+	{
+		WithNetSerializer = true,
+		WithIdenticalViaEquality = true
+	};
+};
@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "PhysicalMaterials/PhysicalMaterial.h"
+#include "ClimbingPhysicalMaterial.generated.h"
+
+/** Physical material with the climbing rules of the surfaces using it */
+UCLASS()
+class WALLCLIMB_API UClimbingPhysicalMaterial : public UPhysicalMaterial
+{
+	GENERATED_BODY()
+
+public:
+	/** Cleared for e.g. glass or ice, nothing climbs a primitive with this as its simple collision material */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing")
+	bool IsClimbable = true;
+};
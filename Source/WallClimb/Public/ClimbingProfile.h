@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ClimbingCore.h"
+#include "ClimbingProfile.generated.h"
+
+/** Tuning of a whole archetype of climbers, e.g. every guard of a level, shared by their UClimbingComponents instead of copied
+	into each of them. Read only at runtime: the core's settings are derived from it once, when it is loaded or edited */
+UCLASS(BlueprintType)
+class WALLCLIMB_API UClimbingProfile : public UDataAsset
+{
+	GENERATED_BODY()
+
+public:
+	/** Profile of the components that have none, with the default values */
+	static const UClimbingProfile& GetDefaultProfile();
+
+	/** The core's settings but the per instance ones, IsClimbOnHitAllowed and ScanWithRay */
+	const FClimbingSettings& GetSettings() const { return Settings; }
+
+	/** Derives the settings from the properties. Only needed for a profile changed at runtime, e.g. created by a tool */
+	void UpdateSettings();
+
+	virtual void PostInitProperties() override;
+	virtual void PostLoad() override;
+#if WITH_EDITOR
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+#endif
+
+	/** Max height that can be climbed */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Climbing Distance"))
+	float MaxClimbingDistance = 200.f;
+
+	/** Speed with which a character moves on the walls vertically */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Climbing Speed"))
+	float MaxClimbingSpeed = 200.f;
+
+	/** Speed with which a character moves on the walls sideways */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Climbing Strafe Speed"))
+	float MaxClimbingStrafeSpeed = 200.f;
+
+	/** An angle of capturing a surface */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Max Capture Angle", ClampMin = "0", ClampMax = "45"))
+	float MaxSurfaceCaptureAngle = 45.f;
+
+	/** While hanging, slide along the rim of the grabbed ledge instead of tracing the wall on every move.
+		Needs baked ledges or the ledge cache */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Use Ledge Following"))
+	bool UseLedgeFollowing = true;
+
+	/** While following a ledge, go around its outer corners instead of stopping at them */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Climb Around Corners"))
+	bool ClimbAroundCorners = true;
+
+	/** Probes across the character's width looking for a ledge to grab. With more than one, the ledges are searched
+		in a single overlap instead of a trace down, which finds narrow and irregular ledges a single ray misses */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Grab Probe Columns", ClampMin = "1", ClampMax = "8"))
+	int32 GrabProbeColumns = 5;
+
+	/** Probes from the wall into the ledge */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Setup", meta = (DisplayName = "Grab Probe Rows", ClampMin = "1", ClampMax = "4"))
+	int32 GrabProbeRows = 2;
+
+	/** Distance to the closest player's view at which the significance reaches zero */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|LOD", meta = (DisplayName = "LOD Max Distance", ClampMin = "1"))
+	float LODMaxDistance = 8000.f;
+
+	/** Part of the significance kept by characters that were not rendered lately */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|LOD", meta = (DisplayName = "Hidden Significance Scale", ClampMin = "0", ClampMax = "1"))
+	float HiddenSignificanceScale = 0.5f;
+
+	/** Distance around the scan capsule in which a wall keeps the component awake */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Sleep", meta = (DisplayName = "Wake Distance", ClampMin = "0"))
+	float WakeDistance = 100.f;
+
+	/** Time between the overlaps looking for a wall in reach, the update interval while asleep */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Sleep", meta = (DisplayName = "Proximity Check Interval", ClampMin = "0.01"))
+	float ProximityCheckInterval = 0.25f;
+
+	/** How long the owning client's predicted state may disagree with the server's, before it is corrected to it */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|Network", meta = (DisplayName = "Max Prediction Age"))
+	float MaxPredictionAge = 0.5f;
+
+	/** Distance of each hand from the middle of the body, along the wall */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|IK", meta = (DisplayName = "Hand Spacing", ClampMin = "0"))
+	float HandSpacing = 20.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|IK", meta = (DisplayName = "Foot Spacing", ClampMin = "0"))
+	float FootSpacing = 15.f;
+
+	/** Above the bottom of the capsule */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|IK", meta = (DisplayName = "Foot Height", ClampMin = "0"))
+	float FootHeight = 15.f;
+
+	/** The limb targets are kept until the body moves further than that, or turns */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Climbing|IK", meta = (DisplayName = "Limb Probe Move Threshold", ClampMin = "0"))
+	float LimbProbeMoveThreshold = 5.f;
+
+private:
+	FClimbingSettings Settings;
+};
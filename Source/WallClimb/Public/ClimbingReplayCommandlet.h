@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "ClimbingReplayCommandlet.generated.h"
+
+/** Runs a Climbing.Capture file with no world, and fails if the rules don't take the recorded decisions again.
+	-Frames=<N> stops after N frames, e.g. to bisect, -KeepGoing counts every mismatch.
+	Usage: -run=ClimbingReplay -File=<File> [-Frames=<N>] [-KeepGoing] */
+UCLASS()
+class WALLCLIMB_API UClimbingReplayCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UClimbingReplayCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** Returns false if the replay went off the recorded decisions */
+	bool RunReplay(const FString& InPath, int64 InMaxFrames, bool InStopOnMismatch) const;
+};
@@ -0,0 +1,90 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "LedgeGraph.h"
+#include "ClimbingRouteComponent.generated.h"
+
+class UClimbingComponent;
+
+/** Climbs an AI character to a goal: plans the route with ULedgeGraphSubsystem,
+	then drives the owner's UClimbingComponent through it, as a player's input would */
+UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
+class WALLCLIMB_API UClimbingRouteComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UClimbingRouteComponent();
+
+	/** Plans a route to InGoal and follows it. The route is planned again from where the character is, if it gets lost */
+	UFUNCTION(BlueprintCallable, Category = "Climbing|Route")
+	void ClimbTo(const FVector& InGoal);
+
+	/** Stops following the route, the character stays where it is */
+	UFUNCTION(BlueprintCallable, Category = "Climbing|Route")
+	void StopRoute();
+
+	UFUNCTION(BlueprintPure, Category = "Climbing|Route")
+	bool IsFollowingRoute() const { return IsFollowing; }
+
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+protected:
+	virtual void BeginPlay() override;
+
+	/** A step taking longer than that means the character is stuck, the route is then planned again */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Route", meta = (DisplayName = "Replan Delay"))
+	float ReplanDelay = 3.f;
+
+	/** How far from a ledge's rim the grab location may be, to be hanging on it */
+	UPROPERTY(BlueprintReadWrite, EditDefaultsOnly, Category = "Climbing|Route", meta = (DisplayName = "Hang Tolerance"))
+	float HangTolerance = 50.f;
+
+private:
+	void RequestRoute();
+
+	void OnRouteFound(int32 InRequestId, bool InFound, const TArray<FLedgePathStep>& InRoute);
+
+	void FollowRoute(const FLedgeGraph& InGraph);
+
+	/** Moves while hanging on InNode, to make the next step */
+	void MakeHangingStep(const FLedgeGraph& InGraph, int32 InNode, const FLedgePathStep& InStep);
+
+	/** Walks to the wall below the first ledge, the climbing component grabs it on hit */
+	void ApproachWall(const FLedgeGraph& InGraph, const FLedgePathStep& InStep);
+
+	void AdvanceStep();
+
+	void FinishRoute();
+
+private:
+	UPROPERTY()
+	UClimbingComponent* Climber;
+
+	FVector Goal = FVector::ZeroVector;
+
+	TArray<FLedgePathStep> Route;
+
+	/** Graph the route was planned in */
+	TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe> RouteGraph;
+
+	/** Ledge the route starts from, INDEX_NONE when starting on the ground */
+	int32 StartNode = INDEX_NONE;
+
+	/** Next step of Route to make */
+	int32 Step = 0;
+
+	/** Time spent on the current step */
+	float StepTime = 0.f;
+
+	/** Request the route is waited from, INDEX_NONE if none */
+	int32 PendingRequest = INDEX_NONE;
+
+	bool IsFollowing = false;
+
+	/** The climbing component's setting, restored when the route is finished */
+	bool WasClimbOnHitAllowed = false;
+};
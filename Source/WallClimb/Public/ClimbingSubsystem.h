@@ -0,0 +1,115 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Engine/Public/CollisionQueryParams.h"
+#include "ClimbingCore.h"
+#include "ClimbingComponent.h"
+#include "ClimbingLatency.h"
+#include "ClimbingSubsystem.generated.h"
+
+/** Everything a TickTrace and its classification need, gathered on the game thread */
+struct FClimbingScanQuery
+{
+	FVector Location;
+
+	FQuat Rotation;
+
+	FCollisionShape Shape;
+
+	FVector ActorForwardVector;
+
+	float WalkableFloorZ;
+
+	float CaptureAngleCos;
+
+	const AActor* IgnoredActor;
+
+	/** A line trace from Location to RayEnd replaces the sweep, for the low climbing LODs */
+	bool IsRay;
+
+	FVector RayEnd;
+};
+
+struct FClimbingScanResult
+{
+	FHitResult HitResult;
+
+	bool HasHit;
+
+	bool IsClimbable;
+};
+
+/** Ticks all registered climbers at once: their scene queries run in parallel, 
+	the state changes are then applied on the game thread in a single pass */
+UCLASS()
+class WALLCLIMB_API UClimbingSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	void RegisterClimber(UClimbingComponent* InClimber);
+
+	void UnregisterClimber(UClimbingComponent* InClimber);
+
+	int32 NumClimbers() const { return Climbers.Num(); }
+
+	/** Query scratch of all the climbers of the world, batched or not */
+	FClimbingComponentScratch& GetScratch() { return Scratch; }
+
+	/** Latencies of the climbers of this world only, a listen server apart from its clients */
+	FClimbingLatencyStats& GetLatency() { return Latency; }
+
+	/** Stops the world from ticking the subsystem, so a tool can call Tick itself (e.g. to time it) */
+	void SetTickedManually(bool InTickedManually) { IsTickedManually = InTickedManually; }
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	/** Fills the query for a climber, returns false if it has nothing to scan this frame */
+	bool GatherQuery(UClimbingComponent* InClimber, FClimbingScanQuery& OutQuery) const;
+
+	void RunQuery(const FClimbingScanQuery& InQuery, FClimbingScanResult& OutResult) const;
+
+private:
+	UPROPERTY()
+	TArray<UClimbingComponent*> Climbers;
+
+	/** Per frame buffers, kept to avoid reallocations */
+	TArray<FClimbingScanQuery> Queries;
+
+	TArray<FClimbingScanResult> Results;
+
+	/** Climbers updated this frame, per their climbing LOD. Weak, the updates of the others may destroy them */
+	TArray<TWeakObjectPtr<UClimbingComponent>> DueClimbers;
+
+	/** Index in Queries of the scan of DueClimbers[i], INDEX_NONE if it has none this frame */
+	TArray<int32> DueQueries;
+
+	/** Climbers that left during Tick, removed from Climbers once it's done with them */
+	TArray<UClimbingComponent*> UnregisteredWhileTicking;
+
+	/** Hits of the frame, classified at once. Surfaces[i] is for Results[HitResults[i]] */
+	FClimbingSurfaceBatch Surfaces;
+
+	TArray<int32> HitResults;
+
+	TArray<bool> Climbable;
+
+	bool IsTickedManually = false;
+
+	bool IsTicking = false;
+
+	FClimbingComponentScratch Scratch;
+
+	FClimbingLatencyStats Latency;
+};
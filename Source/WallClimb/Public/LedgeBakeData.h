@@ -0,0 +1,92 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+#include "LedgeGeometry.h"
+#include "LedgeBakeData.generated.h"
+
+/** Ledge as it is stored on disk. Coordinates are in LedgeQuantizationStep units */
+struct FQuantizedLedge
+{
+	/** First rim point, Z is the top of the ledge */
+	FIntVector Anchor = FIntVector::ZeroValue;
+
+	/** X, Y pairs of the remaining rim points, relative to Anchor */
+	TArray<int16> Deltas;
+
+	/** Outward normal of each segment as a yaw, 256 steps per turn */
+	TArray<uint8> NormalYaws;
+
+	friend FArchive& operator<<(FArchive& Ar, FQuantizedLedge& Ledge)
+	{
+		Ar << Ledge.Anchor << Ledge.Deltas << Ledge.NormalYaws;
+		return Ar;
+	}
+};
+
+/** Which ledges came from which actor, so a bake can skip unchanged actors and the queries can tell the baked actors.
+	Only actors entirely made of static primitives with a readable rim get one */
+struct FLedgeBakeActorRecord
+{
+	/** Actor name, unique inside its level */
+	FName ActorName;
+
+	/** Hash of everything that affects the actor's ledges */
+	uint32 GeometryHash = 0;
+
+	int32 FirstLedge = 0;
+
+	int32 NumLedges = 0;
+
+	friend FArchive& operator<<(FArchive& Ar, FLedgeBakeActorRecord& Record)
+	{
+		Ar << Record.ActorName << Record.GeometryHash << Record.FirstLedge << Record.NumLedges;
+		return Ar;
+	}
+};
+
+/** Baked grabbable ledges of one level. Written by ULedgeBakeCommandlet, referenced by the level's ALedgeDataActor */
+UCLASS()
+class WALLCLIMB_API ULedgeBakeData : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Size of a quantization step, in cm */
+	static constexpr float LedgeQuantizationStep = 1.f;
+
+	virtual void Serialize(FArchive& Ar) override;
+
+	virtual void PostLoad() override;
+
+	/** Replaces the baked content, records must be sorted by actor name */
+	void SetBakedData(TArray<FLedgeBakeActorRecord>&& InRecords, TArray<FQuantizedLedge>&& InLedges);
+
+	const TArray<FLedgeBakeActorRecord>& GetRecords() const { return Records; }
+
+	/** Record of the actor, nullptr if it wasn't baked */
+	const FLedgeBakeActorRecord* FindRecord(FName InActorName) const;
+
+	const TArray<FQuantizedLedge>& GetQuantizedLedges() const { return QuantizedLedges; }
+
+	/** Dequantized ledges, in world space */
+	const TArray<FLedgeShape>& GetLedges() const { return Ledges; }
+
+	/** Returns false if the ledge doesn't fit the quantization range */
+	static bool Quantize(const FLedgeShape& InShape, FQuantizedLedge& OutLedge);
+
+	static void Dequantize(const FQuantizedLedge& InLedge, FLedgeShape& OutShape);
+
+private:
+	void RebuildLedges();
+
+private:
+	TArray<FLedgeBakeActorRecord> Records;
+
+	TArray<FQuantizedLedge> QuantizedLedges;
+
+	/** Runtime copy of QuantizedLedges, never serialized */
+	TArray<FLedgeShape> Ledges;
+};
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "LedgeGeometry.h"
+#include "LedgeCacheSubsystem.generated.h"
+
+/** Grab geometry of one climbable actor */
+struct FLedgeCacheEntry
+{
+	/** One rim per grabbable primitive of the actor */
+	TArray<FLedgeShape, TInlineAllocator<2>> Shapes;
+
+	/** World bounds of the blocking primitives whose rim can't be told from their collision. Grabs over them are traced */
+	TArray<FBox, TInlineAllocator<1>> UnresolvedBounds;
+
+	/** Same as AActor::GetActorBounds, without walking the components on every query */
+	FBox ActorBounds = FBox(ForceInit);
+
+	/** Set when the actor moved since the shapes were extracted */
+	bool IsStale = false;
+
+	/** Bumped on every extraction, so users of the shapes can tell they are outdated */
+	uint32 Revision = 0;
+
+	/** Access stamp for the LRU eviction */
+	uint64 LastUsed = 0;
+
+	/** Extracted primitives we listen to for transform updates. A child moved relative to the root fires its own */
+	TArray<TPair<TWeakObjectPtr<USceneComponent>, FDelegateHandle>, TInlineAllocator<2>> TransformBindings;
+};
+
+/** Shared runtime cache of the top edges of climbable actors.
+	Extracts the geometry the first time an actor is climbed and answers grab queries without physics */
+UCLASS()
+class WALLCLIMB_API ULedgeCacheSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Looks for a grabbable top edge of InActor above InProbe, within [InMinZ, InMaxZ).
+		Returns false if the actor has no rim there, the caller should fall back to a trace.
+		Only the actor's own geometry is known: the caller has to check that nothing else lies on the rim */
+	bool FindGrabLocation(const AActor* InActor, const FVector& InProbe, float InMinZ, float InMaxZ, FVector& OutLocation);
+
+	/** Rim of InActor with its top at InLocation.Z, closest to InLocation. OutRevision is to be checked with IsCurrent */
+	const FLedgeShape* FindLedge(const AActor* InActor, const FVector& InLocation, uint32& OutRevision);
+
+	/** Whether the shapes of the given revision are still the actor's ones */
+	bool IsCurrent(const AActor* InActor, uint32 InRevision) const;
+
+	/** Cached AActor::GetActorBounds, invalidated when the actor moves */
+	bool GetActorBounds(const AActor* InActor, FVector& OutOrigin, FVector& OutExtent);
+
+	/** Drops the cached geometry of an actor */
+	void Invalidate(const AActor* InActor);
+
+	int32 Num() const { return Entries.Num(); }
+
+private:
+	/** Returns an up to date entry for the actor, extracting it if needed */
+	const FLedgeCacheEntry* FindOrExtract(const AActor* InActor);
+
+	void Extract(const AActor* InActor, FLedgeCacheEntry& OutEntry);
+
+	void EvictLeastRecentlyUsed();
+
+	/** Listens to the transform updates of the entry's primitives, from scratch */
+	void Bind(const AActor* InActor, FLedgeCacheEntry& InEntry);
+
+	void Unbind(FLedgeCacheEntry& InEntry);
+
+	void OnTransformUpdated(USceneComponent* InComponent, EUpdateTransformFlags InFlags, ETeleportType InTeleport);
+
+private:
+	TMap<TWeakObjectPtr<const AActor>, FLedgeCacheEntry> Entries;
+
+	uint64 AccessCounter = 0;
+
+	uint32 RevisionCounter = 0;
+};
@@ -0,0 +1,26 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Info.h"
+#include "LedgeDataActor.generated.h"
+
+class ULedgeBakeData;
+
+/** Placed in every baked level by ULedgeBakeCommandlet.
+	Keeps the level's ledge data loaded while the level is, and registers it for the climbing queries */
+UCLASS(NotPlaceable)
+class WALLCLIMB_API ALedgeDataActor : public AInfo
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(VisibleAnywhere, Category = "Climbing")
+	ULedgeBakeData* LedgeData;
+
+protected:
+	virtual void BeginPlay() override;
+
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+};
@@ -0,0 +1,38 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UPrimitiveComponent;
+
+/** Top rim of a climbable primitive, as seen from above */
+struct WALLCLIMB_API FLedgeShape
+{
+	/** Rim corners in world space, counter-clockwise when seen from above */
+	TArray<FVector2D, TInlineAllocator<4>> Points;
+
+	/** Outward normal of each rim segment, segment i goes from Points[i] to Points[i + 1] */
+	TArray<FVector2D, TInlineAllocator<4>> Normals;
+
+	/** Height of the rim */
+	float TopZ = 0.f;
+
+	/** Point in polygon check for the rim footprint */
+	bool ContainsPoint(const FVector2D& InPoint) const;
+
+	/** Fixes the winding and fills Normals from Points */
+	void ComputeNormals();
+
+	/** Casts a horizontal ray against the outer side of the rim segments.
+		Returns the distance along InDirection, or a negative value on a miss */
+	float RaycastSides(const FVector2D& InStart, const FVector2D& InDirection, float InMaxDistance, int32& OutSegment) const;
+
+	/** Horizontal distance from a point to the closest rim segment */
+	float GetRimDistance(const FVector2D& InPoint) const;
+
+	/** Builds the rim from the flat top face of a primitive's simple collision, a single box or convex element.
+		Returns false for primitives that can't be grabbed (no collision, not blocking static traces) and for the ones
+		whose rim can't be told from their collision (several elements, complex as simple, no flat top): those are traced */
+	static bool FromPrimitive(const UPrimitiveComponent* InPrimitive, FLedgeShape& OutShape);
+};
@@ -0,0 +1,148 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+struct FLedgeShape;
+
+/** Ways to get from one ledge to another, as UClimbingComponent moves */
+enum class ELedgeEdgeType : uint8
+{
+	/** Jump from the ledge, climb the wall above it and hang on the next one. From the ground for the first step */
+	ClimbUp,
+	StrafeLeft,
+	StrafeRight,
+	AroundCornerLeft,
+	AroundCornerRight,
+	/** Release the ledge and fall to the ground, only as the last step */
+	Drop
+};
+
+/** A rim segment of a ledge, where a character can hang */
+struct FLedgeGraphNode
+{
+	FVector Start;
+
+	FVector End;
+
+	/** Outward, away from the ledge */
+	FVector2D Normal;
+
+	/** Index of the ledge in the shapes the graph was built from */
+	int32 Ledge;
+
+	FVector GetCenter() const { return (Start + End) * 0.5f; }
+};
+
+struct FLedgeGraphEdge
+{
+	int32 Target;
+
+	ELedgeEdgeType Type;
+
+	float Cost;
+};
+
+/** One move of a path, Node is where it ends (INDEX_NONE for a Drop) */
+struct FLedgePathStep
+{
+	ELedgeEdgeType Type;
+
+	int32 Node;
+};
+
+/** Where a path starts and where it has to end */
+struct FLedgePathQuery
+{
+	FVector Start = FVector::ZeroVector;
+
+	FVector Goal = FVector::ZeroVector;
+
+	/** Start is a hang location on a ledge, not a location on the ground */
+	bool StartsHanging = false;
+};
+
+/** Per search buffers, reused across the queries run by one thread */
+struct FLedgePathScratch
+{
+	TArray<float> Costs;
+
+	TArray<int32> Parents;
+
+	TArray<ELedgeEdgeType> Types;
+
+	TArray<uint32> Visits;
+
+	uint32 Visit = 0;
+
+	TArray<TPair<float, int32>> Open;
+};
+
+/** Connectivity of the ledges a character can hang on, with the moves UClimbingComponent is able to make between them.
+	Immutable once built, so any number of threads can search it at once */
+class WALLCLIMB_API FLedgeGraph
+{
+public:
+	struct FBuildSettings
+	{
+		/** Max height climbed from a ledge or from the ground, UClimbingProfile's MaxClimbingDistance */
+		float MaxClimbingDistance = 200.f;
+
+		/** Horizontal gap between the wall below a ledge and the wall above it, or between two ledges strafed across */
+		float MaxGap = 50.f;
+
+		/** Max horizontal walk to the first wall, and from the ground under the last ledge to the goal */
+		float MaxGroundReach = 300.f;
+
+		/** Max fall of a Drop */
+		float MaxDropHeight = 500.f;
+
+		/** How close to the goal a ledge has to be to end the path */
+		float GoalRadius = 100.f;
+	};
+
+	void Build(const TArray<FLedgeShape>& InLedges, const FBuildSettings& InSettings);
+
+	int32 NumNodes() const { return Nodes.Num(); }
+
+	int32 NumEdges() const { return Edges.Num(); }
+
+	const FLedgeGraphNode& GetNode(int32 InIndex) const { return Nodes[InIndex]; }
+
+	/** Distance from a point to the rim segment of a node */
+	float GetNodeDistance(int32 InNode, const FVector& InPoint) const { return GetPointDistance(Nodes[InNode], InPoint); }
+
+	/** Node with the closest rim segment to InLocation, within InMaxDistance. INDEX_NONE if there is none */
+	int32 FindClosestNode(const FVector& InLocation, float InMaxDistance) const;
+
+	/** A* over the ledges. The path is empty if the goal is already reached */
+	bool FindPath(const FLedgePathQuery& InQuery, FLedgePathScratch& InScratch, TArray<FLedgePathStep>& OutPath) const;
+
+private:
+	void ConnectLedge(const FLedgeShape& InLedge, int32 InFirstNode, TArray<TArray<FLedgeGraphEdge>>& InOutEdges) const;
+
+	void ConnectNeighbours(int32 InNode, TArray<TArray<FLedgeGraphEdge>>& InOutEdges) const;
+
+	void GetCells(const FVector& InStart, const FVector& InEnd, float InReach, TArray<FIntPoint, TInlineAllocator<8>>& OutCells) const;
+
+	/** Closest distance between two rim segments, horizontally */
+	static float GetSegmentGap(const FLedgeGraphNode& InA, const FLedgeGraphNode& InB);
+
+	static float GetPointDistance(const FLedgeGraphNode& InNode, const FVector& InPoint);
+
+	/** Cost of a Drop from InNode to InGoal, negative if the goal can't be reached that way */
+	float GetDropCost(const FLedgeGraphNode& InNode, const FVector& InGoal) const;
+
+private:
+	FBuildSettings Settings;
+
+	TArray<FLedgeGraphNode> Nodes;
+
+	/** Edges of node i are Edges[EdgeOffsets[i]] to Edges[EdgeOffsets[i + 1]] excluded */
+	TArray<int32> EdgeOffsets;
+
+	TArray<FLedgeGraphEdge> Edges;
+
+	TMap<FIntPoint, TArray<int32>> Grid;
+};
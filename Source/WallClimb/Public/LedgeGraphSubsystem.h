@@ -0,0 +1,98 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Async/Future.h"
+#include "LedgeGraph.h"
+#include "LedgeGraphSubsystem.generated.h"
+
+/** Called on the game thread with the path found for a request, empty if the goal was already reached */
+DECLARE_DELEGATE_ThreeParams(FOnLedgePathFound, int32 /*RequestId*/, bool /*Found*/, const TArray<FLedgePathStep>& /*Path*/);
+
+/** Plans climbing routes for the AI. Requests are collected during the frame and searched
+	together on worker threads, their results are delivered on a later frame */
+UCLASS()
+class WALLCLIMB_API ULedgeGraphSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	virtual void Deinitialize() override;
+
+	/** Queues a path query, returns its id */
+	int32 RequestPath(const FLedgePathQuery& InQuery, const FOnLedgePathFound& InOnFound);
+
+	/** The graph the latest results were searched in, null until it is first built */
+	TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe> GetGraph() const { return Graph; }
+
+	/** Rebuilds the graph on the next request, e.g. after the static geometry changed */
+	void MarkGraphDirty() { IsGraphDirty = true; }
+
+	void SetBuildSettings(const FLedgeGraph::FBuildSettings& InSettings);
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	/** Queries of a batch, with their results. Owned by the worker threads while the batch runs */
+	struct FLedgePathBatch
+	{
+		TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe> Graph;
+
+		TArray<FLedgePathQuery> Queries;
+
+		TArray<TArray<FLedgePathStep>> Paths;
+
+		TArray<bool> Found;
+	};
+
+	/** A request waiting for its batch */
+	struct FLedgePathRequest
+	{
+		int32 Id;
+
+		FLedgePathQuery Query;
+
+		FOnLedgePathFound OnFound;
+	};
+
+	bool IsGraphOutdated() const;
+
+	/** Gathers the ledges on the game thread and builds the graph on a worker thread */
+	void StartGraphBuild();
+
+	void StartBatch();
+
+	void FinishBatch();
+
+	static void RunBatch(FLedgePathBatch& InOutBatch);
+
+private:
+	TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe> Graph;
+
+	TFuture<TSharedPtr<const FLedgeGraph, ESPMode::ThreadSafe>> PendingGraph;
+
+	FLedgeGraph::FBuildSettings BuildSettings;
+
+	bool IsGraphDirty = true;
+
+	/** Revision of the baked ledge data the graph was built from */
+	uint32 BakedRevision = 0;
+
+	TArray<FLedgePathRequest> Requests;
+
+	/** Requests of the running batch, Batch->Queries[i] belongs to BatchRequests[i] */
+	TArray<FLedgePathRequest> BatchRequests;
+
+	TSharedPtr<FLedgePathBatch, ESPMode::ThreadSafe> Batch;
+
+	TFuture<void> PendingBatch;
+
+	int32 NextRequestId = 0;
+};
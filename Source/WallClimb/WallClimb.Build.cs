@@ -0,0 +1,15 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class WallClimb : ModuleRules
+{
+	public WallClimb(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		// Core has the CSV profiler and the traces, Engine the commandlets. PhysicsCore is for the body setups
+		// and the physical materials, NetCore for the quantized net state. ClimbingCore has the rules the components drive
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "PhysicsCore", "NetCore", "ClimbingCore" });
+	}
+}
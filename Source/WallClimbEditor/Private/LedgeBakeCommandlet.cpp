@@ -0,0 +1,352 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "LedgeBakeCommandlet.h"
+#include "Engine/World.h"
+#include "Engine/Level.h"
+#include "Engine/LevelStreaming.h"
+#include "Engine/StaticMesh.h"
+#include "Components/StaticMeshComponent.h"
+#include "Misc/PackageName.h"
+#include "UObject/Package.h"
+
+#include "LedgeBakeData.h"
+#include "LedgeDataActor.h"
+#include "LedgeGeometry.h"
+#include "ClimbabilitySubsystem.h"
+
+namespace
+{
+	/** Anything lower is a step or a curb, not a ledge */
+	const float MinLedgeHeight = 50.f;
+
+	uint32 HashPrimitive(const UPrimitiveComponent* InPrimitive)
+	{
+		const FTransform& Transform = InPrimitive->GetComponentTransform();
+		const FVector Location = Transform.GetLocation();
+		const FQuat Rotation = Transform.GetRotation();
+		const FVector Scale = Transform.GetScale3D();
+		const FBox LocalBox = InPrimitive->CalcBounds(FTransform::Identity).GetBox();
+
+		const float Values[] =
+		{
+			Location.X, Location.Y, Location.Z,
+			Rotation.X, Rotation.Y, Rotation.Z, Rotation.W,
+			Scale.X, Scale.Y, Scale.Z,
+			LocalBox.Min.X, LocalBox.Min.Y, LocalBox.Min.Z,
+			LocalBox.Max.X, LocalBox.Max.Y, LocalBox.Max.Z
+		};
+
+		uint32 Hash = FCrc::MemCrc32(Values, sizeof(Values));
+		Hash = HashCombine(Hash, (uint32)InPrimitive->GetCollisionResponseToChannel(UClimbabilitySubsystem::GetTraceChannel()));
+		Hash = HashCombine(Hash, (uint32)UClimbabilitySubsystem::IsPrimitiveClimbable(InPrimitive));
+		Hash = HashCombine(Hash, (uint32)InPrimitive->GetCollisionEnabled());
+
+		const UStaticMeshComponent* MeshComponent = Cast<UStaticMeshComponent>(InPrimitive);
+		if (MeshComponent && MeshComponent->GetStaticMesh())
+		{
+			Hash = FCrc::StrCrc32(*MeshComponent->GetStaticMesh()->GetPathName(), Hash);
+		}
+
+		return Hash;
+	}
+
+	/** Whether every primitive of the actor the climbers could hit is static, the others would move away from their baked ledges */
+	bool IsActorStatic(AActor* InActor)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(InActor);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (Primitive->Mobility != EComponentMobility::Static && Primitive->IsCollisionEnabled() &&
+				Primitive->GetCollisionResponseToChannel(UClimbabilitySubsystem::GetTraceChannel()) == ECR_Block)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	/** Static primitives of the actor, that could hold a ledge */
+	void GetLedgePrimitives(AActor* InActor, TArray<UPrimitiveComponent*, TInlineAllocator<8>>& OutPrimitives)
+	{
+		OutPrimitives.Reset();
+
+		TInlineComponentArray<UPrimitiveComponent*> Primitives(InActor);
+		for (UPrimitiveComponent* Primitive : Primitives)
+		{
+			if (Primitive->Mobility != EComponentMobility::Static)
+			{
+				continue;
+			}
+
+			if (Primitive->Bounds.BoxExtent.Z * 2.f < MinLedgeHeight)
+			{
+				continue;
+			}
+
+			OutPrimitives.Add(Primitive);
+		}
+	}
+}
+
+ULedgeBakeCommandlet::ULedgeBakeCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 ULedgeBakeCommandlet::Main(const FString& Params)
+{
+	FString Maps;
+	if (!FParse::Value(*Params, TEXT("Map="), Maps, false))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] No map to bake. Usage: -run=LedgeBake -Map=/Game/Maps/MyMap [-Full]"), *FString(__FUNCTION__));
+		return 1;
+	}
+
+	const bool FullBake = FParse::Param(*Params, TEXT("Full"));
+
+	TArray<FString> MapNames;
+	Maps.ParseIntoArray(MapNames, TEXT(","));
+
+	int32 Failures = 0;
+	for (const FString& MapName : MapNames)
+	{
+		UPackage* MapPackage = LoadPackage(nullptr, *MapName, LOAD_None);
+		UWorld* World = MapPackage ? UWorld::FindWorldInPackage(MapPackage) : nullptr;
+		if (!(World))
+		{
+			UE_LOG(LogTemp, Error, TEXT("[%s] Can't load map %s."), *FString(__FUNCTION__), *MapName);
+			++Failures;
+			continue;
+		}
+
+		// Every level gets its own data, so it streams with the level
+		TArray<FString> LevelPackages;
+		LevelPackages.Add(MapName);
+		for (ULevelStreaming* StreamingLevel : World->GetStreamingLevels())
+		{
+			if (StreamingLevel)
+			{
+				LevelPackages.AddUnique(StreamingLevel->GetWorldAssetPackageName());
+			}
+		}
+
+		for (const FString& LevelPackage : LevelPackages)
+		{
+			if (!BakeLevelPackage(LevelPackage, FullBake))
+			{
+				++Failures;
+			}
+		}
+
+		CollectGarbage(RF_NoFlags);
+	}
+
+	return Failures == 0 ? 0 : 1;
+}
+
+bool ULedgeBakeCommandlet::BakeLevelPackage(const FString& InPackageName, bool InFullBake)
+{
+	UPackage* Package = LoadPackage(nullptr, *InPackageName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!(World))
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Can't load level %s."), *FString(__FUNCTION__), *InPackageName);
+		return false;
+	}
+
+	// Components have to be registered to get valid transforms and bounds
+	World->AddToRoot();
+	const bool NeedsInit = !World->bIsWorldInitialized;
+	if (NeedsInit)
+	{
+		World->WorldType = EWorldType::Editor;
+		World->InitWorld(UWorld::InitializationValues()
+			.ShouldSimulatePhysics(false)
+			.EnableTraceCollision(false)
+			.CreatePhysicsScene(false)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.AllowAudioPlayback(false));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	// Stored next to the level, the same way as its built data
+	const FString DataPackageName = InPackageName + TEXT("_LedgeData");
+	const FString DataName = FPackageName::GetShortName(DataPackageName);
+
+	UPackage* DataPackage = FPackageName::DoesPackageExist(DataPackageName)
+		? LoadPackage(nullptr, *DataPackageName, LOAD_None)
+		: CreatePackage(nullptr, *DataPackageName);
+
+	ULedgeBakeData* Data = FindObject<ULedgeBakeData>(DataPackage, *DataName);
+	if (!Data)
+	{
+		Data = NewObject<ULedgeBakeData>(DataPackage, *DataName, RF_Public | RF_Standalone);
+	}
+
+	ULevel* Level = World->PersistentLevel;
+	BakeLevel(Level, Data, InFullBake);
+
+	ALedgeDataActor* DataActor = nullptr;
+	for (AActor* Actor : Level->Actors)
+	{
+		DataActor = Cast<ALedgeDataActor>(Actor);
+		if (DataActor)
+		{
+			break;
+		}
+	}
+
+	bool LevelChanged = false;
+	if (!DataActor)
+	{
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.OverrideLevel = Level;
+		DataActor = World->SpawnActor<ALedgeDataActor>(SpawnParams);
+		LevelChanged = true;
+	}
+
+	if (DataActor->LedgeData != Data)
+	{
+		DataActor->LedgeData = Data;
+		LevelChanged = true;
+	}
+
+	bool Saved = UPackage::SavePackage(DataPackage, Data, RF_Standalone,
+		*FPackageName::LongPackageNameToFilename(DataPackageName, FPackageName::GetAssetPackageExtension()),
+		GError, nullptr, false, true, SAVE_NoError);
+
+	// The level itself is only touched the first time it's baked
+	if (Saved && LevelChanged)
+	{
+		Saved = UPackage::SavePackage(Package, World, RF_NoFlags,
+			*FPackageName::LongPackageNameToFilename(InPackageName, FPackageName::GetMapPackageExtension()),
+			GError, nullptr, false, true, SAVE_NoError);
+	}
+
+	if (NeedsInit)
+	{
+		World->CleanupWorld();
+	}
+	World->RemoveFromRoot();
+
+	if (!Saved)
+	{
+		UE_LOG(LogTemp, Error, TEXT("[%s] Failed to save the ledge data of %s."), *FString(__FUNCTION__), *InPackageName);
+	}
+
+	return Saved;
+}
+
+void ULedgeBakeCommandlet::BakeLevel(ULevel* InLevel, ULedgeBakeData* InData, bool InFullBake)
+{
+	TMap<FName, const FLedgeBakeActorRecord*> OldRecords;
+	if (!InFullBake)
+	{
+		for (const FLedgeBakeActorRecord& Record : InData->GetRecords())
+		{
+			OldRecords.Add(Record.ActorName, &Record);
+		}
+	}
+
+	TArray<AActor*> Actors;
+	for (AActor* Actor : InLevel->Actors)
+	{
+		if (Actor && !Actor->IsPendingKill() && !Actor->IsA<ALedgeDataActor>())
+		{
+			Actors.Add(Actor);
+		}
+	}
+
+	// Same output whatever order the level stores its actors in
+	Actors.Sort([](const AActor& A, const AActor& B) { return A.GetFName().LexicalLess(B.GetFName()); });
+
+	TArray<FLedgeBakeActorRecord> Records;
+	TArray<FQuantizedLedge> Ledges;
+	int32 NumBaked = 0;
+	int32 NumReused = 0;
+
+	TArray<UPrimitiveComponent*, TInlineAllocator<8>> Primitives;
+
+	for (AActor* Actor : Actors)
+	{
+		// Actors without a record are left to the ledge cache and the traces
+		GetLedgePrimitives(Actor, Primitives);
+		if (Primitives.Num() == 0 || !IsActorStatic(Actor))
+		{
+			continue;
+		}
+
+		FLedgeBakeActorRecord Record;
+		Record.ActorName = Actor->GetFName();
+		Record.FirstLedge = Ledges.Num();
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			Record.GeometryHash = HashCombine(Record.GeometryHash, HashPrimitive(Primitive));
+		}
+
+		const FLedgeBakeActorRecord* const* OldRecord = OldRecords.Find(Record.ActorName);
+		if (OldRecord && (*OldRecord)->GeometryHash == Record.GeometryHash)
+		{
+			const TArray<FQuantizedLedge>& OldLedges = InData->GetQuantizedLedges();
+			for (int32 i = 0; i < (*OldRecord)->NumLedges; ++i)
+			{
+				Ledges.Add(OldLedges[(*OldRecord)->FirstLedge + i]);
+			}
+
+			Record.NumLedges = (*OldRecord)->NumLedges;
+			Records.Add(Record);
+			++NumReused;
+			continue;
+		}
+
+		// Every primitive's top is grabbable, as for the traced hits
+		bool IsResolved = true;
+		for (const UPrimitiveComponent* Primitive : Primitives)
+		{
+			FLedgeShape Shape;
+			if (!FLedgeShape::FromPrimitive(Primitive, Shape))
+			{
+				// A rim the bake can't read would be shadowed by the others at runtime, the whole actor is traced instead
+				if (UClimbabilitySubsystem::IsPrimitiveClimbable(Primitive) && Primitive->IsCollisionEnabled() &&
+					Primitive->GetCollisionResponseToChannel(UClimbabilitySubsystem::GetTraceChannel()) == ECR_Block)
+				{
+					IsResolved = false;
+					break;
+				}
+				continue;
+			}
+
+			FQuantizedLedge Ledge;
+			if (!ULedgeBakeData::Quantize(Shape, Ledge))
+			{
+				UE_LOG(LogTemp, Warning, TEXT("[%s] A ledge of %s is too large to be baked."), *FString(__FUNCTION__), *Actor->GetName());
+				IsResolved = false;
+				break;
+			}
+
+			Ledges.Add(MoveTemp(Ledge));
+		}
+
+		if (!IsResolved)
+		{
+			Ledges.SetNum(Record.FirstLedge);
+			continue;
+		}
+
+		// Kept even without ledges, so the next bake can skip the actor
+		Record.NumLedges = Ledges.Num() - Record.FirstLedge;
+		Records.Add(Record);
+		++NumBaked;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("[%s] %s: %d actors baked, %d unchanged, %d ledges."),
+		*FString(__FUNCTION__), *InLevel->GetOutermost()->GetName(), NumBaked, NumReused, Ledges.Num());
+
+	InData->SetBakedData(MoveTemp(Records), MoveTemp(Ledges));
+}
@@ -0,0 +1,31 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "LedgeBakeCommandlet.generated.h"
+
+class ULevel;
+class ULedgeBakeData;
+
+/** Bakes the grabbable ledges of a map and its streaming levels into per-level ULedgeBakeData packages. Saves packages,
+	so it lives in the editor module.
+	Usage: -run=LedgeBake -Map=/Game/Maps/MyMap[,/Game/Maps/Other] [-Full] */
+UCLASS()
+class WALLCLIMBEDITOR_API ULedgeBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	ULedgeBakeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** Bakes a single level package, returns false on failure */
+	bool BakeLevelPackage(const FString& InPackageName, bool InFullBake);
+
+	/** Rebakes changed actors of the level into InData, reusing the ledges of the unchanged ones */
+	void BakeLevel(ULevel* InLevel, ULedgeBakeData* InData, bool InFullBake);
+};
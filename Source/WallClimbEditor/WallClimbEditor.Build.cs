@@ -0,0 +1,16 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+using UnrealBuildTool;
+
+public class WallClimbEditor : ModuleRules
+{
+	public WallClimbEditor(ReadOnlyTargetRules Target) : base(Target)
+	{
+		PCHUsage = PCHUsageMode.UseExplicitOrSharedPCHs;
+
+		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine" });
+
+		// The ledge bake saves packages, which only the editor can do
+		PrivateDependencyModuleNames.AddRange(new string[] { "WallClimb", "UnrealEd" });
+	}
+}